@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Emcraft Systems
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Convert an event trace dump to a Perfetto/Chrome trace.
+
+The input is one of:
+ - the raw binary dump, as written by the "event_trace vcom" shell command or downloaded from
+   the Memfault custom data recordings of a device,
+ - a console log that contains the output of the "event_trace dump" shell command.
+
+The output is a JSON file in the Chrome trace event format, which can be opened in
+https://ui.perfetto.dev or chrome://tracing. Each module gets a track with the events it
+handled, the time events spent in its queue, and one track for each state level.
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+from collections import defaultdict, deque
+
+MAGIC = 0x43525445
+VERSION = 1
+HEADER = struct.Struct('<IBBBxIII')
+RECORD = struct.Struct('<IBBBxI')
+NAME_LEN = 24
+NAME_NONE = 0xFF
+
+(BOOT, SUBMIT, ENQUEUE, DEQUEUE, RELEASE, DROP,
+ STATE, SUB_STATE, SUB_SUB_STATE) = range(9)
+
+STATE_LEVELS = {STATE: 'state', SUB_STATE: 'sub-state', SUB_SUB_STATE: 'sub-sub-state'}
+
+PID = 1
+EVENTS_TID = 1
+
+# Gap inserted into the timeline at a reboot, in microseconds. The cycle counter starts over at
+# boot, so the real time between the records before and after the reboot is unknown.
+BOOT_GAP_US = 1000
+
+
+def read_dump(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if len(data) >= 4 and struct.unpack_from('<I', data)[0] == MAGIC:
+        return data
+
+    # Console log, take the hex lines between the begin and end markers.
+    text = data.decode('utf-8', errors='replace')
+    match = re.search(r'event_trace begin(.*?)event_trace end', text, re.S)
+    if not match:
+        sys.exit(f'{path}: no event trace found')
+
+    hex_lines = []
+    for line in match.group(1).splitlines():
+        # Strip ANSI escape sequences that the shell adds to its output.
+        line = re.sub(r'\x1b\[[0-9;]*[A-Za-z]', '', line).strip()
+        if re.fullmatch(r'[0-9a-fA-F]+', line):
+            hex_lines.append(line)
+
+    return bytes.fromhex(''.join(hex_lines))
+
+
+def parse_dump(data):
+    if len(data) < HEADER.size:
+        sys.exit('Event trace dump is truncated')
+
+    (magic, version, record_size, name_count, cycles_per_sec, record_count,
+     overwritten) = HEADER.unpack_from(data)
+
+    if magic != MAGIC:
+        sys.exit('Not an event trace dump')
+    if version != VERSION:
+        sys.exit(f'Unsupported event trace version {version}')
+    if record_size != RECORD.size:
+        sys.exit(f'Unsupported record size {record_size}')
+
+    offset = HEADER.size
+    names = []
+    for i in range(name_count):
+        raw = data[offset + i * NAME_LEN:offset + (i + 1) * NAME_LEN]
+        names.append(raw.split(b'\0', 1)[0].decode('utf-8', errors='replace'))
+    offset += name_count * NAME_LEN
+
+    available = (len(data) - offset) // RECORD.size
+    if available < record_count:
+        print(f'warning: dump is truncated, {available} of {record_count} records',
+              file=sys.stderr)
+        record_count = available
+
+    records = [RECORD.unpack_from(data, offset + i * RECORD.size) for i in range(record_count)]
+
+    return cycles_per_sec, names, records, overwritten
+
+
+class Timeline:
+    def __init__(self, cycles_per_sec, names):
+        self.cycles_per_sec = cycles_per_sec
+        self.names = names
+        self.events = []
+        self.tids = {}
+        self.epoch_base_us = 0.0
+        self.last_us = 0.0
+        self.prev_cycles = None
+        self.wraps = 0
+        self.next_id = 1
+        # Per module: open handler slice, open state slices and queued events.
+        self.handling = {}
+        self.states = {}
+        self.queued = defaultdict(deque)
+
+    def name(self, index, default='?'):
+        if index == NAME_NONE:
+            return default
+        if index < len(self.names):
+            return self.names[index]
+        return f'#{index}'
+
+    def tid(self, track):
+        if track not in self.tids:
+            tid = len(self.tids) + EVENTS_TID + 1
+            self.tids[track] = tid
+            self.events.append({'ph': 'M', 'pid': PID, 'tid': tid, 'name': 'thread_name',
+                                'args': {'name': track}})
+            self.events.append({'ph': 'M', 'pid': PID, 'tid': tid,
+                                'name': 'thread_sort_index', 'args': {'sort_index': tid}})
+        return self.tids[track]
+
+    def timestamp(self, cycles):
+        if self.prev_cycles is not None and cycles < self.prev_cycles:
+            self.wraps += 1
+        self.prev_cycles = cycles
+
+        us = self.epoch_base_us + (self.wraps * 2**32 + cycles) * 1e6 / self.cycles_per_sec
+        self.last_us = max(self.last_us, us)
+        return us
+
+    def close_all(self, ts):
+        for module, event in self.handling.items():
+            if event:
+                self.events.append({'ph': 'E', 'pid': PID, 'tid': self.tid(module), 'ts': ts})
+        self.handling.clear()
+
+        for module, level in self.states:
+            self.events.append({'ph': 'E', 'pid': PID, 'tid': self.tid(f'{module} {level}'),
+                                'ts': ts})
+        self.states.clear()
+
+        for (module, event), queue in self.queued.items():
+            for name, event_id in queue:
+                self.events.append({'ph': 'e', 'pid': PID, 'tid': self.tid(module), 'ts': ts,
+                                    'cat': 'queue', 'name': name, 'id': event_id})
+        self.queued.clear()
+
+    def boot(self):
+        if self.prev_cycles is not None:
+            self.close_all(self.last_us)
+            self.epoch_base_us = self.last_us + BOOT_GAP_US
+        self.prev_cycles = None
+        self.wraps = 0
+
+        self.events.append({'ph': 'i', 'pid': PID, 'tid': EVENTS_TID, 's': 'g', 'name': 'boot',
+                            'ts': self.epoch_base_us})
+
+    def add(self, record):
+        cycles, rtype, module_index, event_index, arg = record
+
+        if rtype == BOOT:
+            self.boot()
+            return
+
+        ts = self.timestamp(cycles)
+        module = self.name(module_index)
+        event = f'{self.name(event_index)}:{arg}'
+
+        if rtype == SUBMIT:
+            self.events.append({'ph': 'i', 'pid': PID, 'tid': EVENTS_TID, 's': 't', 'ts': ts,
+                                'name': event})
+        elif rtype == ENQUEUE:
+            event_id = self.next_id
+            self.next_id += 1
+            self.queued[(module, event)].append((f'{module} queue', event_id))
+            self.events.append({'ph': 'b', 'pid': PID, 'tid': self.tid(module), 'ts': ts,
+                                'cat': 'queue', 'name': f'{module} queue', 'id': event_id,
+                                'args': {'event': event}})
+        elif rtype in (DEQUEUE, DROP):
+            # Events of the same type are queued in order, so the oldest one is dequeued.
+            queue = self.queued[(module, event)]
+            if queue:
+                name, event_id = queue.popleft()
+                self.events.append({'ph': 'e', 'pid': PID, 'tid': self.tid(module), 'ts': ts,
+                                    'cat': 'queue', 'name': name, 'id': event_id})
+            if rtype == DROP:
+                self.events.append({'ph': 'i', 'pid': PID, 'tid': self.tid(module), 's': 't',
+                                    'ts': ts, 'name': f'drop {event}'})
+            else:
+                if self.handling.get(module):
+                    self.events.append({'ph': 'E', 'pid': PID, 'tid': self.tid(module),
+                                        'ts': ts})
+                self.handling[module] = event
+                self.events.append({'ph': 'B', 'pid': PID, 'tid': self.tid(module), 'ts': ts,
+                                    'name': event})
+        elif rtype == RELEASE:
+            if self.handling.get(module):
+                self.events.append({'ph': 'E', 'pid': PID, 'tid': self.tid(module), 'ts': ts})
+                self.handling[module] = None
+        elif rtype in STATE_LEVELS:
+            level = STATE_LEVELS[rtype]
+            track = f'{module} {level}'
+            if (module, level) in self.states:
+                self.events.append({'ph': 'E', 'pid': PID, 'tid': self.tid(track), 'ts': ts})
+            self.states[(module, level)] = arg
+            self.events.append({'ph': 'B', 'pid': PID, 'tid': self.tid(track), 'ts': ts,
+                                'name': f'{level} {arg}'})
+        else:
+            print(f'warning: unknown record type {rtype}', file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='binary event trace dump or console log')
+    parser.add_argument('-o', '--output', default='event_trace.json',
+                        help='output file (default: %(default)s)')
+    args = parser.parse_args()
+
+    cycles_per_sec, names, records, overwritten = parse_dump(read_dump(args.input))
+
+    timeline = Timeline(cycles_per_sec, names)
+    timeline.events.append({'ph': 'M', 'pid': PID, 'name': 'process_name',
+                            'args': {'name': 'device'}})
+    timeline.events.append({'ph': 'M', 'pid': PID, 'tid': EVENTS_TID, 'name': 'thread_name',
+                            'args': {'name': 'submitted events'}})
+
+    for record in records:
+        timeline.add(record)
+
+    timeline.close_all(timeline.last_us)
+
+    with open(args.output, 'w') as f:
+        json.dump({'traceEvents': timeline.events, 'displayTimeUnit': 'ms',
+                   'otherData': {'cycles_per_sec': cycles_per_sec,
+                                 'overwritten_records': overwritten}}, f)
+
+    print(f'{len(records)} records ({overwritten} overwritten) written to {args.output}')
+
+
+if __name__ == '__main__':
+    main()
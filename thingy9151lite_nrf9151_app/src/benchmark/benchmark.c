@@ -0,0 +1,615 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* End-to-end benchmark of the application pipeline.
+ *
+ * Once the cloud module has connected to the in-process cloud stub, stimuli are submitted at
+ * the rates given by CONFIG_BENCHMARK_SCRIPT. A stimulus is one of:
+ *
+ *	button:   A UI module button press, sent by the data module right away.
+ *	sensor:   A data request for environmental data, as sent by the application module,
+ *		  answered by a sensor module reading. The reading completes the request.
+ *	location: A GNSS fix from the location module, which is sent by the data module right
+ *		  away when no data request is pending.
+ *
+ * Each stimulus carries a unique marker (BENCHMARK_MARKER_BASE + sequence number) in the button
+ * number, the temperature or the altitude. The markers are found in the encoded payloads when
+ * the stub transmits them, so that the latency from the event to the delivery of the message can
+ * be measured through the data module, the cloud module, the send scheduler and the cloud codec.
+ * After each phase, the benchmark waits for the messages to be delivered and prints one line
+ * prefixed with BENCHMARK_PREFIX with the following comma separated columns:
+ *
+ *	phase, stimulus, rate [Hz], stimuli, delivered, lost, duration [ms],
+ *	throughput [msg/s], p50, p90, p99 and maximum latency [us], peak heap usage [bytes],
+ *	module queue drops, messages, bytes and rejected sends on the stub, CPU time [us],
+ *	CPU time per delivered stimulus [us], total and maximum event handler CPU time [us].
+ *
+ * Code runs in zero simulated time on native_sim, so the latencies are caused by queueing,
+ * timers and the simulated link only. The kernel cycle counter does not advance while code
+ * runs either, CPU time is therefore read from the process CPU clock of the host. The event
+ * handler CPU time is measured around the listeners of each event, in the Application Event
+ * Manager hooks.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/sys/sys_heap.h>
+#include <app_event_manager.h>
+#include <date_time.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "modules_common.h"
+#include "benchmark_cpu_time_bottom.h"
+#include "cloud/cloud_stub.h"
+#include "events/app_module_event.h"
+#include "events/cloud_module_event.h"
+#include "events/location_module_event.h"
+#include "events/sensor_module_event.h"
+#include "events/ui_module_event.h"
+
+#define MODULE benchmark
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_BENCHMARK_LOG_LEVEL);
+
+#define BENCHMARK_PREFIX	"BENCHMARK:"
+#define BENCHMARK_MARKER_BASE	1000000
+#define BENCHMARK_PHASES_MAX	8
+#define STIMULI_MAX		CONFIG_BENCHMARK_STIMULI_MAX
+#define DRAIN_POLL_MS		100
+#define START_DELAY_MS		1000
+#define SENSOR_REQUEST_TIMEOUT_SEC 10
+
+BUILD_ASSERT(STIMULI_MAX < BENCHMARK_MARKER_BASE, "Markers must not overlap");
+
+/* The altitude is a float, the markers must be exactly representable. */
+BUILD_ASSERT((BENCHMARK_MARKER_BASE + STIMULI_MAX) < BIT(24), "Markers must fit in a float");
+
+enum stimulus {
+	STIMULUS_BUTTON,
+	STIMULUS_SENSOR,
+	STIMULUS_LOCATION,
+
+	STIMULUS_COUNT,
+};
+
+static const char *const stimulus_names[STIMULUS_COUNT] = {
+	[STIMULUS_BUTTON] = "button",
+	[STIMULUS_SENSOR] = "sensor",
+	[STIMULUS_LOCATION] = "location",
+};
+
+struct phase {
+	enum stimulus stimulus;
+	uint32_t rate_hz;
+	uint32_t count;
+	/* Sequence number of the first stimulus in the phase. */
+	uint32_t first;
+};
+
+static struct phase phases[BENCHMARK_PHASES_MAX];
+static size_t phase_count;
+static size_t phase_current;
+
+/* Sequence number of the next stimulus. */
+static uint32_t seq;
+
+/* Uptime when each stimulus was submitted and latency of each delivered stimulus [ticks]. */
+static int64_t submitted_at[STIMULI_MAX];
+static uint32_t latency[STIMULI_MAX];
+static ATOMIC_DEFINE(delivered_flags, STIMULI_MAX);
+
+/* Tag of the last message that each stimulus was found in, 0 if it has not been sent. */
+static uint32_t message_tag[STIMULI_MAX];
+static atomic_t message_count;
+
+/* Scratch buffer for sorting the latencies of a phase. */
+static uint32_t sorted[STIMULI_MAX];
+
+/* Phase state, accessed from the system workqueue only. */
+static int64_t phase_start;
+static int64_t phase_drain_deadline;
+static int64_t last_delivery;
+static uint32_t queue_drops_start;
+static struct cloud_stub_stats stub_start;
+static uint64_t cpu_start_ns;
+
+/* Event handler CPU time, updated by the Application Event Manager hooks. Events are processed
+ * in the system workqueue, as is the benchmark.
+ */
+static uint64_t handler_start_ns;
+static uint64_t handler_total_ns;
+static uint64_t handler_max_ns;
+
+/* The system heap that k_malloc() allocates from, NULL if it was not found. */
+static struct k_heap *system_heap;
+
+static bool started;
+
+static void benchmark_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(benchmark_work, benchmark_work_fn);
+
+static enum {
+	BENCHMARK_IDLE,
+	BENCHMARK_SUBMIT,
+	BENCHMARK_DRAIN,
+	BENCHMARK_DONE,
+} benchmark_state;
+
+/* Parse the stimulus name at the start of a string. Returns a pointer to the character after
+ * the name, or NULL if the name is unknown.
+ */
+static const char *stimulus_parse(const char *pos, enum stimulus *stimulus)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(stimulus_names); i++) {
+		size_t len = strlen(stimulus_names[i]);
+
+		if ((strncmp(pos, stimulus_names[i], len) == 0) &&
+		    ((pos[len] == ',') || (pos[len] == '\0'))) {
+			*stimulus = i;
+			return pos + len;
+		}
+	}
+
+	return NULL;
+}
+
+/* Parse the "rate:count[:stimulus],rate:count[:stimulus]" script into phases. */
+static int script_parse(const char *script)
+{
+	const char *pos = script;
+	uint32_t total = 0;
+
+	phase_count = 0;
+
+	while (*pos != '\0') {
+		char *end;
+		struct phase *phase;
+
+		if (phase_count == BENCHMARK_PHASES_MAX) {
+			return -E2BIG;
+		}
+
+		phase = &phases[phase_count];
+
+		phase->rate_hz = strtoul(pos, &end, 10);
+		if ((end == pos) || (*end != ':') || (phase->rate_hz == 0)) {
+			return -EINVAL;
+		}
+
+		pos = end + 1;
+		phase->count = strtoul(pos, &end, 10);
+		if (end == pos) {
+			return -EINVAL;
+		}
+
+		pos = end;
+		phase->stimulus = STIMULUS_BUTTON;
+
+		if (*pos == ':') {
+			pos = stimulus_parse(pos + 1, &phase->stimulus);
+			if (pos == NULL) {
+				return -EINVAL;
+			}
+		}
+
+		if ((*pos != ',') && (*pos != '\0')) {
+			return -EINVAL;
+		}
+
+		if ((total + phase->count) > STIMULI_MAX) {
+			return -E2BIG;
+		}
+
+		phase->first = total;
+		total += phase->count;
+		phase_count++;
+
+		pos = (*pos == ',') ? pos + 1 : pos;
+	}
+
+	return (phase_count > 0) ? 0 : -EINVAL;
+}
+
+/* Record the message tag of every benchmark marker in an encoded payload. A message can carry
+ * several stimuli, for example a batch of sensor readings. The buffer is not NULL terminated.
+ * Returns the number of markers found.
+ */
+static size_t markers_tag(const char *buf, size_t len, uint32_t tag)
+{
+	size_t found = 0;
+	size_t i = 0;
+
+	while (i < len) {
+		uint64_t value = 0;
+		size_t digits = 0;
+
+		while ((i < len) && (buf[i] >= '0') && (buf[i] <= '9') && (digits < 20)) {
+			value = (value * 10) + (buf[i] - '0');
+			digits++;
+			i++;
+		}
+
+		if ((value >= BENCHMARK_MARKER_BASE) && (value < (BENCHMARK_MARKER_BASE + seq))) {
+			message_tag[value - BENCHMARK_MARKER_BASE] = tag;
+			found++;
+		}
+
+		if (digits == 0) {
+			i++;
+		}
+	}
+
+	return found;
+}
+
+static uint32_t stub_sent(enum cloud_stub_topic topic, const char *buf, size_t len)
+{
+	/* Tag 0 is reserved for messages without markers. */
+	uint32_t tag = (uint32_t)atomic_inc(&message_count) + 1;
+
+	ARG_UNUSED(topic);
+
+	if ((buf == NULL) || (tag == 0)) {
+		return 0;
+	}
+
+	return (markers_tag(buf, len, tag) > 0) ? tag : 0;
+}
+
+static void stub_delivered(enum cloud_stub_topic topic, uint32_t tag, size_t len)
+{
+	int64_t now = k_uptime_ticks();
+
+	ARG_UNUSED(topic);
+	ARG_UNUSED(len);
+
+	if (tag == 0) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < seq; i++) {
+		if ((message_tag[i] == tag) && !atomic_test_and_set_bit(delivered_flags, i)) {
+			latency[i] = (uint32_t)(now - submitted_at[i]);
+			last_delivery = now;
+		}
+	}
+}
+
+static const struct cloud_stub_cb stub_cb = {
+	.sent = stub_sent,
+	.delivered = stub_delivered,
+};
+
+static int latency_compare(const void *a, const void *b)
+{
+	uint32_t lhs = *(const uint32_t *)a;
+	uint32_t rhs = *(const uint32_t *)b;
+
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+/* Nearest-rank percentile of a sorted array, in microseconds. */
+static uint32_t percentile_us(const uint32_t *values, size_t count, uint32_t percent)
+{
+	size_t rank;
+
+	if (count == 0) {
+		return 0;
+	}
+
+	rank = ((count * percent) + 99) / 100;
+	rank = CLAMP(rank, 1, count);
+
+	return (uint32_t)k_ticks_to_us_floor64(values[rank - 1]);
+}
+
+static size_t phase_delivered_get(const struct phase *phase)
+{
+	size_t count = 0;
+
+	for (uint32_t i = phase->first; i < (phase->first + phase->count); i++) {
+		if (atomic_test_bit(delivered_flags, i)) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/* The system heap is not exposed by the kernel. It is found as the heap that holds a block
+ * allocated with k_malloc().
+ */
+static struct k_heap *system_heap_find(void)
+{
+	struct k_heap *found = NULL;
+	uint8_t *mem = k_malloc(1);
+
+	if (mem == NULL) {
+		return NULL;
+	}
+
+	STRUCT_SECTION_FOREACH(k_heap, heap) {
+		uint8_t *start = heap->heap.init_mem;
+
+		if ((mem >= start) && (mem < (start + heap->heap.init_bytes))) {
+			found = heap;
+			break;
+		}
+	}
+
+	k_free(mem);
+
+	return found;
+}
+
+static void phase_begin(void)
+{
+	phase_start = k_uptime_ticks();
+	last_delivery = phase_start;
+	queue_drops_start = module_queue_drop_count_get();
+	cloud_stub_stats_get(&stub_start);
+
+	if (system_heap) {
+		(void)sys_heap_runtime_stats_reset_max(&system_heap->heap);
+	}
+
+	cpu_start_ns = benchmark_cpu_time_ns_bottom();
+	handler_total_ns = 0;
+	handler_max_ns = 0;
+
+	LOG_INF("Phase %zu: %u %s stimuli at %u Hz", phase_current, phases[phase_current].count,
+		stimulus_names[phases[phase_current].stimulus], phases[phase_current].rate_hz);
+}
+
+static void phase_report(void)
+{
+	const struct phase *phase = &phases[phase_current];
+	struct sys_memory_stats heap = { 0 };
+	struct cloud_stub_stats stub;
+	size_t delivered = 0;
+	uint32_t duration_ms = (uint32_t)k_ticks_to_ms_floor64(last_delivery - phase_start);
+	uint32_t cpu_us = (uint32_t)((benchmark_cpu_time_ns_bottom() - cpu_start_ns) /
+				     NSEC_PER_USEC);
+	uint32_t throughput_centi;
+
+	for (uint32_t i = phase->first; i < (phase->first + phase->count); i++) {
+		if (atomic_test_bit(delivered_flags, i)) {
+			sorted[delivered++] = latency[i];
+		}
+	}
+
+	qsort(sorted, delivered, sizeof(sorted[0]), latency_compare);
+
+	throughput_centi = duration_ms ? (uint32_t)((delivered * 100000ULL) / duration_ms) : 0;
+
+	if (system_heap) {
+		(void)sys_heap_runtime_stats_get(&system_heap->heap, &heap);
+	}
+
+	cloud_stub_stats_get(&stub);
+
+	printk("%s%zu,%s,%u,%u,%zu,%zu,%u,%u.%02u,%u,%u,%u,%u,%zu,%u,%u,%u,%u,%u,%u,%u,%u\n",
+	       BENCHMARK_PREFIX, phase_current, stimulus_names[phase->stimulus], phase->rate_hz,
+	       phase->count, delivered, phase->count - delivered,
+	       duration_ms, throughput_centi / 100, throughput_centi % 100,
+	       percentile_us(sorted, delivered, 50), percentile_us(sorted, delivered, 90),
+	       percentile_us(sorted, delivered, 99), percentile_us(sorted, delivered, 100),
+	       heap.max_allocated_bytes, module_queue_drop_count_get() - queue_drops_start,
+	       stub.messages - stub_start.messages, stub.bytes - stub_start.bytes,
+	       stub.rejected - stub_start.rejected, cpu_us,
+	       delivered ? (uint32_t)(cpu_us / delivered) : 0,
+	       (uint32_t)(handler_total_ns / NSEC_PER_USEC),
+	       (uint32_t)(handler_max_ns / NSEC_PER_USEC));
+}
+
+static void button_submit(uint32_t marker)
+{
+	struct ui_module_event *ui_module_event = new_ui_module_event();
+
+	__ASSERT(ui_module_event, "Not enough heap left to allocate event");
+
+	ui_module_event->type = UI_EVT_BUTTON_DATA_READY;
+	ui_module_event->data.ui.button_number = marker;
+	ui_module_event->data.ui.timestamp = k_uptime_get();
+
+	APP_EVENT_SUBMIT(ui_module_event);
+}
+
+static void sensor_submit(uint32_t marker)
+{
+	struct app_module_event *app_module_event = new_app_module_event();
+	struct sensor_module_event *sensor_module_event;
+
+	__ASSERT(app_module_event, "Not enough heap left to allocate event");
+
+	app_module_event->type = APP_EVT_DATA_GET;
+	app_module_event->data_list[0] = APP_DATA_ENVIRONMENTAL;
+	app_module_event->count = 1;
+	app_module_event->timeout = SENSOR_REQUEST_TIMEOUT_SEC;
+
+	APP_EVENT_SUBMIT(app_module_event);
+
+	sensor_module_event = new_sensor_module_event();
+
+	__ASSERT(sensor_module_event, "Not enough heap left to allocate event");
+
+	sensor_module_event->type = SENSOR_EVT_ENVIRONMENTAL_DATA_READY;
+	sensor_module_event->data.sensors.temperature = marker;
+	sensor_module_event->data.sensors.humidity = 48.5;
+	sensor_module_event->data.sensors.pressure = 101.3;
+	sensor_module_event->data.sensors.bsec_air_quality = 50;
+	sensor_module_event->data.sensors.timestamp = k_uptime_get();
+
+	APP_EVENT_SUBMIT(sensor_module_event);
+}
+
+static void location_submit(uint32_t marker)
+{
+	struct location_module_event *location_module_event = new_location_module_event();
+
+	__ASSERT(location_module_event, "Not enough heap left to allocate event");
+
+	location_module_event->type = LOCATION_MODULE_EVT_GNSS_DATA_READY;
+	location_module_event->data.location.pvt.latitude = 63.431;
+	location_module_event->data.location.pvt.longitude = 10.417;
+	location_module_event->data.location.pvt.altitude = marker;
+	location_module_event->data.location.pvt.accuracy = 4.5;
+	location_module_event->data.location.satellites_tracked = 8;
+	location_module_event->data.location.timestamp = k_uptime_get();
+
+	APP_EVENT_SUBMIT(location_module_event);
+}
+
+static void stimulus_submit(enum stimulus stimulus)
+{
+	uint32_t marker = BENCHMARK_MARKER_BASE + seq;
+
+	submitted_at[seq] = k_uptime_ticks();
+	seq++;
+
+	switch (stimulus) {
+	case STIMULUS_BUTTON:
+		button_submit(marker);
+		break;
+	case STIMULUS_SENSOR:
+		sensor_submit(marker);
+		break;
+	case STIMULUS_LOCATION:
+		location_submit(marker);
+		break;
+	default:
+		break;
+	}
+}
+
+static void benchmark_work_fn(struct k_work *work)
+{
+	const struct phase *phase = &phases[phase_current];
+	uint32_t sent;
+
+	switch (benchmark_state) {
+	case BENCHMARK_SUBMIT:
+		stimulus_submit(phase->stimulus);
+
+		sent = seq - phase->first;
+		if (sent < phase->count) {
+			/* Stimuli are scheduled relative to the start of the phase so that the
+			 * rate does not drift with the time spent submitting them.
+			 */
+			int64_t next = k_ticks_to_ms_floor64(phase_start) +
+				       (((int64_t)sent * MSEC_PER_SEC) / phase->rate_hz);
+
+			(void)k_work_schedule(&benchmark_work, K_TIMEOUT_ABS_MS(next));
+			break;
+		}
+
+		benchmark_state = BENCHMARK_DRAIN;
+		phase_drain_deadline = k_uptime_get() +
+				       (CONFIG_BENCHMARK_DRAIN_TIMEOUT_SEC * MSEC_PER_SEC);
+		(void)k_work_schedule(&benchmark_work, K_MSEC(DRAIN_POLL_MS));
+		break;
+	case BENCHMARK_DRAIN:
+		if ((phase_delivered_get(phase) < phase->count) &&
+		    (k_uptime_get() < phase_drain_deadline)) {
+			(void)k_work_schedule(&benchmark_work, K_MSEC(DRAIN_POLL_MS));
+			break;
+		}
+
+		phase_report();
+		phase_current++;
+
+		if (phase_current == phase_count) {
+			benchmark_state = BENCHMARK_DONE;
+			printk("%sdone\n", BENCHMARK_PREFIX);
+			break;
+		}
+
+		benchmark_state = BENCHMARK_SUBMIT;
+		phase_begin();
+		(void)k_work_schedule(&benchmark_work, K_NO_WAIT);
+		break;
+	case BENCHMARK_IDLE: {
+		int err = script_parse(CONFIG_BENCHMARK_SCRIPT);
+
+		if (err) {
+			LOG_ERR("Invalid benchmark script, error: %d", err);
+			benchmark_state = BENCHMARK_DONE;
+			break;
+		}
+
+		/* Data is only sent to cloud with a valid time. There is no network time on
+		 * native_sim.
+		 */
+		if (!date_time_is_valid()) {
+			struct tm date = {
+				.tm_year = 124,
+				.tm_mday = 1,
+			};
+
+			err = date_time_set(&date);
+			if (err) {
+				LOG_ERR("date_time_set, error: %d", err);
+			}
+		}
+
+		system_heap = system_heap_find();
+		if (system_heap == NULL) {
+			LOG_WRN("System heap not found, heap usage is not reported");
+		}
+
+		cloud_stub_cb_set(&stub_cb);
+
+		benchmark_state = BENCHMARK_SUBMIT;
+		phase_begin();
+		(void)k_work_schedule(&benchmark_work, K_NO_WAIT);
+		break;
+	}
+	case BENCHMARK_DONE:
+		break;
+	}
+}
+
+static void event_preprocess(const struct app_event_header *aeh)
+{
+	ARG_UNUSED(aeh);
+
+	handler_start_ns = benchmark_cpu_time_ns_bottom();
+}
+
+static void event_postprocess(const struct app_event_header *aeh)
+{
+	uint64_t time_ns = benchmark_cpu_time_ns_bottom() - handler_start_ns;
+
+	ARG_UNUSED(aeh);
+
+	handler_total_ns += time_ns;
+	handler_max_ns = MAX(handler_max_ns, time_ns);
+}
+
+APP_EVENT_HOOK_PREPROCESS_REGISTER_LAST(event_preprocess);
+APP_EVENT_HOOK_POSTPROCESS_REGISTER_FIRST(event_postprocess);
+
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+	if (is_cloud_module_event(aeh)) {
+		struct cloud_module_event *event = cast_cloud_module_event(aeh);
+
+		if ((event->type == CLOUD_EVT_CONNECTED) && !started) {
+			started = true;
+
+			/* Let the modules send their initial messages before the first phase. */
+			(void)k_work_schedule(&benchmark_work, K_MSEC(START_DELAY_MS));
+		}
+	}
+
+	return false;
+}
+
+APP_EVENT_LISTENER(MODULE, app_event_handler);
+APP_EVENT_SUBSCRIBE(MODULE, cloud_module_event);
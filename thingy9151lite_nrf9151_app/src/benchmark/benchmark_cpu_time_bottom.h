@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef BENCHMARK_CPU_TIME_BOTTOM_H__
+#define BENCHMARK_CPU_TIME_BOTTOM_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Host side of the benchmark, built with the host C library on native_sim.
+ * Only one Zephyr thread runs at a time, so the process CPU time of the host advances only while
+ * Zephyr code runs.
+ */
+
+/**
+ * @brief Get the CPU time consumed by the native_sim process.
+ *
+ * @return CPU time in nanoseconds, or 0 if the host clock could not be read.
+ */
+uint64_t benchmark_cpu_time_ns_bottom(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCHMARK_CPU_TIME_BOTTOM_H__ */
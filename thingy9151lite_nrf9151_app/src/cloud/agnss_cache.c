@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
+#include <date_time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nrf_cloud_agnss_schema_v1.h>
+
+#include "agnss_cache.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(agnss_cache, CONFIG_CLOUD_MODULE_LOG_LEVEL);
+
+#define CACHE_SETTINGS_KEY	"agnss_cache"
+#define CACHE_KEY_DATA		"data"
+#define CACHE_KEY_VALID_UNTIL	"valid_until"
+#define CACHE_KEY_LEN_MAX	sizeof(CACHE_SETTINGS_KEY "/255/" CACHE_KEY_VALID_UNTIL)
+
+/* Number of GPS satellites. */
+#define SV_COUNT		32
+
+/* The nRF Cloud A-GNSS binary format starts with the schema version. */
+#define SCHEMA_VERSION_SIZE	1
+
+/* Element header in the nRF Cloud A-GNSS binary format: element type, followed by the number
+ * of elements of that type in little endian.
+ */
+#define ELEMENT_HEADER_SIZE	3
+
+/* GPS time starts at 1980-01-06 00:00:00 UTC and is ahead of UTC by the leap seconds
+ * inserted since then.
+ */
+#define GPS_EPOCH_UNIX_S	315964800LL
+#define GPS_LEAP_SECONDS	18
+#define GPS_WEEK_S		604800LL
+
+/* Almanac and UTC parameter week numbers are transmitted modulo 256 weeks. */
+#define GPS_WEEK_NUMBER_PERIOD_S	(256 * GPS_WEEK_S)
+
+/* Scale factors of the reference times, in seconds. */
+#define EPHEMERIS_TOE_SCALE_S	16
+#define ALMANAC_TOA_SCALE_S	4096
+#define UTC_TOT_SCALE_S		4096
+
+#define EPHEMERIS_VALIDITY_MS	(CONFIG_CLOUD_AGNSS_CACHE_EPHEMERIS_VALIDITY_MIN * 60 * 1000LL)
+#define ALMANAC_VALIDITY_MS	(CONFIG_CLOUD_AGNSS_CACHE_ALMANAC_VALIDITY_HOURS * 3600 * 1000LL)
+#define IONO_UTC_VALIDITY_MS	(CONFIG_CLOUD_AGNSS_CACHE_IONO_UTC_VALIDITY_HOURS * 3600 * 1000LL)
+
+static struct nrf_cloud_agnss_utc utc;
+static struct nrf_cloud_agnss_ephemeris ephemerides[SV_COUNT];
+static struct nrf_cloud_agnss_almanac almanacs[SV_COUNT];
+static struct nrf_cloud_agnss_klobuchar klobuchar;
+static struct nrf_cloud_agnss_nequick nequick;
+
+static int64_t utc_valid_until;
+static int64_t ephemerides_valid_until[SV_COUNT];
+static int64_t almanacs_valid_until[SV_COUNT];
+static int64_t klobuchar_valid_until;
+static int64_t nequick_valid_until;
+
+/* Cached element type. */
+struct element_type {
+	uint8_t type;
+	/* Size of an element. */
+	size_t size;
+	/* Number of elements, one per satellite or a single element. */
+	size_t count;
+	/* Time an element is valid after its reference time [ms]. */
+	int64_t validity_ms;
+	/* Get the UNIX time [ms] an element refers to, NULL if the element carries no reference
+	 * time and is valid from when it was received.
+	 */
+	int64_t (*reference_time_get)(const uint8_t *element, int64_t now);
+	/* Request flag of the data, 0 for satellite specific data. */
+	uint32_t request_flag;
+	void *data;
+	int64_t *valid_until;
+};
+
+/* Resolve a GPS time, known modulo the given period, to the UNIX time [ms] closest to now. */
+static int64_t gps_time_resolve(int64_t time_s, int64_t period_s, int64_t now)
+{
+	int64_t gps_now_s = (now / MSEC_PER_SEC) - GPS_EPOCH_UNIX_S + GPS_LEAP_SECONDS;
+	int64_t diff_s = time_s - (gps_now_s % period_s);
+
+	if (diff_s > (period_s / 2)) {
+		diff_s -= period_s;
+	} else if (diff_s < -(period_s / 2)) {
+		diff_s += period_s;
+	}
+
+	return now + (diff_s * MSEC_PER_SEC);
+}
+
+static int64_t utc_reference_time_get(const uint8_t *element, int64_t now)
+{
+	const struct nrf_cloud_agnss_utc *data = (const struct nrf_cloud_agnss_utc *)element;
+
+	return gps_time_resolve((data->wn_t * GPS_WEEK_S) + (data->tot * UTC_TOT_SCALE_S),
+				GPS_WEEK_NUMBER_PERIOD_S, now);
+}
+
+static int64_t ephemeris_reference_time_get(const uint8_t *element, int64_t now)
+{
+	const struct nrf_cloud_agnss_ephemeris *data =
+		(const struct nrf_cloud_agnss_ephemeris *)element;
+
+	return gps_time_resolve(data->toe * EPHEMERIS_TOE_SCALE_S, GPS_WEEK_S, now);
+}
+
+static int64_t almanac_reference_time_get(const uint8_t *element, int64_t now)
+{
+	const struct nrf_cloud_agnss_almanac *data =
+		(const struct nrf_cloud_agnss_almanac *)element;
+
+	return gps_time_resolve((data->wn * GPS_WEEK_S) + (data->toa * ALMANAC_TOA_SCALE_S),
+				GPS_WEEK_NUMBER_PERIOD_S, now);
+}
+
+static const struct element_type element_types[] = {
+	{
+		.type = NRF_CLOUD_AGNSS_UTC_PARAMETERS,
+		.size = sizeof(utc),
+		.count = 1,
+		.validity_ms = IONO_UTC_VALIDITY_MS,
+		.reference_time_get = utc_reference_time_get,
+		.request_flag = NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST,
+		.data = &utc,
+		.valid_until = &utc_valid_until,
+	},
+	{
+		.type = NRF_CLOUD_AGNSS_EPHEMERIDES,
+		.size = sizeof(ephemerides[0]),
+		.count = SV_COUNT,
+		.validity_ms = EPHEMERIS_VALIDITY_MS,
+		.reference_time_get = ephemeris_reference_time_get,
+		.data = ephemerides,
+		.valid_until = ephemerides_valid_until,
+	},
+	{
+		.type = NRF_CLOUD_AGNSS_ALMANAC,
+		.size = sizeof(almanacs[0]),
+		.count = SV_COUNT,
+		.validity_ms = ALMANAC_VALIDITY_MS,
+		.reference_time_get = almanac_reference_time_get,
+		.data = almanacs,
+		.valid_until = almanacs_valid_until,
+	},
+	{
+		.type = NRF_CLOUD_AGNSS_KLOBUCHAR_CORRECTION,
+		.size = sizeof(klobuchar),
+		.count = 1,
+		.validity_ms = IONO_UTC_VALIDITY_MS,
+		.request_flag = NRF_MODEM_GNSS_AGNSS_KLOBUCHAR_REQUEST,
+		.data = &klobuchar,
+		.valid_until = &klobuchar_valid_until,
+	},
+	{
+		.type = NRF_CLOUD_AGNSS_NEQUICK_CORRECTION,
+		.size = sizeof(nequick),
+		.count = 1,
+		.validity_ms = IONO_UTC_VALIDITY_MS,
+		.request_flag = NRF_MODEM_GNSS_AGNSS_NEQUICK_REQUEST,
+		.data = &nequick,
+		.valid_until = &nequick_valid_until,
+	},
+};
+
+static struct agnss_cache_stats stats;
+
+static int settings_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg);
+
+SETTINGS_STATIC_HANDLER_DEFINE(agnss_cache, CACHE_SETTINGS_KEY, NULL, settings_set, NULL, NULL);
+
+static const struct element_type *element_type_get(uint8_t type)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(element_types); i++) {
+		if (element_types[i].type == type) {
+			return &element_types[i];
+		}
+	}
+
+	return NULL;
+}
+
+static uint8_t *element_get(const struct element_type *et, size_t index)
+{
+	return (uint8_t *)et->data + (index * et->size);
+}
+
+static void key_get(char *key, const struct element_type *et, const char *name)
+{
+	(void)snprintf(key, CACHE_KEY_LEN_MAX, CACHE_SETTINGS_KEY "/%u/%s", et->type, name);
+}
+
+static int64_t element_valid_until_get(const struct element_type *et, const uint8_t *element,
+				       int64_t now)
+{
+	int64_t reference_time = now;
+
+	if (et->reference_time_get) {
+		reference_time = et->reference_time_get(element, now);
+	}
+
+	return reference_time + et->validity_ms;
+}
+
+/* Get the satellite mask in a request that covers the elements of a type, NULL if the request
+ * does not include GPS data or the data is not satellite specific.
+ */
+static uint64_t *sv_mask_get(const struct element_type *et,
+			     struct nrf_modem_gnss_agnss_data_frame *request)
+{
+	for (size_t i = 0; i < request->system_count; i++) {
+		if (request->system[i].system_id != NRF_MODEM_GNSS_SYSTEM_GPS) {
+			continue;
+		}
+
+		if (et->type == NRF_CLOUD_AGNSS_EPHEMERIDES) {
+			return &request->system[i].sv_mask_ephe;
+		} else if (et->type == NRF_CLOUD_AGNSS_ALMANAC) {
+			return &request->system[i].sv_mask_alm;
+		}
+	}
+
+	return NULL;
+}
+
+static bool element_requested(const struct element_type *et, size_t index,
+			      struct nrf_modem_gnss_agnss_data_frame *request)
+{
+	uint64_t *sv_mask;
+
+	if (et->request_flag) {
+		return request->data_flags & et->request_flag;
+	}
+
+	sv_mask = sv_mask_get(et, request);
+
+	return sv_mask && (*sv_mask & BIT64(index));
+}
+
+static void element_request_clear(const struct element_type *et, size_t index,
+				  struct nrf_modem_gnss_agnss_data_frame *request)
+{
+	uint64_t *sv_mask;
+
+	if (et->request_flag) {
+		request->data_flags &= ~et->request_flag;
+		return;
+	}
+
+	sv_mask = sv_mask_get(et, request);
+	if (sv_mask) {
+		*sv_mask &= ~BIT64(index);
+	}
+}
+
+/* Save all elements of a type, the data followed by the validity times. If only the data is
+ * saved, the new elements are loaded with the validity times of the elements they replaced,
+ * which are never later than their own.
+ */
+static int type_save(const struct element_type *et)
+{
+	char key[CACHE_KEY_LEN_MAX];
+	int err;
+
+	key_get(key, et, CACHE_KEY_DATA);
+
+	err = settings_save_one(key, et->data, et->count * et->size);
+	if (err) {
+		return err;
+	}
+
+	key_get(key, et, CACHE_KEY_VALID_UNTIL);
+
+	return settings_save_one(key, et->valid_until, et->count * sizeof(et->valid_until[0]));
+}
+
+static int settings_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	const struct element_type *et;
+	const char *next;
+	char *end;
+	long type;
+	void *value;
+	size_t value_len = 0;
+	ssize_t read;
+
+	type = strtol(key, &end, 10);
+	if ((end == key) || (settings_name_next(key, &next) == 0) || (next == NULL)) {
+		return -ENOENT;
+	}
+
+	et = element_type_get(type);
+	if (et == NULL) {
+		value = NULL;
+	} else if (strcmp(next, CACHE_KEY_DATA) == 0) {
+		value = et->data;
+		value_len = et->count * et->size;
+	} else if (strcmp(next, CACHE_KEY_VALID_UNTIL) == 0) {
+		value = et->valid_until;
+		value_len = et->count * sizeof(et->valid_until[0]);
+	} else {
+		value = NULL;
+	}
+
+	if ((value == NULL) || (len != value_len)) {
+		/* Left behind by a different version of the cache, ignored. */
+		LOG_DBG("Unknown cache entry: %s", key);
+		return 0;
+	}
+
+	read = read_cb(cb_arg, value, len);
+	if (read < 0) {
+		LOG_ERR("Failed to load cache entry %s, error: %d", key, (int)read);
+		return read;
+	}
+
+	return 0;
+}
+
+int agnss_cache_init(void)
+{
+	int err;
+
+	for (size_t i = 0; i < ARRAY_SIZE(element_types); i++) {
+		memset(element_types[i].valid_until, 0,
+		       element_types[i].count * sizeof(element_types[i].valid_until[0]));
+	}
+
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("settings_subsys_init, error: %d", err);
+		return err;
+	}
+
+	err = settings_load_subtree(CACHE_SETTINGS_KEY);
+	if (err) {
+		LOG_ERR("settings_load_subtree, error: %d", err);
+		return err;
+	}
+
+	return 0;
+}
+
+int agnss_cache_store(const uint8_t *buf, size_t len)
+{
+	bool changed[ARRAY_SIZE(element_types)] = { 0 };
+	int64_t now;
+	size_t pos = SCHEMA_VERSION_SIZE;
+	int stored = 0;
+	int err;
+
+	if ((buf == NULL) || (len <= SCHEMA_VERSION_SIZE) ||
+	    (buf[0] != NRF_CLOUD_AGNSS_BIN_SCHEMA_VERSION)) {
+		return -EINVAL;
+	}
+
+	if (date_time_now(&now)) {
+		return -ENODATA;
+	}
+
+	while (pos + ELEMENT_HEADER_SIZE <= len) {
+		uint8_t type = buf[pos];
+		uint16_t count = sys_get_le16(&buf[pos + 1]);
+		const struct element_type *et = element_type_get(type);
+
+		pos += ELEMENT_HEADER_SIZE;
+
+		if (et == NULL) {
+			LOG_DBG("Element type %d is not cached, remaining elements ignored", type);
+			break;
+		}
+
+		if ((count * et->size) > (len - pos)) {
+			LOG_WRN("Truncated A-GNSS element, type: %d", type);
+			break;
+		}
+
+		for (size_t i = 0; i < count; i++, pos += et->size) {
+			/* Satellite specific elements start with the satellite ID. */
+			size_t index = (et->count > 1) ? (buf[pos] - 1) : 0;
+
+			int64_t valid_until;
+
+			if (index >= et->count) {
+				continue;
+			}
+
+			/* Keep the cached element if it is valid for as long, an element that is
+			 * downloaded again is not written to flash again.
+			 */
+			valid_until = element_valid_until_get(et, &buf[pos], now);
+			if ((valid_until <= now) || (valid_until <= et->valid_until[index])) {
+				continue;
+			}
+
+			memcpy(element_get(et, index), &buf[pos], et->size);
+			et->valid_until[index] = valid_until;
+
+			changed[et - element_types] = true;
+			stored++;
+		}
+	}
+
+	/* The elements of a type are written at once, instead of one write per satellite. */
+	for (size_t i = 0; i < ARRAY_SIZE(element_types); i++) {
+		if (!changed[i]) {
+			continue;
+		}
+
+		err = type_save(&element_types[i]);
+		if (err) {
+			/* The elements are still cached until reboot. */
+			LOG_WRN("Failed to store A-GNSS elements, type: %d, error: %d",
+				element_types[i].type, err);
+		}
+	}
+
+	LOG_DBG("%d A-GNSS elements cached", stored);
+
+	return stored;
+}
+
+int agnss_cache_lookup(struct nrf_modem_gnss_agnss_data_frame *request, uint8_t **buf,
+		       size_t *len)
+{
+	size_t found[ARRAY_SIZE(element_types)] = { 0 };
+	size_t size = SCHEMA_VERSION_SIZE;
+	int elements = 0;
+	size_t pos;
+	int64_t now;
+
+	*buf = NULL;
+	*len = 0;
+
+	if (date_time_now(&now)) {
+		LOG_DBG("Date and time not known, cache not used");
+		stats.misses++;
+		return 0;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(element_types); i++) {
+		const struct element_type *et = &element_types[i];
+
+		for (size_t index = 0; index < et->count; index++) {
+			if ((et->valid_until[index] > now) &&
+			    element_requested(et, index, request)) {
+				found[i]++;
+			}
+		}
+
+		if (found[i] > 0) {
+			size += ELEMENT_HEADER_SIZE + (found[i] * et->size);
+			elements += found[i];
+		}
+	}
+
+	if (elements == 0) {
+		stats.misses++;
+		LOG_DBG("A-GNSS cache miss, %u hits, %u partial hits, %u misses", stats.hits,
+			stats.partial_hits, stats.misses);
+		return 0;
+	}
+
+	*buf = k_malloc(size);
+	if (*buf == NULL) {
+		return -ENOMEM;
+	}
+
+	(*buf)[0] = NRF_CLOUD_AGNSS_BIN_SCHEMA_VERSION;
+	pos = SCHEMA_VERSION_SIZE;
+
+	for (size_t i = 0; i < ARRAY_SIZE(element_types); i++) {
+		const struct element_type *et = &element_types[i];
+
+		if (found[i] == 0) {
+			continue;
+		}
+
+		(*buf)[pos] = et->type;
+		sys_put_le16(found[i], &(*buf)[pos + 1]);
+		pos += ELEMENT_HEADER_SIZE;
+
+		for (size_t index = 0; index < et->count; index++) {
+			if ((et->valid_until[index] <= now) ||
+			    !element_requested(et, index, request)) {
+				continue;
+			}
+
+			memcpy(&(*buf)[pos], element_get(et, index), et->size);
+			pos += et->size;
+
+			element_request_clear(et, index, request);
+		}
+	}
+
+	*len = size;
+
+	if (agnss_cache_request_empty(request)) {
+		stats.hits++;
+	} else {
+		stats.partial_hits++;
+	}
+
+	stats.elements_served += elements;
+	stats.bytes_served += size;
+
+	LOG_DBG("%d A-GNSS elements found in cache, %u hits, %u partial hits, %u misses",
+		elements, stats.hits, stats.partial_hits, stats.misses);
+
+	return 0;
+}
+
+bool agnss_cache_request_empty(const struct nrf_modem_gnss_agnss_data_frame *request)
+{
+	if (request->data_flags) {
+		return false;
+	}
+
+	for (size_t i = 0; i < request->system_count; i++) {
+		if (request->system[i].sv_mask_ephe || request->system[i].sv_mask_alm) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void agnss_cache_stats_get(struct agnss_cache_stats *out)
+{
+	*out = stats;
+}
+
+int agnss_cache_clear(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(element_types); i++) {
+		const struct element_type *et = &element_types[i];
+		bool cached = false;
+		char key[CACHE_KEY_LEN_MAX];
+		int err;
+
+		for (size_t index = 0; index < et->count; index++) {
+			cached |= (et->valid_until[index] != 0);
+			et->valid_until[index] = 0;
+		}
+
+		if (!cached) {
+			continue;
+		}
+
+		key_get(key, et, CACHE_KEY_VALID_UNTIL);
+
+		err = settings_delete(key);
+		if (err) {
+			return err;
+		}
+
+		key_get(key, et, CACHE_KEY_DATA);
+
+		err = settings_delete(key);
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
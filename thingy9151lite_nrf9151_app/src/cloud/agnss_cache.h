@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef AGNSS_CACHE_H__
+#define AGNSS_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <nrf_modem_gnss.h>
+
+/**@file
+ *
+ * @defgroup agnss_cache A-GNSS assistance cache
+ * @brief    Persistent cache of A-GNSS assistance data received from cloud.
+ *
+ * @details A-GNSS responses from cloud, in the nRF Cloud A-GNSS binary format, are split into
+ *	    elements that are cached per element type and satellite, and stored in flash using
+ *	    the settings API with one entry per element type. Ephemerides, almanacs and UTC
+ *	    parameters are valid for a set time after the reference time they carry, ionospheric
+ *	    corrections for a set time after they were received.
+ *	    GPS ephemerides and almanacs, UTC parameters and Klobuchar and NeQuick ionospheric
+ *	    corrections are cached. GPS system time, position and integrity data are not.
+ *
+ *	    When the modem requests assistance data, the valid elements that it has asked for
+ *	    are put together into an A-GNSS response that is injected locally, and only the
+ *	    remaining data is requested from cloud.
+ *
+ *	    The validity of the cached data is based on UNIX time. The cache is bypassed until
+ *	    the date and time have been obtained.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Cache statistics, counted since boot. */
+struct agnss_cache_stats {
+	/** Requests that were answered from the cache only. */
+	uint32_t hits;
+	/** Requests that were answered partly from the cache. */
+	uint32_t partial_hits;
+	/** Requests for which no data was found in the cache. */
+	uint32_t misses;
+	/** Elements injected from the cache. */
+	uint32_t elements_served;
+	/** Bytes of A-GNSS data injected from the cache instead of downloaded. */
+	uint32_t bytes_served;
+};
+
+/**
+ * @brief Initialize the cache and load the cached elements from flash.
+ *
+ * @note Must be called after the settings subsystem has been initialized.
+ *
+ * @retval 0 on success.
+ * @return Negative error value from the settings API on failure.
+ */
+int agnss_cache_init(void);
+
+/**
+ * @brief Store the cacheable elements of an A-GNSS response received from cloud.
+ *
+ * @note An element replaces the cached element of the same type and satellite if it is valid
+ *	 until later. Only the element types with replaced elements are written to flash.
+ *	 Parsing stops at the first element of a type that is not cached, as the size of such
+ *	 elements is not known.
+ *
+ * @param[in] buf A-GNSS response.
+ * @param[in] len Length of the A-GNSS response.
+ *
+ * @return Number of elements stored on success, not counting elements that were already
+ *	   cached.
+ * @retval -EINVAL if the response is empty or of an unsupported schema version.
+ * @retval -ENODATA if the date and time are not known.
+ */
+int agnss_cache_store(const uint8_t *buf, size_t len);
+
+/**
+ * @brief Look up A-GNSS data requested by the modem in the cache.
+ *
+ * @note The data that is found in the cache is removed from the request, which is left with
+ *	 the data that must be requested from cloud.
+ *
+ * @param[in,out] request A-GNSS data request from the modem.
+ * @param[out] buf Heap allocated A-GNSS response, in the nRF Cloud A-GNSS binary format,
+ *		   holding the data found in the cache. Set to NULL if no data was found.
+ *		   Must be freed by the caller.
+ * @param[out] len Length of the A-GNSS response.
+ *
+ * @retval 0 on success.
+ * @retval -ENOMEM if the A-GNSS response could not be allocated.
+ */
+int agnss_cache_lookup(struct nrf_modem_gnss_agnss_data_frame *request, uint8_t **buf,
+		       size_t *len);
+
+/**
+ * @brief Check whether an A-GNSS request has anything left to request.
+ *
+ * @param[in] request A-GNSS data request.
+ *
+ * @return True if no data is requested.
+ */
+bool agnss_cache_request_empty(const struct nrf_modem_gnss_agnss_data_frame *request);
+
+/**
+ * @brief Get the cache statistics.
+ *
+ * @param[out] stats Cache statistics.
+ */
+void agnss_cache_stats_get(struct agnss_cache_stats *stats);
+
+/**
+ * @brief Remove all elements from the cache.
+ *
+ * @retval 0 on success.
+ * @return Negative error value from the settings API on failure.
+ */
+int agnss_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* AGNSS_CACHE_H__ */
@@ -434,8 +434,11 @@ int cloud_wrap_data_send(char *buf, size_t len, bool ack, uint32_t id,
 	return 0;
 }
 
-int cloud_wrap_batch_send(char *buf, size_t len, bool ack, uint32_t id)
+int cloud_wrap_batch_send(char *buf, size_t len, bool ack, uint32_t id,
+			  const struct lwm2m_obj_path path_list[])
 {
+	ARG_UNUSED(path_list);
+
 	int err;
 
 	struct aws_iot_data msg = {
@@ -15,6 +15,7 @@
 #include "cJSON.h"
 #include "json_helpers.h"
 #include "json_common.h"
+#include "json_arena.h"
 #include "json_protocol_names.h"
 
 #include <zephyr/logging/log.h>
@@ -68,10 +69,13 @@ int cloud_codec_encode_cloud_location(
 	__ASSERT_NO_MSG(output != NULL);
 	__ASSERT_NO_MSG(cloud_location != NULL);
 
+	json_arena_begin(JSON_ARENA_ENCODE_CLOUD_LOCATION);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
 		cJSON_Delete(root_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -93,7 +97,7 @@ int cloud_codec_encode_cloud_location(
 	}
 #endif
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -110,6 +114,7 @@ int cloud_codec_encode_cloud_location(
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -128,9 +133,12 @@ int cloud_codec_encode_agnss_request(struct cloud_codec_data *output,
 	__ASSERT_NO_MSG(output != NULL);
 	__ASSERT_NO_MSG(agnss_request != NULL);
 
+	json_arena_begin(JSON_ARENA_ENCODE_AGNSS_REQUEST);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -140,7 +148,7 @@ int cloud_codec_encode_agnss_request(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -157,6 +165,7 @@ int cloud_codec_encode_agnss_request(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -169,9 +178,12 @@ int cloud_codec_encode_pgps_request(struct cloud_codec_data *output,
 	__ASSERT_NO_MSG(output != NULL);
 	__ASSERT_NO_MSG(pgps_request != NULL);
 
+	json_arena_begin(JSON_ARENA_ENCODE_PGPS_REQUEST);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -180,7 +192,7 @@ int cloud_codec_encode_pgps_request(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -197,6 +209,7 @@ int cloud_codec_encode_pgps_request(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -264,6 +277,8 @@ int cloud_codec_encode_config(struct cloud_codec_data *output,
 	int err;
 	char *buffer;
 
+	json_arena_begin(JSON_ARENA_ENCODE_CONFIG);
+
 	cJSON *root_obj = cJSON_CreateObject();
 	cJSON *state_obj = cJSON_CreateObject();
 	cJSON *rep_obj = cJSON_CreateObject();
@@ -272,6 +287,7 @@ int cloud_codec_encode_config(struct cloud_codec_data *output,
 		cJSON_Delete(root_obj);
 		cJSON_Delete(state_obj);
 		cJSON_Delete(rep_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -284,7 +300,7 @@ int cloud_codec_encode_config(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -301,6 +317,7 @@ int cloud_codec_encode_config(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -315,8 +332,11 @@ int cloud_codec_encode_data(struct cloud_codec_data *output,
 {
 	int err;
 	char *buffer;
+	uint32_t fields;
 	bool object_added = false;
 
+	json_arena_begin(JSON_ARENA_ENCODE_DATA);
+
 	cJSON *root_obj = cJSON_CreateObject();
 	cJSON *state_obj = cJSON_CreateObject();
 	cJSON *rep_obj = cJSON_CreateObject();
@@ -325,6 +345,7 @@ int cloud_codec_encode_data(struct cloud_codec_data *output,
 		cJSON_Delete(root_obj);
 		cJSON_Delete(state_obj);
 		cJSON_Delete(rep_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -348,20 +369,25 @@ int cloud_codec_encode_data(struct cloud_codec_data *output,
 		goto add_object;
 	}
 
-	err = json_common_modem_static_data_add(rep_obj, modem_stat_buf,
-						JSON_COMMON_ADD_DATA_TO_OBJECT,
-						DATA_MODEM_STATIC,
-						NULL);
+	/* Only the modem data fields that have changed are reported to the shadow. */
+	fields = cloud_codec_shadow_modem_static_stage(modem_stat_buf);
+
+	err = json_common_modem_static_fields_add(rep_obj, modem_stat_buf, fields,
+						  JSON_COMMON_ADD_DATA_TO_OBJECT,
+						  DATA_MODEM_STATIC,
+						  NULL);
 	if (err == 0) {
 		object_added = true;
 	} else if (err != -ENODATA) {
 		goto add_object;
 	}
 
-	err = json_common_modem_dynamic_data_add(rep_obj, modem_dyn_buf,
-						 JSON_COMMON_ADD_DATA_TO_OBJECT,
-						 DATA_MODEM_DYNAMIC,
-						 NULL);
+	fields = cloud_codec_shadow_modem_dynamic_stage(modem_dyn_buf);
+
+	err = json_common_modem_dynamic_fields_add(rep_obj, modem_dyn_buf, fields,
+						   JSON_COMMON_ADD_DATA_TO_OBJECT,
+						   DATA_MODEM_DYNAMIC,
+						   NULL);
 	if (err == 0) {
 		object_added = true;
 	} else if (err != -ENODATA) {
@@ -421,7 +447,7 @@ add_object:
 		err = 0;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -438,19 +464,27 @@ add_object:
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
+/* With CONFIG_CLOUD_CODEC_CBOR, the messages for the batch and messages topics are encoded by the
+ * CBOR codec.
+ */
+#if !defined(CONFIG_CLOUD_CODEC_CBOR)
 int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
 			       struct cloud_data_ui *ui_buf)
 {
 	int err;
 	char *buffer;
 
+	json_arena_begin(JSON_ARENA_ENCODE_UI);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
 		cJSON_Delete(root_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -462,7 +496,7 @@ int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -479,6 +513,7 @@ int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -488,10 +523,13 @@ int cloud_codec_encode_impact_data(struct cloud_codec_data *output,
 	int err;
 	char *buffer;
 
+	json_arena_begin(JSON_ARENA_ENCODE_IMPACT);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
 		cJSON_Delete(root_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -504,7 +542,7 @@ int cloud_codec_encode_impact_data(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -521,6 +559,7 @@ int cloud_codec_encode_impact_data(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -540,92 +579,45 @@ int cloud_codec_encode_batch_data(struct cloud_codec_data *output,
 				  size_t impact_buf_count,
 				  size_t bat_buf_count)
 {
+	const struct json_common_batch_buffer buffers[] = {
+		{ JSON_COMMON_MODEM_STATIC, modem_stat_buf, modem_stat_buf_count,
+		  DATA_MODEM_STATIC },
+		{ JSON_COMMON_MODEM_DYNAMIC, modem_dyn_buf, modem_dyn_buf_count,
+		  DATA_MODEM_DYNAMIC },
+		{ JSON_COMMON_GNSS, gnss_buf, gnss_buf_count, DATA_GNSS },
+		{ JSON_COMMON_SENSOR, sensor_buf, sensor_buf_count, DATA_ENVIRONMENTALS },
+		{ JSON_COMMON_UI, ui_buf, ui_buf_count, DATA_BUTTON },
+		{ JSON_COMMON_IMPACT, impact_buf, impact_buf_count, DATA_IMPACT },
+		{ JSON_COMMON_BATTERY, bat_buf, bat_buf_count, DATA_BATTERY },
+	};
+
+#if defined(CONFIG_CLOUD_CODEC_JSON_WRITER)
+	return json_common_batch_encode(output, buffers, ARRAY_SIZE(buffers),
+					CONFIG_CLOUD_CODEC_BATCH_SIZE_MAX);
+#else
 	int err;
 	char *buffer;
-	bool object_added = false;
+
+	json_arena_begin(JSON_ARENA_ENCODE_BATCH);
 
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
 		cJSON_Delete(root_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_MODEM_STATIC,
-					 modem_stat_buf, modem_stat_buf_count,
-					 DATA_MODEM_STATIC);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_MODEM_DYNAMIC,
-					 modem_dyn_buf, modem_dyn_buf_count,
-					 DATA_MODEM_DYNAMIC);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_GNSS,
-					 gnss_buf, gnss_buf_count,
-					 DATA_GNSS);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_SENSOR,
-					 sensor_buf, sensor_buf_count,
-					 DATA_ENVIRONMENTALS);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_UI,
-					 ui_buf, ui_buf_count,
-					 DATA_BUTTON);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_IMPACT,
-					 impact_buf, impact_buf_count,
-					 DATA_IMPACT);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_BATTERY,
-					 bat_buf, bat_buf_count,
-					 DATA_BATTERY);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	if (!object_added) {
-		err = -ENODATA;
+	err = json_common_batch_add(root_obj, buffers, ARRAY_SIZE(buffers),
+				    CONFIG_CLOUD_CODEC_BATCH_SIZE_MAX);
+	if (err == -ENODATA) {
 		LOG_DBG("No data to encode, JSON string empty...");
 		goto exit;
-	} else {
-		/* At this point err can be either 0 or -ENODATA. Explicitly set err to 0 if
-		 * objects has been added to the rootj object.
-		 */
-		err = 0;
+	} else if (err) {
+		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -642,5 +634,8 @@ int cloud_codec_encode_batch_data(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
+#endif /* CONFIG_CLOUD_CODEC_JSON_WRITER */
 }
+#endif /* !CONFIG_CLOUD_CODEC_CBOR */
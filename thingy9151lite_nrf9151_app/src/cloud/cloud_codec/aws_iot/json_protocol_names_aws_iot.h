@@ -25,6 +25,7 @@
 #define CONFIG_ACC_ACT_THRESHOLD	  "accath"
 #define CONFIG_ACC_INACT_THRESHOLD	  "accith"
 #define CONFIG_ACC_INACT_TIMEOUT	  "accito"
+#define CONFIG_SEND_POLICY		  "sndpol"
 #define CONFIG_NO_DATA_LIST		  "nod"
 #define CONFIG_NO_DATA_LIST_GNSS	  "gnss"
 #define CONFIG_NO_DATA_LIST_NEIGHBOR_CELL "ncell"
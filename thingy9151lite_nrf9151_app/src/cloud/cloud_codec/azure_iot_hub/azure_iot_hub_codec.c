@@ -15,6 +15,7 @@
 
 #include "json_helpers.h"
 #include "json_common.h"
+#include "json_arena.h"
 #include "json_protocol_names.h"
 
 #include <zephyr/logging/log.h>
@@ -39,9 +40,12 @@ int cloud_codec_encode_cloud_location(
 	__ASSERT_NO_MSG(output != NULL);
 	__ASSERT_NO_MSG(cloud_location != NULL);
 
+	json_arena_begin(JSON_ARENA_ENCODE_CLOUD_LOCATION);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -63,7 +67,7 @@ int cloud_codec_encode_cloud_location(
 	}
 #endif
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -80,6 +84,7 @@ int cloud_codec_encode_cloud_location(
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -99,9 +104,12 @@ int cloud_codec_encode_agnss_request(struct cloud_codec_data *output,
 	__ASSERT_NO_MSG(output != NULL);
 	__ASSERT_NO_MSG(agnss_request != NULL);
 
+	json_arena_begin(JSON_ARENA_ENCODE_AGNSS_REQUEST);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -111,7 +119,7 @@ int cloud_codec_encode_agnss_request(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -128,6 +136,7 @@ int cloud_codec_encode_agnss_request(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -140,9 +149,12 @@ int cloud_codec_encode_pgps_request(struct cloud_codec_data *output,
 	__ASSERT_NO_MSG(output != NULL);
 	__ASSERT_NO_MSG(pgps_request != NULL);
 
+	json_arena_begin(JSON_ARENA_ENCODE_PGPS_REQUEST);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -151,7 +163,7 @@ int cloud_codec_encode_pgps_request(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -168,6 +180,7 @@ int cloud_codec_encode_pgps_request(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -230,10 +243,13 @@ int cloud_codec_encode_config(struct cloud_codec_data *output,
 	int err;
 	char *buffer;
 
+	json_arena_begin(JSON_ARENA_ENCODE_CONFIG);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
 		cJSON_Delete(root_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -243,7 +259,7 @@ int cloud_codec_encode_config(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -260,6 +276,7 @@ int cloud_codec_encode_config(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -274,12 +291,16 @@ int cloud_codec_encode_data(struct cloud_codec_data *output,
 {
 	int err;
 	char *buffer;
+	uint32_t fields;
 	bool object_added = false;
 
+	json_arena_begin(JSON_ARENA_ENCODE_DATA);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
 		cJSON_Delete(root_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -303,20 +324,25 @@ int cloud_codec_encode_data(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	err = json_common_modem_static_data_add(root_obj, modem_stat_buf,
-						JSON_COMMON_ADD_DATA_TO_OBJECT,
-						DATA_MODEM_STATIC,
-						NULL);
+	/* Only the modem data fields that have changed are reported to the shadow. */
+	fields = cloud_codec_shadow_modem_static_stage(modem_stat_buf);
+
+	err = json_common_modem_static_fields_add(root_obj, modem_stat_buf, fields,
+						  JSON_COMMON_ADD_DATA_TO_OBJECT,
+						  DATA_MODEM_STATIC,
+						  NULL);
 	if (err == 0) {
 		object_added = true;
 	} else if (err != -ENODATA) {
 		goto exit;
 	}
 
-	err = json_common_modem_dynamic_data_add(root_obj, modem_dyn_buf,
-						 JSON_COMMON_ADD_DATA_TO_OBJECT,
-						 DATA_MODEM_DYNAMIC,
-						 NULL);
+	fields = cloud_codec_shadow_modem_dynamic_stage(modem_dyn_buf);
+
+	err = json_common_modem_dynamic_fields_add(root_obj, modem_dyn_buf, fields,
+						   JSON_COMMON_ADD_DATA_TO_OBJECT,
+						   DATA_MODEM_DYNAMIC,
+						   NULL);
 	if (err == 0) {
 		object_added = true;
 	} else if (err != -ENODATA) {
@@ -364,7 +390,7 @@ int cloud_codec_encode_data(struct cloud_codec_data *output,
 		err = 0;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -381,6 +407,7 @@ int cloud_codec_encode_data(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -390,10 +417,13 @@ int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
 	int err;
 	char *buffer;
 
+	json_arena_begin(JSON_ARENA_ENCODE_UI);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
 		cJSON_Delete(root_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -405,7 +435,7 @@ int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -422,6 +452,7 @@ int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -431,10 +462,13 @@ int cloud_codec_encode_impact_data(struct cloud_codec_data *output,
 	int err;
 	char *buffer;
 
+	json_arena_begin(JSON_ARENA_ENCODE_IMPACT);
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
 		cJSON_Delete(root_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
@@ -446,7 +480,7 @@ int cloud_codec_encode_impact_data(struct cloud_codec_data *output,
 		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -463,6 +497,7 @@ int cloud_codec_encode_impact_data(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
 }
 
@@ -482,92 +517,45 @@ int cloud_codec_encode_batch_data(struct cloud_codec_data *output,
 				  size_t impact_buf_count,
 				  size_t bat_buf_count)
 {
+	const struct json_common_batch_buffer buffers[] = {
+		{ JSON_COMMON_MODEM_STATIC, modem_stat_buf, modem_stat_buf_count,
+		  DATA_MODEM_STATIC },
+		{ JSON_COMMON_MODEM_DYNAMIC, modem_dyn_buf, modem_dyn_buf_count,
+		  DATA_MODEM_DYNAMIC },
+		{ JSON_COMMON_GNSS, gnss_buf, gnss_buf_count, DATA_GNSS },
+		{ JSON_COMMON_SENSOR, sensor_buf, sensor_buf_count, DATA_ENVIRONMENTALS },
+		{ JSON_COMMON_UI, ui_buf, ui_buf_count, DATA_BUTTON },
+		{ JSON_COMMON_IMPACT, impact_buf, impact_buf_count, DATA_IMPACT },
+		{ JSON_COMMON_BATTERY, bat_buf, bat_buf_count, DATA_BATTERY },
+	};
+
+#if defined(CONFIG_CLOUD_CODEC_JSON_WRITER)
+	return json_common_batch_encode(output, buffers, ARRAY_SIZE(buffers),
+					CONFIG_CLOUD_CODEC_BATCH_SIZE_MAX);
+#else
 	int err;
 	char *buffer;
-	bool object_added = false;
+
+	json_arena_begin(JSON_ARENA_ENCODE_BATCH);
 
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
 		cJSON_Delete(root_obj);
+		json_arena_end();
 		return -ENOMEM;
 	}
 
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_MODEM_STATIC,
-					 modem_stat_buf, modem_stat_buf_count,
-					 DATA_MODEM_STATIC);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_MODEM_DYNAMIC,
-					 modem_dyn_buf, modem_dyn_buf_count,
-					 DATA_MODEM_DYNAMIC);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_GNSS,
-					 gnss_buf, gnss_buf_count,
-					 DATA_GNSS);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_SENSOR,
-					 sensor_buf, sensor_buf_count,
-					 DATA_ENVIRONMENTALS);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_UI,
-					 ui_buf, ui_buf_count,
-					 DATA_BUTTON);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_IMPACT,
-					 impact_buf, impact_buf_count,
-					 DATA_IMPACT);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	err = json_common_batch_data_add(root_obj, JSON_COMMON_BATTERY,
-					 bat_buf, bat_buf_count,
-					 DATA_BATTERY);
-	if (err == 0) {
-		object_added = true;
-	} else if (err != -ENODATA) {
-		goto exit;
-	}
-
-	if (!object_added) {
-		err = -ENODATA;
+	err = json_common_batch_add(root_obj, buffers, ARRAY_SIZE(buffers),
+				    CONFIG_CLOUD_CODEC_BATCH_SIZE_MAX);
+	if (err == -ENODATA) {
 		LOG_DBG("No data to encode, JSON string empty...");
 		goto exit;
-	} else {
-		/* At this point err can be either 0 or -ENODATA. Explicitly set err to 0 if
-		 * objects has been added to the rootj object.
-		 */
-		err = 0;
+	} else if (err) {
+		goto exit;
 	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
+	buffer = json_arena_print(root_obj);
 	if (buffer == NULL) {
 		LOG_ERR("Failed to allocate memory for JSON string");
 
@@ -584,5 +572,7 @@ int cloud_codec_encode_batch_data(struct cloud_codec_data *output,
 
 exit:
 	cJSON_Delete(root_obj);
+	json_arena_end();
 	return err;
+#endif /* CONFIG_CLOUD_CODEC_JSON_WRITER */
 }
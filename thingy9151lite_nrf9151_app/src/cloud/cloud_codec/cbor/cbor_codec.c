@@ -0,0 +1,601 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <cloud_codec.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <stdlib.h>
+#include <date_time.h>
+#include <zcbor_encode.h>
+
+#include "cbor_protocol_keys.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(cloud_codec, CONFIG_CLOUD_CODEC_LOG_LEVEL);
+
+/* CBOR encoders for the messages that are published to the batch and messages topics. All other
+ * messages, including the device shadow updates and the configuration that is received from the
+ * shadow, are encoded and decoded by the AWS IoT codec in JSON, the only format that the device
+ * shadow service accepts.
+ */
+
+/* Maximum nesting depth of an encoded message: root map -> array -> entry map -> value map. */
+#define NESTING_MAX 4
+
+/* The encoded size of an entry never exceeds the size of the structure it is encoded from by
+ * more than this. Every field adds at most a key and a header byte, and each entry adds its own
+ * map headers and keys. The output buffer is sized from this bound, so that no first pass
+ * is needed to compute the encoded length.
+ */
+#define ENTRY_OVERHEAD_MAX 48
+
+/* Overhead of the root map of a message. */
+#define ROOT_OVERHEAD_MAX 16
+
+/* Maximum number of buffers in a message, one per data type of a batch message. */
+#define BUFFERS_MAX 7
+
+/* Encode value as an integer if it has no fractional part, the same way cJSON prints such
+ * values. Otherwise encode it as float32 if that is lossless, or as float64.
+ */
+static bool float_put(zcbor_state_t *state, double value)
+{
+	if ((value >= INT32_MIN) && (value <= INT32_MAX) && ((double)(int32_t)value == value)) {
+		return zcbor_int32_put(state, (int32_t)value);
+	}
+
+	if ((double)(float)value == value) {
+		return zcbor_float32_put(state, (float)value);
+	}
+
+	return zcbor_float64_put(state, value);
+}
+
+static int unix_ts_get(int64_t ts, bool ts_unix, int64_t *unix_ts)
+{
+	int err;
+
+	*unix_ts = ts;
+
+	if (ts_unix) {
+		return 0;
+	}
+
+	err = date_time_uptime_to_unix_time_ms(unix_ts);
+	if (err) {
+		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+		return err;
+	}
+
+	return 0;
+}
+
+/* Entry encoders. Each one encodes a map with the value and the timestamp of the entry.
+ * The passed in data is not modified.
+ */
+
+static int modem_static_encode(zcbor_state_t *state, const void *entry)
+{
+	const struct cloud_data_modem_static *data = entry;
+	int64_t ts;
+	int err;
+
+	err = unix_ts_get(data->ts, false, &ts);
+	if (err) {
+		return err;
+	}
+
+	if (!(zcbor_map_start_encode(state, 2) &&
+	      zcbor_uint32_put(state, CBOR_DATA_VALUE) &&
+	      zcbor_map_start_encode(state, 5) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_IMEI) &&
+	      zcbor_tstr_put_term(state, data->imei, sizeof(data->imei)) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_ICCID) &&
+	      zcbor_tstr_put_term(state, data->iccid, sizeof(data->iccid)) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_FIRMWARE_VERSION) &&
+	      zcbor_tstr_put_term(state, data->fw, sizeof(data->fw)) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_BOARD) &&
+	      zcbor_tstr_put_term(state, data->brdv, sizeof(data->brdv)) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_APP_VERSION) &&
+	      zcbor_tstr_put_term(state, data->appv, sizeof(data->appv)) &&
+	      zcbor_map_end_encode(state, 5) &&
+	      zcbor_uint32_put(state, CBOR_DATA_TIMESTAMP) &&
+	      zcbor_uint64_put(state, ts) &&
+	      zcbor_map_end_encode(state, 2))) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int modem_dynamic_encode(zcbor_state_t *state, const void *entry)
+{
+	const struct cloud_data_modem_dynamic *data = entry;
+	uint32_t mccmnc;
+	char *end_ptr;
+	int64_t ts;
+	int err;
+
+	err = unix_ts_get(data->ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	/* Convert mccmnc to unsigned long integer. */
+	errno = 0;
+	mccmnc = strtoul(data->mccmnc, &end_ptr, 10);
+
+	if ((errno == ERANGE) || (*end_ptr != '\0')) {
+		LOG_ERR("MCCMNC string could not be converted.");
+		return -ENOTEMPTY;
+	}
+
+	if (!(zcbor_map_start_encode(state, 2) &&
+	      zcbor_uint32_put(state, CBOR_DATA_VALUE) &&
+	      zcbor_map_start_encode(state, 7) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_CURRENT_BAND) &&
+	      zcbor_uint32_put(state, data->band) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_NETWORK_MODE) &&
+	      zcbor_uint32_put(state, data->nw_mode) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_RSRP) &&
+	      zcbor_int32_put(state, data->rsrp) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_AREA_CODE) &&
+	      zcbor_uint32_put(state, data->area) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_MCCMNC) &&
+	      zcbor_uint32_put(state, mccmnc) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_CELL_ID) &&
+	      zcbor_uint32_put(state, data->cell) &&
+	      zcbor_uint32_put(state, CBOR_MODEM_IP_ADDRESS) &&
+	      zcbor_tstr_put_term(state, data->ip, sizeof(data->ip)) &&
+	      zcbor_map_end_encode(state, 7) &&
+	      zcbor_uint32_put(state, CBOR_DATA_TIMESTAMP) &&
+	      zcbor_uint64_put(state, ts) &&
+	      zcbor_map_end_encode(state, 2))) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int gnss_encode(zcbor_state_t *state, const void *entry)
+{
+	const struct cloud_data_gnss *data = entry;
+	int64_t ts;
+	int err;
+
+	err = unix_ts_get(data->gnss_ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	if (!(zcbor_map_start_encode(state, 2) &&
+	      zcbor_uint32_put(state, CBOR_DATA_VALUE) &&
+	      zcbor_map_start_encode(state, 6) &&
+	      zcbor_uint32_put(state, CBOR_GNSS_LONGITUDE) &&
+	      float_put(state, data->pvt.longi) &&
+	      zcbor_uint32_put(state, CBOR_GNSS_LATITUDE) &&
+	      float_put(state, data->pvt.lat) &&
+	      zcbor_uint32_put(state, CBOR_GNSS_ACCURACY) &&
+	      zcbor_float32_put(state, data->pvt.acc) &&
+	      zcbor_uint32_put(state, CBOR_GNSS_ALTITUDE) &&
+	      zcbor_float32_put(state, data->pvt.alt) &&
+	      zcbor_uint32_put(state, CBOR_GNSS_SPEED) &&
+	      zcbor_float32_put(state, data->pvt.spd) &&
+	      zcbor_uint32_put(state, CBOR_GNSS_HEADING) &&
+	      zcbor_float32_put(state, data->pvt.hdg) &&
+	      zcbor_map_end_encode(state, 6) &&
+	      zcbor_uint32_put(state, CBOR_DATA_TIMESTAMP) &&
+	      zcbor_uint64_put(state, ts) &&
+	      zcbor_map_end_encode(state, 2))) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int sensor_encode(zcbor_state_t *state, const void *entry)
+{
+	const struct cloud_data_sensors *data = entry;
+	int64_t ts;
+	int err;
+
+	err = unix_ts_get(data->env_ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	if (!(zcbor_map_start_encode(state, 2) &&
+	      zcbor_uint32_put(state, CBOR_DATA_VALUE) &&
+	      zcbor_map_start_encode(state, 4) &&
+	      zcbor_uint32_put(state, CBOR_ENV_TEMPERATURE) &&
+	      float_put(state, data->temperature) &&
+	      zcbor_uint32_put(state, CBOR_ENV_HUMIDITY) &&
+	      float_put(state, data->humidity) &&
+	      zcbor_uint32_put(state, CBOR_ENV_PRESSURE) &&
+	      float_put(state, data->pressure))) {
+		return -ENOMEM;
+	}
+
+	/* If air quality is negative, the value is not provided. */
+	if (data->bsec_air_quality >= 0) {
+		if (!(zcbor_uint32_put(state, CBOR_ENV_BSEC_IAQ) &&
+		      zcbor_int32_put(state, data->bsec_air_quality))) {
+			return -ENOMEM;
+		}
+	}
+
+	if (!(zcbor_map_end_encode(state, 4) &&
+	      zcbor_uint32_put(state, CBOR_DATA_TIMESTAMP) &&
+	      zcbor_uint64_put(state, ts) &&
+	      zcbor_map_end_encode(state, 2))) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int ui_encode(zcbor_state_t *state, const void *entry)
+{
+	const struct cloud_data_ui *data = entry;
+	int64_t ts;
+	int err;
+
+	err = unix_ts_get(data->btn_ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	if (!(zcbor_map_start_encode(state, 2) &&
+	      zcbor_uint32_put(state, CBOR_DATA_VALUE) &&
+	      zcbor_int32_put(state, data->btn) &&
+	      zcbor_uint32_put(state, CBOR_DATA_TIMESTAMP) &&
+	      zcbor_uint64_put(state, ts) &&
+	      zcbor_map_end_encode(state, 2))) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int impact_encode(zcbor_state_t *state, const void *entry)
+{
+	const struct cloud_data_impact *data = entry;
+	int64_t ts;
+	int err;
+
+	err = unix_ts_get(data->ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	if (!(zcbor_map_start_encode(state, 2) &&
+	      zcbor_uint32_put(state, CBOR_DATA_VALUE) &&
+	      float_put(state, data->magnitude) &&
+	      zcbor_uint32_put(state, CBOR_DATA_TIMESTAMP) &&
+	      zcbor_uint64_put(state, ts) &&
+	      zcbor_map_end_encode(state, 2))) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int battery_encode(zcbor_state_t *state, const void *entry)
+{
+	const struct cloud_data_battery *data = entry;
+	int64_t ts;
+	int err;
+
+	err = unix_ts_get(data->bat_ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	if (!(zcbor_map_start_encode(state, 2) &&
+	      zcbor_uint32_put(state, CBOR_DATA_VALUE) &&
+	      zcbor_uint32_put(state, data->bat) &&
+	      zcbor_uint32_put(state, CBOR_DATA_TIMESTAMP) &&
+	      zcbor_uint64_put(state, ts) &&
+	      zcbor_map_end_encode(state, 2))) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/* Returns the queued flag of an entry, and optionally clears it. */
+#define ENTRY_QUEUED_DEFINE(_name, _type)				\
+	static bool _name##_queued(void *entry, bool clear)		\
+	{								\
+		_type *data = entry;					\
+		bool queued = data->queued;				\
+									\
+		if (clear) {						\
+			data->queued = false;				\
+		}							\
+									\
+		return queued;						\
+	}
+
+ENTRY_QUEUED_DEFINE(modem_static, struct cloud_data_modem_static)
+ENTRY_QUEUED_DEFINE(modem_dynamic, struct cloud_data_modem_dynamic)
+ENTRY_QUEUED_DEFINE(gnss, struct cloud_data_gnss)
+ENTRY_QUEUED_DEFINE(sensor, struct cloud_data_sensors)
+ENTRY_QUEUED_DEFINE(ui, struct cloud_data_ui)
+ENTRY_QUEUED_DEFINE(impact, struct cloud_data_impact)
+ENTRY_QUEUED_DEFINE(battery, struct cloud_data_battery)
+
+/* Buffer of entries of one data type that is encoded under a key in the root map. */
+struct buffer {
+	uint32_t key;
+	void *buf;
+	size_t count;
+	size_t entry_size;
+	int (*encode)(zcbor_state_t *state, const void *entry);
+	bool (*queued)(void *entry, bool clear);
+};
+
+#define BUFFER(_key, _name, _buf, _count)			\
+	{							\
+		.key = (_key),					\
+		.buf = (_buf),					\
+		.count = ((_buf) == NULL) ? 0 : (_count),	\
+		.entry_size = sizeof(*(_buf)),			\
+		.encode = _name##_encode,			\
+		.queued = _name##_queued,			\
+	}
+
+static void *entry_get(const struct buffer *buffer, size_t i)
+{
+	return (uint8_t *)buffer->buf + (i * buffer->entry_size);
+}
+
+/* Returns the number of queued entries before entry end. */
+static size_t queued_count(const struct buffer *buffer, size_t end)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < end; i++) {
+		if (buffer->queued(entry_get(buffer, i), false)) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static void dequeue(const struct buffer *buffer, size_t end)
+{
+	for (size_t i = 0; i < end; i++) {
+		(void)buffer->queued(entry_get(buffer, i), true);
+	}
+}
+
+static int output_alloc(struct cloud_codec_data *output, size_t size)
+{
+	output->buf = k_malloc(size);
+	if (output->buf == NULL) {
+		LOG_ERR("Failed to allocate memory for CBOR message");
+		return -ENOMEM;
+	}
+
+	output->len = size;
+
+	return 0;
+}
+
+static void output_free(struct cloud_codec_data *output)
+{
+	k_free(output->buf);
+	output->buf = NULL;
+	output->len = 0;
+}
+
+/* Set the output length to the number of bytes encoded. */
+static void output_finish(struct cloud_codec_data *output, zcbor_state_t *state)
+{
+	output->len = state->payload - (uint8_t *)output->buf;
+
+	LOG_DBG("Encoded message, %zu bytes", output->len);
+	LOG_HEXDUMP_DBG(output->buf, output->len, "Encoded message:");
+}
+
+/* Set ends[] to the entries of each buffer that fit in a message of size_max bytes, taken from
+ * the buffers in the passed in order, and return the size of the output buffer. The size of an
+ * entry is bounded from the size of its structure, so the message can hold fewer entries than
+ * would fit. The first entry is always included, so that an entry larger than size_max does
+ * not block the buffer. If size_max is 0, all entries are included.
+ */
+static size_t buffers_fit(const struct buffer *buffers, size_t buffer_count, size_t size_max,
+			  size_t *ends)
+{
+	size_t size = ROOT_OVERHEAD_MAX;
+	size_t entries = 0;
+	bool full = false;
+
+	for (size_t i = 0; i < buffer_count; i++) {
+		const struct buffer *buffer = &buffers[i];
+		size_t entry_size_max = buffer->entry_size + ENTRY_OVERHEAD_MAX;
+
+		ends[i] = full ? 0 : buffer->count;
+
+		for (size_t j = 0; j < ends[i]; j++) {
+			if (!buffer->queued(entry_get(buffer, j), false)) {
+				continue;
+			}
+
+			if ((size_max > 0) && (entries > 0) && (size + entry_size_max > size_max)) {
+				/* The entry is left for the next message. */
+				ends[i] = j;
+				full = true;
+				break;
+			}
+
+			size += entry_size_max;
+			entries++;
+		}
+	}
+
+	return size;
+}
+
+/* Encode the queued entries in the passed in buffers. If single is set, each buffer holds a
+ * single entry that is encoded as a map directly under its key. Otherwise the queued entries of
+ * each buffer are encoded as an array. If size_max is not 0, only the oldest entries that fit in
+ * size_max bytes are encoded, the remaining entries are left queued for the next message.
+ * Entries are dequeued only if the whole message is encoded successfully.
+ */
+static int buffers_encode(struct cloud_codec_data *output, const struct buffer *buffers,
+			  size_t buffer_count, bool single, size_t size_max)
+{
+	int err;
+	size_t size;
+	size_t keys = 0;
+	size_t ends[BUFFERS_MAX];
+
+	if (buffer_count > ARRAY_SIZE(ends)) {
+		return -EINVAL;
+	}
+
+	size = buffers_fit(buffers, buffer_count, size_max, ends);
+
+	for (size_t i = 0; i < buffer_count; i++) {
+		if (queued_count(&buffers[i], ends[i]) > 0) {
+			keys++;
+		}
+	}
+
+	if (keys == 0) {
+		LOG_DBG("No data to encode, CBOR message empty...");
+		return -ENODATA;
+	}
+
+	err = output_alloc(output, size);
+	if (err) {
+		return err;
+	}
+
+	ZCBOR_STATE_E(state, NESTING_MAX, output->buf, output->len, 1);
+
+	if (!zcbor_map_start_encode(state, keys)) {
+		err = -ENOMEM;
+		goto exit;
+	}
+
+	for (size_t i = 0; i < buffer_count; i++) {
+		const struct buffer *buffer = &buffers[i];
+		size_t count = queued_count(buffer, ends[i]);
+
+		if (count == 0) {
+			continue;
+		}
+
+		if (!zcbor_uint32_put(state, buffer->key)) {
+			err = -ENOMEM;
+			goto exit;
+		}
+
+		if (!single && !zcbor_list_start_encode(state, count)) {
+			err = -ENOMEM;
+			goto exit;
+		}
+
+		for (size_t j = 0; j < ends[i]; j++) {
+			void *entry = entry_get(buffer, j);
+
+			if (!buffer->queued(entry, false)) {
+				continue;
+			}
+
+			err = buffer->encode(state, entry);
+			if (err) {
+				goto exit;
+			}
+		}
+
+		if (!single && !zcbor_list_end_encode(state, count)) {
+			err = -ENOMEM;
+			goto exit;
+		}
+	}
+
+	if (!zcbor_map_end_encode(state, keys)) {
+		err = -ENOMEM;
+		goto exit;
+	}
+
+	for (size_t i = 0; i < buffer_count; i++) {
+		dequeue(&buffers[i], ends[i]);
+	}
+
+	output_finish(output, state);
+
+	return 0;
+
+exit:
+	LOG_ERR("Encoding error: %d", err);
+	output_free(output);
+	return err;
+}
+
+int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
+			       struct cloud_data_ui *ui_buf)
+{
+	const struct buffer buffers[] = {
+		BUFFER(CBOR_DATA_BUTTON, ui, ui_buf, 1),
+	};
+
+	__ASSERT_NO_MSG(output != NULL);
+
+	return buffers_encode(output, buffers, ARRAY_SIZE(buffers), true, 0);
+}
+
+int cloud_codec_encode_impact_data(struct cloud_codec_data *output,
+				   struct cloud_data_impact *impact_buf)
+{
+	const struct buffer buffers[] = {
+		BUFFER(CBOR_DATA_IMPACT, impact, impact_buf, 1),
+	};
+
+	__ASSERT_NO_MSG(output != NULL);
+
+	return buffers_encode(output, buffers, ARRAY_SIZE(buffers), true, 0);
+}
+
+int cloud_codec_encode_batch_data(struct cloud_codec_data *output,
+				  struct cloud_data_gnss *gnss_buf,
+				  struct cloud_data_sensors *sensor_buf,
+				  struct cloud_data_modem_static *modem_stat_buf,
+				  struct cloud_data_modem_dynamic *modem_dyn_buf,
+				  struct cloud_data_ui *ui_buf,
+				  struct cloud_data_impact *impact_buf,
+				  struct cloud_data_battery *bat_buf,
+				  size_t gnss_buf_count,
+				  size_t sensor_buf_count,
+				  size_t modem_stat_buf_count,
+				  size_t modem_dyn_buf_count,
+				  size_t ui_buf_count,
+				  size_t impact_buf_count,
+				  size_t bat_buf_count)
+{
+	const struct buffer buffers[] = {
+		BUFFER(CBOR_DATA_MODEM_STATIC, modem_static, modem_stat_buf, modem_stat_buf_count),
+		BUFFER(CBOR_DATA_MODEM_DYNAMIC, modem_dynamic, modem_dyn_buf, modem_dyn_buf_count),
+		BUFFER(CBOR_DATA_GNSS, gnss, gnss_buf, gnss_buf_count),
+		BUFFER(CBOR_DATA_ENVIRONMENTALS, sensor, sensor_buf, sensor_buf_count),
+		BUFFER(CBOR_DATA_BUTTON, ui, ui_buf, ui_buf_count),
+		BUFFER(CBOR_DATA_IMPACT, impact, impact_buf, impact_buf_count),
+		BUFFER(CBOR_DATA_BATTERY, battery, bat_buf, bat_buf_count),
+	};
+
+	__ASSERT_NO_MSG(output != NULL);
+
+	return buffers_encode(output, buffers, ARRAY_SIZE(buffers), false,
+			      CONFIG_CLOUD_CODEC_BATCH_SIZE_MAX);
+}
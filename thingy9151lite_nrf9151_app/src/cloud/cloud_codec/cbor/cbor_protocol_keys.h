@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Map keys used by the CBOR codec. Messages have the same structure as the batch and UI messages
+ * encoded by the AWS IoT codec, with integer keys in place of the JSON object names.
+ *
+ * Timestamps are encoded as unsigned integers in UNIX milliseconds. Floating point values without
+ * a fractional part are encoded as integers, other values as float32 if that is lossless,
+ * otherwise as float64. Decoders must accept all three. The network mode is encoded as the
+ * enum lte_lc_lte_mode value.
+ */
+
+/* Keys in the root map. Keys 0, 1 and 9 to 12 are reserved. */
+#define CBOR_DATA_MODEM_STATIC	  2
+#define CBOR_DATA_MODEM_DYNAMIC	  3
+#define CBOR_DATA_GNSS		  4
+#define CBOR_DATA_ENVIRONMENTALS  5
+#define CBOR_DATA_BUTTON	  6
+#define CBOR_DATA_IMPACT	  7
+#define CBOR_DATA_BATTERY	  8
+
+/* Keys in a data entry map. */
+#define CBOR_DATA_VALUE		  0
+#define CBOR_DATA_TIMESTAMP	  1
+
+/* Keys in the static modem data value map. */
+#define CBOR_MODEM_IMEI			  0
+#define CBOR_MODEM_ICCID		  1
+#define CBOR_MODEM_FIRMWARE_VERSION	  2
+#define CBOR_MODEM_BOARD		  3
+#define CBOR_MODEM_APP_VERSION		  4
+
+/* Keys in the dynamic modem data value map. */
+#define CBOR_MODEM_CURRENT_BAND		  0
+#define CBOR_MODEM_NETWORK_MODE		  1
+#define CBOR_MODEM_RSRP			  2
+#define CBOR_MODEM_AREA_CODE		  3
+#define CBOR_MODEM_MCCMNC		  4
+#define CBOR_MODEM_CELL_ID		  5
+#define CBOR_MODEM_IP_ADDRESS		  6
+
+/* Keys in the GNSS value map. */
+#define CBOR_GNSS_LONGITUDE		  0
+#define CBOR_GNSS_LATITUDE		  1
+#define CBOR_GNSS_ACCURACY		  2
+#define CBOR_GNSS_ALTITUDE		  3
+#define CBOR_GNSS_SPEED			  4
+#define CBOR_GNSS_HEADING		  5
+
+/* Keys in the environmental value map. */
+#define CBOR_ENV_TEMPERATURE		  0
+#define CBOR_ENV_HUMIDITY		  1
+#define CBOR_ENV_PRESSURE		  2
+#define CBOR_ENV_BSEC_IAQ		  3
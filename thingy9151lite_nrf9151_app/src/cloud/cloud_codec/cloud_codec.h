@@ -21,6 +21,8 @@
 #include <net/wifi_location_common.h>
 #include <nrf_modem_gnss.h>
 
+#include "cloud_codec_ringbuffer.h"
+
 #if defined(CONFIG_LWM2M)
 #include <zephyr/net/lwm2m.h>
 #else
@@ -46,6 +48,8 @@ struct cloud_data_battery {
 	int64_t bat_ts;
 	/** Flag signifying that the data entry is to be encoded. */
 	bool queued : 1;
+	/** Flag signifying that the timestamp is already in UNIX milliseconds. */
+	bool ts_unix : 1;
 };
 
 struct cloud_data_gnss_pvt {
@@ -73,6 +77,8 @@ struct cloud_data_gnss {
 
 	/** Flag signifying that the data entry is to be encoded. */
 	bool queued : 1;
+	/** Flag signifying that the timestamp is already in UNIX milliseconds. */
+	bool ts_unix : 1;
 };
 
 /** Structure containing boolean variables used to enable/disable inclusion of the corresponding
@@ -110,6 +116,10 @@ struct cloud_data_cfg {
 	double accelerometer_inactivity_timeout;
 	/** Variable used to govern what data types are requested by the application. */
 	struct cloud_data_no_data no_data;
+	/** Policy that decides when data is sent, based on LTE connection evaluation.
+	 *  0: energy threshold, 1: adaptive, 2: always send.
+	 */
+	int send_policy;
 };
 
 /** Structure containing the magnitude of an impact event detected by the high-G Accelerometer. */
@@ -120,6 +130,8 @@ struct cloud_data_impact {
 	double magnitude;
 	/** Flag signifying that the data entry is to be published. */
 	bool queued : 1;
+	/** Flag signifying that the timestamp is already in UNIX milliseconds. */
+	bool ts_unix : 1;
 };
 
 struct cloud_data_sensors {
@@ -137,6 +149,8 @@ struct cloud_data_sensors {
 	int bsec_air_quality;
 	/** Flag signifying that the data entry is to be encoded. */
 	bool queued : 1;
+	/** Flag signifying that the timestamp is already in UNIX milliseconds. */
+	bool ts_unix : 1;
 };
 
 struct cloud_data_modem_static {
@@ -181,6 +195,8 @@ struct cloud_data_modem_dynamic {
 	char mccmnc[7];
 	/** Flag signifying that the data entry is to be encoded. */
 	bool queued : 1;
+	/** Flag signifying that the timestamp is already in UNIX milliseconds. */
+	bool ts_unix : 1;
 };
 
 struct cloud_data_ui {
@@ -190,6 +206,8 @@ struct cloud_data_ui {
 	int64_t btn_ts;
 	/** Flag signifying that the data entry is to be encoded. */
 	bool queued : 1;
+	/** Flag signifying that the timestamp is already in UNIX milliseconds. */
+	bool ts_unix : 1;
 };
 
 struct cloud_codec_data {
@@ -271,6 +289,15 @@ struct cloud_data_pgps_request {
 	bool queued : 1;
 };
 
+/** Ringbuffers for data that is sampled and encoded in batch messages. */
+CLOUD_CODEC_RINGBUFFER_DECLARE(cloud_data_gnss_ringbuffer, struct cloud_data_gnss)
+CLOUD_CODEC_RINGBUFFER_DECLARE(cloud_data_sensors_ringbuffer, struct cloud_data_sensors)
+CLOUD_CODEC_RINGBUFFER_DECLARE(cloud_data_ui_ringbuffer, struct cloud_data_ui)
+CLOUD_CODEC_RINGBUFFER_DECLARE(cloud_data_impact_ringbuffer, struct cloud_data_impact)
+CLOUD_CODEC_RINGBUFFER_DECLARE(cloud_data_battery_ringbuffer, struct cloud_data_battery)
+CLOUD_CODEC_RINGBUFFER_DECLARE(cloud_data_modem_dynamic_ringbuffer,
+			       struct cloud_data_modem_dynamic)
+
 enum cloud_codec_event_type {
 	/** Only used in LwM2M codec. This event carries a config update. */
 	CLOUD_CODEC_EVT_CONFIG_UPDATE = 1,
@@ -464,6 +491,13 @@ int cloud_codec_encode_impact_data(struct cloud_codec_data *output,
 /**
  * @brief Encode a batch of cloud buffer data.
  *
+ * @note Only the first entries of each buffer, up to the given count, are read. To encode the
+ *	 live entries of a ringbuffer, pass the entries returned by its peek function.
+ *
+ * @note The queued flag of the encoded entries is cleared. The message size may be bounded by
+ *	 the backend, in which case only the oldest entries that fit are encoded and the
+ *	 remaining entries are left queued for the next call.
+ *
  * @param[out] output string buffer for encoding result.
  * @param[in] gnss_buf GNSS data buffer.
  * @param[in] sensor_buf Sensor data buffer.
@@ -502,39 +536,6 @@ int cloud_codec_encode_batch_data(struct cloud_codec_data *output,
 				  size_t impact_buf_count,
 				  size_t bat_buf_count);
 
-void cloud_codec_populate_sensor_buffer(
-				struct cloud_data_sensors *sensor_buffer,
-				struct cloud_data_sensors *new_sensor_data,
-				int *head_sensor_buf,
-				size_t buffer_count);
-
-void cloud_codec_populate_ui_buffer(struct cloud_data_ui *ui_buffer,
-				    struct cloud_data_ui *new_ui_data,
-				    int *head_ui_buf,
-				    size_t buffer_count);
-
-void cloud_codec_populate_impact_buffer(
-				struct cloud_data_impact *impact_buf,
-				struct cloud_data_impact *new_impact_data,
-				int *head_impact_buf,
-				size_t buffer_count);
-
-void cloud_codec_populate_bat_buffer(struct cloud_data_battery *bat_buffer,
-				     struct cloud_data_battery *new_bat_data,
-				     int *head_bat_buf,
-				     size_t buffer_count);
-
-void cloud_codec_populate_gnss_buffer(struct cloud_data_gnss *gnss_buffer,
-				     struct cloud_data_gnss *new_gnss_data,
-				     int *head_gnss_buf,
-				     size_t buffer_count);
-
-void cloud_codec_populate_modem_dynamic_buffer(
-				struct cloud_data_modem_dynamic *modem_buffer,
-				struct cloud_data_modem_dynamic *new_modem_data,
-				int *head_modem_buf,
-				size_t buffer_count);
-
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#if defined(CONFIG_CLOUD_CODEC_COMPRESS_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "cloud_codec_compress.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(cloud_codec_compress, CONFIG_CLOUD_CODEC_LOG_LEVEL);
+
+/* Frame descriptor: version 01, independent blocks, content size present. */
+#define FRAME_FLG		0x68
+/* Frame descriptor: 64 KB maximum block size. */
+#define FRAME_BD		0x40
+#define FRAME_BLOCK_SIZE_MAX	(64 * 1024)
+/* Magic number, FLG, BD, content size and header checksum. */
+#define FRAME_HEADER_SIZE	15
+/* Block size and end mark. */
+#define FRAME_OVERHEAD		(FRAME_HEADER_SIZE + sizeof(uint32_t) * 2)
+#define BLOCK_UNCOMPRESSED	BIT(31)
+
+/* Block format limits, see the LZ4 block format specification. */
+#define MIN_MATCH		4
+#define LAST_LITERALS		5
+#define MATCH_FIND_LIMIT	12
+#define OFFSET_MAX		UINT16_MAX
+#define RUN_MASK		15
+
+#define HASH_BITS		CONFIG_CLOUD_CODEC_COMPRESS_HASH_BITS
+
+/* xxHash32 primes, used for the frame header checksum. */
+#define PRIME32_1		2654435761U
+#define PRIME32_2		2246822519U
+#define PRIME32_3		3266489917U
+#define PRIME32_4		668265263U
+#define PRIME32_5		374761393U
+
+/* Output writer. If buf is NULL, only the length of the output is computed. */
+struct writer {
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+};
+
+/* Last position in the block of each hashed 4-byte sequence. Positions are relative to the
+ * start of the block, which is at most 64 KB. Stale entries are harmless, every candidate
+ * match is verified.
+ */
+static uint16_t hash_table[1 << HASH_BITS];
+
+static struct cloud_codec_compress_stats stats;
+
+/* Serializes compressions, the hash table is shared. */
+static K_MUTEX_DEFINE(compress_lock);
+
+static void write_bytes(struct writer *w, const uint8_t *data, size_t len)
+{
+	if ((w->buf != NULL) && (w->len + len <= w->size)) {
+		memcpy(&w->buf[w->len], data, len);
+	}
+
+	w->len += len;
+}
+
+static void write_u8(struct writer *w, uint8_t value)
+{
+	write_bytes(w, &value, sizeof(value));
+}
+
+static void write_le32(struct writer *w, uint32_t value)
+{
+	uint8_t bytes[sizeof(uint32_t)];
+
+	sys_put_le32(value, bytes);
+	write_bytes(w, bytes, sizeof(bytes));
+}
+
+static void patch_le32(struct writer *w, size_t offset, uint32_t value)
+{
+	if ((w->buf != NULL) && (offset + sizeof(uint32_t) <= w->size)) {
+		sys_put_le32(value, &w->buf[offset]);
+	}
+}
+
+/* Write the remainder of a literal or match length that does not fit in the token. */
+static void write_length(struct writer *w, size_t len)
+{
+	while (len >= UINT8_MAX) {
+		write_u8(w, UINT8_MAX);
+		len -= UINT8_MAX;
+	}
+
+	write_u8(w, len);
+}
+
+static void write_sequence(struct writer *w, const uint8_t *literals, size_t literal_len,
+			   uint16_t offset, size_t match_len)
+{
+	size_t match_code = (match_len > 0) ? match_len - MIN_MATCH : 0;
+	uint8_t token = (MIN(literal_len, RUN_MASK) << 4) | MIN(match_code, RUN_MASK);
+
+	write_u8(w, token);
+
+	if (literal_len >= RUN_MASK) {
+		write_length(w, literal_len - RUN_MASK);
+	}
+
+	write_bytes(w, literals, literal_len);
+
+	/* The last sequence of a block only has literals. */
+	if (match_len == 0) {
+		return;
+	}
+
+	write_u8(w, offset & 0xFF);
+	write_u8(w, offset >> 8);
+
+	if (match_code >= RUN_MASK) {
+		write_length(w, match_code - RUN_MASK);
+	}
+}
+
+static uint32_t hash(uint32_t sequence)
+{
+	return (sequence * PRIME32_1) >> (32 - HASH_BITS);
+}
+
+/* Greedy LZ4 block compression with a single entry per hash bucket. */
+static void block_compress(struct writer *w, const uint8_t *src, size_t len)
+{
+	size_t pos = 0;
+	size_t anchor = 0;
+
+	memset(hash_table, 0, sizeof(hash_table));
+
+	while (len >= MATCH_FIND_LIMIT + 1 && pos <= len - MATCH_FIND_LIMIT) {
+		uint32_t sequence = sys_get_le32(&src[pos]);
+		uint32_t h = hash(sequence);
+		size_t candidate = hash_table[h];
+		size_t match_len = MIN_MATCH;
+
+		hash_table[h] = pos;
+
+		if ((candidate >= pos) || (pos - candidate > OFFSET_MAX) ||
+		    (sys_get_le32(&src[candidate]) != sequence)) {
+			pos++;
+			continue;
+		}
+
+		while ((pos + match_len < len - LAST_LITERALS) &&
+		       (src[candidate + match_len] == src[pos + match_len])) {
+			match_len++;
+		}
+
+		write_sequence(w, &src[anchor], pos - anchor, pos - candidate, match_len);
+
+		pos += match_len;
+		anchor = pos;
+	}
+
+	write_sequence(w, &src[anchor], len - anchor, 0, 0);
+}
+
+static void block_write(struct writer *w, const uint8_t *src, size_t len)
+{
+	size_t header = w->len;
+	size_t compressed_len;
+
+	write_le32(w, 0);
+	block_compress(w, src, len);
+
+	compressed_len = w->len - header - sizeof(uint32_t);
+
+	if (compressed_len < len) {
+		patch_le32(w, header, compressed_len);
+		return;
+	}
+
+	/* Incompressible data is stored as is. */
+	w->len = header;
+	write_le32(w, len | BLOCK_UNCOMPRESSED);
+	write_bytes(w, src, len);
+}
+
+static uint32_t rotl32(uint32_t value, uint8_t shift)
+{
+	return (value << shift) | (value >> (32 - shift));
+}
+
+/* xxHash32 with seed 0, for inputs shorter than 16 bytes. */
+static uint32_t xxh32_short(const uint8_t *data, size_t len)
+{
+	uint32_t h = PRIME32_5 + len;
+	size_t i = 0;
+
+	__ASSERT_NO_MSG(len < 16);
+
+	for (; i + sizeof(uint32_t) <= len; i += sizeof(uint32_t)) {
+		h += sys_get_le32(&data[i]) * PRIME32_3;
+		h = rotl32(h, 17) * PRIME32_4;
+	}
+
+	for (; i < len; i++) {
+		h += data[i] * PRIME32_5;
+		h = rotl32(h, 11) * PRIME32_1;
+	}
+
+	h ^= h >> 15;
+	h *= PRIME32_2;
+	h ^= h >> 13;
+	h *= PRIME32_3;
+	h ^= h >> 16;
+
+	return h;
+}
+
+static void frame_write(struct writer *w, const uint8_t *src, size_t len)
+{
+	uint8_t descriptor[2 + sizeof(uint64_t)] = { FRAME_FLG, FRAME_BD };
+
+	sys_put_le64(len, &descriptor[2]);
+
+	write_le32(w, CLOUD_CODEC_COMPRESS_MAGIC);
+	write_bytes(w, descriptor, sizeof(descriptor));
+	write_u8(w, (xxh32_short(descriptor, sizeof(descriptor)) >> 8) & 0xFF);
+
+	for (size_t offset = 0; offset < len; offset += FRAME_BLOCK_SIZE_MAX) {
+		block_write(w, &src[offset], MIN(len - offset, FRAME_BLOCK_SIZE_MAX));
+	}
+
+	/* End mark. */
+	write_le32(w, 0);
+}
+
+int cloud_codec_compress(struct cloud_codec_data *output)
+{
+	struct writer w = { 0 };
+	uint32_t start = k_cycle_get_32();
+	uint32_t time_us;
+	uint8_t *buf;
+
+	if ((output == NULL) || (output->buf == NULL) || (output->len == 0)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&compress_lock, K_FOREVER);
+
+	/* Compute the compressed length first, so that no larger buffer than needed is
+	 * allocated. The compression is deterministic, the second pass has the same length.
+	 */
+	frame_write(&w, (const uint8_t *)output->buf, output->len);
+
+	if (w.len >= output->len) {
+		LOG_DBG("Compression does not reduce the size of %zu bytes", output->len);
+		stats.skipped++;
+		k_mutex_unlock(&compress_lock);
+		return -EMSGSIZE;
+	}
+
+	buf = k_malloc(w.len);
+	if (buf == NULL) {
+		LOG_WRN("Cannot allocate %zu bytes for the compressed message", w.len);
+		stats.skipped++;
+		k_mutex_unlock(&compress_lock);
+		return -ENOMEM;
+	}
+
+	w.buf = buf;
+	w.size = w.len;
+	w.len = 0;
+
+	frame_write(&w, (const uint8_t *)output->buf, output->len);
+
+	__ASSERT_NO_MSG(w.len == w.size);
+
+	time_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	stats.count++;
+	stats.bytes_in += output->len;
+	stats.bytes_out += w.len;
+	stats.last_us = time_us;
+	stats.max_us = MAX(stats.max_us, time_us);
+	stats.total_us += time_us;
+
+	k_mutex_unlock(&compress_lock);
+
+	LOG_INF("Message compressed from %zu to %zu bytes (%zu%%) in %u us",
+		output->len, w.len, w.len * 100 / output->len, time_us);
+
+	k_free(output->buf);
+
+	output->buf = (char *)buf;
+	output->len = w.len;
+
+	return 0;
+}
+
+bool cloud_codec_compressed(const uint8_t *buf, size_t len)
+{
+	return (buf != NULL) && (len >= FRAME_OVERHEAD) &&
+	       (sys_get_le32(buf) == CLOUD_CODEC_COMPRESS_MAGIC);
+}
+
+int cloud_codec_compress_stats_get(struct cloud_codec_compress_stats *out)
+{
+	if (out == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&compress_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&compress_lock);
+
+	return 0;
+}
+
+void cloud_codec_compress_stats_reset(void)
+{
+	k_mutex_lock(&compress_lock, K_FOREVER);
+	memset(&stats, 0, sizeof(stats));
+	k_mutex_unlock(&compress_lock);
+}
+
+#if defined(CONFIG_CLOUD_CODEC_COMPRESS_SHELL)
+static int cmd_compress_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	struct cloud_codec_compress_stats current;
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	(void)cloud_codec_compress_stats_get(&current);
+
+	shell_print(sh, "Compressed messages: %u", current.count);
+	shell_print(sh, "Uncompressed messages: %u", current.skipped);
+
+	if (current.count == 0) {
+		return 0;
+	}
+
+	shell_print(sh, "Bytes: %llu -> %llu (%llu%%)",
+		    (unsigned long long)current.bytes_in, (unsigned long long)current.bytes_out,
+		    (unsigned long long)(current.bytes_out * 100 / current.bytes_in));
+	shell_print(sh, "CPU time: last %u us, max %u us, average %llu us",
+		    current.last_us, current.max_us,
+		    (unsigned long long)(current.total_us / current.count));
+
+	return 0;
+}
+
+static int cmd_compress_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	cloud_codec_compress_stats_reset();
+	shell_print(sh, "Compression statistics reset");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_compress,
+	SHELL_CMD(stats, NULL, "Print batch compression statistics", cmd_compress_stats),
+	SHELL_CMD(reset, NULL, "Reset batch compression statistics", cmd_compress_reset),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(batch_compress, &sub_compress, "Batch message compression", NULL);
+#endif /* CONFIG_CLOUD_CODEC_COMPRESS_SHELL */
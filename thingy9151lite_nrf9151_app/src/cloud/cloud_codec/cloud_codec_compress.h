@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_CODEC_COMPRESS_H__
+#define CLOUD_CODEC_COMPRESS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+
+#include "cloud_codec.h"
+
+/**@file
+ *
+ * @defgroup cloud_codec_compress Cloud codec compression
+ * @brief    Compression of encoded batch messages.
+ *
+ * @details Encoded messages are compressed into an LZ4 frame, see the LZ4 frame format
+ *	    specification. The frame starts with the LZ4 magic number, which cannot be the start
+ *	    of a JSON document. The backend detects compressed messages by this marker and
+ *	    decompresses them with any LZ4 frame decoder, for instance "lz4 -d".
+ *
+ *	    The compressor writes its output through a writer that either stores it or only
+ *	    counts it. The compressed length is computed in a first pass, so that the output
+ *	    buffer can be allocated with the exact compressed size. No buffer of the size of
+ *	    the uncompressed message is allocated.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** LZ4 frame magic number, little endian. Marks a compressed message. */
+#define CLOUD_CODEC_COMPRESS_MAGIC 0x184D2204
+
+/** @brief Compression statistics. */
+struct cloud_codec_compress_stats {
+	/** Number of compressed messages. */
+	uint32_t count;
+	/** Number of messages that were left uncompressed, because compression did not make
+	 *  them smaller or memory could not be allocated.
+	 */
+	uint32_t skipped;
+	/** Total size of the compressed messages before compression. */
+	uint64_t bytes_in;
+	/** Total size of the compressed messages after compression. */
+	uint64_t bytes_out;
+	/** CPU time of the last compression, in microseconds. */
+	uint32_t last_us;
+	/** Longest CPU time of a compression, in microseconds. */
+	uint32_t max_us;
+	/** Total CPU time of all compressions, in microseconds. */
+	uint64_t total_us;
+};
+
+#if defined(CONFIG_CLOUD_CODEC_COMPRESS)
+
+/**
+ * @brief Compress an encoded message.
+ *
+ * @details On success, the message buffer is freed and replaced by a heap allocated buffer
+ *	    holding the compressed message, which must be freed with k_free(). Otherwise the
+ *	    message is left unchanged and can be sent uncompressed.
+ *
+ * @param[in, out] output Encoded message.
+ *
+ * @retval 0 on success.
+ * @retval -EMSGSIZE if the compressed message would not be smaller than the message.
+ * @retval -ENOMEM if memory could not be allocated for the compressed message.
+ * @retval -EINVAL if the message is empty.
+ */
+int cloud_codec_compress(struct cloud_codec_data *output);
+
+/**
+ * @brief Check whether a message is compressed.
+ *
+ * @param[in] buf Message.
+ * @param[in] len Length of the message.
+ *
+ * @return true if the message starts with the compression marker.
+ */
+bool cloud_codec_compressed(const uint8_t *buf, size_t len);
+
+/**
+ * @brief Get the compression statistics.
+ *
+ * @param[out] stats Compression statistics.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if stats is NULL.
+ */
+int cloud_codec_compress_stats_get(struct cloud_codec_compress_stats *stats);
+
+/**
+ * @brief Reset the compression statistics.
+ */
+void cloud_codec_compress_stats_reset(void);
+
+#else
+
+static inline int cloud_codec_compress(struct cloud_codec_data *output)
+{
+	(void)output;
+
+	return -ENOTSUP;
+}
+
+static inline bool cloud_codec_compressed(const uint8_t *buf, size_t len)
+{
+	(void)buf;
+	(void)len;
+
+	return false;
+}
+
+static inline int cloud_codec_compress_stats_get(struct cloud_codec_compress_stats *stats)
+{
+	(void)stats;
+
+	return -ENOTSUP;
+}
+
+static inline void cloud_codec_compress_stats_reset(void)
+{
+}
+
+#endif /* CONFIG_CLOUD_CODEC_COMPRESS */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* CLOUD_CODEC_COMPRESS_H__ */
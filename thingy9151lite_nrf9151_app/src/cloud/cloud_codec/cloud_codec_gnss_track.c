@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <math.h>
+
+#include "cloud_codec_gnss_track.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(cloud_codec_gnss_track, CONFIG_CLOUD_CODEC_LOG_LEVEL);
+
+/* Fixed-point scale factors. 1e-6 degrees is roughly 0.11 meters at the equator. */
+#define LATLON_SCALE	1000000.0
+#define ALT_SCALE	10.0f
+#define ACC_SCALE	10.0f
+#define SPD_SCALE	10.0f
+#define HDG_SCALE	10.0f
+
+/* Maximum length of a LEB128 coded 64-bit value. */
+#define VARINT_LEN_MAX	10
+
+/* A fix is coded as seven varints: timestamp followed by the six PVT fields. */
+#define FIX_LEN_MAX	(7 * VARINT_LEN_MAX)
+
+BUILD_ASSERT(CONFIG_CLOUD_CODEC_GNSS_TRACK_BLOCK_SIZE >= FIX_LEN_MAX,
+	     "GNSS track block must fit at least one fix");
+BUILD_ASSERT(CONFIG_CLOUD_CODEC_GNSS_TRACK_BLOCK_SIZE <= UINT16_MAX,
+	     "GNSS track block is too large");
+
+static uint64_t zigzag_encode(int64_t value)
+{
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t varint_write(uint8_t *buf, int64_t value)
+{
+	uint64_t zz = zigzag_encode(value);
+	size_t len = 0;
+
+	do {
+		buf[len] = zz & 0x7F;
+		zz >>= 7;
+
+		if (zz) {
+			buf[len] |= 0x80;
+		}
+
+		len++;
+	} while (zz);
+
+	return len;
+}
+
+/* Returns the number of bytes read, or 0 if the varint is truncated or too long. */
+static size_t varint_read(const uint8_t *buf, size_t buf_len, int64_t *value)
+{
+	uint64_t zz = 0;
+
+	for (size_t i = 0; (i < buf_len) && (i < VARINT_LEN_MAX); i++) {
+		zz |= (uint64_t)(buf[i] & 0x7F) << (7 * i);
+
+		if (!(buf[i] & 0x80)) {
+			*value = zigzag_decode(zz);
+			return i + 1;
+		}
+	}
+
+	return 0;
+}
+
+static void state_from_fix(struct cloud_codec_gnss_track_state *state,
+			   const struct cloud_data_gnss *fix)
+{
+	state->ts = fix->gnss_ts;
+	state->lat = (int32_t)llround(fix->pvt.lat * LATLON_SCALE);
+	state->longi = (int32_t)llround(fix->pvt.longi * LATLON_SCALE);
+	state->alt = (int32_t)lroundf(fix->pvt.alt * ALT_SCALE);
+	state->acc = (int32_t)lroundf(fix->pvt.acc * ACC_SCALE);
+	state->spd = (int32_t)lroundf(fix->pvt.spd * SPD_SCALE);
+	state->hdg = (int32_t)lroundf(fix->pvt.hdg * HDG_SCALE);
+}
+
+static void state_to_fix(const struct cloud_codec_gnss_track_state *state,
+			 struct cloud_data_gnss *fix)
+{
+	memset(fix, 0, sizeof(struct cloud_data_gnss));
+
+	fix->gnss_ts = state->ts;
+	fix->pvt.lat = state->lat / LATLON_SCALE;
+	fix->pvt.longi = state->longi / LATLON_SCALE;
+	fix->pvt.alt = state->alt / ALT_SCALE;
+	fix->pvt.acc = state->acc / ACC_SCALE;
+	fix->pvt.spd = state->spd / SPD_SCALE;
+	fix->pvt.hdg = state->hdg / HDG_SCALE;
+	fix->queued = true;
+}
+
+/* Code a fix against state, and update state to the fix. Returns the coded length. */
+static size_t fix_encode(struct cloud_codec_gnss_track_state *state,
+			 const struct cloud_data_gnss *fix, uint8_t *buf)
+{
+	struct cloud_codec_gnss_track_state next = { 0 };
+	size_t len = 0;
+
+	state_from_fix(&next, fix);
+	next.ts_delta = next.ts - state->ts;
+	next.lat_delta = next.lat - state->lat;
+	next.longi_delta = next.longi - state->longi;
+
+	len += varint_write(&buf[len], next.ts_delta - state->ts_delta);
+	len += varint_write(&buf[len], (int64_t)next.lat_delta - state->lat_delta);
+	len += varint_write(&buf[len], (int64_t)next.longi_delta - state->longi_delta);
+	len += varint_write(&buf[len], (int64_t)next.alt - state->alt);
+	len += varint_write(&buf[len], (int64_t)next.acc - state->acc);
+	len += varint_write(&buf[len], (int64_t)next.spd - state->spd);
+	len += varint_write(&buf[len], (int64_t)next.hdg - state->hdg);
+
+	*state = next;
+
+	return len;
+}
+
+/* Decode a fix coded against state, and update state to the fix.
+ * Returns the coded length, or 0 if the data is corrupt.
+ */
+static size_t fix_decode(struct cloud_codec_gnss_track_state *state,
+			 const uint8_t *buf, size_t buf_len)
+{
+	int64_t values[7];
+	size_t len = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(values); i++) {
+		size_t field_len = varint_read(&buf[len], buf_len - len, &values[i]);
+
+		if (field_len == 0) {
+			return 0;
+		}
+
+		len += field_len;
+	}
+
+	state->ts_delta += values[0];
+	state->ts += state->ts_delta;
+	state->lat_delta += (int32_t)values[1];
+	state->lat += state->lat_delta;
+	state->longi_delta += (int32_t)values[2];
+	state->longi += state->longi_delta;
+	state->alt += (int32_t)values[3];
+	state->acc += (int32_t)values[4];
+	state->spd += (int32_t)values[5];
+	state->hdg += (int32_t)values[6];
+
+	return len;
+}
+
+static struct cloud_codec_gnss_track_block *block_oldest(struct cloud_codec_gnss_track *track)
+{
+	return &track->blocks[track->tail];
+}
+
+static struct cloud_codec_gnss_track_block *block_newest(struct cloud_codec_gnss_track *track)
+{
+	return &track->blocks[(track->tail + track->used - 1) % track->block_count];
+}
+
+static void block_release_oldest(struct cloud_codec_gnss_track *track)
+{
+	struct cloud_codec_gnss_track_block *block = block_oldest(track);
+
+	track->count -= block->count - track->read_count;
+	track->tail = (track->tail + 1) % track->block_count;
+	track->used--;
+	track->read_offset = 0;
+	track->read_count = 0;
+	memset(&track->read_state, 0, sizeof(track->read_state));
+}
+
+static struct cloud_codec_gnss_track_block *block_open(struct cloud_codec_gnss_track *track)
+{
+	struct cloud_codec_gnss_track_block *block;
+
+	/* The newest block is kept open after all its fixes have been read. It is released before
+	 * the next block is opened, so that reading does not resume at its end.
+	 */
+	if ((track->used > 0) && (track->read_count == block_oldest(track)->count)) {
+		block_release_oldest(track);
+	}
+
+	if (track->used == track->block_count) {
+		LOG_DBG("GNSS track full, dropping %zu fixes",
+			block_oldest(track)->count - track->read_count);
+		block_release_oldest(track);
+	}
+
+	track->used++;
+
+	block = block_newest(track);
+	block->len = 0;
+	block->count = 0;
+	memset(&track->write_state, 0, sizeof(track->write_state));
+
+	return block;
+}
+
+static void fix_compress(struct cloud_codec_gnss_track *track, const struct cloud_data_gnss *fix)
+{
+	struct cloud_codec_gnss_track_block *block = NULL;
+	struct cloud_codec_gnss_track_state state;
+	uint8_t buf[FIX_LEN_MAX];
+	size_t len = 0;
+
+	if (track->used > 0) {
+		block = block_newest(track);
+		state = track->write_state;
+		len = fix_encode(&state, fix, buf);
+	}
+
+	if ((block == NULL) || (len > sizeof(block->data) - block->len) ||
+	    (block->count == UINT16_MAX)) {
+		block = block_open(track);
+		state = track->write_state;
+		len = fix_encode(&state, fix, buf);
+	}
+
+	memcpy(&block->data[block->len], buf, len);
+	block->len += len;
+	block->count++;
+	track->write_state = state;
+	track->count++;
+}
+
+void cloud_codec_gnss_track_add(struct cloud_codec_gnss_track *track,
+				const struct cloud_data_gnss *fix)
+{
+	__ASSERT_NO_MSG(track != NULL);
+	__ASSERT_NO_MSG(fix != NULL);
+	__ASSERT_NO_MSG(!fix->ts_unix);
+
+	if (track->newest.queued) {
+		fix_compress(track, &track->newest);
+	}
+
+	track->newest = *fix;
+}
+
+struct cloud_data_gnss *cloud_codec_gnss_track_newest(struct cloud_codec_gnss_track *track)
+{
+	__ASSERT_NO_MSG(track != NULL);
+
+	return &track->newest;
+}
+
+int cloud_codec_gnss_track_get(struct cloud_codec_gnss_track *track,
+			       struct cloud_data_gnss *fix)
+{
+	struct cloud_codec_gnss_track_block *block;
+	size_t len;
+
+	__ASSERT_NO_MSG(track != NULL);
+	__ASSERT_NO_MSG(fix != NULL);
+
+	if (track->count == 0) {
+		if (!track->newest.queued) {
+			return -ENODATA;
+		}
+
+		*fix = track->newest;
+		track->newest.queued = false;
+		return 0;
+	}
+
+	block = block_oldest(track);
+
+	len = fix_decode(&track->read_state, &block->data[track->read_offset],
+			 block->len - track->read_offset);
+	if (len == 0) {
+		LOG_ERR("Corrupt GNSS track block, dropping %zu fixes",
+			block->count - track->read_count);
+		block_release_oldest(track);
+		return -EBADMSG;
+	}
+
+	state_to_fix(&track->read_state, fix);
+
+	track->read_offset += len;
+	track->read_count++;
+	track->count--;
+
+	/* The newest block is kept open for writing even if all its fixes have been read. */
+	if ((track->read_count == block->count) && (track->used > 1)) {
+		block_release_oldest(track);
+	}
+
+	return 0;
+}
+
+size_t cloud_codec_gnss_track_peek(const struct cloud_codec_gnss_track *track,
+				   struct cloud_data_gnss *fixes, size_t count)
+{
+	/* Reading only moves the read cursor, so the fixes are read from a copy of the track. */
+	struct cloud_codec_gnss_track cursor;
+	size_t decoded = 0;
+	int err;
+
+	__ASSERT_NO_MSG(track != NULL);
+	__ASSERT_NO_MSG((fixes != NULL) || (count == 0));
+
+	cursor = *track;
+
+	while (decoded < count) {
+		err = cloud_codec_gnss_track_get(&cursor, &fixes[decoded]);
+		if (err == -ENODATA) {
+			break;
+		} else if (err) {
+			continue;
+		}
+
+		decoded++;
+	}
+
+	return decoded;
+}
+
+void cloud_codec_gnss_track_release(struct cloud_codec_gnss_track *track, size_t count)
+{
+	struct cloud_data_gnss fix;
+	int err;
+
+	__ASSERT_NO_MSG(track != NULL);
+
+	while (count > 0) {
+		err = cloud_codec_gnss_track_get(track, &fix);
+		if (err == -ENODATA) {
+			break;
+		} else if (err) {
+			continue;
+		}
+
+		count--;
+	}
+}
+
+size_t cloud_codec_gnss_track_count(const struct cloud_codec_gnss_track *track)
+{
+	__ASSERT_NO_MSG(track != NULL);
+
+	return track->count + (track->newest.queued ? 1 : 0);
+}
+
+void cloud_codec_gnss_track_reset(struct cloud_codec_gnss_track *track)
+{
+	__ASSERT_NO_MSG(track != NULL);
+
+	track->tail = 0;
+	track->used = 0;
+	track->count = 0;
+	track->read_offset = 0;
+	track->read_count = 0;
+	memset(&track->write_state, 0, sizeof(track->write_state));
+	memset(&track->read_state, 0, sizeof(track->read_state));
+	memset(&track->newest, 0, sizeof(track->newest));
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_CODEC_GNSS_TRACK_H__
+#define CLOUD_CODEC_GNSS_TRACK_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <stdint.h>
+
+#include "cloud_codec.h"
+
+/**@file
+ *
+ * @defgroup cloud_codec_gnss_track Cloud codec compressed GNSS track.
+ * @brief    Compressed store for buffered GNSS fixes.
+ *
+ * @details Fixes are stored in fixed-size blocks. Latitude and longitude are stored in fixed
+ *	    point with a resolution of 1e-6 degrees, altitude, accuracy, speed and heading with
+ *	    a resolution of 0.1 units. Fields are stored as zigzag varints. Timestamp, latitude
+ *	    and longitude are coded as delta-of-delta, which is close to zero for an asset
+ *	    sampled at a fixed interval and moving at a steady velocity. The other fields are
+ *	    coded as deltas to the previous fix in the block. The first fix in a block is coded
+ *	    against zero, so that every block can be decoded on its own.
+ *
+ *	    The newest fix is kept uncompressed so that it can be encoded outside of a batch
+ *	    message. It is only added to the compressed blocks if it is still queued when
+ *	    the next fix arrives. When all blocks are full, the oldest block is dropped.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Block of compressed fixes. */
+struct cloud_codec_gnss_track_block {
+	/** Number of bytes used in data. */
+	uint16_t len;
+	/** Number of fixes in the block. */
+	uint16_t count;
+	/** Compressed fixes. */
+	uint8_t data[CONFIG_CLOUD_CODEC_GNSS_TRACK_BLOCK_SIZE];
+};
+
+/** @brief Fixed-point values that the next fix in a block is coded against. */
+struct cloud_codec_gnss_track_state {
+	int64_t ts;
+	int64_t ts_delta;
+	int32_t lat;
+	int32_t lat_delta;
+	int32_t longi;
+	int32_t longi_delta;
+	int32_t alt;
+	int32_t acc;
+	int32_t spd;
+	int32_t hdg;
+};
+
+/** @brief Compressed GNSS track. */
+struct cloud_codec_gnss_track {
+	/** Backing array of blocks. */
+	struct cloud_codec_gnss_track_block *blocks;
+	/** Number of blocks in the backing array. */
+	size_t block_count;
+	/** Index of the oldest block in use. */
+	size_t tail;
+	/** Number of blocks in use. */
+	size_t used;
+	/** Number of compressed fixes that have not been read. */
+	size_t count;
+	/** Coding state after the last fix written to the newest block. */
+	struct cloud_codec_gnss_track_state write_state;
+	/** Coding state after the last fix read from the oldest block. */
+	struct cloud_codec_gnss_track_state read_state;
+	/** Offset of the next fix to read in the oldest block. */
+	size_t read_offset;
+	/** Number of fixes read from the oldest block. */
+	size_t read_count;
+	/** Newest fix, uncompressed. */
+	struct cloud_data_gnss newest;
+};
+
+/**
+ * @brief Initializer for a compressed GNSS track.
+ *
+ * @param _blocks Backing array of struct cloud_codec_gnss_track_block.
+ */
+#define CLOUD_CODEC_GNSS_TRACK_INITIALIZER(_blocks) \
+	{ .blocks = (_blocks), .block_count = ARRAY_SIZE(_blocks) }
+
+/**
+ * @brief Add a fix to the track.
+ *
+ * @note The fix becomes the newest fix. The previous newest fix is compressed if it is still
+ *	 queued, and dropped otherwise. Timestamps must be in uptime, fixes that have the
+ *	 ts_unix flag set are not supported.
+ *
+ * @param[in, out] track Pointer to track.
+ * @param[in] fix Pointer to fix.
+ */
+void cloud_codec_gnss_track_add(struct cloud_codec_gnss_track *track,
+				const struct cloud_data_gnss *fix);
+
+/**
+ * @brief Get the newest fix.
+ *
+ * @note The entry is returned even if it has been consumed, the caller is expected to check
+ *	 its queued flag.
+ *
+ * @param[in] track Pointer to track.
+ *
+ * @return Pointer to the newest fix.
+ */
+struct cloud_data_gnss *cloud_codec_gnss_track_newest(struct cloud_codec_gnss_track *track);
+
+/**
+ * @brief Decode and release the oldest queued fix.
+ *
+ * @param[in, out] track Pointer to track.
+ * @param[out] fix Pointer to structure that the decoded fix is stored in.
+ *
+ * @retval 0 on success.
+ * @retval -ENODATA if there are no queued fixes.
+ * @retval -EBADMSG if a block is corrupt. The block is dropped.
+ */
+int cloud_codec_gnss_track_get(struct cloud_codec_gnss_track *track,
+			       struct cloud_data_gnss *fix);
+
+/**
+ * @brief Decode the oldest queued fixes without releasing them.
+ *
+ * @note Fixes in a corrupt block are skipped.
+ *
+ * @param[in] track Pointer to track.
+ * @param[out] fixes Array that the decoded fixes are stored in, oldest first.
+ * @param[in] count Number of entries in the array.
+ *
+ * @return Number of fixes decoded.
+ */
+size_t cloud_codec_gnss_track_peek(const struct cloud_codec_gnss_track *track,
+				   struct cloud_data_gnss *fixes, size_t count);
+
+/**
+ * @brief Release the oldest queued fixes.
+ *
+ * @note Fixes in a corrupt block are skipped in the same way as by
+ *	 cloud_codec_gnss_track_peek(), so the fixes that it returned can be released by count.
+ *
+ * @param[in, out] track Pointer to track.
+ * @param[in] count Number of fixes to release.
+ */
+void cloud_codec_gnss_track_release(struct cloud_codec_gnss_track *track, size_t count);
+
+/**
+ * @brief Get the number of queued fixes.
+ *
+ * @param[in] track Pointer to track.
+ *
+ * @return Number of queued fixes, including the newest fix if it is queued.
+ */
+size_t cloud_codec_gnss_track_count(const struct cloud_codec_gnss_track *track);
+
+/**
+ * @brief Release all fixes.
+ *
+ * @param[in, out] track Pointer to track.
+ */
+void cloud_codec_gnss_track_reset(struct cloud_codec_gnss_track *track);
+
+#ifdef __cplusplus
+}
+#endif
+/**
+ * @}
+ */
+#endif
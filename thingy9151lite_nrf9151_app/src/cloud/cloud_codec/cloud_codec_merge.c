@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "cloud_codec_merge.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(cloud_codec_merge, CONFIG_CLOUD_CODEC_LOG_LEVEL);
+
+/* Outermost JSON value of a message, without surrounding whitespace. */
+struct json_value {
+	const char *buf;
+	size_t len;
+};
+
+/* Name of a top-level member of a JSON object, as it is escaped in the message. */
+struct json_name {
+	const char *buf;
+	size_t len;
+};
+
+static bool is_space(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+/* Get the outermost value of a message. Trailing NUL characters are ignored. */
+static int value_get(const struct cloud_codec_data *msg, struct json_value *value)
+{
+	const char *start = msg->buf;
+	const char *end = msg->buf + msg->len;
+
+	while ((start < end) && is_space(*start)) {
+		start++;
+	}
+
+	while ((end > start) && (is_space(end[-1]) || (end[-1] == '\0'))) {
+		end--;
+	}
+
+	if (start == end) {
+		return -EINVAL;
+	}
+
+	value->buf = start;
+	value->len = end - start;
+
+	return 0;
+}
+
+/* Return the index of the closing quote of the string that starts at index i. */
+static int string_end(const char *buf, size_t len, size_t i)
+{
+	for (i = i + 1; i < len; i++) {
+		if (buf[i] == '\\') {
+			i++;
+		} else if (buf[i] == '"') {
+			return i;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/* Get the names of the top-level members of a JSON object. */
+static int names_get(const struct json_value *obj, struct json_name names[], size_t *count)
+{
+	int depth = 0;
+	bool name_next = false;
+
+	*count = 0;
+
+	for (size_t i = 0; i < obj->len; i++) {
+		char c = obj->buf[i];
+
+		if (c == '"') {
+			int end = string_end(obj->buf, obj->len, i);
+
+			if (end < 0) {
+				return end;
+			}
+
+			if ((depth == 1) && name_next) {
+				if (*count == CLOUD_CODEC_MERGE_MEMBERS_MAX) {
+					return -ENOTSUP;
+				}
+
+				names[*count].buf = &obj->buf[i + 1];
+				names[*count].len = end - i - 1;
+				(*count)++;
+				name_next = false;
+			}
+
+			i = end;
+			continue;
+		}
+
+		switch (c) {
+		case '{':
+			/* Fall through. */
+		case '[':
+			depth++;
+			name_next = (depth == 1);
+			break;
+		case '}':
+			/* Fall through. */
+		case ']':
+			depth--;
+			break;
+		case ',':
+			name_next = (depth == 1);
+			break;
+		default:
+			break;
+		}
+	}
+
+	return (depth == 0) ? 0 : -EINVAL;
+}
+
+static bool names_disjoint(const struct json_value *a, const struct json_value *b)
+{
+	struct json_name names_a[CLOUD_CODEC_MERGE_MEMBERS_MAX];
+	struct json_name names_b[CLOUD_CODEC_MERGE_MEMBERS_MAX];
+	size_t count_a, count_b;
+
+	if (names_get(a, names_a, &count_a) || names_get(b, names_b, &count_b)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < count_a; i++) {
+		for (size_t j = 0; j < count_b; j++) {
+			if ((names_a[i].len == names_b[j].len) &&
+			    (memcmp(names_a[i].buf, names_b[j].buf, names_a[i].len) == 0)) {
+				LOG_DBG("Member %.*s present in both messages",
+					(int)names_a[i].len, names_a[i].buf);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int cloud_codec_merge(struct cloud_codec_data *dst, const struct cloud_codec_data *src,
+		      size_t size_max)
+{
+	struct json_value a, b;
+	size_t inner_a, inner_b, len;
+	char *buf;
+	int err;
+
+	if ((dst == NULL) || (src == NULL) || (dst->buf == NULL) || (src->buf == NULL)) {
+		return -EINVAL;
+	}
+
+	err = value_get(dst, &a);
+	if (err) {
+		return err;
+	}
+
+	err = value_get(src, &b);
+	if (err) {
+		return err;
+	}
+
+	if ((a.len < 2) || (b.len < 2) || (a.buf[0] != b.buf[0])) {
+		return -ENOTSUP;
+	}
+
+	switch (a.buf[0]) {
+	case '[':
+		if ((a.buf[a.len - 1] != ']') || (b.buf[b.len - 1] != ']')) {
+			return -ENOTSUP;
+		}
+		break;
+	case '{':
+		if ((a.buf[a.len - 1] != '}') || (b.buf[b.len - 1] != '}')) {
+			return -ENOTSUP;
+		}
+
+		if (!names_disjoint(&a, &b)) {
+			return -ENOTSUP;
+		}
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	/* Contents between the brackets. */
+	inner_a = a.len - 2;
+	inner_b = b.len - 2;
+
+	len = 2 + inner_a + inner_b + (((inner_a > 0) && (inner_b > 0)) ? 1 : 0);
+
+	if ((size_max > 0) && (len > size_max)) {
+		return -EMSGSIZE;
+	}
+
+	buf = k_malloc(len + 1);
+	if (buf == NULL) {
+		LOG_WRN("Cannot allocate %zu bytes for the merged message", len + 1);
+		return -ENOMEM;
+	}
+
+	/* Copy the first message without its closing bracket, then the contents of the second
+	 * message including its closing bracket.
+	 */
+	memcpy(buf, a.buf, a.len - 1);
+	len = a.len - 1;
+
+	if ((inner_a > 0) && (inner_b > 0)) {
+		buf[len++] = ',';
+	}
+
+	memcpy(&buf[len], &b.buf[1], b.len - 1);
+	len += b.len - 1;
+	buf[len] = '\0';
+
+	LOG_DBG("Merged messages of %zu and %zu bytes", dst->len, src->len);
+
+	k_free(dst->buf);
+
+	dst->buf = buf;
+	dst->len = len;
+
+	return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_CODEC_MERGE_H__
+#define CLOUD_CODEC_MERGE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+
+#include "cloud_codec.h"
+
+/**@file
+ *
+ * @defgroup cloud_codec_merge Cloud codec message merging
+ * @brief    Merging of encoded JSON messages that are published to the same topic.
+ *
+ * @details Two JSON arrays are merged into one array holding the elements of both. Two JSON
+ *	    objects are merged into one object holding the members of both, provided that they
+ *	    have no top-level member name in common. Other messages, for instance CBOR or
+ *	    compressed messages, cannot be merged.
+ *
+ *	    Messages are merged as text, they are not parsed into cJSON objects.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of top-level members of a JSON object that can be merged. */
+#define CLOUD_CODEC_MERGE_MEMBERS_MAX 16
+
+#if defined(CONFIG_CLOUD_CODEC_MERGE)
+
+/**
+ * @brief Merge an encoded message into another.
+ *
+ * @details On success, the buffer of the first message is freed and replaced by a heap
+ *	    allocated buffer holding the merged message, which must be freed with k_free().
+ *	    The second message is not changed. On failure, both messages are left unchanged.
+ *
+ * @param[in, out] dst Encoded message that the other message is merged into.
+ * @param[in] src Encoded message to merge.
+ * @param[in] size_max Maximum size of the merged message, 0 for no limit.
+ *
+ * @retval 0 on success.
+ * @retval -ENOTSUP if the messages are not both JSON arrays, or both JSON objects without
+ *	   top-level member names in common.
+ * @retval -EMSGSIZE if the merged message would be larger than size_max.
+ * @retval -ENOMEM if memory could not be allocated for the merged message.
+ * @retval -EINVAL if a message is empty.
+ */
+int cloud_codec_merge(struct cloud_codec_data *dst, const struct cloud_codec_data *src,
+		      size_t size_max);
+
+#else
+
+static inline int cloud_codec_merge(struct cloud_codec_data *dst,
+				    const struct cloud_codec_data *src, size_t size_max)
+{
+	return -ENOTSUP;
+}
+
+#endif /* CONFIG_CLOUD_CODEC_MERGE */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* CLOUD_CODEC_MERGE_H__ */
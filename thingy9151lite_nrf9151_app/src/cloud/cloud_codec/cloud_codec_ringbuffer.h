@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_CODEC_RINGBUFFER_H__
+#define CLOUD_CODEC_RINGBUFFER_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+
+/**@file
+ *
+ * @defgroup cloud_codec_ringbuffer Cloud codec ringbuffers.
+ * @brief    Type-parameterised ringbuffers for data that is encoded by the cloud codec.
+ *
+ * @details CLOUD_CODEC_RINGBUFFER_DECLARE() generates a ringbuffer structure for an entry type
+ *	    together with a set of static inline functions operating on it. The ringbuffer
+ *	    keeps track of the head, tail and number of live entries. When the ringbuffer is
+ *	    full, the oldest entry is overwritten.
+ *
+ *	    Entries are consumed without copying: peek returns a pointer to the oldest live
+ *	    entries in the backing array and commit releases them once they have been encoded.
+ *	    When the entries wrap around the end of the array, peek rotates the array first so
+ *	    that all of them are contiguous.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializer for a ringbuffer declared with CLOUD_CODEC_RINGBUFFER_DECLARE().
+ *
+ * @param _items Backing array of entries.
+ */
+#define CLOUD_CODEC_RINGBUFFER_INITIALIZER(_items) \
+	{ .items = (_items), .size = ARRAY_SIZE(_items) }
+
+/* Reverse the order of the entries in [first, last). */
+static inline void cloud_codec_ringbuffer_reverse(uint8_t *items, size_t item_size,
+						  size_t first, size_t last)
+{
+	while (first + 1 < last) {
+		uint8_t *a = &items[first * item_size];
+		uint8_t *b = &items[(last - 1) * item_size];
+
+		for (size_t i = 0; i < item_size; i++) {
+			uint8_t tmp = a[i];
+
+			a[i] = b[i];
+			b[i] = tmp;
+		}
+
+		first++;
+		last--;
+	}
+}
+
+/**
+ * @brief Rotate a backing array left by @p shift entries, in place.
+ *
+ * @details Used by the generated peek function, not meant to be called directly.
+ *
+ * @param items Backing array.
+ * @param size Number of entries in the array.
+ * @param item_size Size of an entry.
+ * @param shift Index of the entry that is moved to the start of the array.
+ */
+static inline void cloud_codec_ringbuffer_rotate(void *items, size_t size, size_t item_size,
+						 size_t shift)
+{
+	cloud_codec_ringbuffer_reverse(items, item_size, 0, shift);
+	cloud_codec_ringbuffer_reverse(items, item_size, shift, size);
+	cloud_codec_ringbuffer_reverse(items, item_size, 0, size);
+}
+
+/**
+ * @brief Declare a ringbuffer type and its access functions.
+ *
+ * @details Generates struct _name and the following functions:
+ *	    - _name_put(): Copy an entry into the ringbuffer. Returns a pointer to the stored entry.
+ *	    - _name_newest(): Get the most recently added entry. The slot is returned even if the
+ *	      entry has been consumed, the caller is expected to check its queued flag.
+ *	    - _name_peek(): Get up to n of the oldest live entries. Returns the number of entries,
+ *	      which are contiguous in the backing array starting at the returned pointer. If the
+ *	      entries wrap around the end of the array, it is rotated so that the oldest entry is
+ *	      first. Pointers to entries that were obtained earlier are then no longer valid.
+ *	    - _name_commit(): Release the n oldest live entries.
+ *	    - _name_commit_dequeued(): Release up to n of the oldest live entries, stopping at the
+ *	      first entry that is still queued. Returns the number of released entries. This
+ *	      releases the entries that have been encoded, the entry type must have a queued flag.
+ *	    - _name_count(): Get the number of live entries.
+ *	    - _name_reset(): Release and clear all entries.
+ *
+ * @param _name Name of the ringbuffer structure.
+ * @param _type Entry type.
+ */
+#define CLOUD_CODEC_RINGBUFFER_DECLARE(_name, _type)					\
+	struct _name {									\
+		_type *items;								\
+		size_t size;								\
+		size_t head;								\
+		size_t tail;								\
+		size_t count;								\
+	};										\
+											\
+	static inline _type *_name##_put(struct _name *rb, const _type *item)		\
+	{										\
+		_type *entry = &rb->items[rb->head];					\
+											\
+		*entry = *item;								\
+		rb->head = (rb->head + 1) % rb->size;					\
+											\
+		if (rb->count == rb->size) {						\
+			/* Oldest entry was overwritten. */				\
+			rb->tail = rb->head;						\
+		} else {								\
+			rb->count++;							\
+		}									\
+											\
+		return entry;								\
+	}										\
+											\
+	static inline _type *_name##_newest(struct _name *rb)				\
+	{										\
+		return &rb->items[(rb->head + rb->size - 1) % rb->size];		\
+	}										\
+											\
+	static inline size_t _name##_peek(struct _name *rb, size_t n, _type **items)	\
+	{										\
+		n = MIN(n, rb->count);							\
+											\
+		if (rb->tail + n > rb->size) {						\
+			cloud_codec_ringbuffer_rotate(rb->items, rb->size,		\
+						      sizeof(_type), rb->tail);		\
+			rb->head = (rb->head + rb->size - rb->tail) % rb->size;		\
+			rb->tail = 0;							\
+		}									\
+											\
+		*items = &rb->items[rb->tail];						\
+											\
+		return n;								\
+	}										\
+											\
+	static inline void _name##_commit(struct _name *rb, size_t n)			\
+	{										\
+		n = MIN(n, rb->count);							\
+		rb->tail = (rb->tail + n) % rb->size;					\
+		rb->count -= n;								\
+	}										\
+											\
+	static inline size_t _name##_commit_dequeued(struct _name *rb, size_t n)	\
+	{										\
+		size_t released = 0;							\
+											\
+		while ((released < MIN(n, rb->count)) &&				\
+		       !rb->items[(rb->tail + released) % rb->size].queued) {		\
+			released++;							\
+		}									\
+											\
+		_name##_commit(rb, released);						\
+											\
+		return released;							\
+	}										\
+											\
+	static inline size_t _name##_count(const struct _name *rb)			\
+	{										\
+		return rb->count;							\
+	}										\
+											\
+	static inline void _name##_reset(struct _name *rb)				\
+	{										\
+		memset(rb->items, 0, rb->size * sizeof(_type));				\
+		rb->head = 0;								\
+		rb->tail = 0;								\
+		rb->count = 0;								\
+	}
+
+#ifdef __cplusplus
+}
+#endif
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include "cloud_codec_shadow.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(cloud_codec_shadow, CONFIG_CLOUD_CODEC_LOG_LEVEL);
+
+/* Values last reported to the device shadow, values of the update that is waiting for
+ * acknowledgment, and values staged in the ongoing update.
+ */
+static struct shadow_values {
+	struct cloud_data_modem_static modem_static;
+	struct cloud_data_modem_dynamic modem_dynamic;
+	bool modem_static_valid;
+	bool modem_dynamic_valid;
+} reported, pending, staged;
+
+/* ID of the pending update, 0 if no update is pending. */
+static uint32_t pending_id;
+static uint32_t update_id_next = 1;
+
+/* Encoding happens in the data module, but the shadow can be refreshed from other contexts. */
+static K_MUTEX_DEFINE(shadow_lock);
+
+#define FIELD_CHANGED(_field, _flag) \
+	((strcmp(data->_field, last->_field) != 0) ? (_flag) : 0)
+
+#define VALUE_CHANGED(_field, _flag) \
+	((data->_field != last->_field) ? (_flag) : 0)
+
+uint32_t cloud_codec_shadow_modem_static_stage(const struct cloud_data_modem_static *data)
+{
+	const struct cloud_data_modem_static *last = &reported.modem_static;
+	uint32_t fields = CLOUD_CODEC_SHADOW_MODEM_STATIC_ALL;
+
+	if (!data->queued) {
+		return 0;
+	}
+
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if (reported.modem_static_valid) {
+		fields = FIELD_CHANGED(imei, CLOUD_CODEC_SHADOW_MODEM_IMEI) |
+			 FIELD_CHANGED(iccid, CLOUD_CODEC_SHADOW_MODEM_ICCID) |
+			 FIELD_CHANGED(fw, CLOUD_CODEC_SHADOW_MODEM_FW) |
+			 FIELD_CHANGED(brdv, CLOUD_CODEC_SHADOW_MODEM_BOARD) |
+			 FIELD_CHANGED(appv, CLOUD_CODEC_SHADOW_MODEM_APP_VERSION);
+	}
+
+	staged.modem_static = *data;
+	staged.modem_static_valid = true;
+
+	k_mutex_unlock(&shadow_lock);
+
+	LOG_DBG("Static modem fields to report: 0x%02x", fields);
+
+	return fields;
+}
+
+uint32_t cloud_codec_shadow_modem_dynamic_stage(const struct cloud_data_modem_dynamic *data)
+{
+	const struct cloud_data_modem_dynamic *last = &reported.modem_dynamic;
+	uint32_t fields = CLOUD_CODEC_SHADOW_MODEM_DYNAMIC_ALL;
+
+	if (!data->queued) {
+		return 0;
+	}
+
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if (reported.modem_dynamic_valid) {
+		fields = VALUE_CHANGED(band, CLOUD_CODEC_SHADOW_MODEM_BAND) |
+			 VALUE_CHANGED(nw_mode, CLOUD_CODEC_SHADOW_MODEM_NW_MODE) |
+			 VALUE_CHANGED(rsrp, CLOUD_CODEC_SHADOW_MODEM_RSRP) |
+			 VALUE_CHANGED(area, CLOUD_CODEC_SHADOW_MODEM_AREA) |
+			 FIELD_CHANGED(mccmnc, CLOUD_CODEC_SHADOW_MODEM_MCCMNC) |
+			 VALUE_CHANGED(cell, CLOUD_CODEC_SHADOW_MODEM_CELL) |
+			 FIELD_CHANGED(ip, CLOUD_CODEC_SHADOW_MODEM_IP);
+	}
+
+	staged.modem_dynamic = *data;
+	staged.modem_dynamic_valid = true;
+
+	k_mutex_unlock(&shadow_lock);
+
+	LOG_DBG("Dynamic modem fields to report: 0x%02x", fields);
+
+	return fields;
+}
+
+uint32_t cloud_codec_shadow_update_done(bool encoded)
+{
+	uint32_t id = 0;
+
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if (encoded && (staged.modem_static_valid || staged.modem_dynamic_valid)) {
+		pending = staged;
+		pending_id = update_id_next++;
+		if (update_id_next > CLOUD_CODEC_SHADOW_UPDATE_ID_MAX) {
+			update_id_next = 1;
+		}
+
+		id = pending_id;
+	}
+
+	staged.modem_static_valid = false;
+	staged.modem_dynamic_valid = false;
+
+	k_mutex_unlock(&shadow_lock);
+
+	return id;
+}
+
+int cloud_codec_shadow_update_ack(uint32_t id)
+{
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if ((id == 0) || (id != pending_id)) {
+		k_mutex_unlock(&shadow_lock);
+		return -ENOENT;
+	}
+
+	if (pending.modem_static_valid) {
+		reported.modem_static = pending.modem_static;
+		reported.modem_static_valid = true;
+	}
+
+	if (pending.modem_dynamic_valid) {
+		reported.modem_dynamic = pending.modem_dynamic;
+		reported.modem_dynamic_valid = true;
+	}
+
+	pending_id = 0;
+
+	k_mutex_unlock(&shadow_lock);
+
+	LOG_DBG("Shadow update %d acknowledged", id);
+
+	return 0;
+}
+
+void cloud_codec_shadow_refresh(void)
+{
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	reported.modem_static_valid = false;
+	reported.modem_dynamic_valid = false;
+	pending_id = 0;
+
+	k_mutex_unlock(&shadow_lock);
+
+	LOG_DBG("All modem fields are reported in the next shadow update");
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_CODEC_SHADOW_H__
+#define CLOUD_CODEC_SHADOW_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <zephyr/sys/util.h>
+
+#include "cloud_codec.h"
+
+/**@file
+ *
+ * @defgroup cloud_codec_shadow Cloud codec shadow delta reporting
+ * @brief    Tracks the modem data fields last reported to the device shadow.
+ *
+ * @details The modem data in data messages is reported to the device shadow, which keeps the
+ *	    last reported value of every field. Fields that have not changed since they were
+ *	    last reported can therefore be left out of the message.
+ *
+ *	    Before a data message is encoded, the queued modem data is staged with
+ *	    cloud_codec_shadow_modem_static_stage() and
+ *	    cloud_codec_shadow_modem_dynamic_stage(), which return the fields that differ from
+ *	    the last reported values. Only these fields are encoded. When the message has been
+ *	    encoded, cloud_codec_shadow_update_done() keeps the staged values as a pending update,
+ *	    or discards them if the encoding failed. The pending values become the last reported
+ *	    values when cloud acknowledges the message, see cloud_codec_shadow_update_ack().
+ *	    Until then, the fields are reported again in the next message. Only the most recent
+ *	    update is pending, acknowledgments of older updates are ignored.
+ *
+ *	    cloud_codec_shadow_refresh() forgets the last reported values, so that all fields
+ *	    are reported in the next message. This is done when the shadow may no longer hold
+ *	    the reported values, for instance after a reconnection to the cloud or when the
+ *	    cloud reports an empty shadow.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Fields of the static modem data. */
+#define CLOUD_CODEC_SHADOW_MODEM_IMEI		BIT(0)
+#define CLOUD_CODEC_SHADOW_MODEM_ICCID		BIT(1)
+#define CLOUD_CODEC_SHADOW_MODEM_FW		BIT(2)
+#define CLOUD_CODEC_SHADOW_MODEM_BOARD		BIT(3)
+#define CLOUD_CODEC_SHADOW_MODEM_APP_VERSION	BIT(4)
+
+/** All fields of the static modem data. */
+#define CLOUD_CODEC_SHADOW_MODEM_STATIC_ALL	BIT_MASK(5)
+
+/** Fields of the dynamic modem data. */
+#define CLOUD_CODEC_SHADOW_MODEM_BAND		BIT(0)
+#define CLOUD_CODEC_SHADOW_MODEM_NW_MODE	BIT(1)
+#define CLOUD_CODEC_SHADOW_MODEM_RSRP		BIT(2)
+#define CLOUD_CODEC_SHADOW_MODEM_AREA		BIT(3)
+#define CLOUD_CODEC_SHADOW_MODEM_MCCMNC		BIT(4)
+#define CLOUD_CODEC_SHADOW_MODEM_CELL		BIT(5)
+#define CLOUD_CODEC_SHADOW_MODEM_IP		BIT(6)
+
+/** All fields of the dynamic modem data. */
+#define CLOUD_CODEC_SHADOW_MODEM_DYNAMIC_ALL	BIT_MASK(7)
+
+#if defined(CONFIG_CLOUD_CODEC_SHADOW_DELTA)
+
+/**
+ * @brief Stage static modem data for reporting to the device shadow.
+ *
+ * @param[in] data Static modem data.
+ *
+ * @return Fields that have changed since they were last reported. 0 if the data is not queued.
+ */
+uint32_t cloud_codec_shadow_modem_static_stage(const struct cloud_data_modem_static *data);
+
+/**
+ * @brief Stage dynamic modem data for reporting to the device shadow.
+ *
+ * @param[in] data Dynamic modem data.
+ *
+ * @return Fields that have changed since they were last reported. 0 if the data is not queued.
+ */
+uint32_t cloud_codec_shadow_modem_dynamic_stage(const struct cloud_data_modem_dynamic *data);
+
+/** Largest shadow update ID. IDs start over at 1 when this value is exceeded. */
+#define CLOUD_CODEC_SHADOW_UPDATE_ID_MAX INT32_MAX
+
+/**
+ * @brief Finish encoding a shadow update.
+ *
+ * @param[in] encoded If true, the staged values are kept as the pending update, replacing any
+ *		      older pending update. Otherwise they are discarded.
+ *
+ * @return ID of the pending update, to be passed to cloud_codec_shadow_update_ack() when the
+ *	   message has been acknowledged. 0 if no values were staged or @p encoded is false.
+ */
+uint32_t cloud_codec_shadow_update_done(bool encoded);
+
+/**
+ * @brief Store the values of an acknowledged shadow update as the last reported values.
+ *
+ * @param[in] id ID returned by cloud_codec_shadow_update_done().
+ *
+ * @retval 0 on success.
+ * @retval -ENOENT if the update is no longer pending.
+ */
+int cloud_codec_shadow_update_ack(uint32_t id);
+
+/**
+ * @brief Forget the last reported values, so that all fields are reported in the next update.
+ */
+void cloud_codec_shadow_refresh(void);
+
+#else
+
+static inline uint32_t cloud_codec_shadow_modem_static_stage(
+	const struct cloud_data_modem_static *data)
+{
+	return data->queued ? CLOUD_CODEC_SHADOW_MODEM_STATIC_ALL : 0;
+}
+
+static inline uint32_t cloud_codec_shadow_modem_dynamic_stage(
+	const struct cloud_data_modem_dynamic *data)
+{
+	return data->queued ? CLOUD_CODEC_SHADOW_MODEM_DYNAMIC_ALL : 0;
+}
+
+static inline uint32_t cloud_codec_shadow_update_done(bool encoded)
+{
+	(void)encoded;
+	return 0;
+}
+
+static inline int cloud_codec_shadow_update_ack(uint32_t id)
+{
+	(void)id;
+	return -ENOENT;
+}
+
+static inline void cloud_codec_shadow_refresh(void)
+{
+}
+
+#endif /* CONFIG_CLOUD_CODEC_SHADOW_DELTA */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* CLOUD_CODEC_SHADOW_H__ */
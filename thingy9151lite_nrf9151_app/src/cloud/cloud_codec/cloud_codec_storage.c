@@ -0,0 +1,714 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+#include <date_time.h>
+#include <string.h>
+
+#include "cloud_codec_storage.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(cloud_codec_storage, CONFIG_CLOUD_CODEC_LOG_LEVEL);
+
+#define STORAGE_PARTITION_ID	FIXED_PARTITION_ID(data_storage)
+#define STORAGE_PARTITION_SIZE	FIXED_PARTITION_SIZE(data_storage)
+#define STORAGE_SECTOR_SIZE	CONFIG_CLOUD_CODEC_STORAGE_SECTOR_SIZE
+#define STORAGE_SECTOR_COUNT	(STORAGE_PARTITION_SIZE / STORAGE_SECTOR_SIZE)
+
+/* Version of the record layout. Samples are stored as their raw structures, so the version must
+ * be incremented when the record header or any of the stored structures change. The FCB magic
+ * is derived from it, so that a store written with another layout is erased on initialization.
+ */
+#define STORAGE_LAYOUT_VERSION	1
+#define STORAGE_FCB_MAGIC	(0x61743200 | STORAGE_LAYOUT_VERSION)
+
+BUILD_ASSERT(STORAGE_SECTOR_COUNT >= 2, "Persistent sample store needs at least two sectors");
+BUILD_ASSERT(STORAGE_SECTOR_COUNT <= UINT8_MAX, "Too many persistent sample store sectors");
+
+/* Record type used to persist the sequence number of the last acknowledged sample. */
+#define RECORD_TYPE_CURSOR	0xFF
+
+/* The timestamp of the stored sample is in UNIX time. */
+#define RECORD_FLAG_TS_UNIX	BIT(0)
+
+struct record_header {
+	/* Sequence number. For cursor records, sequence number of the last acknowledged sample. */
+	uint32_t seq;
+	/* Boot counter value when the sample was stored. */
+	uint16_t boot;
+	/* Sample type, or RECORD_TYPE_CURSOR. */
+	uint8_t type;
+	/* Record flags. */
+	uint8_t flags;
+};
+
+struct record {
+	struct record_header hdr;
+	union {
+		struct cloud_data_gnss gnss;
+		struct cloud_data_sensors sensors;
+		struct cloud_data_ui ui;
+		struct cloud_data_impact impact;
+		struct cloud_data_battery battery;
+		struct cloud_data_modem_dynamic modem_dynamic;
+	} sample;
+};
+
+static struct flash_sector sectors[STORAGE_SECTOR_COUNT];
+static struct fcb fcb = {
+	.f_magic = STORAGE_FCB_MAGIC,
+	.f_version = STORAGE_LAYOUT_VERSION,
+	.f_sectors = sectors,
+	.f_sector_cnt = STORAGE_SECTOR_COUNT,
+};
+
+static bool initialized;
+
+/* Page of samples that has been paged out and is waiting for acknowledgment. */
+struct page_info {
+	/* Page ID, given to the caller to acknowledge the page with. */
+	uint32_t id;
+	/* Location and sequence number of the last record in the page. */
+	struct fcb_entry loc;
+	uint32_t seq;
+	/* Number of samples in the page, including the ones that were skipped. */
+	size_t records;
+	/* Number of messages the page was sent in that have not been acknowledged. */
+	uint32_t messages;
+	/* Set when the page has been sent, and the uptime when it was sent. */
+	bool sent;
+	int64_t sent_time;
+};
+
+/* Sequence number given to the next stored sample. */
+static uint32_t seq_next = 1;
+/* Sequence number of the last acknowledged sample. */
+static uint32_t seq_committed;
+/* Number of pages acknowledged since the last cursor record was written. */
+static size_t pages_uncommitted;
+/* Boot counter, incremented every time the store is initialized. */
+static uint16_t boot;
+/* Number of stored samples that have not been acknowledged. */
+static size_t pending;
+
+/* Location of the last acknowledged record. If fe_sector is NULL, reading starts at the oldest
+ * record.
+ */
+static struct fcb_entry read_loc;
+
+/* Pages waiting for acknowledgment, oldest first. Paging continues after the newest one. */
+static struct page_info pages[CONFIG_CLOUD_CODEC_STORAGE_PAGES_MAX];
+static size_t page_count;
+static uint32_t page_id_next = 1;
+
+/* Sequence number of the last stored sample of each type. */
+static uint32_t seq_last[CLOUD_CODEC_STORAGE_TYPE_COUNT];
+
+/* Sequence numbers of the most recent samples that were sent outside of a batch. */
+static uint32_t seq_sent[CONFIG_CLOUD_CODEC_STORAGE_SENT_MAX];
+static size_t seq_sent_next;
+
+static size_t sample_size(enum cloud_codec_storage_type type)
+{
+	switch (type) {
+	case CLOUD_CODEC_STORAGE_GNSS:
+		return sizeof(struct cloud_data_gnss);
+	case CLOUD_CODEC_STORAGE_SENSOR:
+		return sizeof(struct cloud_data_sensors);
+	case CLOUD_CODEC_STORAGE_UI:
+		return sizeof(struct cloud_data_ui);
+	case CLOUD_CODEC_STORAGE_IMPACT:
+		return sizeof(struct cloud_data_impact);
+	case CLOUD_CODEC_STORAGE_BATTERY:
+		return sizeof(struct cloud_data_battery);
+	case CLOUD_CODEC_STORAGE_MODEM_DYNAMIC:
+		return sizeof(struct cloud_data_modem_dynamic);
+	default:
+		return 0;
+	}
+}
+
+static size_t record_size(uint8_t type)
+{
+	if (type == RECORD_TYPE_CURSOR) {
+		return sizeof(struct record_header);
+	}
+
+	return sizeof(struct record_header) + sample_size(type);
+}
+
+/* Convert the timestamp of the sample to UNIX time if date time is available. Samples with an
+ * uptime timestamp can only be sent in the same boot as they were stored in.
+ */
+static void sample_prepare(struct record *record)
+{
+	int64_t *ts;
+
+	switch (record->hdr.type) {
+	case CLOUD_CODEC_STORAGE_GNSS:
+		ts = &record->sample.gnss.gnss_ts;
+		break;
+	case CLOUD_CODEC_STORAGE_SENSOR:
+		ts = &record->sample.sensors.env_ts;
+		break;
+	case CLOUD_CODEC_STORAGE_UI:
+		ts = &record->sample.ui.btn_ts;
+		break;
+	case CLOUD_CODEC_STORAGE_IMPACT:
+		ts = &record->sample.impact.ts;
+		break;
+	case CLOUD_CODEC_STORAGE_BATTERY:
+		ts = &record->sample.battery.bat_ts;
+		break;
+	case CLOUD_CODEC_STORAGE_MODEM_DYNAMIC:
+		ts = &record->sample.modem_dynamic.ts;
+		break;
+	default:
+		return;
+	}
+
+	if (date_time_uptime_to_unix_time_ms(ts) == 0) {
+		record->hdr.flags |= RECORD_FLAG_TS_UNIX;
+	}
+}
+
+/* Restore a stored sample into the ringbuffer of its type.
+ * Returns -ENOSPC if that ringbuffer is full.
+ */
+static int sample_restore(struct cloud_codec_storage_page *page, const struct record *record)
+{
+	bool ts_unix = record->hdr.flags & RECORD_FLAG_TS_UNIX;
+
+#define RESTORE(_rb_type, _buf, _member)					\
+	do {									\
+		if (_rb_type##_count(page->_buf) == page->_buf->size) {		\
+			return -ENOSPC;						\
+		}								\
+		struct cloud_data_##_member *entry =				\
+			_rb_type##_put(page->_buf, &record->sample._member);	\
+		entry->queued = true;						\
+		entry->ts_unix = ts_unix;					\
+	} while (0)
+
+	switch (record->hdr.type) {
+	case CLOUD_CODEC_STORAGE_GNSS:
+		RESTORE(cloud_data_gnss_ringbuffer, gnss_buf, gnss);
+		break;
+	case CLOUD_CODEC_STORAGE_SENSOR:
+		RESTORE(cloud_data_sensors_ringbuffer, sensor_buf, sensors);
+		break;
+	case CLOUD_CODEC_STORAGE_UI:
+		RESTORE(cloud_data_ui_ringbuffer, ui_buf, ui);
+		break;
+	case CLOUD_CODEC_STORAGE_IMPACT:
+		RESTORE(cloud_data_impact_ringbuffer, impact_buf, impact);
+		break;
+	case CLOUD_CODEC_STORAGE_BATTERY:
+		RESTORE(cloud_data_battery_ringbuffer, bat_buf, battery);
+		break;
+	case CLOUD_CODEC_STORAGE_MODEM_DYNAMIC:
+		RESTORE(cloud_data_modem_dynamic_ringbuffer, modem_dyn_buf, modem_dynamic);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+#undef RESTORE
+
+	return 0;
+}
+
+static int record_read(struct fcb_entry *loc, struct record *record)
+{
+	int err;
+	size_t len = MIN(loc->fe_data_len, sizeof(struct record));
+
+	if (len < sizeof(struct record_header)) {
+		return -EBADMSG;
+	}
+
+	memset(record, 0, sizeof(struct record));
+
+	err = flash_area_read(fcb.fap, FCB_ENTRY_FA_DATA_OFF(*loc), record, len);
+	if (err) {
+		return err;
+	}
+
+	/* A record of another size than its type was stored with another layout. */
+	if (loc->fe_data_len != record_size(record->hdr.type)) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+static int record_write(const struct record *record, size_t len)
+{
+	int err;
+	struct fcb_entry loc;
+
+	err = fcb_append(&fcb, len, &loc);
+	if (err) {
+		return err;
+	}
+
+	err = flash_area_write(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), record, len);
+	if (err) {
+		return err;
+	}
+
+	return fcb_append_finish(&fcb, &loc);
+}
+
+static bool record_is_sendable(const struct record *record)
+{
+	if (record->hdr.type >= CLOUD_CODEC_STORAGE_TYPE_COUNT) {
+		LOG_WRN("Skipping record of unknown type: %d", record->hdr.type);
+		return false;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(seq_sent); i++) {
+		if (record->hdr.seq == seq_sent[i]) {
+			/* Already sent outside of a batch. */
+			return false;
+		}
+	}
+
+	if (!(record->hdr.flags & RECORD_FLAG_TS_UNIX) && (record->hdr.boot != boot)) {
+		LOG_WRN("Dropping sample without valid timestamp, seq: %d", record->hdr.seq);
+		return false;
+	}
+
+	return true;
+}
+
+static int unsent_count_cb(struct fcb_entry_ctx *loc_ctx, void *arg)
+{
+	struct record_header hdr;
+	size_t *count = arg;
+	int err;
+
+	err = flash_area_read(loc_ctx->fap, FCB_ENTRY_FA_DATA_OFF(loc_ctx->loc),
+			      &hdr, sizeof(hdr));
+	if (err) {
+		return err;
+	}
+
+	if ((hdr.type != RECORD_TYPE_CURSOR) && (hdr.seq > seq_committed) &&
+	    (loc_ctx->loc.fe_data_len == record_size(hdr.type))) {
+		*count += 1;
+	}
+
+	return 0;
+}
+
+/* Erase the oldest sector to make room for new records. */
+static int oldest_sector_drop(void)
+{
+	int err;
+	size_t dropped = 0;
+	size_t pages_dropped = 0;
+
+	err = fcb_walk(&fcb, fcb.f_oldest, unsent_count_cb, &dropped);
+	if (err) {
+		LOG_WRN("fcb_walk, error: %d", err);
+	}
+
+	if (read_loc.fe_sector == fcb.f_oldest) {
+		read_loc.fe_sector = NULL;
+	}
+
+	/* Pages that end in the sector are forgotten, the samples in them are lost. */
+	while ((pages_dropped < page_count) &&
+	       (pages[pages_dropped].loc.fe_sector == fcb.f_oldest)) {
+		pages_dropped++;
+	}
+
+	if (pages_dropped) {
+		page_count -= pages_dropped;
+		memmove(&pages[0], &pages[pages_dropped], page_count * sizeof(pages[0]));
+	}
+
+	err = fcb_rotate(&fcb);
+	if (err) {
+		LOG_ERR("fcb_rotate, error: %d", err);
+		return err;
+	}
+
+	if (dropped) {
+		LOG_WRN("Persistent sample store full, %d unsent samples dropped", dropped);
+		pending -= MIN(pending, dropped);
+	}
+
+	return 0;
+}
+
+static int record_append(const struct record *record, size_t len)
+{
+	int err;
+
+	err = record_write(record, len);
+	if (err == -ENOSPC) {
+		err = oldest_sector_drop();
+		if (err) {
+			return err;
+		}
+
+		err = record_write(record, len);
+	}
+
+	return err;
+}
+
+static int log_scan(void)
+{
+	int err;
+	struct fcb_entry loc = { 0 };
+	struct record record;
+	uint16_t boot_last = 0;
+
+	/* First pass, recover counters. */
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		err = record_read(&loc, &record);
+		if (err) {
+			LOG_WRN("Skipping unreadable record, error: %d", err);
+			continue;
+		}
+
+		if (record.hdr.type == RECORD_TYPE_CURSOR) {
+			seq_committed = MAX(seq_committed, record.hdr.seq);
+			continue;
+		}
+
+		seq_next = MAX(seq_next, record.hdr.seq + 1);
+		boot_last = record.hdr.boot;
+	}
+
+	boot = boot_last + 1;
+
+	/* Second pass, find the last sent record and count the unsent ones. */
+	memset(&loc, 0, sizeof(loc));
+
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		err = record_read(&loc, &record);
+		if (err) {
+			continue;
+		}
+
+		if (record.hdr.seq > seq_committed) {
+			if (record.hdr.type != RECORD_TYPE_CURSOR) {
+				pending++;
+			}
+		} else if (pending == 0) {
+			read_loc = loc;
+		}
+	}
+
+	return 0;
+}
+
+int cloud_codec_storage_init(void)
+{
+	int err;
+
+	/* Everything is recovered from flash, as after a reboot. */
+	initialized = false;
+	seq_next = 1;
+	seq_committed = 0;
+	pages_uncommitted = 0;
+	pending = 0;
+	page_count = 0;
+	memset(&read_loc, 0, sizeof(read_loc));
+	memset(seq_last, 0, sizeof(seq_last));
+	memset(seq_sent, 0, sizeof(seq_sent));
+
+	for (size_t i = 0; i < ARRAY_SIZE(sectors); i++) {
+		sectors[i].fs_off = i * STORAGE_SECTOR_SIZE;
+		sectors[i].fs_size = STORAGE_SECTOR_SIZE;
+	}
+
+	err = fcb_init(STORAGE_PARTITION_ID, &fcb);
+	if (err == -EINVAL || err == -ENOMSG) {
+		/* The FCB magic also differs when the store was written with another layout. */
+		LOG_WRN("Persistent sample store is corrupt or outdated, erasing, error: %d", err);
+
+		err = fcb_clear(&fcb);
+		if (err) {
+			LOG_ERR("fcb_clear, error: %d", err);
+			return err;
+		}
+	} else if (err) {
+		LOG_ERR("fcb_init, error: %d", err);
+		return err;
+	}
+
+	err = log_scan();
+	if (err) {
+		return err;
+	}
+
+	initialized = true;
+
+	LOG_DBG("Persistent sample store initialized, boot: %d, pending samples: %d",
+		boot, pending);
+
+	return 0;
+}
+
+int cloud_codec_storage_append(enum cloud_codec_storage_type type, const void *data)
+{
+	int err;
+	size_t len = sample_size(type);
+	struct record record = {
+		.hdr.seq = seq_next,
+		.hdr.boot = boot,
+		.hdr.type = type,
+	};
+
+	if (!initialized) {
+		return -EACCES;
+	}
+
+	if (len == 0) {
+		return -EINVAL;
+	}
+
+	memcpy(&record.sample, data, len);
+	sample_prepare(&record);
+
+	err = record_append(&record, record_size(type));
+	if (err) {
+		LOG_ERR("Failed to store sample, error: %d", err);
+
+		/* The newest sample of this type is not in the store, nothing to mark as sent. */
+		seq_last[type] = 0;
+		return err;
+	}
+
+	seq_last[type] = seq_next;
+	seq_next++;
+	pending++;
+
+	return 0;
+}
+
+void cloud_codec_storage_mark_sent(enum cloud_codec_storage_type type)
+{
+	if ((type >= CLOUD_CODEC_STORAGE_TYPE_COUNT) || (seq_last[type] == 0)) {
+		return;
+	}
+
+	seq_sent[seq_sent_next] = seq_last[type];
+	seq_sent_next = (seq_sent_next + 1) % ARRAY_SIZE(seq_sent);
+}
+
+int cloud_codec_storage_page_out(struct cloud_codec_storage_page *page, uint32_t *id)
+{
+	int err;
+	struct fcb_entry loc;
+	struct record record;
+	struct page_info *info;
+	int count = 0;
+
+	__ASSERT_NO_MSG(page != NULL);
+	__ASSERT_NO_MSG(id != NULL);
+
+	if (!initialized) {
+		return -EACCES;
+	}
+
+	if ((page_count > 0) && pages[0].sent &&
+	    ((k_uptime_get() - pages[0].sent_time) >
+	     (CONFIG_CLOUD_CODEC_STORAGE_ACK_TIMEOUT_SEC * MSEC_PER_SEC))) {
+		LOG_WRN("Page %d not acknowledged, sending %d pages again", pages[0].id,
+			page_count);
+		page_count = 0;
+	}
+
+	if (page_count == ARRAY_SIZE(pages)) {
+		return -EBUSY;
+	}
+
+	__ASSERT((page_count == 0) || pages[page_count - 1].sent, "Previous page not sent");
+
+	cloud_data_gnss_ringbuffer_reset(page->gnss_buf);
+	cloud_data_sensors_ringbuffer_reset(page->sensor_buf);
+	cloud_data_ui_ringbuffer_reset(page->ui_buf);
+	cloud_data_impact_ringbuffer_reset(page->impact_buf);
+	cloud_data_battery_ringbuffer_reset(page->bat_buf);
+	cloud_data_modem_dynamic_ringbuffer_reset(page->modem_dyn_buf);
+
+	info = &pages[page_count];
+	*info = (struct page_info) {
+		.loc = (page_count > 0) ? pages[page_count - 1].loc : read_loc,
+		.seq = (page_count > 0) ? pages[page_count - 1].seq : seq_committed,
+	};
+
+	loc = info->loc;
+
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		err = record_read(&loc, &record);
+		if (err) {
+			LOG_WRN("Skipping unreadable record, error: %d", err);
+		} else if (record.hdr.type != RECORD_TYPE_CURSOR) {
+			if (record_is_sendable(&record)) {
+				if (sample_restore(page, &record) == -ENOSPC) {
+					/* Page buffer for this type is full, the record is part of
+					 * the next page.
+					 */
+					break;
+				}
+
+				count++;
+			}
+
+			info->seq = record.hdr.seq;
+			info->records++;
+		}
+
+		info->loc = loc;
+	}
+
+	if (info->records == 0) {
+		return -ENODATA;
+	}
+
+	info->id = page_id_next++;
+	if (page_id_next > CLOUD_CODEC_STORAGE_PAGE_ID_MAX) {
+		page_id_next = 1;
+	}
+
+	*id = info->id;
+	page_count++;
+
+	LOG_DBG("Paged out %d samples, page: %d", count, info->id);
+
+	return count;
+}
+
+/* Write a cursor record and release the sectors where all samples have been acknowledged. */
+static int cursor_write(void)
+{
+	int err;
+	struct record record = {
+		.hdr.seq = seq_committed,
+		.hdr.boot = boot,
+		.hdr.type = RECORD_TYPE_CURSOR,
+	};
+
+	pages_uncommitted = 0;
+
+	err = record_append(&record, record_size(RECORD_TYPE_CURSOR));
+	if (err) {
+		LOG_ERR("Failed to store read position, error: %d", err);
+		return err;
+	}
+
+	/* The sector holding the last acknowledged record is kept, as it marks the read
+	 * position.
+	 */
+	while ((read_loc.fe_sector != NULL) && (fcb.f_oldest != read_loc.fe_sector)) {
+		err = fcb_rotate(&fcb);
+		if (err) {
+			LOG_ERR("fcb_rotate, error: %d", err);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/* Advance the read position past the oldest pages that have been fully acknowledged. The
+ * position is written to flash when no pages are waiting for acknowledgment, or after
+ * CONFIG_CLOUD_CODEC_STORAGE_PAGES_MAX pages, so that an update costs one cursor record.
+ */
+static int pages_commit(void)
+{
+	size_t done = 0;
+
+	while ((done < page_count) && pages[done].sent && (pages[done].messages == 0)) {
+		seq_committed = pages[done].seq;
+		read_loc = pages[done].loc;
+		pending -= MIN(pending, pages[done].records);
+		done++;
+	}
+
+	if (done == 0) {
+		return 0;
+	}
+
+	page_count -= done;
+	memmove(&pages[0], &pages[done], page_count * sizeof(pages[0]));
+	pages_uncommitted += done;
+
+	if ((page_count == 0) || (pages_uncommitted >= ARRAY_SIZE(pages))) {
+		return cursor_write();
+	}
+
+	return 0;
+}
+
+static struct page_info *page_find(uint32_t id)
+{
+	for (size_t i = 0; i < page_count; i++) {
+		if (pages[i].id == id) {
+			return &pages[i];
+		}
+	}
+
+	return NULL;
+}
+
+int cloud_codec_storage_page_sent(uint32_t id, uint32_t messages)
+{
+	struct page_info *info = page_find(id);
+
+	if (!initialized) {
+		return -EACCES;
+	}
+
+	if ((info == NULL) || info->sent) {
+		return -ENOENT;
+	}
+
+	info->messages = messages;
+	info->sent = true;
+	info->sent_time = k_uptime_get();
+
+	return pages_commit();
+}
+
+void cloud_codec_storage_page_abort(uint32_t id)
+{
+	if ((page_count > 0) && (pages[page_count - 1].id == id) && !pages[page_count - 1].sent) {
+		page_count--;
+	}
+}
+
+int cloud_codec_storage_ack(uint32_t id)
+{
+	struct page_info *info = page_find(id);
+
+	if (!initialized) {
+		return -EACCES;
+	}
+
+	if ((info == NULL) || !info->sent || (info->messages == 0)) {
+		/* Acknowledgment of a page that was forgotten, and is sent again. */
+		return -ENOENT;
+	}
+
+	info->messages--;
+
+	return pages_commit();
+}
+
+size_t cloud_codec_storage_pending_count(void)
+{
+	return pending;
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_CODEC_STORAGE_H__
+#define CLOUD_CODEC_STORAGE_H__
+
+#include <zephyr/kernel.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cloud_codec.h"
+
+/**@file
+ *
+ * @defgroup cloud_codec_storage Cloud codec persistent sample store.
+ * @brief    Append-only sample log in external flash that backs the data module ringbuffers.
+ *
+ * @details Every entry added to a data module ringbuffer is also appended to the log.
+ *	    Entries are paged back out, oldest first, into the ringbuffers before batch
+ *	    encoding and are removed from the log once cloud has acknowledged all messages
+ *	    the page was sent in. The read position is written to flash once per update,
+ *	    so entries acknowledged shortly before a power loss can be sent twice.
+ *	    Timestamps are stored in UNIX time when it is available, so entries sampled before
+ *	    a reboot can still be sent after it.
+ *
+ *	    The API is not thread safe and must only be called from the data module thread.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Largest page ID. Page IDs start over at 1 when this value is exceeded. */
+#define CLOUD_CODEC_STORAGE_PAGE_ID_MAX INT32_MAX
+
+/** @brief Sample types that can be stored. */
+enum cloud_codec_storage_type {
+	CLOUD_CODEC_STORAGE_GNSS,
+	CLOUD_CODEC_STORAGE_SENSOR,
+	CLOUD_CODEC_STORAGE_UI,
+	CLOUD_CODEC_STORAGE_IMPACT,
+	CLOUD_CODEC_STORAGE_BATTERY,
+	CLOUD_CODEC_STORAGE_MODEM_DYNAMIC,
+
+	CLOUD_CODEC_STORAGE_TYPE_COUNT,
+};
+
+/** @brief Set of ringbuffers that stored samples are paged out into. */
+struct cloud_codec_storage_page {
+	struct cloud_data_gnss_ringbuffer *gnss_buf;
+	struct cloud_data_sensors_ringbuffer *sensor_buf;
+	struct cloud_data_ui_ringbuffer *ui_buf;
+	struct cloud_data_impact_ringbuffer *impact_buf;
+	struct cloud_data_battery_ringbuffer *bat_buf;
+	struct cloud_data_modem_dynamic_ringbuffer *modem_dyn_buf;
+};
+
+/**
+ * @brief Initialize the persistent sample store.
+ *
+ * @note Scans the log to recover the sequence number, boot counter and read position.
+ *
+ * @retval 0 on success.
+ * @return Negative error value from the flash circular buffer on failure.
+ */
+int cloud_codec_storage_init(void);
+
+/**
+ * @brief Append a sample to the persistent sample store.
+ *
+ * @note If the log is full, the oldest sector is erased to make room, dropping the
+ *	 samples it holds. This mirrors how the RAM ringbuffers overwrite their oldest entry.
+ *
+ * @param[in] type Sample type.
+ * @param[in] data Pointer to the sample, one of the cloud_data_* structures.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the type is unknown.
+ * @retval -EACCES if the store has not been initialized.
+ * @return Negative error value from the flash circular buffer on other failures.
+ */
+int cloud_codec_storage_append(enum cloud_codec_storage_type type, const void *data);
+
+/**
+ * @brief Mark the most recently appended sample of a given type as sent.
+ *
+ * @note Used when the newest sample has been encoded and sent outside of a batch,
+ *	 so it is skipped when the store is paged out. The last
+ *	 CONFIG_CLOUD_CODEC_STORAGE_SENT_MAX samples marked this way are remembered.
+ *
+ * @param[in] type Sample type.
+ */
+void cloud_codec_storage_mark_sent(enum cloud_codec_storage_type type);
+
+/**
+ * @brief Page the oldest unsent samples out of the store.
+ *
+ * @note The ringbuffers are reset before they are filled. Paging stops when the ringbuffer
+ *	 of the next stored sample type is full, to keep samples in order. Paging continues
+ *	 after the pages that are waiting for acknowledgment. The page must be passed to
+ *	 cloud_codec_storage_page_sent() or cloud_codec_storage_page_abort() before the next
+ *	 page is paged out. If the oldest page has not been acknowledged within
+ *	 CONFIG_CLOUD_CODEC_STORAGE_ACK_TIMEOUT_SEC, all pages are paged out again.
+ *
+ * @param[in, out] page Ringbuffers to fill.
+ * @param[out] id Page ID, used to acknowledge the page.
+ *
+ * @return Number of samples paged out on success.
+ * @retval -ENODATA if there are no unsent samples in the store.
+ * @retval -EBUSY if CONFIG_CLOUD_CODEC_STORAGE_PAGES_MAX pages are waiting for acknowledgment.
+ * @retval -EACCES if the store has not been initialized.
+ */
+int cloud_codec_storage_page_out(struct cloud_codec_storage_page *page, uint32_t *id);
+
+/**
+ * @brief Set the number of messages that the last page was sent in.
+ *
+ * @note A page that was sent in no messages, because all its samples were skipped, is
+ *	 acknowledged immediately.
+ *
+ * @param[in] id Page ID.
+ * @param[in] messages Number of messages that must be acknowledged.
+ *
+ * @retval 0 on success.
+ * @retval -ENOENT if the page is not the last one paged out.
+ * @retval -EACCES if the store has not been initialized.
+ * @return Negative error value from the flash circular buffer on other failures.
+ */
+int cloud_codec_storage_page_sent(uint32_t id, uint32_t messages);
+
+/**
+ * @brief Discard the last page, its samples are paged out again.
+ *
+ * @param[in] id Page ID.
+ */
+void cloud_codec_storage_page_abort(uint32_t id);
+
+/**
+ * @brief Acknowledge one of the messages that a page was sent in.
+ *
+ * @note When all messages of the oldest pages have been acknowledged, the samples in them
+ *	 are removed from the store.
+ *
+ * @param[in] id Page ID.
+ *
+ * @retval 0 on success.
+ * @retval -ENOENT if the page is not waiting for acknowledgment.
+ * @retval -EACCES if the store has not been initialized.
+ * @return Negative error value from the flash circular buffer on other failures.
+ */
+int cloud_codec_storage_ack(uint32_t id);
+
+/**
+ * @brief Get the number of samples that are stored and not yet acknowledged.
+ *
+ * @return Number of pending samples.
+ */
+size_t cloud_codec_storage_pending_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+#include <cJSON_os.h>
+
+#include "json_arena.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(json_arena, CONFIG_CLOUD_CODEC_LOG_LEVEL);
+
+/* Alignment of arena allocations. cJSON objects contain doubles. */
+#define ARENA_ALIGN 8
+
+/* cJSON_PrintPreallocated() needs a few bytes more than the printed length. */
+#define PRINT_SLACK 5
+
+static uint8_t arena[CONFIG_CLOUD_CODEC_JSON_ARENA_SIZE] __aligned(ARENA_ALIGN);
+
+/* Offset of the free space in the arena. */
+static size_t arena_offset;
+
+/* Number of bytes requested during the current encoding, including the allocations that did
+ * not fit in the arena.
+ */
+static size_t arena_demand;
+
+/* Number of allocations that did not fit in the arena during the current encoding. */
+static uint32_t arena_fallbacks;
+
+/* Thread that the arena is installed for. */
+static k_tid_t arena_owner;
+
+static enum json_arena_encode_type arena_type;
+
+static struct json_arena_stats arena_stats[JSON_ARENA_ENCODE_COUNT];
+
+static const char *const type_names[] = {
+	[JSON_ARENA_ENCODE_DATA] = "data",
+	[JSON_ARENA_ENCODE_UI] = "UI",
+	[JSON_ARENA_ENCODE_IMPACT] = "impact",
+	[JSON_ARENA_ENCODE_BATCH] = "batch",
+	[JSON_ARENA_ENCODE_CONFIG] = "config",
+	[JSON_ARENA_ENCODE_CLOUD_LOCATION] = "cloud location",
+	[JSON_ARENA_ENCODE_AGNSS_REQUEST] = "A-GNSS request",
+	[JSON_ARENA_ENCODE_PGPS_REQUEST] = "P-GPS request",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(type_names) == JSON_ARENA_ENCODE_COUNT);
+
+/* Serializes encodings, the cJSON hooks are global. */
+static K_MUTEX_DEFINE(arena_lock);
+
+static bool in_arena(const void *ptr)
+{
+	return ((const uint8_t *)ptr >= arena) && ((const uint8_t *)ptr < arena + sizeof(arena));
+}
+
+static void *arena_malloc(size_t size)
+{
+	size_t aligned_size = ROUND_UP(size, ARENA_ALIGN);
+
+	if (k_current_get() != arena_owner) {
+		return k_malloc(size);
+	}
+
+	arena_demand += aligned_size;
+
+	if (aligned_size > sizeof(arena) - arena_offset) {
+		arena_fallbacks++;
+		return k_malloc(size);
+	}
+
+	void *ptr = &arena[arena_offset];
+
+	arena_offset += aligned_size;
+
+	return ptr;
+}
+
+static void arena_free(void *ptr)
+{
+	/* Arena allocations are released all at once by json_arena_end(). */
+	if (in_arena(ptr)) {
+		return;
+	}
+
+	k_free(ptr);
+}
+
+void json_arena_begin(enum json_arena_encode_type type)
+{
+	cJSON_Hooks hooks = {
+		.malloc_fn = arena_malloc,
+		.free_fn = arena_free,
+	};
+
+	__ASSERT_NO_MSG(type < JSON_ARENA_ENCODE_COUNT);
+
+	k_mutex_lock(&arena_lock, K_FOREVER);
+
+	arena_type = type;
+	arena_owner = k_current_get();
+
+	cJSON_InitHooks(&hooks);
+}
+
+char *json_arena_print(const cJSON *root)
+{
+	char *buffer;
+	size_t free_space = sizeof(arena) - arena_offset;
+	size_t len;
+
+	/* Print into the free space of the arena, which avoids the intermediate buffers that
+	 * cJSON_PrintUnformatted() allocates while the output grows. If the output does not fit,
+	 * print it with the hooks instead.
+	 */
+	if ((k_current_get() != arena_owner) || (free_space <= PRINT_SLACK) ||
+	    !cJSON_PrintPreallocated((cJSON *)root, (char *)&arena[arena_offset],
+				     (int)(free_space - PRINT_SLACK), false)) {
+		buffer = cJSON_PrintUnformatted(root);
+		if ((buffer == NULL) || !in_arena(buffer)) {
+			return buffer;
+		}
+	} else {
+		buffer = (char *)&arena[arena_offset];
+	}
+
+	len = strlen(buffer) + 1;
+
+	if (k_current_get() == arena_owner) {
+		arena_demand += len;
+	}
+
+	/* The output outlives the arena, move it to the heap. */
+	char *output = k_malloc(len);
+
+	if (output == NULL) {
+		return NULL;
+	}
+
+	memcpy(output, buffer, len);
+
+	return output;
+}
+
+void json_arena_end(void)
+{
+	struct json_arena_stats *type_stats = &arena_stats[arena_type];
+
+	__ASSERT_NO_MSG(arena_owner == k_current_get());
+
+	/* Restore the default hooks before releasing the arena. */
+	cJSON_Init();
+
+	type_stats->encode_count++;
+
+	if (arena_demand > type_stats->high_water) {
+		type_stats->high_water = arena_demand;
+
+		LOG_INF("New %s arena high-water mark: %zu of %zu bytes",
+			type_names[arena_type], arena_demand, sizeof(arena));
+	}
+
+	if (arena_fallbacks > 0) {
+		type_stats->fallback_count += arena_fallbacks;
+
+		LOG_WRN("%u %s allocations did not fit in the arena",
+			arena_fallbacks, type_names[arena_type]);
+		LOG_WRN("Consider increasing CONFIG_CLOUD_CODEC_JSON_ARENA_SIZE");
+	}
+
+	arena_offset = 0;
+	arena_demand = 0;
+	arena_fallbacks = 0;
+	arena_owner = NULL;
+
+	k_mutex_unlock(&arena_lock);
+}
+
+int json_arena_stats_get(enum json_arena_encode_type type, struct json_arena_stats *stats)
+{
+	if ((type >= JSON_ARENA_ENCODE_COUNT) || (stats == NULL)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&arena_lock, K_FOREVER);
+	*stats = arena_stats[type];
+	k_mutex_unlock(&arena_lock);
+
+	return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef JSON_ARENA_H__
+#define JSON_ARENA_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+
+#include "cJSON.h"
+
+/**@file
+ *
+ * @defgroup json_arena JSON arena allocator
+ * @brief    Arena allocator used by cJSON while a message is encoded.
+ *
+ * @details Between json_arena_begin() and json_arena_end(), cJSON allocations made by the
+ *	    calling thread are served from a static arena by bumping an offset, and frees are
+ *	    ignored. The arena is reset in one go by json_arena_end(). Allocations made by other
+ *	    threads, and allocations that do not fit in the arena, are passed on to the
+ *	    system heap.
+ *
+ *	    The arena usage of each encoding is recorded per encode type, so that
+ *	    CONFIG_CLOUD_CODEC_JSON_ARENA_SIZE can be sized from the high-water marks.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Encode types that the arena usage is recorded for. */
+enum json_arena_encode_type {
+	JSON_ARENA_ENCODE_DATA,
+	JSON_ARENA_ENCODE_UI,
+	JSON_ARENA_ENCODE_IMPACT,
+	JSON_ARENA_ENCODE_BATCH,
+	JSON_ARENA_ENCODE_CONFIG,
+	JSON_ARENA_ENCODE_CLOUD_LOCATION,
+	JSON_ARENA_ENCODE_AGNSS_REQUEST,
+	JSON_ARENA_ENCODE_PGPS_REQUEST,
+
+	JSON_ARENA_ENCODE_COUNT
+};
+
+/** @brief Arena usage of an encode type. */
+struct json_arena_stats {
+	/** Largest number of bytes an encoding has needed, including the printed output and
+	 *  the allocations that did not fit in the arena.
+	 */
+	size_t high_water;
+	/** Number of allocations that did not fit in the arena. */
+	uint32_t fallback_count;
+	/** Number of encodings. */
+	uint32_t encode_count;
+};
+
+#if defined(CONFIG_CLOUD_CODEC_JSON_ARENA)
+
+/**
+ * @brief Install the arena as the cJSON allocator for the calling thread.
+ *
+ * @note Blocks if another thread is encoding. Must be followed by json_arena_end().
+ *
+ * @param[in] type Encode type that the arena usage is recorded for.
+ */
+void json_arena_begin(enum json_arena_encode_type type);
+
+/**
+ * @brief Print a cJSON object to a heap allocated string.
+ *
+ * @details The object is printed into the free space of the arena and copied to a buffer
+ *	    of the exact length. The returned string must be freed with k_free().
+ *
+ * @param[in] root Object to print.
+ *
+ * @return Printed string, or NULL if memory could not be allocated.
+ */
+char *json_arena_print(const cJSON *root);
+
+/**
+ * @brief Restore the default cJSON allocator and reset the arena.
+ *
+ * @note All cJSON objects allocated since json_arena_begin() must have been deleted.
+ */
+void json_arena_end(void);
+
+/**
+ * @brief Get the arena usage of an encode type.
+ *
+ * @param[in] type Encode type.
+ * @param[out] stats Arena usage.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the encode type is invalid.
+ */
+int json_arena_stats_get(enum json_arena_encode_type type, struct json_arena_stats *stats);
+
+#else
+
+static inline void json_arena_begin(enum json_arena_encode_type type)
+{
+	(void)type;
+}
+
+static inline char *json_arena_print(const cJSON *root)
+{
+	return cJSON_PrintUnformatted(root);
+}
+
+static inline void json_arena_end(void)
+{
+}
+
+static inline int json_arena_stats_get(enum json_arena_encode_type type,
+				       struct json_arena_stats *stats)
+{
+	(void)type;
+	(void)stats;
+
+	return -ENOTSUP;
+}
+
+#endif /* CONFIG_CLOUD_CODEC_JSON_ARENA */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* JSON_ARENA_H__ */
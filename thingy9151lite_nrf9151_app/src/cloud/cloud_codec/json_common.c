@@ -63,6 +63,18 @@ int json_common_modem_static_data_add(cJSON *parent,
 				      enum json_common_op_code op,
 				      const char *object_label,
 				      cJSON **parent_ref)
+{
+	return json_common_modem_static_fields_add(parent, data,
+						   CLOUD_CODEC_SHADOW_MODEM_STATIC_ALL,
+						   op, object_label, parent_ref);
+}
+
+int json_common_modem_static_fields_add(cJSON *parent,
+					struct cloud_data_modem_static *data,
+					uint32_t fields,
+					enum json_common_op_code op,
+					const char *object_label,
+					cJSON **parent_ref)
 {
 	int err;
 
@@ -70,6 +82,12 @@ int json_common_modem_static_data_add(cJSON *parent,
 		return -ENODATA;
 	}
 
+	if (fields == 0) {
+		/* All values have already been reported. */
+		data->queued = false;
+		return -ENODATA;
+	}
+
 	err = date_time_uptime_to_unix_time_ms(&data->ts);
 	if (err) {
 		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
@@ -84,34 +102,44 @@ int json_common_modem_static_data_add(cJSON *parent,
 		goto exit;
 	}
 
-	err = json_add_str(modem_val_obj, MODEM_IMEI, data->imei);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_IMEI) {
+		err = json_add_str(modem_val_obj, MODEM_IMEI, data->imei);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	err = json_add_str(modem_val_obj, MODEM_ICCID, data->iccid);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_ICCID) {
+		err = json_add_str(modem_val_obj, MODEM_ICCID, data->iccid);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	err = json_add_str(modem_val_obj, MODEM_FIRMWARE_VERSION, data->fw);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_FW) {
+		err = json_add_str(modem_val_obj, MODEM_FIRMWARE_VERSION, data->fw);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	err = json_add_str(modem_val_obj, MODEM_BOARD, data->brdv);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_BOARD) {
+		err = json_add_str(modem_val_obj, MODEM_BOARD, data->brdv);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	err = json_add_str(modem_val_obj, MODEM_APP_VERSION, data->appv);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_APP_VERSION) {
+		err = json_add_str(modem_val_obj, MODEM_APP_VERSION, data->appv);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
 	json_add_obj(modem_obj, DATA_VALUE, modem_val_obj);
@@ -144,6 +172,18 @@ int json_common_modem_dynamic_data_add(cJSON *parent,
 				       enum json_common_op_code op,
 				       const char *object_label,
 				       cJSON **parent_ref)
+{
+	return json_common_modem_dynamic_fields_add(parent, data,
+						    CLOUD_CODEC_SHADOW_MODEM_DYNAMIC_ALL,
+						    op, object_label, parent_ref);
+}
+
+int json_common_modem_dynamic_fields_add(cJSON *parent,
+					 struct cloud_data_modem_dynamic *data,
+					 uint32_t fields,
+					 enum json_common_op_code op,
+					 const char *object_label,
+					 cJSON **parent_ref)
 {
 	int err;
 	uint32_t mccmnc;
@@ -153,10 +193,18 @@ int json_common_modem_dynamic_data_add(cJSON *parent,
 		return -ENODATA;
 	}
 
-	err = date_time_uptime_to_unix_time_ms(&data->ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+	if (fields == 0) {
+		/* All values have already been reported. */
+		data->queued = false;
+		return -ENODATA;
+	}
+
+	if (!data->ts_unix) {
+		err = date_time_uptime_to_unix_time_ms(&data->ts);
+		if (err) {
+			LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+			return err;
+		}
 	}
 
 	cJSON *modem_obj = cJSON_CreateObject();
@@ -167,58 +215,72 @@ int json_common_modem_dynamic_data_add(cJSON *parent,
 		goto exit;
 	}
 
-	err = json_add_number(modem_val_obj, MODEM_CURRENT_BAND, data->band);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_BAND) {
+		err = json_add_number(modem_val_obj, MODEM_CURRENT_BAND, data->band);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	err = json_add_str(modem_val_obj, MODEM_NETWORK_MODE,
-			   (data->nw_mode == LTE_LC_LTE_MODE_LTEM) ? "LTE-M" :
-			   (data->nw_mode == LTE_LC_LTE_MODE_NBIOT) ? "NB-IoT" : "Unknown");
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_NW_MODE) {
+		err = json_add_str(modem_val_obj, MODEM_NETWORK_MODE,
+				   (data->nw_mode == LTE_LC_LTE_MODE_LTEM) ? "LTE-M" :
+				   (data->nw_mode == LTE_LC_LTE_MODE_NBIOT) ? "NB-IoT" : "Unknown");
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	err = json_add_number(modem_val_obj, MODEM_RSRP, data->rsrp);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_RSRP) {
+		err = json_add_number(modem_val_obj, MODEM_RSRP, data->rsrp);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	err = json_add_number(modem_val_obj, MODEM_AREA_CODE, data->area);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_AREA) {
+		err = json_add_number(modem_val_obj, MODEM_AREA_CODE, data->area);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	/* Convert mccmnc to unsigned long integer. */
-	errno = 0;
-	mccmnc = strtoul(data->mccmnc, &end_ptr, 10);
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_MCCMNC) {
+		/* Convert mccmnc to unsigned long integer. */
+		errno = 0;
+		mccmnc = strtoul(data->mccmnc, &end_ptr, 10);
 
-	if ((errno == ERANGE) || (*end_ptr != '\0')) {
-		LOG_ERR("MCCMNC string could not be converted.");
-		err = -ENOTEMPTY;
-		goto exit;
-	}
+		if ((errno == ERANGE) || (*end_ptr != '\0')) {
+			LOG_ERR("MCCMNC string could not be converted.");
+			err = -ENOTEMPTY;
+			goto exit;
+		}
 
-	err = json_add_number(modem_val_obj, MODEM_MCCMNC, mccmnc);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+		err = json_add_number(modem_val_obj, MODEM_MCCMNC, mccmnc);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	err = json_add_number(modem_val_obj, MODEM_CELL_ID, data->cell);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_CELL) {
+		err = json_add_number(modem_val_obj, MODEM_CELL_ID, data->cell);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
-	err = json_add_str(modem_val_obj, MODEM_IP_ADDRESS, data->ip);
-	if (err) {
-		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
-		goto exit;
+	if (fields & CLOUD_CODEC_SHADOW_MODEM_IP) {
+		err = json_add_str(modem_val_obj, MODEM_IP_ADDRESS, data->ip);
+		if (err) {
+			LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+			goto exit;
+		}
 	}
 
 	json_add_obj(modem_obj, DATA_VALUE, modem_val_obj);
@@ -258,10 +320,12 @@ int json_common_sensor_data_add(cJSON *parent,
 		return -ENODATA;
 	}
 
-	err = date_time_uptime_to_unix_time_ms(&data->env_ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+	if (!data->ts_unix) {
+		err = date_time_uptime_to_unix_time_ms(&data->env_ts);
+		if (err) {
+			LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+			return err;
+		}
 	}
 
 	cJSON *sensor_obj = cJSON_CreateObject();
@@ -336,10 +400,12 @@ int json_common_gnss_data_add(cJSON *parent,
 		return -ENODATA;
 	}
 
-	err = date_time_uptime_to_unix_time_ms(&data->gnss_ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+	if (!data->ts_unix) {
+		err = date_time_uptime_to_unix_time_ms(&data->gnss_ts);
+		if (err) {
+			LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+			return err;
+		}
 	}
 
 	cJSON *gnss_obj = cJSON_CreateObject();
@@ -423,10 +489,12 @@ int json_common_ui_data_add(cJSON *parent,
 		return -ENODATA;
 	}
 
-	err = date_time_uptime_to_unix_time_ms(&data->btn_ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+	if (!data->ts_unix) {
+		err = date_time_uptime_to_unix_time_ms(&data->btn_ts);
+		if (err) {
+			LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+			return err;
+		}
 	}
 
 	cJSON *button_obj = cJSON_CreateObject();
@@ -474,10 +542,12 @@ int json_common_impact_data_add(cJSON *parent,
 		return -ENODATA;
 	}
 
-	err = date_time_uptime_to_unix_time_ms(&data->ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+	if (!data->ts_unix) {
+		err = date_time_uptime_to_unix_time_ms(&data->ts);
+		if (err) {
+			LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+			return err;
+		}
 	}
 
 	cJSON *impact_obj = cJSON_CreateObject();
@@ -973,10 +1043,12 @@ int json_common_battery_data_add(cJSON *parent,
 		return -ENODATA;
 	}
 
-	err = date_time_uptime_to_unix_time_ms(&data->bat_ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+	if (!data->ts_unix) {
+		err = date_time_uptime_to_unix_time_ms(&data->bat_ts);
+		if (err) {
+			LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+			return err;
+		}
 	}
 
 	cJSON *battery_obj = cJSON_CreateObject();
@@ -1079,6 +1151,12 @@ int json_common_config_add(cJSON *parent, struct cloud_data_cfg *data, const cha
 		goto exit;
 	}
 
+	err = json_add_number(config_obj, CONFIG_SEND_POLICY, data->send_policy);
+	if (err) {
+		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+		goto exit;
+	}
+
 	cJSON *nod_list = cJSON_CreateArray();
 
 	if (nod_list == NULL) {
@@ -1146,6 +1224,7 @@ void json_common_config_get(cJSON *parent, struct cloud_data_cfg *data)
 	cJSON *acc_act_thres = cJSON_GetObjectItem(parent, CONFIG_ACC_ACT_THRESHOLD);
 	cJSON *acc_inact_thres = cJSON_GetObjectItem(parent, CONFIG_ACC_INACT_THRESHOLD);
 	cJSON *acc_inact_time = cJSON_GetObjectItem(parent, CONFIG_ACC_INACT_TIMEOUT);
+	cJSON *send_policy = cJSON_GetObjectItem(parent, CONFIG_SEND_POLICY);
 	cJSON *nod_list = cJSON_GetObjectItem(parent, CONFIG_NO_DATA_LIST);
 
 	if (location_timeout != NULL) {
@@ -1180,6 +1259,10 @@ void json_common_config_get(cJSON *parent, struct cloud_data_cfg *data)
 		data->accelerometer_inactivity_timeout = acc_inact_time->valuedouble;
 	}
 
+	if (send_policy != NULL) {
+		data->send_policy = send_policy->valueint;
+	}
+
 	if (nod_list != NULL && cJSON_IsArray(nod_list)) {
 		cJSON *item;
 		bool gnss_found = false;
@@ -1211,116 +1294,656 @@ void json_common_config_get(cJSON *parent, struct cloud_data_cfg *data)
 	}
 }
 
-int json_common_batch_data_add(cJSON *parent, enum json_common_buffer_type type, void *buf,
-			       size_t buf_count, const char *object_label)
+/* Length of a batch message that is built as a cJSON tree. */
+struct batch_size {
+	/* Maximum length of the message in bytes, 0 for no limit. */
+	size_t max;
+	/* Length of the message so far. */
+	size_t len;
+	/* Number of entries in the message. */
+	size_t entries;
+	/* Set when an entry did not fit, the following entries are left queued. */
+	bool full;
+};
+
+/* Length of the root object of a batch message, "{}". */
+#define BATCH_ROOT_LEN 2
+
+/* Length of an array in a batch message without its entries, "label":[], with the separator
+ * before it.
+ */
+#define BATCH_ARRAY_LEN(_label) (strlen(_label) + 6)
+
+/* Add an encoded entry to the array if it fits in the message. The first entry of a message is
+ * always added, so that an entry larger than the maximum does not block the buffer. Returns
+ * -ENOSPC and sets size->full if the entry does not fit, the entry is freed in that case.
+ */
+static int batch_entry_add(cJSON *array, const char *label, cJSON *item, struct batch_size *size)
+{
+	char *str;
+	size_t len;
+
+	if (size->max > 0) {
+		str = cJSON_PrintUnformatted(item);
+		if (str == NULL) {
+			cJSON_Delete(item);
+			return -ENOMEM;
+		}
+
+		/* The entry with the separator before it, and the array for its first entry. */
+		len = strlen(str) + 1;
+		cJSON_free(str);
+
+		if (cJSON_GetArraySize(array) == 0) {
+			len += BATCH_ARRAY_LEN(label);
+		}
+
+		if ((size->entries > 0) && (size->len + len > size->max)) {
+			cJSON_Delete(item);
+			size->full = true;
+			return -ENOSPC;
+		}
+
+		size->len += len;
+	}
+
+	json_add_obj_array(array, item);
+	size->entries++;
+
+	return 0;
+}
+
+/* Add the entries of a buffer of the given type to an array, skipping entries that are not
+ * queued. The buffer type is resolved once per buffer rather than once per entry. Each entry is
+ * encoded from a copy, which is written back only if the entry is added to the message. An
+ * entry that does not fit is left queued, with its timestamp unconverted.
+ */
+#define BATCH_ENTRIES_ADD(_err, _array, _label, _type, _buf, _buf_count, _add, _size)	\
+	do {										\
+		_type *_data = (_type *)(_buf);						\
+											\
+		for (size_t _i = 0; (_i < (_buf_count)) && !(_size)->full; _i++) {	\
+			_type _entry = _data[_i];					\
+			cJSON *_item = NULL;						\
+											\
+			_err = _add(NULL, &_entry, JSON_COMMON_GET_POINTER_TO_OBJECT,	\
+				    NULL, &_item);					\
+			if (_err == 0) {						\
+				_err = batch_entry_add((_array), (_label), _item,	\
+						       (_size));			\
+			}								\
+											\
+			if ((_err == 0) || (_err == -ENODATA)) {			\
+				_data[_i] = _entry;					\
+				_err = 0;						\
+			} else if (_err == -ENOSPC) {					\
+				_err = 0;						\
+			} else {							\
+				break;							\
+			}								\
+		}									\
+	} while (0)
+
+static int batch_data_add(cJSON *parent, const struct json_common_batch_buffer *buffer,
+			  struct batch_size *size)
 {
 	int err = 0;
-	cJSON *array_obj = cJSON_CreateArray();
+	cJSON *array_obj;
+	void *buf = buffer->buf;
+	size_t buf_count = buffer->buf_count;
+	const char *label = buffer->object_label;
+
+	if (label == NULL) {
+		LOG_WRN("Missing object label");
+		return -EINVAL;
+	}
+
+	/* Nothing to allocate or encode for an empty buffer. */
+	if (buf_count == 0) {
+		return -ENODATA;
+	}
+
+	array_obj = cJSON_CreateArray();
 
 	if (parent == NULL || array_obj == NULL) {
 		cJSON_Delete(array_obj);
 		return -ENOMEM;
 	}
 
-	if (object_label == NULL) {
-		LOG_WRN("Missing object label");
+	switch (buffer->type) {
+	case JSON_COMMON_UI:
+		BATCH_ENTRIES_ADD(err, array_obj, label, struct cloud_data_ui, buf, buf_count,
+				  json_common_ui_data_add, size);
+		break;
+	case JSON_COMMON_IMPACT:
+		BATCH_ENTRIES_ADD(err, array_obj, label, struct cloud_data_impact, buf, buf_count,
+				  json_common_impact_data_add, size);
+		break;
+	case JSON_COMMON_MODEM_STATIC:
+		BATCH_ENTRIES_ADD(err, array_obj, label, struct cloud_data_modem_static, buf,
+				  buf_count, json_common_modem_static_data_add, size);
+		break;
+	case JSON_COMMON_MODEM_DYNAMIC:
+		BATCH_ENTRIES_ADD(err, array_obj, label, struct cloud_data_modem_dynamic, buf,
+				  buf_count, json_common_modem_dynamic_data_add, size);
+		break;
+	case JSON_COMMON_GNSS:
+		BATCH_ENTRIES_ADD(err, array_obj, label, struct cloud_data_gnss, buf, buf_count,
+				  json_common_gnss_data_add, size);
+		break;
+	case JSON_COMMON_SENSOR:
+		BATCH_ENTRIES_ADD(err, array_obj, label, struct cloud_data_sensors, buf, buf_count,
+				  json_common_sensor_data_add, size);
+		break;
+	case JSON_COMMON_BATTERY:
+		BATCH_ENTRIES_ADD(err, array_obj, label, struct cloud_data_battery, buf, buf_count,
+				  json_common_battery_data_add, size);
+		break;
+	default:
+		LOG_WRN("Unknown buffer type: %d", buffer->type);
+		break;
+	}
+
+	if (err) {
+		LOG_ERR("Failed adding data to array object");
 		cJSON_Delete(array_obj);
-		return -EINVAL;
+		return err;
 	}
 
-	for (int i = 0; i < buf_count; i++) {
-		switch (type) {
-		case JSON_COMMON_UI: {
-			struct cloud_data_ui *data =
-					(struct cloud_data_ui *)buf;
-			err = json_common_ui_data_add(array_obj,
-						      &data[i],
-						      JSON_COMMON_ADD_DATA_TO_ARRAY,
-						      NULL,
-						      NULL);
-		}
-			break;
-		case JSON_COMMON_IMPACT: {
-			struct cloud_data_impact *data =
-					(struct cloud_data_impact *)buf;
-			err = json_common_impact_data_add(array_obj,
-						      &data[i],
-						      JSON_COMMON_ADD_DATA_TO_ARRAY,
-						      NULL,
-						      NULL);
-		}
-			break;
-		case JSON_COMMON_MODEM_STATIC: {
-			struct cloud_data_modem_static *data =
-					(struct cloud_data_modem_static *)buf;
-			err = json_common_modem_static_data_add(array_obj,
-								&data[i],
-								JSON_COMMON_ADD_DATA_TO_ARRAY,
-								NULL,
-								NULL);
+	if (cJSON_GetArraySize(array_obj) == 0) {
+		cJSON_Delete(array_obj);
+		return -ENODATA;
+	}
+
+	json_add_obj(parent, label, array_obj);
+	return 0;
+}
+
+int json_common_batch_data_add(cJSON *parent, enum json_common_buffer_type type, void *buf,
+			       size_t buf_count, const char *object_label)
+{
+	const struct json_common_batch_buffer buffer = {
+		.type = type,
+		.buf = buf,
+		.buf_count = buf_count,
+		.object_label = object_label,
+	};
+	struct batch_size size = { 0 };
+
+	return batch_data_add(parent, &buffer, &size);
+}
+
+int json_common_batch_add(cJSON *parent, const struct json_common_batch_buffer *buffers,
+			  size_t count, size_t size_max)
+{
+	int err;
+	bool object_added = false;
+	struct batch_size size = {
+		.max = size_max,
+		.len = BATCH_ROOT_LEN,
+	};
+
+	for (size_t i = 0; (i < count) && !size.full; i++) {
+		err = batch_data_add(parent, &buffers[i], &size);
+		if (err == 0) {
+			object_added = true;
+		} else if (err != -ENODATA) {
+			return err;
 		}
-			break;
-		case JSON_COMMON_MODEM_DYNAMIC: {
-			struct cloud_data_modem_dynamic *data =
-					(struct cloud_data_modem_dynamic *)buf;
-			err = json_common_modem_dynamic_data_add(array_obj,
-								 &data[i],
-								 JSON_COMMON_ADD_DATA_TO_ARRAY,
-								 NULL,
-								 NULL);
+	}
+
+	if ((size_max > 0) && (size.len > size_max)) {
+		LOG_WRN("Batch entry does not fit in %zu bytes, sent in a %zu byte message",
+			size_max, size.len);
+	}
+
+	return object_added ? 0 : -ENODATA;
+}
+
+#if defined(CONFIG_CLOUD_CODEC_JSON_WRITER)
+/* Streaming encoders. They produce the same output as the corresponding json_common_*_data_add()
+ * functions with JSON_COMMON_ADD_DATA_TO_ARRAY, but write it to a JSON writer and do not modify
+ * the passed in data. This allows the output to be measured before it is written.
+ */
+
+/* Length of the end of the last array and of the batch message object, "]}". */
+#define BATCH_CLOSE_LEN 2
+
+static int unix_ts_get(int64_t ts, bool ts_unix, int64_t *unix_ts)
+{
+	int err;
+
+	*unix_ts = ts;
+
+	if (ts_unix) {
+		return 0;
+	}
+
+	err = date_time_uptime_to_unix_time_ms(unix_ts);
+	if (err) {
+		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+		return err;
+	}
+
+	return 0;
+}
+
+static int modem_static_data_write(struct json_writer *writer,
+				   const struct cloud_data_modem_static *data)
+{
+	int err;
+	int64_t ts;
+
+	err = unix_ts_get(data->ts, false, &ts);
+	if (err) {
+		return err;
+	}
+
+	json_writer_object_start(writer, NULL);
+	json_writer_object_start(writer, DATA_VALUE);
+	json_writer_string(writer, MODEM_IMEI, data->imei);
+	json_writer_string(writer, MODEM_ICCID, data->iccid);
+	json_writer_string(writer, MODEM_FIRMWARE_VERSION, data->fw);
+	json_writer_string(writer, MODEM_BOARD, data->brdv);
+	json_writer_string(writer, MODEM_APP_VERSION, data->appv);
+	json_writer_object_end(writer);
+	json_writer_number(writer, DATA_TIMESTAMP, ts);
+	json_writer_object_end(writer);
+
+	return 0;
+}
+
+static int modem_dynamic_data_write(struct json_writer *writer,
+				    const struct cloud_data_modem_dynamic *data)
+{
+	int err;
+	int64_t ts;
+	uint32_t mccmnc;
+	char *end_ptr;
+
+	err = unix_ts_get(data->ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	/* Convert mccmnc to unsigned long integer. */
+	errno = 0;
+	mccmnc = strtoul(data->mccmnc, &end_ptr, 10);
+
+	if ((errno == ERANGE) || (*end_ptr != '\0')) {
+		LOG_ERR("MCCMNC string could not be converted.");
+		return -ENOTEMPTY;
+	}
+
+	json_writer_object_start(writer, NULL);
+	json_writer_object_start(writer, DATA_VALUE);
+	json_writer_number(writer, MODEM_CURRENT_BAND, data->band);
+	json_writer_string(writer, MODEM_NETWORK_MODE,
+			   (data->nw_mode == LTE_LC_LTE_MODE_LTEM) ? "LTE-M" :
+			   (data->nw_mode == LTE_LC_LTE_MODE_NBIOT) ? "NB-IoT" : "Unknown");
+	json_writer_number(writer, MODEM_RSRP, data->rsrp);
+	json_writer_number(writer, MODEM_AREA_CODE, data->area);
+	json_writer_number(writer, MODEM_MCCMNC, mccmnc);
+	json_writer_number(writer, MODEM_CELL_ID, data->cell);
+	json_writer_string(writer, MODEM_IP_ADDRESS, data->ip);
+	json_writer_object_end(writer);
+	json_writer_number(writer, DATA_TIMESTAMP, ts);
+	json_writer_object_end(writer);
+
+	return 0;
+}
+
+static int gnss_data_write(struct json_writer *writer, const struct cloud_data_gnss *data)
+{
+	int err;
+	int64_t ts;
+
+	err = unix_ts_get(data->gnss_ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	json_writer_object_start(writer, NULL);
+	json_writer_object_start(writer, DATA_VALUE);
+	json_writer_number(writer, DATA_GNSS_LONGITUDE, data->pvt.longi);
+	json_writer_number(writer, DATA_GNSS_LATITUDE, data->pvt.lat);
+	json_writer_number(writer, DATA_GNSS_ACCURACY, data->pvt.acc);
+	json_writer_number(writer, DATA_GNSS_ALTITUDE, data->pvt.alt);
+	json_writer_number(writer, DATA_GNSS_SPEED, data->pvt.spd);
+	json_writer_number(writer, DATA_GNSS_HEADING, data->pvt.hdg);
+	json_writer_object_end(writer);
+	json_writer_number(writer, DATA_TIMESTAMP, ts);
+	json_writer_object_end(writer);
+
+	return 0;
+}
+
+static int sensor_data_write(struct json_writer *writer, const struct cloud_data_sensors *data)
+{
+	int err;
+	int64_t ts;
+
+	err = unix_ts_get(data->env_ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	json_writer_object_start(writer, NULL);
+	json_writer_object_start(writer, DATA_VALUE);
+	json_writer_number(writer, DATA_TEMPERATURE, data->temperature);
+	json_writer_number(writer, DATA_HUMIDITY, data->humidity);
+	json_writer_number(writer, DATA_PRESSURE, data->pressure);
+
+	/* If air quality is negative, the value is not provided. */
+	if (data->bsec_air_quality >= 0) {
+		json_writer_number(writer, DATA_BSEC_IAQ, data->bsec_air_quality);
+	}
+
+	json_writer_object_end(writer);
+	json_writer_number(writer, DATA_TIMESTAMP, ts);
+	json_writer_object_end(writer);
+
+	return 0;
+}
+
+static int ui_data_write(struct json_writer *writer, const struct cloud_data_ui *data)
+{
+	int err;
+	int64_t ts;
+
+	err = unix_ts_get(data->btn_ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	json_writer_object_start(writer, NULL);
+	json_writer_number(writer, DATA_VALUE, data->btn);
+	json_writer_number(writer, DATA_TIMESTAMP, ts);
+	json_writer_object_end(writer);
+
+	return 0;
+}
+
+static int impact_data_write(struct json_writer *writer, const struct cloud_data_impact *data)
+{
+	int err;
+	int64_t ts;
+
+	err = unix_ts_get(data->ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	json_writer_object_start(writer, NULL);
+	json_writer_number(writer, DATA_VALUE, data->magnitude);
+	json_writer_number(writer, DATA_TIMESTAMP, ts);
+	json_writer_object_end(writer);
+
+	return 0;
+}
+
+static int battery_data_write(struct json_writer *writer, const struct cloud_data_battery *data)
+{
+	int err;
+	int64_t ts;
+
+	err = unix_ts_get(data->bat_ts, data->ts_unix, &ts);
+	if (err) {
+		return err;
+	}
+
+	json_writer_object_start(writer, NULL);
+	json_writer_number(writer, DATA_VALUE, data->bat);
+	json_writer_number(writer, DATA_TIMESTAMP, ts);
+	json_writer_object_end(writer);
+
+	return 0;
+}
+
+/* Get the queued flag of entry i in buf. Optionally clear it. */
+static bool batch_entry_queued(enum json_common_buffer_type type, void *buf, size_t i, bool clear)
+{
+	bool queued;
+
+#define ENTRY_QUEUED(_type)					\
+	do {							\
+		_type *data = &((_type *)buf)[i];		\
+								\
+		queued = data->queued;				\
+		if (clear) {					\
+			data->queued = false;			\
+		}						\
+	} while (0)
+
+	switch (type) {
+	case JSON_COMMON_UI:
+		ENTRY_QUEUED(struct cloud_data_ui);
+		break;
+	case JSON_COMMON_IMPACT:
+		ENTRY_QUEUED(struct cloud_data_impact);
+		break;
+	case JSON_COMMON_MODEM_STATIC:
+		ENTRY_QUEUED(struct cloud_data_modem_static);
+		break;
+	case JSON_COMMON_MODEM_DYNAMIC:
+		ENTRY_QUEUED(struct cloud_data_modem_dynamic);
+		break;
+	case JSON_COMMON_GNSS:
+		ENTRY_QUEUED(struct cloud_data_gnss);
+		break;
+	case JSON_COMMON_SENSOR:
+		ENTRY_QUEUED(struct cloud_data_sensors);
+		break;
+	case JSON_COMMON_BATTERY:
+		ENTRY_QUEUED(struct cloud_data_battery);
+		break;
+	default:
+		queued = false;
+		break;
+	}
+
+#undef ENTRY_QUEUED
+
+	return queued;
+}
+
+static int batch_entry_write(struct json_writer *writer, enum json_common_buffer_type type,
+			     void *buf, size_t i)
+{
+	switch (type) {
+	case JSON_COMMON_UI:
+		return ui_data_write(writer, &((struct cloud_data_ui *)buf)[i]);
+	case JSON_COMMON_IMPACT:
+		return impact_data_write(writer, &((struct cloud_data_impact *)buf)[i]);
+	case JSON_COMMON_MODEM_STATIC:
+		return modem_static_data_write(writer,
+					       &((struct cloud_data_modem_static *)buf)[i]);
+	case JSON_COMMON_MODEM_DYNAMIC:
+		return modem_dynamic_data_write(writer,
+						&((struct cloud_data_modem_dynamic *)buf)[i]);
+	case JSON_COMMON_GNSS:
+		return gnss_data_write(writer, &((struct cloud_data_gnss *)buf)[i]);
+	case JSON_COMMON_SENSOR:
+		return sensor_data_write(writer, &((struct cloud_data_sensors *)buf)[i]);
+	case JSON_COMMON_BATTERY:
+		return battery_data_write(writer, &((struct cloud_data_battery *)buf)[i]);
+	default:
+		LOG_WRN("Unknown buffer type: %d", type);
+		return -EINVAL;
+	}
+}
+
+/* Write the queued entries of a buffer, up to entry *end, as an array. If size_max is not 0,
+ * writing stops at the first entry that would make the message longer than size_max, and *end
+ * is set to that entry. *written counts the entries in the message, the first entry is always
+ * written so that an entry larger than size_max does not block the buffer.
+ */
+static int batch_buffer_write(struct json_writer *writer,
+			      const struct json_common_batch_buffer *buffer, size_t *end,
+			      size_t size_max, size_t *written, bool *full)
+{
+	int err;
+	bool array_started = false;
+
+	if (buffer->buf == NULL) {
+		return -ENODATA;
+	}
+
+	for (size_t i = 0; i < *end; i++) {
+		struct json_writer snapshot = *writer;
+		bool array_started_before = array_started;
+
+		if (!batch_entry_queued(buffer->type, buffer->buf, i, false)) {
+			continue;
 		}
-			break;
-		case JSON_COMMON_GNSS: {
-			struct cloud_data_gnss *data =
-					(struct cloud_data_gnss *)buf;
-			err = json_common_gnss_data_add(array_obj,
-						       &data[i],
-						       JSON_COMMON_ADD_DATA_TO_ARRAY,
-						       NULL,
-						       NULL);
+
+		if (!array_started) {
+			json_writer_array_start(writer, buffer->object_label);
+			array_started = true;
 		}
-			break;
-		case JSON_COMMON_SENSOR: {
-			struct cloud_data_sensors *data =
-					(struct cloud_data_sensors *)buf;
-			err = json_common_sensor_data_add(array_obj,
-							  &data[i],
-							  JSON_COMMON_ADD_DATA_TO_ARRAY,
-							  NULL,
-							  NULL);
+
+		err = batch_entry_write(writer, buffer->type, buffer->buf, i);
+		if (err) {
+			return err;
 		}
+
+		if ((size_max > 0) && (*written > 0) &&
+		    (json_writer_len(writer) + BATCH_CLOSE_LEN > size_max)) {
+			/* The entry is left for the next message. */
+			*writer = snapshot;
+			array_started = array_started_before;
+			*end = i;
+			*full = true;
 			break;
-		case JSON_COMMON_BATTERY: {
-			struct cloud_data_battery *data =
-					(struct cloud_data_battery *)buf;
-			err = json_common_battery_data_add(array_obj,
-							   &data[i],
-							   JSON_COMMON_ADD_DATA_TO_ARRAY,
-							   NULL,
-							   NULL);
 		}
-			break;
-		default:
-			LOG_WRN("Unknown buffer type: %d", type);
-			break;
+
+		(*written)++;
+	}
+
+	if (!array_started) {
+		return -ENODATA;
+	}
+
+	json_writer_array_end(writer);
+	return 0;
+}
+
+int json_common_batch_data_write(struct json_writer *writer, enum json_common_buffer_type type,
+				 void *buf, size_t buf_count, const char *object_label)
+{
+	const struct json_common_batch_buffer buffer = {
+		.type = type,
+		.buf = buf,
+		.buf_count = buf_count,
+		.object_label = object_label,
+	};
+	size_t end = buf_count;
+	size_t written = 0;
+	bool full = false;
+
+	return batch_buffer_write(writer, &buffer, &end, 0, &written, &full);
+}
+
+/* Write a batch message with the entries of each buffer up to ends[i]. If size_max is not 0,
+ * ends[] is updated to the entries that fit in a message of size_max bytes.
+ */
+static int batch_write(struct json_writer *writer,
+		       const struct json_common_batch_buffer *buffers, size_t *ends,
+		       size_t count, size_t size_max)
+{
+	int err;
+	bool object_added = false;
+	bool full = false;
+	size_t written = 0;
+
+	json_writer_object_start(writer, NULL);
+
+	for (size_t i = 0; i < count; i++) {
+		if (full) {
+			ends[i] = 0;
+			continue;
 		}
 
-		if ((err != 0) && (err != -ENODATA)) {
-			LOG_ERR("Failed adding data to array object");
-			cJSON_Delete(array_obj);
+		err = batch_buffer_write(writer, &buffers[i], &ends[i], size_max, &written, &full);
+		if (err == 0) {
+			object_added = true;
+		} else if (err != -ENODATA) {
 			return err;
 		}
 	}
 
-	if (cJSON_GetArraySize(array_obj) == 0) {
-		cJSON_Delete(array_obj);
-		/* At this point err can be either 0 or -ENODATA depending on the return
-		 * value of the function that adds the last item present in the respective buffer.
-		 * Because of this we explicitly set err to -ENODATA if the array is empty.
-		 */
-		return -ENODATA;
+	json_writer_object_end(writer);
+
+	return object_added ? 0 : -ENODATA;
+}
+
+int json_common_batch_encode(struct cloud_codec_data *output,
+			     const struct json_common_batch_buffer *buffers, size_t count,
+			     size_t size_max)
+{
+	int err;
+	char *buffer;
+	size_t len;
+	size_t ends[JSON_COMMON_COUNT];
+	struct json_writer writer;
+
+	if (count > ARRAY_SIZE(ends)) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		ends[i] = buffers[i].buf_count;
+	}
+
+	/* First pass, compute the length of the output and the entries that fit in it. */
+	json_writer_init(&writer, NULL, 0);
+
+	err = batch_write(&writer, buffers, ends, count, size_max);
+	if (err == -ENODATA) {
+		LOG_DBG("No data to encode, JSON string empty...");
+		return err;
+	} else if (err) {
+		return err;
+	}
+
+	len = json_writer_len(&writer);
+
+	if ((size_max > 0) && (len > size_max)) {
+		LOG_WRN("Batch entry does not fit in %zu bytes, sent in a %zu byte message",
+			size_max, len);
+	}
+
+	buffer = k_malloc(len + 1);
+	if (buffer == NULL) {
+		LOG_ERR("Failed to allocate memory for JSON string");
+		return -ENOMEM;
+	}
+
+	/* Second pass, write the output. */
+	json_writer_init(&writer, buffer, len + 1);
+
+	err = batch_write(&writer, buffers, ends, count, 0);
+	if (err == 0) {
+		err = json_writer_finish(&writer);
 	}
 
-	json_add_obj(parent, object_label, array_obj);
+	if (err) {
+		k_free(buffer);
+		return err;
+	}
+
+	/* Only the entries in the message are dequeued. */
+	for (size_t i = 0; i < count; i++) {
+		for (size_t j = 0; j < ends[i]; j++) {
+			(void)batch_entry_queued(buffers[i].type, buffers[i].buf, j, true);
+		}
+	}
+
+	LOG_DBG("Encoded batch message: %s", buffer);
+
+	output->buf = buffer;
+	output->len = len;
+
 	return 0;
 }
+#endif /* CONFIG_CLOUD_CODEC_JSON_WRITER */
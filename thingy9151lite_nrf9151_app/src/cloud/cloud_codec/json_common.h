@@ -25,7 +25,9 @@ extern "C" {
 #include <cJSON.h>
 
 #include "cloud_codec.h"
+#include "cloud_codec_shadow.h"
 #include "json_protocol_names.h"
+#include "json_writer.h"
 
 /** @brief Type of data to be handled by the respective API. Used to signify what data structure
  *         that is passed in to the function.
@@ -97,6 +99,56 @@ int json_common_modem_dynamic_data_add(cJSON *parent,
 				       const char *object_label,
 				       cJSON **parent_ref);
 
+/**
+ * @brief Encode and add selected fields of static modem data to the parent object.
+ *
+ * @details Used to report only the fields that have changed to the device shadow, see
+ *	    cloud_codec_shadow.h. The data is dequeued without being encoded if no fields are
+ *	    selected.
+ *
+ * @param[out] parent Pointer to object that the encoded data is added to.
+ * @param[in] data Pointer to data that is to be encoded.
+ * @param[in] fields Fields to encode, CLOUD_CODEC_SHADOW_MODEM_* static modem data flags.
+ * @param[in] op Operation that is to be carried out.
+ * @param[in] object_label Name of the encoded object.
+ * @param[out] parent_ref Reference to an unallocated parent object pointer. See
+ *			  json_common_modem_static_data_add().
+ *
+ * @return 0 on success. -ENODATA if the passed in data is not valid or no fields are selected.
+ *	   Otherwise a negative error code is returned.
+ */
+int json_common_modem_static_fields_add(cJSON *parent,
+					struct cloud_data_modem_static *data,
+					uint32_t fields,
+					enum json_common_op_code op,
+					const char *object_label,
+					cJSON **parent_ref);
+
+/**
+ * @brief Encode and add selected fields of dynamic modem data to the parent object.
+ *
+ * @details Used to report only the fields that have changed to the device shadow, see
+ *	    cloud_codec_shadow.h. The data is dequeued without being encoded if no fields are
+ *	    selected.
+ *
+ * @param[out] parent Pointer to object that the encoded data is added to.
+ * @param[in] data Pointer to data that is to be encoded.
+ * @param[in] fields Fields to encode, CLOUD_CODEC_SHADOW_MODEM_* dynamic modem data flags.
+ * @param[in] op Operation that is to be carried out.
+ * @param[in] object_label Name of the encoded object.
+ * @param[out] parent_ref Reference to an unallocated parent object pointer. See
+ *			  json_common_modem_dynamic_data_add().
+ *
+ * @return 0 on success. -ENODATA if the passed in data is not valid or no fields are selected.
+ *	   Otherwise a negative error code is returned.
+ */
+int json_common_modem_dynamic_fields_add(cJSON *parent,
+					 struct cloud_data_modem_dynamic *data,
+					 uint32_t fields,
+					 enum json_common_op_code op,
+					 const char *object_label,
+					 cJSON **parent_ref);
+
 /**
  * @brief Encode and add environmental sensor data to the parent object.
  *
@@ -288,6 +340,10 @@ void json_common_config_get(cJSON *parent, struct cloud_data_cfg *data);
  * @brief Encode all queued entries in the passed in buffer and add it to the parent object
  *        as an array.
  *
+ * @details The buffer is expected to hold only the live entries of a ringbuffer, as returned
+ *          by its peek function, so the encoding cost scales with the number of pending
+ *          entries rather than with the ringbuffer size.
+ *
  * @param[out] parent Pointer to object that the encoded data is added to.
  * @param[in] type Type of data passed in to the function.
  * @param[in] buf Pointer to data buffer that is to be encoded.
@@ -300,6 +356,85 @@ void json_common_config_get(cJSON *parent, struct cloud_data_cfg *data);
 int json_common_batch_data_add(cJSON *parent, enum json_common_buffer_type type, void *buf,
 			       size_t buf_count, const char *object_label);
 
+/** @brief Buffer that is encoded as an array in a batch message. */
+struct json_common_batch_buffer {
+	/** Type of data in the buffer. */
+	enum json_common_buffer_type type;
+	/** Pointer to data buffer. */
+	void *buf;
+	/** Number of entries in the data buffer. */
+	size_t buf_count;
+	/** Name of the array in the batch message. */
+	const char *object_label;
+};
+
+/**
+ * @brief Encode the queued entries in the passed in buffers and add them to the parent object,
+ *        one array each.
+ *
+ * @details If size_max is not 0, only the queued entries that fit in a message of
+ *          size_max bytes are added, taken from the buffers in the passed in order. The
+ *          remaining entries are left queued for the next call. An entry that does not fit in
+ *          an empty message is added on its own. Each entry is printed to measure it, the
+ *          streaming encoder json_common_batch_encode() avoids this cost.
+ *
+ * @param[out] parent Pointer to the root object of the batch message.
+ * @param[in] buffers Buffers that are encoded, in the passed in order.
+ * @param[in] count Number of buffers.
+ * @param[in] size_max Maximum length of the printed message in bytes, or 0 for no limit.
+ *
+ * @return 0 on success. -ENODATA if there are no queued entries in any of the buffers.
+ *         Otherwise a negative error code is returned.
+ */
+int json_common_batch_add(cJSON *parent, const struct json_common_batch_buffer *buffers,
+			  size_t count, size_t size_max);
+
+#if defined(CONFIG_CLOUD_CODEC_JSON_WRITER)
+
+/**
+ * @brief Write all queued entries in the passed in buffer as an array.
+ *
+ * @note Produces the same output as json_common_batch_data_add(). The passed in data is not
+ *       modified, entries are not dequeued and timestamps are converted in a local copy.
+ *
+ * @param[in, out] writer Pointer to JSON writer.
+ * @param[in] type Type of data passed in to the function.
+ * @param[in] buf Pointer to data buffer that is to be encoded.
+ * @param[in] buf_count Number of entries in passed in data buffer.
+ * @param[in] object_label Name of the array.
+ *
+ * @return 0 on success. -ENODATA if there are no queued entries. Otherwise a negative error
+ *         code is returned.
+ */
+int json_common_batch_data_write(struct json_writer *writer, enum json_common_buffer_type type,
+				 void *buf, size_t buf_count, const char *object_label);
+
+/**
+ * @brief Encode a batch message without building a cJSON tree.
+ *
+ * @details The message is measured in a first pass, then written to a single buffer of the
+ *          exact size. Entries are dequeued only if the message is encoded successfully.
+ *          The output buffer must be freed by the caller with k_free().
+ *
+ *          If size_max is not 0, the message holds the oldest queued entries that fit in
+ *          size_max bytes, taken from the buffers in the passed in order. Only these entries
+ *          are dequeued, the remaining entries are encoded by the next call. An entry that
+ *          does not fit in an empty message is encoded on its own in a larger message.
+ *
+ * @param[out] output Pointer to structure that the encoded message is stored in.
+ * @param[in] buffers Buffers that are encoded, one array each, in the passed in order.
+ * @param[in] count Number of buffers, at most JSON_COMMON_COUNT.
+ * @param[in] size_max Maximum length of the message in bytes, or 0 for no limit.
+ *
+ * @return 0 on success. -ENODATA if there are no queued entries in any of the buffers.
+ *         -ENOMEM if the output buffer could not be allocated. -EINVAL if count is too
+ *         large. Otherwise a negative error code is returned.
+ */
+int json_common_batch_encode(struct cloud_codec_data *output,
+			     const struct json_common_batch_buffer *buffers, size_t count,
+			     size_t size_max);
+#endif /* CONFIG_CLOUD_CODEC_JSON_WRITER */
+
 #ifdef __cplusplus
 }
 #endif
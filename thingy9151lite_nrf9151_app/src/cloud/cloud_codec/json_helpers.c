@@ -102,5 +102,6 @@ void json_print_obj(const char *prefix, const cJSON *obj)
 
 	printk("%s%s\n", prefix, string);
 
-	cJSON_FreeString(string);
+	/* Free with the cJSON hooks, the string may have been allocated from the JSON arena. */
+	cJSON_free(string);
 }
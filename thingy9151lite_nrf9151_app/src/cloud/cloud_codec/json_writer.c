@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "json_writer.h"
+
+/* Size of the buffer that numbers are formatted in. Same as used by cJSON. */
+#define NUMBER_BUF_SIZE 26
+
+static void raw_write(struct json_writer *writer, const char *str, size_t len)
+{
+	/* Once the output does not fit, nothing more is written. The length is still updated
+	 * so that it reflects the size that would have been needed.
+	 */
+	if ((writer->buf != NULL) && ((writer->len + len) < writer->size)) {
+		memcpy(&writer->buf[writer->len], str, len);
+	}
+
+	writer->len += len;
+}
+
+static void char_write(struct json_writer *writer, char c)
+{
+	raw_write(writer, &c, 1);
+}
+
+/* Escapes the same characters as cJSON. */
+static void string_write(struct json_writer *writer, const char *str)
+{
+	char escape[7];
+
+	char_write(writer, '"');
+
+	for (const unsigned char *c = (const unsigned char *)str; *c != '\0'; c++) {
+		switch (*c) {
+		case '"':
+			raw_write(writer, "\\\"", 2);
+			break;
+		case '\\':
+			raw_write(writer, "\\\\", 2);
+			break;
+		case '\b':
+			raw_write(writer, "\\b", 2);
+			break;
+		case '\f':
+			raw_write(writer, "\\f", 2);
+			break;
+		case '\n':
+			raw_write(writer, "\\n", 2);
+			break;
+		case '\r':
+			raw_write(writer, "\\r", 2);
+			break;
+		case '\t':
+			raw_write(writer, "\\t", 2);
+			break;
+		default:
+			if (*c < 32) {
+				snprintf(escape, sizeof(escape), "\\u%04x", *c);
+				raw_write(writer, escape, 6);
+			} else {
+				char_write(writer, *c);
+			}
+			break;
+		}
+	}
+
+	char_write(writer, '"');
+}
+
+static void value_start(struct json_writer *writer, const char *key)
+{
+	if (writer->separator) {
+		char_write(writer, ',');
+	}
+
+	if (key != NULL) {
+		string_write(writer, key);
+		char_write(writer, ':');
+	}
+}
+
+static bool double_equal(double a, double b)
+{
+	double max = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
+
+	return fabs(a - b) <= max * DBL_EPSILON;
+}
+
+/* Formats numbers the same way as cJSON. Integers are printed as such, other numbers with
+ * 15 significant digits, or 17 if that is needed to represent the value exactly.
+ */
+static int number_format(char *buf, double value)
+{
+	int value_int;
+	double test;
+	int len;
+
+	if (isnan(value) || isinf(value)) {
+		return snprintf(buf, NUMBER_BUF_SIZE, "null");
+	}
+
+	if (value >= INT_MAX) {
+		value_int = INT_MAX;
+	} else if (value <= (double)INT_MIN) {
+		value_int = INT_MIN;
+	} else {
+		value_int = (int)value;
+	}
+
+	if (value == (double)value_int) {
+		return snprintf(buf, NUMBER_BUF_SIZE, "%d", value_int);
+	}
+
+	len = snprintf(buf, NUMBER_BUF_SIZE, "%1.15g", value);
+
+	if ((sscanf(buf, "%lg", &test) != 1) || !double_equal(test, value)) {
+		len = snprintf(buf, NUMBER_BUF_SIZE, "%1.17g", value);
+	}
+
+	return len;
+}
+
+void json_writer_init(struct json_writer *writer, char *buf, size_t size)
+{
+	writer->buf = buf;
+	writer->size = size;
+	writer->len = 0;
+	writer->separator = false;
+}
+
+void json_writer_object_start(struct json_writer *writer, const char *key)
+{
+	value_start(writer, key);
+	char_write(writer, '{');
+	writer->separator = false;
+}
+
+void json_writer_object_end(struct json_writer *writer)
+{
+	char_write(writer, '}');
+	writer->separator = true;
+}
+
+void json_writer_array_start(struct json_writer *writer, const char *key)
+{
+	value_start(writer, key);
+	char_write(writer, '[');
+	writer->separator = false;
+}
+
+void json_writer_array_end(struct json_writer *writer)
+{
+	char_write(writer, ']');
+	writer->separator = true;
+}
+
+void json_writer_number(struct json_writer *writer, const char *key, double value)
+{
+	char buf[NUMBER_BUF_SIZE];
+	int len;
+
+	value_start(writer, key);
+
+	len = number_format(buf, value);
+	if ((len > 0) && (len < sizeof(buf))) {
+		raw_write(writer, buf, len);
+	}
+
+	writer->separator = true;
+}
+
+void json_writer_string(struct json_writer *writer, const char *key, const char *value)
+{
+	value_start(writer, key);
+	string_write(writer, value);
+	writer->separator = true;
+}
+
+void json_writer_bool(struct json_writer *writer, const char *key, bool value)
+{
+	value_start(writer, key);
+
+	if (value) {
+		raw_write(writer, "true", 4);
+	} else {
+		raw_write(writer, "false", 5);
+	}
+
+	writer->separator = true;
+}
+
+int json_writer_finish(struct json_writer *writer)
+{
+	if (writer->buf == NULL) {
+		return 0;
+	}
+
+	if (writer->len >= writer->size) {
+		return -ENOMEM;
+	}
+
+	writer->buf[writer->len] = '\0';
+
+	return 0;
+}
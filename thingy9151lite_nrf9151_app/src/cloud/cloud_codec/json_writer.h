@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef JSON_WRITER_H__
+#define JSON_WRITER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**@file
+ *
+ * @defgroup json_writer JSON writer
+ * @brief    Streaming JSON writer that does not allocate memory.
+ *
+ * @details Values are written directly to a caller-provided buffer, in the same format as
+ *	    cJSON_PrintUnformatted(). If the writer is initialized without a buffer, nothing is
+ *	    written and only the length of the output is computed. This is used to size the
+ *	    output buffer in a first pass.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief JSON writer state. */
+struct json_writer {
+	/** Output buffer. NULL if only the length is computed. */
+	char *buf;
+	/** Size of the output buffer. */
+	size_t size;
+	/** Length of the output, including what did not fit in the buffer. */
+	size_t len;
+	/** A value has been written at the current nesting level. */
+	bool separator;
+};
+
+/**
+ * @brief Initialize a JSON writer.
+ *
+ * @param[out] writer Pointer to writer.
+ * @param[in] buf Output buffer, or NULL to only compute the length of the output.
+ * @param[in] size Size of the output buffer, including the null terminator.
+ */
+void json_writer_init(struct json_writer *writer, char *buf, size_t size);
+
+/**
+ * @brief Start an object.
+ *
+ * @param[in, out] writer Pointer to writer.
+ * @param[in] key Name of the object, or NULL if it is an array element or the root.
+ */
+void json_writer_object_start(struct json_writer *writer, const char *key);
+
+/**
+ * @brief End the current object.
+ *
+ * @param[in, out] writer Pointer to writer.
+ */
+void json_writer_object_end(struct json_writer *writer);
+
+/**
+ * @brief Start an array.
+ *
+ * @param[in, out] writer Pointer to writer.
+ * @param[in] key Name of the array, or NULL if it is an array element or the root.
+ */
+void json_writer_array_start(struct json_writer *writer, const char *key);
+
+/**
+ * @brief End the current array.
+ *
+ * @param[in, out] writer Pointer to writer.
+ */
+void json_writer_array_end(struct json_writer *writer);
+
+/**
+ * @brief Write a number.
+ *
+ * @param[in, out] writer Pointer to writer.
+ * @param[in] key Name of the number, or NULL if it is an array element.
+ * @param[in] value Value.
+ */
+void json_writer_number(struct json_writer *writer, const char *key, double value);
+
+/**
+ * @brief Write a string.
+ *
+ * @param[in, out] writer Pointer to writer.
+ * @param[in] key Name of the string, or NULL if it is an array element.
+ * @param[in] value Null terminated string.
+ */
+void json_writer_string(struct json_writer *writer, const char *key, const char *value);
+
+/**
+ * @brief Write a boolean.
+ *
+ * @param[in, out] writer Pointer to writer.
+ * @param[in] key Name of the boolean, or NULL if it is an array element.
+ * @param[in] value Value.
+ */
+void json_writer_bool(struct json_writer *writer, const char *key, bool value);
+
+/**
+ * @brief Null terminate the output.
+ *
+ * @param[in, out] writer Pointer to writer.
+ *
+ * @retval 0 on success, or if the writer only computes the length.
+ * @retval -ENOMEM if the output did not fit in the buffer.
+ */
+int json_writer_finish(struct json_writer *writer);
+
+/**
+ * @brief Get the length of the output, excluding the null terminator.
+ *
+ * @param[in] writer Pointer to writer.
+ *
+ * @return Length of the output.
+ */
+static inline size_t json_writer_len(const struct json_writer *writer)
+{
+	return writer->len;
+}
+
+#ifdef __cplusplus
+}
+#endif
+/**
+ * @}
+ */
+#endif /* JSON_WRITER_H__ */
@@ -26,6 +26,9 @@ LOG_MODULE_REGISTER(cloud_codec, CONFIG_CLOUD_CODEC_LOG_LEVEL);
 /* Module event handler.  */
 static cloud_codec_evt_handler_t module_evt_handler;
 
+/* Send policy, not part of the configuration object. Kept as set at initialization. */
+static int send_policy;
+
 /* Function that is called whenever the configuration object is written to. */
 static int config_update_cb(uint16_t obj_inst_id, uint16_t res_id, uint16_t res_inst_id,
 			    uint8_t *data, uint16_t data_len, bool last_block, size_t total_size)
@@ -54,6 +57,8 @@ static int config_update_cb(uint16_t obj_inst_id, uint16_t res_id, uint16_t res_
 		return err;
 	}
 
+	cfg.send_policy = send_policy;
+
 	evt.config_update = cfg;
 	module_evt_handler(&evt);
 	return 0;
@@ -75,6 +80,16 @@ int cloud_codec_init(struct cloud_data_cfg *cfg, cloud_codec_evt_handler_t event
 		return err;
 	}
 
+#if defined(CONFIG_CLOUD_CODEC_LWM2M_BATCH)
+	err = lwm2m_codec_helpers_setup_batch_cache();
+	if (err) {
+		LOG_ERR("lwm2m_codec_helpers_setup_batch_cache, error: %d", err);
+		return err;
+	}
+#endif /* CONFIG_CLOUD_CODEC_LWM2M_BATCH */
+
+	send_policy = cfg->send_policy;
+
 	err = lwm2m_codec_helpers_setup_configuration_object(cfg, &config_update_cb);
 	if (err) {
 		LOG_ERR("lwm2m_codec_helpers_setup_configuration_object, error: %d", err);
@@ -341,6 +356,183 @@ int cloud_codec_encode_impact_data(struct cloud_codec_data *output,
 	return -ENOTSUP;
 }
 
+#if defined(CONFIG_CLOUD_CODEC_LWM2M_BATCH)
+/* Handle the result of adding a buffered entry to the time-series caches. Returns true if the
+ * entry has been cached. *full is set if the caches are full, other errors are stored in *error.
+ */
+static bool batch_entry_added(int err, const char *type, bool *full, int *error)
+{
+	switch (err) {
+	case 0:
+		return true;
+	case -ENODATA:
+		return false;
+	case -ENOBUFS:
+		*full = true;
+		return false;
+	default:
+		LOG_ERR("Failed to cache %s data, error: %d", type, err);
+		*error = err;
+		return false;
+	}
+}
+
+int cloud_codec_encode_batch_data(struct cloud_codec_data *output,
+				  struct cloud_data_gnss *gnss_buf,
+				  struct cloud_data_sensors *sensor_buf,
+				  struct cloud_data_modem_static *modem_stat_buf,
+				  struct cloud_data_modem_dynamic *modem_dyn_buf,
+				  struct cloud_data_ui *ui_buf,
+				  struct cloud_data_impact *impact_buf,
+				  struct cloud_data_battery *bat_buf,
+				  size_t gnss_buf_count,
+				  size_t sensor_buf_count,
+				  size_t modem_stat_buf_count,
+				  size_t modem_dyn_buf_count,
+				  size_t ui_buf_count,
+				  size_t impact_buf_count,
+				  size_t bat_buf_count)
+{
+	/* Static modem data is sent with the regular data updates. */
+	ARG_UNUSED(modem_stat_buf);
+	ARG_UNUSED(modem_stat_buf_count);
+
+	static const struct lwm2m_obj_path gnss_paths[] = { BATCH_GNSS_PATHS };
+	static const struct lwm2m_obj_path battery_paths[] = { BATCH_BATTERY_PATHS };
+	static const struct lwm2m_obj_path ui_paths[] = { BATCH_UI_PATHS };
+	int err = 0;
+	bool full = false;
+	bool gnss_added = false;
+	bool sensor_added = false;
+	bool battery_added = false;
+	bool ui_added[ARRAY_SIZE(ui_paths)] = { 0 };
+	bool cached = false;
+	bool cache_full = false;
+
+	/* Entries are cached oldest first. An entry that does not fit in the caches, and the
+	 * entries after it, are left queued and are cached once the caches have been sent.
+	 */
+	for (size_t i = 0; (i < gnss_buf_count) && !full && !err; i++) {
+		if (batch_entry_added(lwm2m_codec_helpers_batch_gnss_add(&gnss_buf[i]),
+				      "GNSS", &full, &err)) {
+			gnss_buf[i].queued = false;
+			gnss_added = true;
+		}
+	}
+
+	cache_full |= full;
+	full = false;
+
+	for (size_t i = 0; (i < sensor_buf_count) && !full && !err; i++) {
+		if (!IS_ENABLED(CONFIG_CLOUD_CODEC_LWM2M_THINGY91_SENSORS)) {
+			/* No sensor objects to cache the data in. */
+			sensor_buf[i].queued = false;
+			continue;
+		}
+
+		if (batch_entry_added(lwm2m_codec_helpers_batch_sensor_add(&sensor_buf[i]),
+				      "sensor", &full, &err)) {
+			sensor_buf[i].queued = false;
+			sensor_added = true;
+		}
+	}
+
+	cache_full |= full;
+	full = false;
+
+	for (size_t i = 0; (i < bat_buf_count) && !full && !err; i++) {
+		if (batch_entry_added(lwm2m_codec_helpers_batch_battery_add(&bat_buf[i]),
+				      "battery", &full, &err)) {
+			bat_buf[i].queued = false;
+			battery_added = true;
+		}
+	}
+
+	cache_full |= full;
+	full = false;
+
+	for (size_t i = 0; (i < ui_buf_count) && !full && !err; i++) {
+		if (batch_entry_added(lwm2m_codec_helpers_batch_ui_add(&ui_buf[i]),
+				      "UI", &full, &err)) {
+			ui_buf[i].queued = false;
+			ui_added[ui_buf[i].btn - 1] = true;
+		}
+	}
+
+	cache_full |= full;
+
+	if (err) {
+		return err;
+	}
+
+	/* Dynamic modem data and impact data have no time-series representation. Only the newest
+	 * dynamic modem data is sent, with the regular data updates.
+	 */
+	for (size_t i = 0; i < modem_dyn_buf_count; i++) {
+		modem_dyn_buf[i].queued = false;
+	}
+
+	for (size_t i = 0; i < impact_buf_count; i++) {
+		impact_buf[i].queued = false;
+	}
+
+	if (gnss_added) {
+		err = lwm2m_codec_helpers_object_path_list_add(output, gnss_paths,
+							       ARRAY_SIZE(gnss_paths));
+		if (err) {
+			LOG_ERR("Failed populating object path list, error: %d", err);
+			return err;
+		}
+
+		cached = true;
+	}
+
+	if (sensor_added) {
+		static const struct lwm2m_obj_path sensor_paths[] = { BATCH_SENSOR_PATHS };
+
+		err = lwm2m_codec_helpers_object_path_list_add(output, sensor_paths,
+							       ARRAY_SIZE(sensor_paths));
+		if (err) {
+			LOG_ERR("Failed populating object path list, error: %d", err);
+			return err;
+		}
+
+		cached = true;
+	}
+
+	if (battery_added) {
+		err = lwm2m_codec_helpers_object_path_list_add(output, battery_paths,
+							       ARRAY_SIZE(battery_paths));
+		if (err) {
+			LOG_ERR("Failed populating object path list, error: %d", err);
+			return err;
+		}
+
+		cached = true;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(ui_paths); i++) {
+		if (!ui_added[i]) {
+			continue;
+		}
+
+		err = lwm2m_codec_helpers_object_path_list_add(output, &ui_paths[i], 1);
+		if (err) {
+			LOG_ERR("Failed populating object path list, error: %d", err);
+			return err;
+		}
+
+		cached = true;
+	}
+
+	if (cached) {
+		return 0;
+	}
+
+	/* Queued entries are left if the caches are full. They are sent in the next update. */
+	return cache_full ? -ENOBUFS : -ENODATA;
+}
+#else
 int cloud_codec_encode_batch_data(struct cloud_codec_data *output,
 				  struct cloud_data_gnss *gnss_buf,
 				  struct cloud_data_sensors *sensor_buf,
@@ -375,3 +567,4 @@ int cloud_codec_encode_batch_data(struct cloud_codec_data *output,
 
 	return -ENOTSUP;
 }
+#endif /* CONFIG_CLOUD_CODEC_LWM2M_BATCH */
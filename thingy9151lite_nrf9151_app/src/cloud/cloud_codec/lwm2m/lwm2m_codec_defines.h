@@ -77,4 +77,34 @@
 #define BUTTON2_OBJ_INST_ID 1
 #define BUTTON2_APP_NAME "Push button 2"
 
+/* Resources that buffered data is written to when batch data is encoded. Each resource has a
+ * time-series cache that holds one value per buffered entry, see lwm2m_enable_cache().
+ */
+#define BATCH_GNSS_PATHS							\
+	LWM2M_OBJ(LWM2M_OBJECT_LOCATION_ID, 0, LATITUDE_RID),			\
+	LWM2M_OBJ(LWM2M_OBJECT_LOCATION_ID, 0, LONGITUDE_RID),			\
+	LWM2M_OBJ(LWM2M_OBJECT_LOCATION_ID, 0, ALTITUDE_RID),			\
+	LWM2M_OBJ(LWM2M_OBJECT_LOCATION_ID, 0, RADIUS_RID),			\
+	LWM2M_OBJ(LWM2M_OBJECT_LOCATION_ID, 0, SPEED_RID),			\
+	LWM2M_OBJ(LWM2M_OBJECT_LOCATION_ID, 0, LOCATION_TIMESTAMP_RID)
+
+#define BATCH_SENSOR_PATHS							\
+	LWM2M_OBJ(IPSO_OBJECT_TEMP_SENSOR_ID, 0, TIMESTAMP_RID),		\
+	LWM2M_OBJ(IPSO_OBJECT_HUMIDITY_SENSOR_ID, 0, TIMESTAMP_RID),		\
+	LWM2M_OBJ(IPSO_OBJECT_PRESSURE_ID, 0, TIMESTAMP_RID),			\
+	LWM2M_OBJ(IPSO_OBJECT_TEMP_SENSOR_ID, 0, SENSOR_VALUE_RID),		\
+	LWM2M_OBJ(IPSO_OBJECT_HUMIDITY_SENSOR_ID, 0, SENSOR_VALUE_RID),		\
+	LWM2M_OBJ(IPSO_OBJECT_PRESSURE_ID, 0, SENSOR_VALUE_RID)
+
+#define BATCH_BATTERY_PATHS							\
+	LWM2M_OBJ(LWM2M_OBJECT_DEVICE_ID, 0, POWER_SOURCE_VOLTAGE_RID)
+
+/* One path per push button instance, indexed by button number - 1. */
+#define BATCH_UI_PATHS								\
+	LWM2M_OBJ(IPSO_OBJECT_PUSH_BUTTON_ID, BUTTON1_OBJ_INST_ID, TIMESTAMP_RID),	\
+	LWM2M_OBJ(IPSO_OBJECT_PUSH_BUTTON_ID, BUTTON2_OBJ_INST_ID, TIMESTAMP_RID)
+
+/* Largest number of resources that are written for a single buffered entry. */
+#define BATCH_ENTRY_PATHS_MAX 6
+
 #endif /* LWM2M_CODEC_DEFINES_H */
@@ -12,6 +12,10 @@
 #include <string.h>
 #include <modem/lte_lc.h>
 
+#if defined(CONFIG_CLOUD_CODEC_LWM2M_BATCH)
+#include <lwm2m_registry.h>
+#endif
+
 #include "lwm2m_codec_defines.h"
 #include "lwm2m_codec_helpers.h"
 
@@ -956,6 +960,261 @@ int lwm2m_codec_helpers_set_neighbor_cell_data(struct cloud_data_neighbor_cells
 	return 0;
 }
 
+#if defined(CONFIG_CLOUD_CODEC_LWM2M_BATCH)
+#define BATCH_CACHE_ENTRIES CONFIG_CLOUD_CODEC_LWM2M_BATCH_CACHE_ENTRIES
+
+static const struct lwm2m_obj_path batch_gnss_paths[] = { BATCH_GNSS_PATHS };
+static const struct lwm2m_obj_path batch_battery_paths[] = { BATCH_BATTERY_PATHS };
+static const struct lwm2m_obj_path batch_ui_paths[] = { BATCH_UI_PATHS };
+
+static struct lwm2m_time_series_elem gnss_cache[ARRAY_SIZE(batch_gnss_paths)]
+					       [BATCH_CACHE_ENTRIES];
+static struct lwm2m_time_series_elem battery_cache[ARRAY_SIZE(batch_battery_paths)]
+						  [BATCH_CACHE_ENTRIES];
+static struct lwm2m_time_series_elem ui_cache[ARRAY_SIZE(batch_ui_paths)]
+					     [BATCH_CACHE_ENTRIES];
+
+#if defined(CONFIG_CLOUD_CODEC_LWM2M_THINGY91_SENSORS)
+static const struct lwm2m_obj_path batch_sensor_paths[] = { BATCH_SENSOR_PATHS };
+
+static struct lwm2m_time_series_elem sensor_cache[ARRAY_SIZE(batch_sensor_paths)]
+						 [BATCH_CACHE_ENTRIES];
+#endif /* CONFIG_CLOUD_CODEC_LWM2M_THINGY91_SENSORS */
+
+BUILD_ASSERT(ARRAY_SIZE(batch_gnss_paths) <= BATCH_ENTRY_PATHS_MAX);
+
+static int batch_cache_enable(const struct lwm2m_obj_path paths[], size_t count,
+			      struct lwm2m_time_series_elem cache[][BATCH_CACHE_ENTRIES])
+{
+	int err;
+
+	for (size_t i = 0; i < count; i++) {
+		err = lwm2m_enable_cache(&paths[i], cache[i], BATCH_CACHE_ENTRIES);
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/* Append one value to the time-series cache of each resource, with timestamp ts in UNIX
+ * milliseconds. The values are only cached if all caches have room for them, so that the
+ * caches of the resources of an object hold the same samples.
+ */
+static int batch_cache_write(const struct lwm2m_obj_path paths[],
+			     struct lwm2m_time_series_elem values[], size_t count, int64_t ts)
+{
+	struct lwm2m_time_series_resource *entries[BATCH_ENTRY_PATHS_MAX];
+	int err = 0;
+
+	__ASSERT_NO_MSG(count <= ARRAY_SIZE(entries));
+
+	lwm2m_registry_lock();
+
+	for (size_t i = 0; i < count; i++) {
+		entries[i] = lwm2m_cache_entry_get_by_object(&paths[i]);
+		if (entries[i] == NULL) {
+			err = -ENOENT;
+			goto exit;
+		}
+
+		if (lwm2m_cache_size(entries[i]) >= BATCH_CACHE_ENTRIES) {
+			err = -ENOBUFS;
+			goto exit;
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		values[i].t = (time_t)(ts / MSEC_PER_SEC);
+
+		if (!lwm2m_cache_write(entries[i], &values[i])) {
+			err = -ENOBUFS;
+			goto exit;
+		}
+	}
+
+exit:
+	lwm2m_registry_unlock();
+	return err;
+}
+
+/* Convert an uptime timestamp to UNIX time. Entries that did not fit in the caches are
+ * written again later, the timestamp must only be converted once.
+ */
+static int batch_ts_convert(int64_t *ts, bool *ts_unix)
+{
+	int err;
+
+	if (*ts_unix) {
+		return 0;
+	}
+
+	err = date_time_uptime_to_unix_time_ms(ts);
+	if (err) {
+		return err;
+	}
+
+	*ts_unix = true;
+	return 0;
+}
+
+int lwm2m_codec_helpers_setup_batch_cache(void)
+{
+	int err;
+
+	err = batch_cache_enable(batch_gnss_paths, ARRAY_SIZE(batch_gnss_paths), gnss_cache);
+	if (err) {
+		return err;
+	}
+
+#if defined(CONFIG_CLOUD_CODEC_LWM2M_THINGY91_SENSORS)
+	err = batch_cache_enable(batch_sensor_paths, ARRAY_SIZE(batch_sensor_paths),
+				 sensor_cache);
+	if (err) {
+		return err;
+	}
+#endif /* CONFIG_CLOUD_CODEC_LWM2M_THINGY91_SENSORS */
+
+	err = batch_cache_enable(batch_battery_paths, ARRAY_SIZE(batch_battery_paths),
+				 battery_cache);
+	if (err) {
+		return err;
+	}
+
+	/* Only the push button instances that have been created have a timestamp resource. */
+	return batch_cache_enable(batch_ui_paths,
+				  MIN(CONFIG_LWM2M_IPSO_PUSH_BUTTON_INSTANCE_COUNT,
+				      ARRAY_SIZE(batch_ui_paths)),
+				  ui_cache);
+}
+
+int lwm2m_codec_helpers_batch_gnss_add(struct cloud_data_gnss *gnss)
+{
+	int err;
+
+	if (!gnss->queued) {
+		return -ENODATA;
+	}
+
+	err = batch_ts_convert(&gnss->gnss_ts, &gnss->ts_unix);
+	if (err) {
+		return err;
+	}
+
+	/* Same order as BATCH_GNSS_PATHS. */
+	struct lwm2m_time_series_elem values[] = {
+		{ .f = gnss->pvt.lat },
+		{ .f = gnss->pvt.longi },
+		{ .f = (double)gnss->pvt.alt },
+		{ .f = (double)gnss->pvt.acc },
+		{ .f = (double)gnss->pvt.spd },
+		{ .time = (time_t)(gnss->gnss_ts / MSEC_PER_SEC) },
+	};
+
+	return batch_cache_write(batch_gnss_paths, values, ARRAY_SIZE(values), gnss->gnss_ts);
+}
+
+int lwm2m_codec_helpers_batch_sensor_add(struct cloud_data_sensors *sensor)
+{
+#if defined(CONFIG_CLOUD_CODEC_LWM2M_THINGY91_SENSORS)
+	int err;
+
+	if (!sensor->queued) {
+		return -ENODATA;
+	}
+
+	err = batch_ts_convert(&sensor->env_ts, &sensor->ts_unix);
+	if (err) {
+		return err;
+	}
+
+	/* Same order as BATCH_SENSOR_PATHS. */
+	struct lwm2m_time_series_elem values[] = {
+		{ .time = (time_t)(sensor->env_ts / MSEC_PER_SEC) },
+		{ .time = (time_t)(sensor->env_ts / MSEC_PER_SEC) },
+		{ .time = (time_t)(sensor->env_ts / MSEC_PER_SEC) },
+		{ .f = sensor->temperature },
+		{ .f = sensor->humidity },
+		{ .f = sensor->pressure },
+	};
+
+	return batch_cache_write(batch_sensor_paths, values, ARRAY_SIZE(values),
+				 sensor->env_ts);
+#else
+	ARG_UNUSED(sensor);
+
+	return -ENOTSUP;
+#endif /* CONFIG_CLOUD_CODEC_LWM2M_THINGY91_SENSORS */
+}
+
+int lwm2m_codec_helpers_batch_battery_add(struct cloud_data_battery *battery)
+{
+	int err;
+
+	if (!battery->queued) {
+		return -ENODATA;
+	}
+
+	err = batch_ts_convert(&battery->bat_ts, &battery->ts_unix);
+	if (err) {
+		return err;
+	}
+
+	struct lwm2m_time_series_elem values[] = {
+		{ .i32 = battery->bat },
+	};
+
+	return batch_cache_write(batch_battery_paths, values, ARRAY_SIZE(values),
+				 battery->bat_ts);
+}
+
+int lwm2m_codec_helpers_batch_ui_add(struct cloud_data_ui *user_interface)
+{
+	int err;
+	int inst;
+
+	if (!user_interface->queued) {
+		return -ENODATA;
+	}
+
+	if ((user_interface->btn < 1) ||
+	    (user_interface->btn > MIN(CONFIG_LWM2M_IPSO_PUSH_BUTTON_INSTANCE_COUNT,
+				       ARRAY_SIZE(batch_ui_paths)))) {
+		return -EINVAL;
+	}
+
+	inst = user_interface->btn - 1;
+
+	err = batch_ts_convert(&user_interface->btn_ts, &user_interface->ts_unix);
+	if (err) {
+		return err;
+	}
+
+	struct lwm2m_time_series_elem values[] = {
+		{ .time = (time_t)(user_interface->btn_ts / MSEC_PER_SEC) },
+	};
+
+	err = batch_cache_write(&batch_ui_paths[inst], values, ARRAY_SIZE(values),
+				user_interface->btn_ts);
+	if (err) {
+		return err;
+	}
+
+	/* Toggle the digital input state to increment the digital input counter, as for button
+	 * presses that are sent immediately.
+	 */
+	err = lwm2m_set_bool(&LWM2M_OBJ(IPSO_OBJECT_PUSH_BUTTON_ID, inst,
+			     DIGITAL_INPUT_STATE_RID), true);
+	if (err) {
+		return err;
+	}
+
+	return lwm2m_set_bool(&LWM2M_OBJ(IPSO_OBJECT_PUSH_BUTTON_ID, inst,
+			      DIGITAL_INPUT_STATE_RID), false);
+}
+#endif /* CONFIG_CLOUD_CODEC_LWM2M_BATCH */
+
 int lwm2m_codec_helpers_object_path_list_add(struct cloud_codec_data *output,
 					     const struct lwm2m_obj_path path[],
 					     size_t path_size)
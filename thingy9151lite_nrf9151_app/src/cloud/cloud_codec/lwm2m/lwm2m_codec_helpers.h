@@ -146,6 +146,59 @@ int lwm2m_codec_helpers_set_user_interface_data(struct cloud_data_ui *user_inter
  */
 int lwm2m_codec_helpers_set_neighbor_cell_data(struct cloud_data_neighbor_cells *neighbor_cells);
 
+/** @brief Enable the time-series caches of the resources that batch data is written to.
+ *	   Values written to these resources are kept in the caches until they are sent, and are
+ *	   sent with their timestamps when the resources are included in a SenML CBOR send
+ *	   operation.
+ *
+ *  @retval 0 If successful, otherwise a negative value indicating the reason of failure.
+ */
+int lwm2m_codec_helpers_setup_batch_cache(void);
+
+/** @brief Add buffered GNSS data to the time-series caches of the location object.
+ *	   The values are cached with the timestamp of the GNSS fix.
+ *
+ *  @param[in] gnss Pointer to structure that contains GNSS data.
+ *
+ *  @retval 0 If successful, otherwise a negative value indicating the reason of failure.
+ *  @return -ENODATA if the queued flag present in the input structure is false.
+ *  @return -ENOBUFS if the caches are full. No value has been cached.
+ */
+int lwm2m_codec_helpers_batch_gnss_add(struct cloud_data_gnss *gnss);
+
+/** @brief Add buffered environmental sensor data to the time-series caches of the sensor
+ *	   objects. The values are cached with the timestamp of the sample.
+ *
+ *  @param[in] sensor Pointer to structure that contains environmental sensor data.
+ *
+ *  @retval 0 If successful, otherwise a negative value indicating the reason of failure.
+ *  @return -ENODATA if the queued flag present in the input structure is false.
+ *  @return -ENOBUFS if the caches are full. No value has been cached.
+ */
+int lwm2m_codec_helpers_batch_sensor_add(struct cloud_data_sensors *sensor);
+
+/** @brief Add buffered battery data to the time-series cache of the power source voltage
+ *	   resource. The value is cached with the timestamp of the sample.
+ *
+ *  @param[in] battery Pointer to structure that contains battery data.
+ *
+ *  @retval 0 If successful, otherwise a negative value indicating the reason of failure.
+ *  @return -ENODATA if the queued flag present in the input structure is false.
+ *  @return -ENOBUFS if the cache is full. No value has been cached.
+ */
+int lwm2m_codec_helpers_batch_battery_add(struct cloud_data_battery *battery);
+
+/** @brief Add a buffered button press to the time-series cache of the push button timestamp
+ *	   resource. The digital input counter of the button is incremented.
+ *
+ *  @param[in] user_interface Pointer to structure that contains user interface data.
+ *
+ *  @retval 0 If successful, otherwise a negative value indicating the reason of failure.
+ *  @return -ENODATA if the queued flag present in the input structure is false.
+ *  @return -ENOBUFS if the cache is full. No value has been cached.
+ */
+int lwm2m_codec_helpers_batch_ui_add(struct cloud_data_ui *user_interface);
+
 /** @brief Generate path lists with reference to objects.
  *	   This function outputs a list of paths that can be used to reference objects that should
  *	   be updated (sent to server) when calling the lwm2m_send_cb() function.
@@ -54,6 +54,7 @@
 #define CONFIG_ACC_ACT_THRESHOLD	  "accThreshAct"
 #define CONFIG_ACC_INACT_THRESHOLD	  "accThreshInact"
 #define CONFIG_ACC_INACT_TIMEOUT	  "accTimeoutInact"
+#define CONFIG_SEND_POLICY		  "sendPolicy"
 #define CONFIG_NO_DATA_LIST		  "nod"
 #define CONFIG_NO_DATA_LIST_GNSS	  "gnss"
 #define CONFIG_NO_DATA_LIST_NEIGHBOR_CELL "ncell"
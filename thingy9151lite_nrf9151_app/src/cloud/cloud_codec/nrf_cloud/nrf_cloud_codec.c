@@ -173,11 +173,15 @@ static int add_pvt_data(cJSON *parent, struct cloud_data_gnss *gnss)
 		return -ENOMEM;
 	}
 
-	err = date_time_uptime_to_unix_time_ms(&gnss->gnss_ts);
-	if (err) {
-		LOG_WRN("date_time_uptime_to_unix_time_ms, error: %d", err);
-	} else {
+	if (gnss->ts_unix) {
 		gnss_pvt.ts_ms = gnss->gnss_ts;
+	} else {
+		err = date_time_uptime_to_unix_time_ms(&gnss->gnss_ts);
+		if (err) {
+			LOG_WRN("date_time_uptime_to_unix_time_ms, error: %d", err);
+		} else {
+			gnss_pvt.ts_ms = gnss->gnss_ts;
+		}
 	}
 
 	/* Encode the location data into a device message */
@@ -202,10 +206,12 @@ static int modem_dynamic_data_add(struct cloud_data_modem_dynamic *data, cJSON *
 		return -ENODATA;
 	}
 
-	err = date_time_uptime_to_unix_time_ms(&data->ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+	if (!data->ts_unix) {
+		err = date_time_uptime_to_unix_time_ms(&data->ts);
+		if (err) {
+			LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+			return err;
+		}
 	}
 
 	cJSON *modem_val_obj = cJSON_CreateObject();
@@ -346,6 +352,12 @@ static int config_add(cJSON *parent, struct cloud_data_cfg *data, const char *ob
 		goto exit;
 	}
 
+	err = json_add_number(config_obj, CONFIG_SEND_POLICY, data->send_policy);
+	if (err) {
+		LOG_ERR("Encoding error: %d returned at %s:%d", err, __FILE__, __LINE__);
+		goto exit;
+	}
+
 	cJSON *nod_list = cJSON_CreateArray();
 
 	if (nod_list == NULL) {
@@ -413,6 +425,7 @@ static void config_get(cJSON *parent, struct cloud_data_cfg *data)
 	cJSON *acc_act_thres = cJSON_GetObjectItem(parent, CONFIG_ACC_ACT_THRESHOLD);
 	cJSON *acc_inact_thres = cJSON_GetObjectItem(parent, CONFIG_ACC_INACT_THRESHOLD);
 	cJSON *acc_inact_timeout = cJSON_GetObjectItem(parent, CONFIG_ACC_INACT_TIMEOUT);
+	cJSON *send_policy = cJSON_GetObjectItem(parent, CONFIG_SEND_POLICY);
 	cJSON *nod_list = cJSON_GetObjectItem(parent, CONFIG_NO_DATA_LIST);
 
 	if (location_timeout != NULL) {
@@ -447,6 +460,10 @@ static void config_get(cJSON *parent, struct cloud_data_cfg *data)
 		data->accelerometer_inactivity_timeout = acc_inact_timeout->valuedouble;
 	}
 
+	if (send_policy != NULL) {
+		data->send_policy = send_policy->valueint;
+	}
+
 	if (nod_list != NULL && cJSON_IsArray(nod_list)) {
 		cJSON *item;
 		bool gnss_found = false;
@@ -510,10 +527,12 @@ static int add_batch_data(cJSON *array, enum batch_data_type type, void *buf, si
 				break;
 			}
 
-			err = date_time_uptime_to_unix_time_ms(&data[i].env_ts);
-			if (err) {
-				LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-				return -EOVERFLOW;
+			if (!data[i].ts_unix) {
+				err = date_time_uptime_to_unix_time_ms(&data[i].env_ts);
+				if (err) {
+					LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+					return -EOVERFLOW;
+				}
 			}
 
 			len = snprintk(humidity, sizeof(humidity), "%.2f",
@@ -579,10 +598,12 @@ static int add_batch_data(cJSON *array, enum batch_data_type type, void *buf, si
 				break;
 			}
 
-			err = date_time_uptime_to_unix_time_ms(&data[i].ts);
-			if (err) {
-				LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-				return -EOVERFLOW;
+			if (!data[i].ts_unix) {
+				err = date_time_uptime_to_unix_time_ms(&data[i].ts);
+				if (err) {
+					LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+					return -EOVERFLOW;
+				}
 			}
 
 			len = snprintk(magnitude, sizeof(magnitude), "%.2f",
@@ -614,7 +635,7 @@ static int add_batch_data(cJSON *array, enum batch_data_type type, void *buf, si
 			}
 
 			err =  add_data(array, NULL, APP_ID_BUTTON, button,
-					&data[i].btn_ts, data[i].queued, NULL, true);
+					&data[i].btn_ts, data[i].queued, NULL, !data[i].ts_unix);
 			if (err && err != -ENODATA) {
 				return err;
 			}
@@ -670,7 +691,7 @@ static int add_batch_data(cJSON *array, enum batch_data_type type, void *buf, si
 			}
 
 			err = add_data(array, NULL, APP_ID_BATTERY, batt_lvl, &data[i].bat_ts,
-				       data[i].queued, NULL, true);
+				       data[i].queued, NULL, !data[i].ts_unix);
 			if (err && err != -ENODATA) {
 				return err;
 			}
@@ -0,0 +1,491 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+#include <string.h>
+
+#include "cloud_journal.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(cloud_journal, CONFIG_CLOUD_MODULE_LOG_LEVEL);
+
+#define JOURNAL_PARTITION_ID	FIXED_PARTITION_ID(message_journal)
+#define JOURNAL_PARTITION_SIZE	FIXED_PARTITION_SIZE(message_journal)
+#define JOURNAL_SECTOR_SIZE	CONFIG_CLOUD_JOURNAL_SECTOR_SIZE
+#define JOURNAL_SECTOR_COUNT	(JOURNAL_PARTITION_SIZE / JOURNAL_SECTOR_SIZE)
+#define JOURNAL_FCB_MAGIC	0x6a726e6c
+#define INFLIGHT_MAX		CONFIG_CLOUD_JOURNAL_INFLIGHT_MAX
+
+BUILD_ASSERT(JOURNAL_SECTOR_COUNT >= 2, "Message journal needs at least two sectors");
+BUILD_ASSERT(JOURNAL_SECTOR_COUNT <= UINT8_MAX, "Too many message journal sectors");
+
+/* Record type used to persist the sequence number of the last acknowledged message. */
+#define RECORD_TYPE_CURSOR	0xFF
+
+/* Largest entry that the flash circular buffer can hold. */
+#define RECORD_LEN_MAX		0x3FFF
+
+struct record_header {
+	/* Sequence number. For cursor records, sequence number of the last acknowledged
+	 * message.
+	 */
+	uint32_t seq;
+	/* Message flags. */
+	uint32_t flags;
+	/* Message type, or RECORD_TYPE_CURSOR. */
+	uint8_t type;
+	uint8_t reserved[3];
+};
+
+/* Message that has been read out and not yet acknowledged. */
+struct inflight {
+	uint32_t seq;
+	struct fcb_entry loc;
+	bool acked;
+};
+
+static K_MUTEX_DEFINE(journal_lock);
+
+static struct flash_sector sectors[JOURNAL_SECTOR_COUNT];
+static struct fcb fcb = {
+	.f_magic = JOURNAL_FCB_MAGIC,
+	.f_sectors = sectors,
+	.f_sector_cnt = JOURNAL_SECTOR_COUNT,
+};
+
+static bool initialized;
+
+/* Sequence number given to the next stored message. */
+static uint32_t seq_next;
+/* Sequence number of the last acknowledged message. */
+static uint32_t seq_committed;
+/* Number of stored messages that have not been acknowledged. */
+static size_t pending;
+
+/* Location of the last acknowledged record. If fe_sector is NULL, reading starts at the
+ * oldest record.
+ */
+static struct fcb_entry commit_loc;
+/* Location of the last record that has been read out. */
+static struct fcb_entry read_loc;
+
+/* Messages in flight, oldest first. */
+static struct inflight inflight[INFLIGHT_MAX];
+static size_t inflight_count;
+
+static uint16_t message_id(uint32_t seq)
+{
+	return CLOUD_JOURNAL_MESSAGE_ID_BASE + (seq % CLOUD_JOURNAL_MESSAGE_ID_COUNT);
+}
+
+static int header_read(const struct fcb_entry *loc, struct record_header *hdr)
+{
+	if (loc->fe_data_len < sizeof(struct record_header)) {
+		return -EBADMSG;
+	}
+
+	return flash_area_read(fcb.fap, FCB_ENTRY_FA_DATA_OFF(*loc), hdr, sizeof(*hdr));
+}
+
+static int record_write(const struct record_header *hdr, const char *buf, size_t len)
+{
+	int err;
+	struct fcb_entry loc;
+
+	err = fcb_append(&fcb, sizeof(*hdr) + len, &loc);
+	if (err) {
+		return err;
+	}
+
+	err = flash_area_write(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), hdr, sizeof(*hdr));
+	if (err) {
+		return err;
+	}
+
+	if (len > 0) {
+		err = flash_area_write(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc) + sizeof(*hdr),
+				       buf, len);
+		if (err) {
+			return err;
+		}
+	}
+
+	return fcb_append_finish(&fcb, &loc);
+}
+
+static int unacked_count_cb(struct fcb_entry_ctx *loc_ctx, void *arg)
+{
+	struct record_header hdr;
+	size_t *count = arg;
+	int err;
+
+	err = flash_area_read(loc_ctx->fap, FCB_ENTRY_FA_DATA_OFF(loc_ctx->loc),
+			      &hdr, sizeof(hdr));
+	if (err) {
+		return err;
+	}
+
+	if ((hdr.type != RECORD_TYPE_CURSOR) && (hdr.seq > seq_committed)) {
+		*count += 1;
+	}
+
+	return 0;
+}
+
+/* Erase the oldest sector to make room for new records. */
+static int oldest_sector_drop(void)
+{
+	int err;
+	size_t dropped = 0;
+	size_t inflight_dropped = 0;
+
+	err = fcb_walk(&fcb, fcb.f_oldest, unacked_count_cb, &dropped);
+	if (err) {
+		LOG_WRN("fcb_walk, error: %d", err);
+	}
+
+	if (commit_loc.fe_sector == fcb.f_oldest) {
+		commit_loc.fe_sector = NULL;
+	}
+
+	if (read_loc.fe_sector == fcb.f_oldest) {
+		read_loc.fe_sector = NULL;
+	}
+
+	/* Messages in flight from the dropped sector are forgotten, their acknowledgments
+	 * are ignored.
+	 */
+	while ((inflight_dropped < inflight_count) &&
+	       (inflight[inflight_dropped].loc.fe_sector == fcb.f_oldest)) {
+		inflight_dropped++;
+	}
+
+	if (inflight_dropped) {
+		inflight_count -= inflight_dropped;
+		memmove(&inflight[0], &inflight[inflight_dropped],
+			inflight_count * sizeof(inflight[0]));
+	}
+
+	err = fcb_rotate(&fcb);
+	if (err) {
+		LOG_ERR("fcb_rotate, error: %d", err);
+		return err;
+	}
+
+	if (dropped) {
+		LOG_WRN("Message journal full, %d messages dropped", dropped);
+		pending -= MIN(pending, dropped);
+	}
+
+	return 0;
+}
+
+static int record_append(const struct record_header *hdr, const char *buf, size_t len)
+{
+	int err;
+
+	err = record_write(hdr, buf, len);
+	if (err == -ENOSPC) {
+		err = oldest_sector_drop();
+		if (err) {
+			return err;
+		}
+
+		err = record_write(hdr, buf, len);
+	}
+
+	return err;
+}
+
+/* Persist the sequence number of the last acknowledged message and release sectors where all
+ * messages have been acknowledged. The sector holding the last acknowledged record is kept, as
+ * it marks the read position.
+ */
+static int commit(void)
+{
+	int err;
+	struct record_header hdr = {
+		.seq = seq_committed,
+		.type = RECORD_TYPE_CURSOR,
+	};
+
+	err = record_append(&hdr, NULL, 0);
+	if (err) {
+		LOG_ERR("Failed to store read position, error: %d", err);
+		return err;
+	}
+
+	while ((commit_loc.fe_sector != NULL) && (fcb.f_oldest != commit_loc.fe_sector)) {
+		err = fcb_rotate(&fcb);
+		if (err) {
+			LOG_ERR("fcb_rotate, error: %d", err);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static void log_scan(void)
+{
+	int err;
+	struct fcb_entry loc = { 0 };
+	struct record_header hdr;
+
+	/* First pass, recover the sequence numbers. */
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		err = header_read(&loc, &hdr);
+		if (err) {
+			LOG_WRN("Skipping unreadable record, error: %d", err);
+			continue;
+		}
+
+		if (hdr.type == RECORD_TYPE_CURSOR) {
+			seq_committed = MAX(seq_committed, hdr.seq);
+			continue;
+		}
+
+		seq_next = MAX(seq_next, hdr.seq + 1);
+	}
+
+	/* Second pass, find the last acknowledged record and count the unacknowledged ones. */
+	memset(&loc, 0, sizeof(loc));
+
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		err = header_read(&loc, &hdr);
+		if (err) {
+			continue;
+		}
+
+		if (hdr.seq > seq_committed) {
+			if (hdr.type != RECORD_TYPE_CURSOR) {
+				pending++;
+			}
+		} else if (pending == 0) {
+			commit_loc = loc;
+		}
+	}
+
+	read_loc = commit_loc;
+}
+
+int cloud_journal_init(void)
+{
+	int err;
+
+	k_mutex_lock(&journal_lock, K_FOREVER);
+
+	initialized = false;
+	seq_next = 1;
+	seq_committed = 0;
+	pending = 0;
+	inflight_count = 0;
+	memset(&commit_loc, 0, sizeof(commit_loc));
+	memset(&read_loc, 0, sizeof(read_loc));
+
+	for (size_t i = 0; i < ARRAY_SIZE(sectors); i++) {
+		sectors[i].fs_off = i * JOURNAL_SECTOR_SIZE;
+		sectors[i].fs_size = JOURNAL_SECTOR_SIZE;
+	}
+
+	err = fcb_init(JOURNAL_PARTITION_ID, &fcb);
+	if (err == -EINVAL || err == -ENOMSG) {
+		LOG_WRN("Message journal is corrupt, erasing, error: %d", err);
+
+		err = fcb_clear(&fcb);
+		if (err) {
+			LOG_ERR("fcb_clear, error: %d", err);
+			goto exit;
+		}
+	} else if (err) {
+		LOG_ERR("fcb_init, error: %d", err);
+		goto exit;
+	}
+
+	log_scan();
+
+	initialized = true;
+
+	LOG_DBG("Message journal initialized, pending messages: %d", pending);
+
+exit:
+	k_mutex_unlock(&journal_lock);
+	return err;
+}
+
+int cloud_journal_append(uint8_t type, uint32_t flags, const char *buf, size_t len)
+{
+	int err;
+	struct record_header hdr = {
+		.flags = flags,
+		.type = type,
+	};
+
+	if ((buf == NULL) || (len == 0) || (type == RECORD_TYPE_CURSOR)) {
+		return -EINVAL;
+	}
+
+	if ((sizeof(hdr) + len) > MIN(RECORD_LEN_MAX, JOURNAL_SECTOR_SIZE / 2)) {
+		return -EMSGSIZE;
+	}
+
+	k_mutex_lock(&journal_lock, K_FOREVER);
+
+	if (!initialized) {
+		err = -EACCES;
+		goto exit;
+	}
+
+	hdr.seq = seq_next;
+
+	err = record_append(&hdr, buf, len);
+	if (err) {
+		LOG_ERR("Failed to store message, error: %d", err);
+		goto exit;
+	}
+
+	seq_next++;
+	pending++;
+
+	LOG_DBG("Message of type %d stored, %d pending", type, pending);
+
+exit:
+	k_mutex_unlock(&journal_lock);
+	return err;
+}
+
+int cloud_journal_next(struct cloud_journal_entry *entry)
+{
+	int err;
+	struct fcb_entry loc;
+	struct record_header hdr;
+
+	__ASSERT_NO_MSG(entry != NULL);
+
+	k_mutex_lock(&journal_lock, K_FOREVER);
+
+	if (!initialized) {
+		err = -EACCES;
+		goto exit;
+	}
+
+	if (inflight_count == ARRAY_SIZE(inflight)) {
+		err = -EBUSY;
+		goto exit;
+	}
+
+	loc = read_loc;
+	err = -ENODATA;
+
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		if (header_read(&loc, &hdr) ||
+		    (hdr.type == RECORD_TYPE_CURSOR) ||
+		    (hdr.seq <= seq_committed)) {
+			read_loc = loc;
+			continue;
+		}
+
+		entry->len = loc.fe_data_len - sizeof(hdr);
+		entry->buf = k_malloc(entry->len);
+		if (entry->buf == NULL) {
+			/* The message is read out again on the next call. */
+			err = -ENOMEM;
+			break;
+		}
+
+		err = flash_area_read(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc) + sizeof(hdr),
+				      entry->buf, entry->len);
+		if (err) {
+			LOG_WRN("Skipping unreadable message, error: %d", err);
+			k_free(entry->buf);
+			read_loc = loc;
+			err = -ENODATA;
+			continue;
+		}
+
+		entry->id = message_id(hdr.seq);
+		entry->type = hdr.type;
+		entry->flags = hdr.flags;
+
+		inflight[inflight_count].seq = hdr.seq;
+		inflight[inflight_count].loc = loc;
+		inflight[inflight_count].acked = false;
+		inflight_count++;
+
+		read_loc = loc;
+		break;
+	}
+
+exit:
+	k_mutex_unlock(&journal_lock);
+	return err;
+}
+
+int cloud_journal_ack(uint32_t id)
+{
+	int err = -ENOENT;
+	size_t committed = 0;
+
+	k_mutex_lock(&journal_lock, K_FOREVER);
+
+	for (size_t i = 0; i < inflight_count; i++) {
+		if (message_id(inflight[i].seq) == id) {
+			inflight[i].acked = true;
+			err = 0;
+			break;
+		}
+	}
+
+	if (err) {
+		goto exit;
+	}
+
+	/* Messages are removed in order, an acknowledged message stays in the log until all
+	 * older messages have been acknowledged.
+	 */
+	while ((committed < inflight_count) && inflight[committed].acked) {
+		seq_committed = inflight[committed].seq;
+		commit_loc = inflight[committed].loc;
+		committed++;
+	}
+
+	if (committed == 0) {
+		goto exit;
+	}
+
+	inflight_count -= committed;
+	memmove(&inflight[0], &inflight[committed], inflight_count * sizeof(inflight[0]));
+	pending -= MIN(pending, committed);
+
+	err = commit();
+
+	LOG_DBG("%d messages acknowledged, %d pending", committed, pending);
+
+exit:
+	k_mutex_unlock(&journal_lock);
+	return err;
+}
+
+void cloud_journal_rewind(void)
+{
+	k_mutex_lock(&journal_lock, K_FOREVER);
+
+	if (inflight_count) {
+		LOG_DBG("%d messages in flight are read out again", inflight_count);
+	}
+
+	inflight_count = 0;
+	read_loc = commit_loc;
+
+	k_mutex_unlock(&journal_lock);
+}
+
+size_t cloud_journal_pending_count(void)
+{
+	return pending;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_JOURNAL_H__
+#define CLOUD_JOURNAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**@file
+ *
+ * @defgroup cloud_journal Cloud outbound message journal
+ * @brief    Persistent store-and-forward queue for encoded messages that could not be sent.
+ *
+ * @details Encoded messages are appended to a log in the message_journal flash partition
+ *	    and read back out, oldest first, when the device is connected to cloud. A message
+ *	    that has been read out is in flight until it is acknowledged with
+ *	    cloud_journal_ack(), and is only removed from the log once it and all older
+ *	    messages have been acknowledged. Messages that are in flight when the connection
+ *	    is lost are read out again after cloud_journal_rewind() has been called.
+ *
+ *	    Messages read out of the journal are given message IDs in a range of their own, so
+ *	    that acknowledgments can be told apart from those of messages sent from RAM.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief First message ID given to messages read out of the journal. */
+#define CLOUD_JOURNAL_MESSAGE_ID_BASE 10000
+
+/** @brief Number of message IDs given to messages read out of the journal. */
+#define CLOUD_JOURNAL_MESSAGE_ID_COUNT 5000
+
+/** @brief Message read out of the journal. */
+struct cloud_journal_entry {
+	/** Heap allocated copy of the encoded message. Must be freed by the caller. */
+	char *buf;
+	/** Length of the encoded message. */
+	size_t len;
+	/** Message ID, used to acknowledge the message. */
+	uint16_t id;
+	/** Message type, as passed to cloud_journal_append(). */
+	uint8_t type;
+	/** Flags, as passed to cloud_journal_append(). */
+	uint32_t flags;
+};
+
+/**
+ * @brief Initialize the journal.
+ *
+ * @note Scans the log to recover the sequence number and read position.
+ *
+ * @retval 0 on success.
+ * @return Negative error value from the flash circular buffer on failure.
+ */
+int cloud_journal_init(void);
+
+/**
+ * @brief Append an encoded message to the journal.
+ *
+ * @note If the log is full, the oldest sector is erased to make room, dropping the
+ *	 messages it holds.
+ *
+ * @param[in] type Message type.
+ * @param[in] flags Message flags.
+ * @param[in] buf Encoded message.
+ * @param[in] len Length of the encoded message.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the message is empty.
+ * @retval -EMSGSIZE if the message is too large to be stored.
+ * @retval -EACCES if the journal has not been initialized.
+ * @return Negative error value from the flash circular buffer on other failures.
+ */
+int cloud_journal_append(uint8_t type, uint32_t flags, const char *buf, size_t len);
+
+/**
+ * @brief Read the next message out of the journal.
+ *
+ * @param[out] entry Message read out of the journal. Ownership of the buffer is passed on to
+ *		     the caller.
+ *
+ * @retval 0 on success.
+ * @retval -ENODATA if there are no more messages to read out.
+ * @retval -EBUSY if the maximum number of messages are in flight.
+ * @retval -ENOMEM if the message buffer could not be allocated.
+ * @retval -EACCES if the journal has not been initialized.
+ */
+int cloud_journal_next(struct cloud_journal_entry *entry);
+
+/**
+ * @brief Acknowledge a message that has been read out of the journal.
+ *
+ * @note The message is removed from the log once all older messages have been
+ *	 acknowledged.
+ *
+ * @param[in] id Message ID of the message.
+ *
+ * @retval 0 on success.
+ * @retval -ENOENT if the ID does not belong to a message in flight.
+ * @return Negative error value from the flash circular buffer on other failures.
+ */
+int cloud_journal_ack(uint32_t id);
+
+/**
+ * @brief Check if a message ID belongs to the range used by the journal.
+ *
+ * @param[in] id Message ID.
+ *
+ * @return True if the message ID is used by the journal.
+ */
+static inline bool cloud_journal_id_check(uint32_t id)
+{
+	return (id >= CLOUD_JOURNAL_MESSAGE_ID_BASE) &&
+	       (id < (CLOUD_JOURNAL_MESSAGE_ID_BASE + CLOUD_JOURNAL_MESSAGE_ID_COUNT));
+}
+
+/**
+ * @brief Read all messages in flight out again, starting with the oldest.
+ *
+ * @note Called when the connection to cloud has been lost, as acknowledgments of messages
+ *	 in flight will not be received.
+ */
+void cloud_journal_rewind(void);
+
+/**
+ * @brief Get the number of messages that are stored and not yet acknowledged.
+ *
+ * @return Number of pending messages.
+ */
+size_t cloud_journal_pending_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* CLOUD_JOURNAL_H__ */
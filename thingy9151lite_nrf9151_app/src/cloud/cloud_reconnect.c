@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/random/random.h>
+#include <string.h>
+
+#include "cloud_reconnect.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(cloud_reconnect, CONFIG_CLOUD_MODULE_LOG_LEVEL);
+
+#define BASE_SEC	CONFIG_CLOUD_RECONNECT_BACKOFF_BASE_SEC
+#define MAX_SEC		CONFIG_CLOUD_RECONNECT_BACKOFF_MAX_SEC
+#define RSRP_UNKNOWN	INT16_MIN
+
+BUILD_ASSERT(CONFIG_CLOUD_RECONNECT_BACKOFF_MAX_SEC >= CONFIG_CLOUD_RECONNECT_BACKOFF_BASE_SEC,
+	     "The maximum backoff delay must not be less than the base delay");
+
+/* The module thread starts attempts, while errors are reported from the integration layer. */
+static struct k_spinlock lock;
+
+/* Attempts since the device last connected. */
+static uint32_t attempts;
+
+/* Attempts since the backoff was last reset. */
+static uint32_t retries;
+
+/* Previous backoff delay [s]. */
+static uint32_t sleep_sec = BASE_SEC;
+
+/* An attempt has been started and has neither connected nor failed. */
+static bool attempt_active;
+
+/* Uptime when the current attempt was started [ms]. */
+static int64_t attempt_start;
+
+/* Cause of the latest failed attempt. */
+static enum cloud_reconnect_cause cause;
+
+/* The backoff has been reset since the latest failed attempt. */
+static bool reset_done;
+
+/* Latest RSRP of the serving cell, and the RSRP when the latest attempt failed. */
+static int16_t rsrp_latest = RSRP_UNKNOWN;
+static int16_t rsrp_failure = RSRP_UNKNOWN;
+
+/* Failed attempts per cause since the device last connected. */
+static uint16_t failures[CLOUD_RECONNECT_CAUSE_COUNT];
+
+static struct cloud_reconnect_stats stats;
+
+static const char *const cause_str[] = {
+	[CLOUD_RECONNECT_CAUSE_TIMEOUT] = "timeout",
+	[CLOUD_RECONNECT_CAUSE_NETWORK] = "network",
+	[CLOUD_RECONNECT_CAUSE_DNS] = "DNS",
+	[CLOUD_RECONNECT_CAUSE_TLS] = "TLS",
+	[CLOUD_RECONNECT_CAUSE_REJECTED] = "rejected",
+};
+
+/* Random number in the range [low, high). */
+static uint32_t random_get(uint32_t low, uint32_t high)
+{
+	if (high <= low) {
+		return low;
+	}
+
+	return low + (sys_rand32_get() % (high - low));
+}
+
+static void failure_record(enum cloud_reconnect_cause failure_cause)
+{
+	attempt_active = false;
+	cause = failure_cause;
+	reset_done = false;
+	rsrp_failure = rsrp_latest;
+
+	failures[cause]++;
+	stats.failures[cause]++;
+
+	LOG_DBG("Connection attempt %u failed, cause: %s", attempts, cause_str[cause]);
+}
+
+static void backoff_reset(void)
+{
+	retries = 0;
+	sleep_sec = BASE_SEC;
+}
+
+static void episode_reset(void)
+{
+	backoff_reset();
+
+	attempts = 0;
+	attempt_active = false;
+	cause = CLOUD_RECONNECT_CAUSE_TIMEOUT;
+	rsrp_failure = RSRP_UNKNOWN;
+	memset(failures, 0, sizeof(failures));
+}
+
+static bool trigger(int64_t now)
+{
+	if (retries == 0) {
+		return false;
+	}
+
+	/* An attempt that has been running for longer than the base delay is considered to have
+	 * timed out, the trigger is not caused by the attempt itself.
+	 */
+	if (attempt_active) {
+		if ((now - attempt_start) < ((int64_t)BASE_SEC * MSEC_PER_SEC)) {
+			return false;
+		}
+
+		failure_record(CLOUD_RECONNECT_CAUSE_TIMEOUT);
+	}
+
+	if (reset_done) {
+		return false;
+	}
+
+	/* Improved radio conditions do not fix credentials or a broker that refuses the
+	 * device.
+	 */
+	if ((cause == CLOUD_RECONNECT_CAUSE_TLS) || (cause == CLOUD_RECONNECT_CAUSE_REJECTED)) {
+		return false;
+	}
+
+	backoff_reset();
+	reset_done = true;
+	stats.resets++;
+
+	LOG_DBG("Backoff reset after %u attempts", attempts);
+
+	return true;
+}
+
+uint32_t cloud_reconnect_attempt(int64_t now)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t delay_sec;
+
+	if (attempt_active) {
+		failure_record(CLOUD_RECONNECT_CAUSE_TIMEOUT);
+	}
+
+	attempts++;
+	retries++;
+	attempt_active = true;
+	attempt_start = now;
+
+	/* Decorrelated jitter: the delay is drawn between the base delay and three times the
+	 * previous delay, capped at the maximum delay.
+	 */
+	delay_sec = random_get(BASE_SEC, (uint32_t)MIN((uint64_t)sleep_sec * 3, UINT32_MAX));
+	delay_sec = MIN(delay_sec, MAX_SEC);
+	sleep_sec = delay_sec;
+
+	k_spin_unlock(&lock, key);
+
+	return delay_sec;
+}
+
+uint32_t cloud_reconnect_retries_get(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint32_t count = retries;
+
+	k_spin_unlock(&lock, key);
+
+	return count;
+}
+
+enum cloud_reconnect_cause cloud_reconnect_cause_get(int err)
+{
+	switch (err) {
+	case -EHOSTUNREACH:
+		return CLOUD_RECONNECT_CAUSE_DNS;
+	case -EACCES:
+		/* Fall through. */
+	case -ECONNABORTED:
+		return CLOUD_RECONNECT_CAUSE_TLS;
+	case -ECONNREFUSED:
+		return CLOUD_RECONNECT_CAUSE_REJECTED;
+	case -ENETUNREACH:
+		/* Fall through. */
+	case -ENETDOWN:
+		/* Fall through. */
+	case -ECONNRESET:
+		/* Fall through. */
+	case -ENOTCONN:
+		return CLOUD_RECONNECT_CAUSE_NETWORK;
+	default:
+		return CLOUD_RECONNECT_CAUSE_TIMEOUT;
+	}
+}
+
+void cloud_reconnect_error(int err)
+{
+	enum cloud_reconnect_cause failure_cause = cloud_reconnect_cause_get(err);
+	k_spinlock_key_t key;
+
+	if ((failure_cause == CLOUD_RECONNECT_CAUSE_TIMEOUT) && (err != -ETIMEDOUT)) {
+		return;
+	}
+
+	key = k_spin_lock(&lock);
+
+	if (attempt_active) {
+		failure_record(failure_cause);
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+void cloud_reconnect_connected(struct cloud_reconnect_summary *summary)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	summary->attempts = attempts;
+	memcpy(summary->failures, failures, sizeof(summary->failures));
+
+	if (attempts > 0) {
+		stats.histogram[cloud_reconnect_histogram_bucket(attempts)]++;
+	}
+
+	episode_reset();
+
+	k_spin_unlock(&lock, key);
+}
+
+void cloud_reconnect_abort(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	episode_reset();
+
+	k_spin_unlock(&lock, key);
+}
+
+bool cloud_reconnect_trigger(int64_t now)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	bool reset = trigger(now);
+
+	k_spin_unlock(&lock, key);
+
+	return reset;
+}
+
+bool cloud_reconnect_rsrp_update(int16_t rsrp, int64_t now)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	bool reset = false;
+
+	rsrp_latest = rsrp;
+
+	if ((rsrp_failure != RSRP_UNKNOWN) &&
+	    ((rsrp - rsrp_failure) >= CONFIG_CLOUD_RECONNECT_RSRP_IMPROVEMENT_DB)) {
+		reset = trigger(now);
+	}
+
+	k_spin_unlock(&lock, key);
+
+	return reset;
+}
+
+uint32_t cloud_reconnect_jitter_get(void)
+{
+	return random_get(0, (CONFIG_CLOUD_RECONNECT_RESET_JITTER_SEC * MSEC_PER_SEC) + 1);
+}
+
+void cloud_reconnect_ping_ack(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	stats.pings++;
+
+	k_spin_unlock(&lock, key);
+}
+
+void cloud_reconnect_stats_get(struct cloud_reconnect_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	*out = stats;
+
+	k_spin_unlock(&lock, key);
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_RECONNECT_H__
+#define CLOUD_RECONNECT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/sys/util.h>
+
+/**@file
+ *
+ * @defgroup cloud_reconnect Cloud reconnect scheduler
+ * @brief    Backoff between attempts to connect to cloud.
+ *
+ * @details The delay before the next connection attempt is drawn with decorrelated jitter,
+ *	    so that devices that lose their connection at the same time do not reconnect at
+ *	    the same time. The failure cause of each attempt is recorded. When the radio
+ *	    conditions improve after a failure that the radio conditions can explain, the
+ *	    backoff is reset so that the device does not wait for a long delay to expire.
+ *	    The number of attempts needed to connect is recorded in a histogram, and the
+ *	    keepalive pings of the established connection are counted.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Cause of a failed connection attempt. */
+enum cloud_reconnect_cause {
+	/** No connection within the backoff delay, or the cause is unknown. */
+	CLOUD_RECONNECT_CAUSE_TIMEOUT,
+	/** The network or the cloud service could not be reached. */
+	CLOUD_RECONNECT_CAUSE_NETWORK,
+	/** The host name of the cloud service could not be resolved. */
+	CLOUD_RECONNECT_CAUSE_DNS,
+	/** The TLS handshake failed. */
+	CLOUD_RECONNECT_CAUSE_TLS,
+	/** The connection was rejected by the broker. */
+	CLOUD_RECONNECT_CAUSE_REJECTED,
+
+	CLOUD_RECONNECT_CAUSE_COUNT
+};
+
+/** Number of buckets in the histogram of connection attempts. The buckets hold 1, 2, 3 to 4,
+ *  5 to 8, 9 to 16 and more than 16 attempts.
+ */
+#define CLOUD_RECONNECT_HISTOGRAM_SIZE 6
+
+/** @brief Summary of the connection attempts needed to connect to cloud. */
+struct cloud_reconnect_summary {
+	/** Number of connection attempts, including the successful attempt. */
+	uint32_t attempts;
+	/** Number of failed attempts per cause, indexed by @ref cloud_reconnect_cause. */
+	uint16_t failures[CLOUD_RECONNECT_CAUSE_COUNT];
+};
+
+/** @brief Reconnect statistics, counted since boot. */
+struct cloud_reconnect_stats {
+	/** Number of connections per number of attempts needed. */
+	uint32_t histogram[CLOUD_RECONNECT_HISTOGRAM_SIZE];
+	/** Failed attempts per cause, indexed by @ref cloud_reconnect_cause. */
+	uint32_t failures[CLOUD_RECONNECT_CAUSE_COUNT];
+	/** Number of times the backoff has been reset by improved radio conditions. */
+	uint32_t resets;
+	/** Number of keepalive pings acknowledged by the cloud service. */
+	uint32_t pings;
+};
+
+/**
+ * @brief Start a connection attempt.
+ *
+ * @note If the previous attempt has not connected or failed, it is recorded as a failure with
+ *	 cause @ref CLOUD_RECONNECT_CAUSE_TIMEOUT.
+ *
+ * @param[in] now Current uptime [ms].
+ *
+ * @return Delay before the next attempt if this attempt does not connect [s].
+ */
+uint32_t cloud_reconnect_attempt(int64_t now);
+
+/**
+ * @brief Get the number of connection attempts since the backoff was last reset.
+ *
+ * @return Number of attempts.
+ */
+uint32_t cloud_reconnect_retries_get(void);
+
+/**
+ * @brief Record that the current connection attempt has failed.
+ *
+ * @note Errors that do not map to a cause are ignored, as they are also returned when the
+ *	 cloud library is busy with an ongoing attempt.
+ *
+ * @param[in] err Negative error code reported by the cloud integration layer.
+ */
+void cloud_reconnect_error(int err);
+
+/**
+ * @brief Get the failure cause that an error code maps to.
+ *
+ * @param[in] err Negative error code reported by the cloud integration layer.
+ *
+ * @return Failure cause, @ref CLOUD_RECONNECT_CAUSE_TIMEOUT if the error is unknown.
+ */
+enum cloud_reconnect_cause cloud_reconnect_cause_get(int err);
+
+/**
+ * @brief Record that the device has connected to cloud and reset the backoff.
+ *
+ * @param[out] summary Summary of the connection attempts needed to connect.
+ */
+void cloud_reconnect_connected(struct cloud_reconnect_summary *summary);
+
+/** @brief Reset the backoff without recording a connection, for instance when the LTE
+ *	   connection is lost.
+ */
+void cloud_reconnect_abort(void);
+
+/**
+ * @brief Notify that the radio conditions may have improved, for instance because an RRC
+ *	  connection has been established or the serving cell has changed.
+ *
+ * @note The backoff is only reset once per failed attempt, and not if the attempt failed
+ *	 because of TLS or a rejection from the broker.
+ *
+ * @param[in] now Current uptime [ms].
+ *
+ * @return True if the backoff was reset and the device should reconnect.
+ */
+bool cloud_reconnect_trigger(int64_t now);
+
+/**
+ * @brief Update the RSRP of the serving cell.
+ *
+ * @note A sufficient improvement since the last failed attempt is handled as a trigger.
+ *
+ * @param[in] rsrp RSRP of the serving cell, as reported by the modem.
+ * @param[in] now Current uptime [ms].
+ *
+ * @return True if the backoff was reset and the device should reconnect.
+ */
+bool cloud_reconnect_rsrp_update(int16_t rsrp, int64_t now);
+
+/**
+ * @brief Get a random delay to apply before reconnecting after the backoff has been reset.
+ *
+ * @return Delay [ms].
+ */
+uint32_t cloud_reconnect_jitter_get(void);
+
+/**
+ * @brief Get the histogram bucket of a number of connection attempts.
+ *
+ * @note Inline, so that the modules that report the histogram do not depend on the scheduler.
+ *
+ * @param[in] attempts Number of attempts, at least 1.
+ *
+ * @return Index of the bucket.
+ */
+static inline uint8_t cloud_reconnect_histogram_bucket(uint32_t attempts)
+{
+	uint8_t bucket = 0;
+
+	/* Bucket n holds up to 2^n attempts. */
+	while ((bucket < (CLOUD_RECONNECT_HISTOGRAM_SIZE - 1)) && (attempts > BIT(bucket))) {
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/**
+ * @brief Record that a keepalive ping has been acknowledged by the cloud service.
+ *
+ * @note Pings are counted here instead of being sent as an event, since only the connection
+ *	 overhead metrics use them.
+ */
+void cloud_reconnect_ping_ack(void);
+
+/**
+ * @brief Get the reconnect statistics.
+ *
+ * @param[out] stats Reconnect statistics.
+ */
+void cloud_reconnect_stats_get(struct cloud_reconnect_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* CLOUD_RECONNECT_H__ */
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+
+#include "cloud_send_scheduler.h"
+#include "cloud_codec/cloud_codec_merge.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(cloud_send_scheduler, CONFIG_CLOUD_MODULE_LOG_LEVEL);
+
+#define PENDING_MAX CONFIG_CLOUD_SEND_SCHEDULER_MSG_MAX
+
+static void window_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(window_work, window_work_fn);
+static K_MUTEX_DEFINE(scheduler_lock);
+
+/* Pending messages, in the order they were added. */
+static struct cloud_send_scheduler_msg pending[PENDING_MAX];
+static size_t pending_count;
+
+static cloud_send_scheduler_send_t send_handler;
+
+/* Try to merge a message into a pending message. Returns true if the message was merged. */
+static bool pending_merge(const struct cloud_send_scheduler_msg *msg)
+{
+	if (!IS_ENABLED(CONFIG_CLOUD_SEND_SCHEDULER_MERGE) || !msg->heap_allocated ||
+	    (msg->ack_id != 0)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < pending_count; i++) {
+		struct cloud_send_scheduler_msg *dst = &pending[i];
+		struct cloud_codec_data dst_data = { .buf = dst->buf, .len = dst->len };
+		struct cloud_codec_data src_data = { .buf = msg->buf, .len = msg->len };
+		int err;
+
+		if ((dst->type != msg->type) || (dst->flags != msg->flags) ||
+		    !dst->heap_allocated || (dst->ack_id != 0)) {
+			continue;
+		}
+
+		err = cloud_codec_merge(&dst_data, &src_data,
+					CONFIG_CLOUD_SEND_SCHEDULER_MERGE_SIZE_MAX);
+		if (err) {
+			LOG_DBG("Message of type %d not merged, error: %d", msg->type, err);
+			continue;
+		}
+
+		dst->buf = dst_data.buf;
+		dst->len = dst_data.len;
+		dst->priority = MIN(dst->priority, msg->priority);
+
+		k_free(msg->buf);
+
+		LOG_DBG("Message of type %d merged, %zu bytes", msg->type, dst->len);
+		return true;
+	}
+
+	return false;
+}
+
+/* Hand on all pending messages in order of priority. Messages with the same priority are
+ * sent in the order they were added. Must be called with the lock held.
+ */
+static void pending_send(bool burst_end)
+{
+	size_t count = pending_count;
+
+	/* Stable insertion sort, the list is short. */
+	for (size_t i = 1; i < count; i++) {
+		struct cloud_send_scheduler_msg msg = pending[i];
+		size_t j = i;
+
+		while ((j > 0) && (pending[j - 1].priority > msg.priority)) {
+			pending[j] = pending[j - 1];
+			j--;
+		}
+
+		pending[j] = msg;
+	}
+
+	pending_count = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		send_handler(&pending[i], burst_end && (i == (count - 1)));
+	}
+
+	if (count > 0) {
+		LOG_DBG("%zu messages sent", count);
+	}
+}
+
+static void window_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+	pending_send(true);
+	k_mutex_unlock(&scheduler_lock);
+}
+
+int cloud_send_scheduler_init(cloud_send_scheduler_send_t send)
+{
+	if (send == NULL) {
+		return -EINVAL;
+	}
+
+	send_handler = send;
+	return 0;
+}
+
+int cloud_send_scheduler_add(const struct cloud_send_scheduler_msg *msg)
+{
+	if ((msg == NULL) || (msg->buf == NULL) || (msg->len == 0)) {
+		return -EINVAL;
+	}
+
+	if (send_handler == NULL) {
+		return -EPERM;
+	}
+
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+
+	if (!pending_merge(msg)) {
+		if (pending_count == ARRAY_SIZE(pending)) {
+			LOG_DBG("Pending messages full, sending before the window expires");
+			pending_send(false);
+		}
+
+		pending[pending_count++] = *msg;
+	}
+
+	/* The window starts with the first message and is not extended by later messages, so
+	 * that the latency of a message is bounded by the window.
+	 */
+	(void)k_work_schedule(&window_work, K_MSEC(CONFIG_CLOUD_SEND_SCHEDULER_WINDOW_MS));
+
+	k_mutex_unlock(&scheduler_lock);
+
+	return 0;
+}
+
+void cloud_send_scheduler_flush(void)
+{
+	(void)k_work_cancel_delayable(&window_work);
+
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+	pending_send(true);
+	k_mutex_unlock(&scheduler_lock);
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_SEND_SCHEDULER_H__
+#define CLOUD_SEND_SCHEDULER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**@file
+ *
+ * @defgroup cloud_send_scheduler Cloud send scheduler
+ * @brief    Coalescing and ordering of messages before they are sent to cloud.
+ *
+ * @details Messages added to the scheduler are held for a short coalescing window, which
+ *	    starts when the first message is added. Within the window, a message is merged
+ *	    into a pending message of the same type and flags when the codec can merge them,
+ *	    so that it is published together with it. When the window expires, the pending
+ *	    messages are handed on in order of priority, and the last message of the burst
+ *	    is marked as such.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Message handled by the scheduler. */
+struct cloud_send_scheduler_msg {
+	/** Encoded message. */
+	char *buf;
+	/** Length of the encoded message. */
+	size_t len;
+	/** Message type. Only messages of the same type are merged. */
+	uint8_t type;
+	/** Priority. Messages with lower values are sent first. */
+	uint8_t priority;
+	/** Flags that are passed on with the message. Only messages with the same flags are
+	 *  merged.
+	 */
+	uint32_t flags;
+	/** The buffer is allocated on the heap. Only heap allocated messages are merged. */
+	bool heap_allocated;
+	/** ID that the sender is notified with when the message has been acknowledged, 0 if
+	 *  none. Messages with an ID are acknowledged one by one and are never merged.
+	 */
+	uint32_t ack_id;
+};
+
+/**
+ * @brief Handler that sends a message.
+ *
+ * @details Called from the system workqueue, in order of priority. Ownership of heap
+ *	    allocated buffers is passed on to the handler.
+ *
+ * @param[in] msg Message to send.
+ * @param[in] last True for the last message of a burst.
+ */
+typedef void (*cloud_send_scheduler_send_t)(const struct cloud_send_scheduler_msg *msg,
+					    bool last);
+
+/**
+ * @brief Initialize the scheduler.
+ *
+ * @param[in] send Handler that pending messages are handed on to.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the handler is NULL.
+ */
+int cloud_send_scheduler_init(cloud_send_scheduler_send_t send);
+
+/**
+ * @brief Add a message to the scheduler.
+ *
+ * @details If all pending message slots are in use, the pending messages are sent before
+ *	    the message is added.
+ *
+ * @param[in] msg Message to add. Ownership of heap allocated buffers is taken over by the
+ *		  scheduler.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the message is empty.
+ * @retval -EPERM if the scheduler has not been initialized.
+ */
+int cloud_send_scheduler_add(const struct cloud_send_scheduler_msg *msg);
+
+/**
+ * @brief Send all pending messages without waiting for the coalescing window to expire.
+ */
+void cloud_send_scheduler_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* CLOUD_SEND_SCHEDULER_H__ */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_STUB_H__
+#define CLOUD_STUB_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**@file
+ *
+ * @defgroup cloud_stub Cloud stub integration layer
+ * @brief    In-process stand-in for a cloud service, implementing the cloud wrapper API.
+ *
+ * @details Messages are not sent anywhere. Each message occupies a simulated uplink for the
+ *	    time it takes to transmit at CONFIG_CLOUD_STUB_UPLINK_BYTES_PER_SEC, and is delivered
+ *	    CONFIG_CLOUD_STUB_LATENCY_MS later. Messages that require acknowledgment are then
+ *	    acknowledged, as by an MQTT broker.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Topic of a message passed to the stub, one per send function of the wrapper API. */
+enum cloud_stub_topic {
+	CLOUD_STUB_TOPIC_STATE,
+	CLOUD_STUB_TOPIC_DATA,
+	CLOUD_STUB_TOPIC_BATCH,
+	CLOUD_STUB_TOPIC_UI,
+	CLOUD_STUB_TOPIC_CLOUD_LOCATION,
+	CLOUD_STUB_TOPIC_AGNSS,
+	CLOUD_STUB_TOPIC_PGPS,
+	CLOUD_STUB_TOPIC_MEMFAULT,
+};
+
+/** @brief Callbacks used to observe the messages that pass through the stub. */
+struct cloud_stub_cb {
+	/** Called when a message is sent, in the context of the sender. The message buffer is
+	 *  only valid during the call. The returned tag is passed to the delivered callback.
+	 */
+	uint32_t (*sent)(enum cloud_stub_topic topic, const char *buf, size_t len);
+	/** Called when a message has been delivered to the simulated cloud service. */
+	void (*delivered)(enum cloud_stub_topic topic, uint32_t tag, size_t len);
+};
+
+/** @brief Stub statistics, counted since boot. */
+struct cloud_stub_stats {
+	/** Messages delivered. */
+	uint32_t messages;
+	/** Payload bytes delivered. */
+	uint32_t bytes;
+	/** Messages rejected because CONFIG_CLOUD_STUB_INFLIGHT_MAX messages were in transit. */
+	uint32_t rejected;
+};
+
+/**
+ * @brief Set the callbacks used to observe messages.
+ *
+ * @param[in] cb Callbacks, or NULL to remove them.
+ */
+void cloud_stub_cb_set(const struct cloud_stub_cb *cb);
+
+/**
+ * @brief Get the stub statistics.
+ *
+ * @param[out] stats Stub statistics.
+ */
+void cloud_stub_stats_get(struct cloud_stub_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* CLOUD_STUB_H__ */
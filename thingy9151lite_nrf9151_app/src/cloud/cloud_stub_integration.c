@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "cloud/cloud_wrapper.h"
+#include "cloud/cloud_stub.h"
+#include <zephyr/kernel.h>
+
+#define MODULE cloud_stub_integration
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_CLOUD_INTEGRATION_LOG_LEVEL);
+
+#define INFLIGHT_MAX CONFIG_CLOUD_STUB_INFLIGHT_MAX
+
+struct inflight_message {
+	enum cloud_stub_topic topic;
+	uint32_t id;
+	uint32_t tag;
+	size_t len;
+	bool ack;
+	/* Uptime when the message is delivered [ms], 0 if the entry is free. */
+	int64_t deliver_at;
+};
+
+static void deliver_work_fn(struct k_work *work);
+static void connect_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(deliver_work, deliver_work_fn);
+static K_WORK_DELAYABLE_DEFINE(connect_work, connect_work_fn);
+static K_MUTEX_DEFINE(stub_lock);
+
+static struct inflight_message inflight[INFLIGHT_MAX];
+
+/* Uptime when the simulated uplink has transmitted all messages that have been sent [ms]. */
+static int64_t uplink_free_at;
+
+static bool connected;
+
+static const struct cloud_stub_cb *observer;
+static struct cloud_stub_stats stats;
+
+static cloud_wrap_evt_handler_t wrapper_evt_handler;
+
+static void cloud_wrapper_notify_event(const struct cloud_wrap_event *evt)
+{
+	if ((wrapper_evt_handler != NULL) && (evt != NULL)) {
+		wrapper_evt_handler(evt);
+	} else {
+		LOG_ERR("Library event handler not registered, or empty event");
+	}
+}
+
+/* Schedule the delivery work for the next message in transit. Called with the lock held. */
+static void deliver_work_schedule(void)
+{
+	int64_t next = INT64_MAX;
+
+	for (size_t i = 0; i < INFLIGHT_MAX; i++) {
+		if (inflight[i].deliver_at != 0) {
+			next = MIN(next, inflight[i].deliver_at);
+		}
+	}
+
+	if (next != INT64_MAX) {
+		(void)k_work_reschedule(&deliver_work, K_TIMEOUT_ABS_MS(next));
+	}
+}
+
+static void deliver_work_fn(struct k_work *work)
+{
+	struct inflight_message delivered[INFLIGHT_MAX];
+	size_t count = 0;
+	int64_t now = k_uptime_get();
+
+	k_mutex_lock(&stub_lock, K_FOREVER);
+
+	for (size_t i = 0; i < INFLIGHT_MAX; i++) {
+		if ((inflight[i].deliver_at != 0) && (inflight[i].deliver_at <= now)) {
+			delivered[count++] = inflight[i];
+			inflight[i].deliver_at = 0;
+
+			stats.messages++;
+			stats.bytes += inflight[i].len;
+		}
+	}
+
+	deliver_work_schedule();
+
+	k_mutex_unlock(&stub_lock);
+
+	/* Notify outside of the lock, the cloud module may send new messages from the event
+	 * handler.
+	 */
+	for (size_t i = 0; i < count; i++) {
+		if (observer && observer->delivered) {
+			observer->delivered(delivered[i].topic, delivered[i].tag, delivered[i].len);
+		}
+
+		if (delivered[i].ack) {
+			struct cloud_wrap_event cloud_wrap_evt = {
+				.type = CLOUD_WRAP_EVT_DATA_ACK,
+				.message_id = delivered[i].id,
+			};
+
+			cloud_wrapper_notify_event(&cloud_wrap_evt);
+		}
+	}
+}
+
+static void connect_work_fn(struct k_work *work)
+{
+	struct cloud_wrap_event cloud_wrap_evt = {
+		.type = CLOUD_WRAP_EVT_CONNECTED
+	};
+
+	connected = true;
+
+	cloud_wrapper_notify_event(&cloud_wrap_evt);
+}
+
+static int message_send(enum cloud_stub_topic topic, const char *buf, size_t len, bool ack,
+			uint32_t id)
+{
+	struct inflight_message *msg = NULL;
+	int64_t now = k_uptime_get();
+	int64_t transmit_ms = ((int64_t)len * MSEC_PER_SEC) /
+			      CONFIG_CLOUD_STUB_UPLINK_BYTES_PER_SEC;
+
+	if (!connected) {
+		return -ENOTCONN;
+	}
+
+	k_mutex_lock(&stub_lock, K_FOREVER);
+
+	for (size_t i = 0; i < INFLIGHT_MAX; i++) {
+		if (inflight[i].deliver_at == 0) {
+			msg = &inflight[i];
+			break;
+		}
+	}
+
+	if (msg == NULL) {
+		stats.rejected++;
+		k_mutex_unlock(&stub_lock);
+
+		LOG_WRN("Message not sent, %d messages in transit", INFLIGHT_MAX);
+		return -ENOMEM;
+	}
+
+	/* Messages are transmitted one after the other on the simulated uplink. */
+	uplink_free_at = MAX(uplink_free_at, now) + transmit_ms;
+
+	msg->topic = topic;
+	msg->id = id;
+	msg->len = len;
+	msg->ack = ack;
+	msg->tag = (observer && observer->sent) ? observer->sent(topic, buf, len) : 0;
+	msg->deliver_at = MAX(uplink_free_at + CONFIG_CLOUD_STUB_LATENCY_MS, 1);
+
+	deliver_work_schedule();
+
+	k_mutex_unlock(&stub_lock);
+
+	return 0;
+}
+
+void cloud_stub_cb_set(const struct cloud_stub_cb *cb)
+{
+	observer = cb;
+}
+
+void cloud_stub_stats_get(struct cloud_stub_stats *out)
+{
+	k_mutex_lock(&stub_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&stub_lock);
+}
+
+int cloud_wrap_init(cloud_wrap_evt_handler_t event_handler)
+{
+	LOG_DBG("********************************************");
+	LOG_DBG(" The Asset Tracker v2 has started");
+	LOG_DBG(" Version:     %s", CONFIG_ASSET_TRACKER_V2_APP_VERSION);
+	LOG_DBG(" Cloud:       %s", "In-process stub");
+	LOG_DBG(" Latency:     %d ms", CONFIG_CLOUD_STUB_LATENCY_MS);
+	LOG_DBG(" Uplink:      %d bytes/s", CONFIG_CLOUD_STUB_UPLINK_BYTES_PER_SEC);
+	LOG_DBG("********************************************");
+
+	wrapper_evt_handler = event_handler;
+
+	return 0;
+}
+
+int cloud_wrap_connect(void)
+{
+	struct cloud_wrap_event cloud_wrap_evt = {
+		.type = CLOUD_WRAP_EVT_CONNECTING
+	};
+
+	if (connected) {
+		return -EALREADY;
+	}
+
+	cloud_wrapper_notify_event(&cloud_wrap_evt);
+
+	(void)k_work_reschedule(&connect_work, K_MSEC(CONFIG_CLOUD_STUB_LATENCY_MS));
+
+	return 0;
+}
+
+int cloud_wrap_disconnect(void)
+{
+	struct cloud_wrap_event cloud_wrap_evt = {
+		.type = CLOUD_WRAP_EVT_DISCONNECTED
+	};
+
+	(void)k_work_cancel_delayable(&connect_work);
+
+	k_mutex_lock(&stub_lock, K_FOREVER);
+
+	/* Messages in transit are lost. */
+	for (size_t i = 0; i < INFLIGHT_MAX; i++) {
+		inflight[i].deliver_at = 0;
+	}
+
+	(void)k_work_cancel_delayable(&deliver_work);
+
+	k_mutex_unlock(&stub_lock);
+
+	if (connected) {
+		connected = false;
+		cloud_wrapper_notify_event(&cloud_wrap_evt);
+	}
+
+	return 0;
+}
+
+int cloud_wrap_state_get(bool ack, uint32_t id)
+{
+	/* The stub does not keep a device state, no configuration is returned. */
+	return message_send(CLOUD_STUB_TOPIC_STATE, NULL, 0, ack, id);
+}
+
+int cloud_wrap_state_send(char *buf, size_t len, bool ack, uint32_t id)
+{
+	return message_send(CLOUD_STUB_TOPIC_STATE, buf, len, ack, id);
+}
+
+int cloud_wrap_data_send(char *buf, size_t len, bool ack, uint32_t id,
+			 const struct lwm2m_obj_path path_list[])
+{
+	ARG_UNUSED(path_list);
+
+	return message_send(CLOUD_STUB_TOPIC_DATA, buf, len, ack, id);
+}
+
+int cloud_wrap_batch_send(char *buf, size_t len, bool ack, uint32_t id,
+			  const struct lwm2m_obj_path path_list[])
+{
+	ARG_UNUSED(path_list);
+
+	return message_send(CLOUD_STUB_TOPIC_BATCH, buf, len, ack, id);
+}
+
+int cloud_wrap_ui_send(char *buf, size_t len, bool ack, uint32_t id,
+		       const struct lwm2m_obj_path path_list[])
+{
+	ARG_UNUSED(path_list);
+
+	return message_send(CLOUD_STUB_TOPIC_UI, buf, len, ack, id);
+}
+
+int cloud_wrap_cloud_location_send(char *buf, size_t len, bool ack, uint32_t id)
+{
+	return message_send(CLOUD_STUB_TOPIC_CLOUD_LOCATION, buf, len, ack, id);
+}
+
+bool cloud_wrap_cloud_location_response_wait(void)
+{
+	return false;
+}
+
+int cloud_wrap_agnss_request_send(char *buf, size_t len, bool ack, uint32_t id)
+{
+	return message_send(CLOUD_STUB_TOPIC_AGNSS, buf, len, ack, id);
+}
+
+int cloud_wrap_pgps_request_send(char *buf, size_t len, bool ack, uint32_t id)
+{
+	return message_send(CLOUD_STUB_TOPIC_PGPS, buf, len, ack, id);
+}
+
+int cloud_wrap_memfault_data_send(char *buf, size_t len, bool ack, uint32_t id)
+{
+	return message_send(CLOUD_STUB_TOPIC_MEMFAULT, buf, len, ack, id);
+}
@@ -37,6 +37,10 @@ enum cloud_wrap_event_type {
 	CLOUD_WRAP_EVT_CONNECTED,
 	/** Cloud integration layer is disconnected. */
 	CLOUD_WRAP_EVT_DISCONNECTED,
+	/** An attempt to connect to cloud has failed. The cause is attached in the event
+	 *  structure as a negative error code (err).
+	 */
+	CLOUD_WRAP_EVT_CONNECT_ERROR,
 	/** Data received from cloud integration layer.
 	 *  Payload is of type @ref cloud_wrap_event_data.
 	 */
@@ -179,10 +183,12 @@ int cloud_wrap_data_send(char *buf, size_t len, bool ack, uint32_t id,
  * @param[in] len Length of buffer.
  * @param[in] ack Flag signifying if the message should be acknowledged or not.
  * @param[in] id Message ID.
+ * @param[in] path_list List of LwM2M objects to be sent.
  *
  * @return 0 on success, or a negative error code on failure.
  */
-int cloud_wrap_batch_send(char *buf, size_t len, bool ack, uint32_t id);
+int cloud_wrap_batch_send(char *buf, size_t len, bool ack, uint32_t id,
+			  const struct lwm2m_obj_path path_list[]);
 
 /**
  * @brief Send UI data to cloud.
@@ -527,9 +527,25 @@ int cloud_wrap_data_send(char *buf, size_t len, bool ack, uint32_t id,
 	return 0;
 }
 
-int cloud_wrap_batch_send(char *buf, size_t len, bool ack, uint32_t id)
+int cloud_wrap_batch_send(char *buf, size_t len, bool ack, uint32_t id,
+			  const struct lwm2m_obj_path path_list[])
 {
-	return -ENOTSUP;
+	ARG_UNUSED(buf);
+	ARG_UNUSED(ack);
+	ARG_UNUSED(id);
+
+	int err;
+
+	/* The resources in the path list have time-series caches. All cached values are sent,
+	 * with their timestamps, in a single SenML CBOR message.
+	 */
+	err = lwm2m_send_cb(&client, path_list, len, NULL);
+	if (err) {
+		LOG_ERR("lwm2m_send_cb, error: %d", err);
+		return err;
+	}
+
+	return 0;
 }
 
 int cloud_wrap_ui_send(char *buf, size_t len, bool ack, uint32_t id,
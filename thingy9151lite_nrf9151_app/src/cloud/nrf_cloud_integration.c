@@ -115,6 +115,28 @@ static void user_association_work_fn(struct k_work *work)
 	cloud_wrapper_notify_event(&cloud_wrap_evt);
 }
 
+/* Convert the result of a failed connection attempt to a negative error code. */
+static int connect_error_get(int status)
+{
+	switch (status) {
+	case NRF_CLOUD_CONNECT_RES_ERR_NETWORK:
+		return -ENETUNREACH;
+	case NRF_CLOUD_CONNECT_RES_ERR_PRV_KEY:
+		/* Fall through. */
+	case NRF_CLOUD_CONNECT_RES_ERR_CERT:
+		/* Fall through. */
+	case NRF_CLOUD_CONNECT_RES_ERR_CERT_MISC:
+		return -EACCES;
+	case NRF_CLOUD_CONNECT_RES_ERR_BACKEND:
+		return -ECONNREFUSED;
+	case NRF_CLOUD_CONNECT_RES_ERR_TIMEOUT_NO_DATA:
+		return -ETIMEDOUT;
+	default:
+		/* Positive values are MQTT CONNACK return codes from the broker. */
+		return (status > 0) ? -ECONNREFUSED : -EIO;
+	}
+}
+
 static void nrf_cloud_event_handler(const struct nrf_cloud_evt *evt)
 {
 	struct cloud_wrap_event cloud_wrap_evt = { 0 };
@@ -132,6 +154,9 @@ static void nrf_cloud_event_handler(const struct nrf_cloud_evt *evt)
 		break;
 	case NRF_CLOUD_EVT_TRANSPORT_CONNECT_ERROR:
 		LOG_ERR("NRF_CLOUD_EVT_TRANSPORT_CONNECT_ERROR: %d", evt->status);
+		cloud_wrap_evt.type = CLOUD_WRAP_EVT_CONNECT_ERROR;
+		cloud_wrap_evt.err = connect_error_get(evt->status);
+		notify = true;
 		break;
 	case NRF_CLOUD_EVT_READY:
 		LOG_DBG("NRF_CLOUD_EVT_READY");
@@ -339,8 +364,11 @@ int cloud_wrap_state_send(char *buf, size_t len, bool ack, uint32_t id)
 	return 0;
 }
 
-int cloud_wrap_batch_send(char *buf, size_t len, bool ack, uint32_t id)
+int cloud_wrap_batch_send(char *buf, size_t len, bool ack, uint32_t id,
+			  const struct lwm2m_obj_path path_list[])
 {
+	ARG_UNUSED(path_list);
+
 	int err;
 	struct nrf_cloud_tx_data msg = {
 		.data.ptr = buf,
@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2024 Emcraft Systems
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+#include <app_event_manager.h>
+#if defined(CONFIG_EVENT_TRACE_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+#if defined(CONFIG_EVENT_TRACE_VCOM)
+#include <zephyr/drivers/uart.h>
+#endif
+#if defined(CONFIG_EVENT_TRACE_MEMFAULT)
+#include <memfault/core/custom_data_recording.h>
+#endif
+
+#include "event_trace.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(event_trace, CONFIG_EVENT_TRACE_LOG_LEVEL);
+
+/* Marks a ring buffer that was initialized by this firmware. Bump it if the layout of
+ * struct event_trace_ring changes.
+ */
+#define EVENT_TRACE_RING_MAGIC 0x45545231
+
+#define DUMP_CHUNK_SIZE 32
+
+BUILD_ASSERT(sizeof(struct event_trace_record) == 12, "Unexpected trace record size");
+BUILD_ASSERT(sizeof(struct event_trace_dump_header) == 20, "Unexpected trace header size");
+BUILD_ASSERT(CONFIG_EVENT_TRACE_NAME_COUNT < EVENT_TRACE_NAME_NONE, "Too many trace names");
+
+/* All application events carry their type directly after the event header. */
+struct event_prototype {
+	struct app_event_header header;
+	int type;
+};
+
+/* The ring buffer is not initialized at boot, so that the trace leading up to a warm reboot can
+ * be dumped afterwards. Names are copied into the ring buffer, because a record can outlive the
+ * firmware image that wrote it.
+ */
+struct event_trace_ring {
+	uint32_t magic;
+	uint32_t record_count;
+	uint32_t head;
+	uint32_t used;
+	uint32_t overwritten;
+	uint32_t name_count;
+	char names[CONFIG_EVENT_TRACE_NAME_COUNT][EVENT_TRACE_NAME_LEN];
+	struct event_trace_record records[CONFIG_EVENT_TRACE_RECORD_COUNT];
+};
+
+static __noinit struct event_trace_ring trace;
+
+/* Name pointers seen since boot, used to look up the index of a name without comparing strings. */
+static const char *name_cache[CONFIG_EVENT_TRACE_NAME_COUNT];
+
+static struct k_spinlock lock;
+static atomic_t pause_count;
+static bool ready;
+
+#if defined(CONFIG_EVENT_TRACE_MEMFAULT)
+static atomic_t cdr_pending;
+#endif
+
+static bool ring_valid(void)
+{
+	if ((trace.magic != EVENT_TRACE_RING_MAGIC) ||
+	    (trace.record_count != CONFIG_EVENT_TRACE_RECORD_COUNT) ||
+	    (trace.head >= CONFIG_EVENT_TRACE_RECORD_COUNT) ||
+	    (trace.used > CONFIG_EVENT_TRACE_RECORD_COUNT) ||
+	    (trace.name_count > CONFIG_EVENT_TRACE_NAME_COUNT)) {
+		return false;
+	}
+
+	return true;
+}
+
+static void ring_clear(void)
+{
+	trace.magic = EVENT_TRACE_RING_MAGIC;
+	trace.record_count = CONFIG_EVENT_TRACE_RECORD_COUNT;
+	trace.head = 0;
+	trace.used = 0;
+	trace.overwritten = 0;
+	trace.name_count = 0;
+
+	memset(name_cache, 0, sizeof(name_cache));
+}
+
+/* Must be called with the lock held. */
+static uint8_t name_index_get(const char *name)
+{
+	uint32_t i;
+
+	if (name == NULL) {
+		return EVENT_TRACE_NAME_NONE;
+	}
+
+	for (i = 0; i < trace.name_count; i++) {
+		if (name_cache[i] == name) {
+			return i;
+		}
+	}
+
+	/* Names retained from before a reboot are matched by content once, and cached after. */
+	for (i = 0; i < trace.name_count; i++) {
+		if (strncmp(trace.names[i], name, EVENT_TRACE_NAME_LEN - 1) == 0) {
+			name_cache[i] = name;
+			return i;
+		}
+	}
+
+	if (trace.name_count == CONFIG_EVENT_TRACE_NAME_COUNT) {
+		return EVENT_TRACE_NAME_NONE;
+	}
+
+	i = trace.name_count++;
+
+	strncpy(trace.names[i], name, EVENT_TRACE_NAME_LEN - 1);
+	trace.names[i][EVENT_TRACE_NAME_LEN - 1] = '\0';
+	name_cache[i] = name;
+
+	return i;
+}
+
+static void record(enum event_trace_type type, const char *module, const char *event,
+		   uint32_t arg)
+{
+	struct event_trace_record *rec;
+	k_spinlock_key_t key;
+
+	if (!ready || atomic_get(&pause_count)) {
+		return;
+	}
+
+	key = k_spin_lock(&lock);
+
+	rec = &trace.records[trace.head];
+	rec->timestamp = k_cycle_get_32();
+	rec->type = type;
+	rec->module = name_index_get(module);
+	rec->event = name_index_get(event);
+	rec->reserved = 0;
+	rec->arg = arg;
+
+	trace.head = (trace.head + 1) % CONFIG_EVENT_TRACE_RECORD_COUNT;
+
+	if (trace.used < CONFIG_EVENT_TRACE_RECORD_COUNT) {
+		trace.used++;
+	} else {
+		trace.overwritten++;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+static void submit_hook(const struct app_event_header *aeh)
+{
+	event_trace_event(EVENT_TRACE_SUBMIT, NULL, aeh);
+}
+
+APP_EVENT_HOOK_ON_SUBMIT_REGISTER(submit_hook, 0);
+
+/* Public interface */
+void event_trace_event(enum event_trace_type type, const char *module,
+		       const struct app_event_header *aeh)
+{
+	const struct event_prototype *event = (const struct event_prototype *)aeh;
+
+	record(type, module, aeh->type_id->name, event->type);
+}
+
+void event_trace_state(enum event_trace_type type, const char *module, uint32_t state)
+{
+	record(type, module, NULL, state);
+}
+
+size_t event_trace_dump_size_get(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	size_t size = sizeof(struct event_trace_dump_header) +
+		      trace.name_count * EVENT_TRACE_NAME_LEN +
+		      trace.used * sizeof(struct event_trace_record);
+
+	k_spin_unlock(&lock, key);
+
+	return size;
+}
+
+size_t event_trace_dump_read(size_t offset, uint8_t *buf, size_t len)
+{
+	const size_t record_size = sizeof(struct event_trace_record);
+	struct event_trace_dump_header header;
+	size_t names_size, first, read = 0;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+
+	header = (struct event_trace_dump_header) {
+		.magic = EVENT_TRACE_MAGIC,
+		.version = EVENT_TRACE_VERSION,
+		.record_size = record_size,
+		.name_count = trace.name_count,
+		.cycles_per_sec = sys_clock_hw_cycles_per_sec(),
+		.record_count = trace.used,
+		.overwritten_count = trace.overwritten,
+	};
+
+	names_size = trace.name_count * EVENT_TRACE_NAME_LEN;
+	first = (trace.head + CONFIG_EVENT_TRACE_RECORD_COUNT - trace.used) %
+		CONFIG_EVENT_TRACE_RECORD_COUNT;
+
+	/* The dump is the header, followed by the name table and the records from oldest to
+	 * newest.
+	 */
+	while (read < len) {
+		size_t pos = offset + read;
+		const uint8_t *src;
+		size_t avail;
+
+		if (pos < sizeof(header)) {
+			src = (const uint8_t *)&header + pos;
+			avail = sizeof(header) - pos;
+		} else if ((pos -= sizeof(header)) < names_size) {
+			src = (const uint8_t *)trace.names + pos;
+			avail = names_size - pos;
+		} else if ((pos -= names_size) < trace.used * record_size) {
+			size_t index = first + pos / record_size;
+
+			index %= CONFIG_EVENT_TRACE_RECORD_COUNT;
+			src = (const uint8_t *)&trace.records[index] + pos % record_size;
+			avail = record_size - pos % record_size;
+		} else {
+			break;
+		}
+
+		avail = MIN(avail, len - read);
+		memcpy(buf + read, src, avail);
+		read += avail;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	return read;
+}
+
+int event_trace_dump(event_trace_write_t write, void *user_data)
+{
+	uint8_t buf[DUMP_CHUNK_SIZE];
+	size_t offset = 0;
+	size_t len;
+	int err = 0;
+
+	event_trace_pause(true);
+
+	while ((len = event_trace_dump_read(offset, buf, sizeof(buf))) > 0) {
+		err = write(buf, len, user_data);
+		if (err) {
+			break;
+		}
+
+		offset += len;
+	}
+
+	event_trace_pause(false);
+
+	return err;
+}
+
+void event_trace_pause(bool pause)
+{
+	if (pause) {
+		atomic_inc(&pause_count);
+	} else {
+		atomic_dec(&pause_count);
+	}
+}
+
+void event_trace_clear(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	ring_clear();
+	k_spin_unlock(&lock, key);
+}
+
+#if defined(CONFIG_EVENT_TRACE_MEMFAULT)
+static const char *cdr_mimetypes[] = { MEMFAULT_CDR_BINARY };
+
+/* Recording is paused from the moment Memfault starts reading the trace until it has been
+ * read completely, so that the uploaded data is consistent.
+ */
+static bool cdr_has_cdr_cb(sMemfaultCdrMetadata *metadata)
+{
+	if (!atomic_get(&cdr_pending)) {
+		return false;
+	}
+
+	if (atomic_cas(&cdr_pending, 1, 2)) {
+		event_trace_pause(true);
+	}
+
+	*metadata = (sMemfaultCdrMetadata) {
+		.start_time.type = kMemfaultCurrentTimeType_Unknown,
+		.mimetypes = cdr_mimetypes,
+		.num_mimetypes = ARRAY_SIZE(cdr_mimetypes),
+		.data_size_bytes = event_trace_dump_size_get(),
+		.collection_reason = "event trace",
+	};
+
+	return true;
+}
+
+static bool cdr_read_data_cb(uint32_t offset, void *buf, size_t buf_len)
+{
+	return event_trace_dump_read(offset, buf, buf_len) == buf_len;
+}
+
+static void cdr_mark_cdr_read_cb(void)
+{
+	if (atomic_cas(&cdr_pending, 2, 0)) {
+		event_trace_pause(false);
+	}
+}
+
+static const sMemfaultCdrSourceImpl cdr_source = {
+	.has_cdr_cb = cdr_has_cdr_cb,
+	.read_data_cb = cdr_read_data_cb,
+	.mark_cdr_read_cb = cdr_mark_cdr_read_cb,
+};
+
+static void cdr_upload_request(void)
+{
+	(void)atomic_cas(&cdr_pending, 0, 1);
+}
+#endif /* CONFIG_EVENT_TRACE_MEMFAULT */
+
+static int event_trace_init(void)
+{
+	bool retained = ring_valid();
+
+	if (!retained) {
+		ring_clear();
+	}
+
+	ready = true;
+
+	if (retained) {
+		LOG_INF("Event trace with %u records retained from before reboot", trace.used);
+	}
+
+#if defined(CONFIG_EVENT_TRACE_MEMFAULT)
+	if (!memfault_cdr_register_source(&cdr_source)) {
+		LOG_ERR("Failed to register the event trace as Memfault CDR source");
+	} else if (retained && trace.used) {
+		/* Upload the trace that led up to the reboot. */
+		cdr_upload_request();
+	}
+#endif
+
+	/* Mark the restart of the cycle counter, so that the decoder can split the timeline. */
+	record(EVENT_TRACE_BOOT, NULL, NULL, 0);
+
+	return 0;
+}
+
+SYS_INIT(event_trace_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#if defined(CONFIG_EVENT_TRACE_SHELL)
+static int dump_hex_write(const uint8_t *buf, size_t len, void *user_data)
+{
+	const struct shell *sh = user_data;
+	char hex[DUMP_CHUNK_SIZE * 2 + 1];
+
+	bin2hex(buf, len, hex, sizeof(hex));
+	shell_print(sh, "%s", hex);
+
+	return 0;
+}
+
+static int cmd_status(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(sh, "records: %u/%u, overwritten: %u, names: %u/%u, dump size: %zu",
+		    trace.used, CONFIG_EVENT_TRACE_RECORD_COUNT, trace.overwritten,
+		    trace.name_count, CONFIG_EVENT_TRACE_NAME_COUNT, event_trace_dump_size_get());
+
+	return 0;
+}
+
+static int cmd_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	/* The markers let the host decoder find the dump in a captured console log. */
+	shell_print(sh, "event_trace begin");
+	(void)event_trace_dump(dump_hex_write, (void *)sh);
+	shell_print(sh, "event_trace end");
+
+	return 0;
+}
+
+#if defined(CONFIG_EVENT_TRACE_VCOM)
+static int dump_vcom_write(const uint8_t *buf, size_t len, void *user_data)
+{
+	const struct device *uart_dev = user_data;
+
+	for (size_t i = 0; i < len; i++) {
+		uart_poll_out(uart_dev, buf[i]);
+	}
+
+	return 0;
+}
+
+static int cmd_vcom(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *uart_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_ppp_uart));
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!device_is_ready(uart_dev)) {
+		shell_error(sh, "VCOM UART is not ready");
+		return -ENODEV;
+	}
+
+	shell_print(sh, "Writing %zu bytes to the VCOM UART", event_trace_dump_size_get());
+
+	return event_trace_dump(dump_vcom_write, (void *)uart_dev);
+}
+#endif /* CONFIG_EVENT_TRACE_VCOM */
+
+#if defined(CONFIG_EVENT_TRACE_MEMFAULT)
+static int cmd_upload(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	cdr_upload_request();
+	shell_print(sh, "The event trace will be uploaded with the next Memfault data");
+
+	return 0;
+}
+#endif /* CONFIG_EVENT_TRACE_MEMFAULT */
+
+static int cmd_clear(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	event_trace_clear();
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_event_trace,
+	SHELL_CMD(status, NULL, "Print event trace usage", cmd_status),
+	SHELL_CMD(dump, NULL, "Print the event trace as hex", cmd_dump),
+#if defined(CONFIG_EVENT_TRACE_VCOM)
+	SHELL_CMD(vcom, NULL, "Write the binary event trace to the VCOM UART", cmd_vcom),
+#endif
+#if defined(CONFIG_EVENT_TRACE_MEMFAULT)
+	SHELL_CMD(upload, NULL, "Upload the event trace to Memfault", cmd_upload),
+#endif
+	SHELL_CMD(clear, NULL, "Discard all event trace records", cmd_clear),
+	SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_REGISTER(event_trace, &sub_event_trace, "Binary event trace", NULL);
+#endif /* CONFIG_EVENT_TRACE_SHELL */
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2024 Emcraft Systems
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _EVENT_TRACE_H_
+#define _EVENT_TRACE_H_
+
+/**
+ * @brief Event trace
+ * @defgroup event_trace Event trace
+ * @{
+ */
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct app_event_header;
+
+/** @brief Magic number at the start of an event trace dump, "ETRC" in little-endian order. */
+#define EVENT_TRACE_MAGIC 0x43525445
+
+/** @brief Version of the event trace dump format. */
+#define EVENT_TRACE_VERSION 1
+
+/** @brief Maximum length of a module or event name in the trace, including the terminator. */
+#define EVENT_TRACE_NAME_LEN 24
+
+/** @brief Name index used when a record does not refer to a module or event. */
+#define EVENT_TRACE_NAME_NONE UINT8_MAX
+
+/** @brief Type of an event trace record. The values are part of the dump format. */
+enum event_trace_type {
+	/** The trace was (re)started, the cycle counter starts over. */
+	EVENT_TRACE_BOOT,
+	/** An event was submitted to the Application Event Manager. */
+	EVENT_TRACE_SUBMIT,
+	/** An event was enqueued to a module's queue. */
+	EVENT_TRACE_ENQUEUE,
+	/** A module dequeued an event and started processing it. */
+	EVENT_TRACE_DEQUEUE,
+	/** A module finished processing an event. */
+	EVENT_TRACE_RELEASE,
+	/** An event was dropped from or rejected by a full module queue. */
+	EVENT_TRACE_DROP,
+	/** A module changed its state. */
+	EVENT_TRACE_STATE,
+	/** A module changed its sub-state. */
+	EVENT_TRACE_SUB_STATE,
+	/** A module changed its sub-sub-state. */
+	EVENT_TRACE_SUB_SUB_STATE,
+};
+
+/** @brief Event trace record, as stored in the ring buffer and in the dump. */
+struct event_trace_record {
+	/** Value of the hardware cycle counter when the record was written. */
+	uint32_t timestamp;
+	/** Record type, see @ref event_trace_type. */
+	uint8_t type;
+	/** Index of the module name, or EVENT_TRACE_NAME_NONE. */
+	uint8_t module;
+	/** Index of the event name, or EVENT_TRACE_NAME_NONE. */
+	uint8_t event;
+	uint8_t reserved;
+	/** Event sub-type for event records, new state for state records. */
+	uint32_t arg;
+};
+
+/** @brief Header of an event trace dump.
+ *
+ *  The header is followed by the name table, @p name_count entries of EVENT_TRACE_NAME_LEN bytes,
+ *  and by @p record_count records ordered from oldest to newest. All fields are little-endian.
+ */
+struct event_trace_dump_header {
+	/** EVENT_TRACE_MAGIC. */
+	uint32_t magic;
+	/** EVENT_TRACE_VERSION. */
+	uint8_t version;
+	/** Size of each record in bytes. */
+	uint8_t record_size;
+	/** Number of entries in the name table. */
+	uint8_t name_count;
+	uint8_t reserved;
+	/** Frequency of the cycle counter used for the record timestamps. */
+	uint32_t cycles_per_sec;
+	/** Number of records in the dump. */
+	uint32_t record_count;
+	/** Number of records that were overwritten since the trace was cleared. */
+	uint32_t overwritten_count;
+};
+
+/** @brief Callback used to write a dump of the event trace.
+ *
+ *  @param[in] buf Pointer to the data.
+ *  @param[in] len Length of the data.
+ *  @param[in] user_data User data passed to event_trace_dump().
+ *
+ *  @return 0 if successful, otherwise a negative error code that stops the dump.
+ */
+typedef int (*event_trace_write_t)(const uint8_t *buf, size_t len, void *user_data);
+
+#if defined(CONFIG_EVENT_TRACE)
+
+/** @brief Record an event related trace entry.
+ *
+ *  @param[in] type Record type.
+ *  @param[in] module Name of the module that the record belongs to, or NULL.
+ *  @param[in] aeh Pointer to the header of the event.
+ */
+void event_trace_event(enum event_trace_type type, const char *module,
+		       const struct app_event_header *aeh);
+
+/** @brief Record a module state transition.
+ *
+ *  @param[in] type EVENT_TRACE_STATE, EVENT_TRACE_SUB_STATE or EVENT_TRACE_SUB_SUB_STATE.
+ *  @param[in] module Name of the module.
+ *  @param[in] state The new state.
+ */
+void event_trace_state(enum event_trace_type type, const char *module, uint32_t state);
+
+/** @brief Get the size of an event trace dump.
+ *
+ *  @return Size of the dump in bytes.
+ */
+size_t event_trace_dump_size_get(void);
+
+/** @brief Read part of an event trace dump.
+ *
+ *  Recording should be paused using event_trace_pause() while the dump is read in several parts,
+ *  otherwise the parts can be inconsistent.
+ *
+ *  @param[in] offset Offset into the dump.
+ *  @param[out] buf Buffer that the data will be written to.
+ *  @param[in] len Number of bytes to read.
+ *
+ *  @return Number of bytes read, 0 at the end of the dump.
+ */
+size_t event_trace_dump_read(size_t offset, uint8_t *buf, size_t len);
+
+/** @brief Write a dump of the event trace. Recording is paused while the dump is written.
+ *
+ *  @param[in] write Callback that is called for each part of the dump.
+ *  @param[in] user_data User data passed to the callback.
+ *
+ *  @retval 0 if successful.
+ *  @return Otherwise the error returned by the callback.
+ */
+int event_trace_dump(event_trace_write_t write, void *user_data);
+
+/** @brief Pause or resume recording. Records written while paused are discarded.
+ *
+ *  @param[in] pause true to pause recording, false to resume it.
+ */
+void event_trace_pause(bool pause);
+
+/** @brief Discard all records. */
+void event_trace_clear(void);
+
+#else
+
+static inline void event_trace_event(enum event_trace_type type, const char *module,
+				     const struct app_event_header *aeh) {}
+static inline void event_trace_state(enum event_trace_type type, const char *module,
+				     uint32_t state) {}
+
+#endif /* CONFIG_EVENT_TRACE */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _EVENT_TRACE_H_ */
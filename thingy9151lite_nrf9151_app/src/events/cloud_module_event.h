@@ -21,6 +21,7 @@
 #endif
 
 #include "cloud/cloud_codec/cloud_codec.h"
+#include "cloud/cloud_reconnect.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,7 +29,10 @@ extern "C" {
 
 /** @brief Event types submitted by the cloud module. */
 enum cloud_module_event_type {
-	/** Cloud service is connected. */
+	/** Cloud service is connected.
+	 *  The payload associated with this event is of type @ref cloud_reconnect_summary
+	 *  (connection).
+	 */
 	CLOUD_EVT_CONNECTED,
 
 	/** Cloud service is disconnected. */
@@ -102,6 +106,18 @@ enum cloud_module_event_type {
 	 */
 	CLOUD_EVT_DATA_SEND_QOS,
 
+	/** The last message of a send burst has been sent, no messages are waiting for
+	 *  acknowledgment and no responses are expected from cloud. No more data is scheduled to
+	 *  be sent or received, and the radio connection can be released.
+	 */
+	CLOUD_EVT_DATA_SEND_DONE,
+
+	/** A message sent with a non-zero acknowledgment ID has been acknowledged by the cloud
+	 *  service, or has been stored in the journal to be sent later.
+	 *  The payload associated with this event is of type @ref cloud_module_data_ack (ack).
+	 */
+	CLOUD_EVT_DATA_ACK,
+
 	/** The cloud module has performed all procedures to prepare for
 	 *  a shutdown of the system. The event carries the ID (id) of the module.
 	 */
@@ -119,6 +135,8 @@ struct cloud_module_data_ack {
 	void *ptr;
 	/** Length of data that was attempted to be sent. */
 	size_t len;
+	/** Acknowledgment ID that the message was sent with. */
+	uint32_t id;
 };
 
 /** @brief Cloud module event. */
@@ -141,6 +159,8 @@ struct cloud_module_event {
 		struct cloud_module_data_ack ack;
 		/** The message that should be sent to cloud. */
 		struct qos_data message;
+		/** Connection attempts needed to connect to the cloud service. */
+		struct cloud_reconnect_summary connection;
 		/** Module ID, used when acknowledging shutdown requests. */
 		uint32_t id;
 		/** Code signifying the cause of error. */
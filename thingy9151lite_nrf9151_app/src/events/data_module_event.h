@@ -27,6 +27,11 @@
 extern "C" {
 #endif
 
+/** @brief Flag set in the acknowledgment ID of shadow updates, to tell them apart from storage
+ *  page IDs. Both kinds of IDs are in the range 1 to INT32_MAX.
+ */
+#define DATA_ACK_ID_SHADOW BIT(31)
+
 /** @brief Data event types submitted by Data module. */
 enum data_module_event_type {
 	/** All data has been received for a given sample request. */
@@ -119,6 +124,11 @@ enum data_module_event_type {
 struct data_module_data_buffers {
 	char *buf;
 	size_t len;
+	/** If non-zero, CLOUD_EVT_DATA_ACK is sent with this ID once the message has been
+	 *  acknowledged by the cloud service. Storage page ID for batch messages, shadow update ID
+	 *  with DATA_ACK_ID_SHADOW set for data messages.
+	 */
+	uint32_t ack_id;
 	/** Object paths used in lwM2M. NULL terminated. */
 	struct lwm2m_obj_path paths[CONFIG_CLOUD_CODEC_LWM2M_PATH_LIST_ENTRIES_MAX];
 	uint8_t valid_object_paths;
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#if defined(CONFIG_EVENT_POOL_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "event_pool.h"
+#include "app_module_event.h"
+#include "cloud_module_event.h"
+#include "data_module_event.h"
+#include "debug_module_event.h"
+#include "led_state_event.h"
+#include "location_module_event.h"
+#include "modem_module_event.h"
+#include "sensor_module_event.h"
+#include "ui_module_event.h"
+#include "util_module_event.h"
+
+#define EVENT_POOL_BLOCK_SIZE(_type) \
+	ROUND_UP(EVENT_POOL_BLOCK_HEADER_SIZE + sizeof(_type), EVENT_POOL_BLOCK_ALIGN)
+
+/* One pool is sized for each event type. The block size is derived from the event definition,
+ * but blocks are handed out by size, see event_pool_alloc().
+ */
+#define EVENT_POOL_LIST(X)								\
+	X(app, struct app_module_event, CONFIG_EVENT_POOL_APP_COUNT)			\
+	X(cloud, struct cloud_module_event, CONFIG_EVENT_POOL_CLOUD_COUNT)		\
+	X(data, struct data_module_event, CONFIG_EVENT_POOL_DATA_COUNT)			\
+	X(debug, struct debug_module_event, CONFIG_EVENT_POOL_DEBUG_COUNT)		\
+	X(led_state, struct led_state_event, CONFIG_EVENT_POOL_LED_STATE_COUNT)		\
+	X(location, struct location_module_event, CONFIG_EVENT_POOL_LOCATION_COUNT)	\
+	X(modem, struct modem_module_event, CONFIG_EVENT_POOL_MODEM_COUNT)		\
+	X(sensor, struct sensor_module_event, CONFIG_EVENT_POOL_SENSOR_COUNT)		\
+	X(ui, struct ui_module_event, CONFIG_EVENT_POOL_UI_COUNT)			\
+	X(util, struct util_module_event, CONFIG_EVENT_POOL_UTIL_COUNT)
+
+#define EVENT_POOL_SLAB_DEFINE(_name, _type, _count)					\
+	K_MEM_SLAB_DEFINE_STATIC(_name##_event_slab, EVENT_POOL_BLOCK_SIZE(_type),	\
+				 _count, EVENT_POOL_BLOCK_ALIGN);
+
+#define EVENT_POOL_ENTRY(_name, _type, _count)						\
+	{										\
+		.name = STRINGIFY(_name),						\
+		.slab = &_name##_event_slab,						\
+		.block_size = EVENT_POOL_BLOCK_SIZE(_type),				\
+		.block_count = _count,							\
+	},
+
+struct event_pool {
+	const char *name;
+	struct k_mem_slab *slab;
+	size_t block_size;
+	uint32_t block_count;
+	atomic_t max_used;
+	atomic_t alloc_failures;
+};
+
+EVENT_POOL_LIST(EVENT_POOL_SLAB_DEFINE)
+
+static struct event_pool pools[] = {
+	EVENT_POOL_LIST(EVENT_POOL_ENTRY)
+};
+
+BUILD_ASSERT(ARRAY_SIZE(pools) < EVENT_POOL_NONE, "Too many event pools");
+
+static void max_used_update(struct event_pool *pool)
+{
+	atomic_val_t used = k_mem_slab_num_used_get(pool->slab);
+	atomic_val_t max_used;
+
+	do {
+		max_used = atomic_get(&pool->max_used);
+		if (used <= max_used) {
+			return;
+		}
+	} while (!atomic_cas(&pool->max_used, max_used, used));
+}
+
+/* Public interface */
+void *event_pool_alloc(size_t size, uint8_t *pool)
+{
+	size_t fit = SIZE_MAX;
+	size_t fit_index = 0;
+	void *block;
+
+	*pool = EVENT_POOL_NONE;
+
+	/* Find the smallest block size that fits the request. Events of the same size share all
+	 * pools with that block size, but never spill over into pools sized for larger events.
+	 */
+	for (size_t i = 0; i < ARRAY_SIZE(pools); i++) {
+		if ((pools[i].block_size >= size) && (pools[i].block_size < fit)) {
+			fit = pools[i].block_size;
+			fit_index = i;
+		}
+	}
+
+	if (fit == SIZE_MAX) {
+		return NULL;
+	}
+
+	for (size_t i = fit_index; i < ARRAY_SIZE(pools); i++) {
+		if (pools[i].block_size != fit) {
+			continue;
+		}
+
+		if (k_mem_slab_alloc(pools[i].slab, &block, K_NO_WAIT) == 0) {
+			max_used_update(&pools[i]);
+			*pool = i;
+			return block;
+		}
+	}
+
+	atomic_inc(&pools[fit_index].alloc_failures);
+	return NULL;
+}
+
+void event_pool_free(void *block, uint8_t pool)
+{
+	__ASSERT_NO_MSG(pool < ARRAY_SIZE(pools));
+
+	k_mem_slab_free(pools[pool].slab, block);
+}
+
+size_t event_pool_count_get(void)
+{
+	return ARRAY_SIZE(pools);
+}
+
+int event_pool_stats_get(size_t index, struct event_pool_stats *stats)
+{
+	if (index >= ARRAY_SIZE(pools)) {
+		return -ENOENT;
+	}
+
+	stats->name = pools[index].name;
+	stats->block_size = pools[index].block_size;
+	stats->block_count = pools[index].block_count;
+	stats->used = k_mem_slab_num_used_get(pools[index].slab);
+	stats->max_used = atomic_get(&pools[index].max_used);
+	stats->alloc_failures = atomic_get(&pools[index].alloc_failures);
+
+	return 0;
+}
+
+#if defined(CONFIG_EVENT_POOL_SHELL)
+static int cmd_event_pool(const struct shell *sh, size_t argc, char **argv)
+{
+	struct event_pool_stats stats;
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(sh, "%-10s %6s %6s %6s %6s %8s", "pool", "size", "blocks", "used", "peak",
+		    "failures");
+
+	for (size_t i = 0; i < event_pool_count_get(); i++) {
+		(void)event_pool_stats_get(i, &stats);
+
+		shell_print(sh, "%-10s %6zu %6u %6u %6u %8u", stats.name, stats.block_size,
+			    stats.block_count, stats.used, stats.max_used, stats.alloc_failures);
+	}
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(event_pool, NULL, "Print application event pool usage", cmd_event_pool);
+#endif /* CONFIG_EVENT_POOL_SHELL */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _EVENT_POOL_H_
+#define _EVENT_POOL_H_
+
+/**
+ * @brief Event pool
+ * @defgroup event_pool Event pool
+ * @{
+ */
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Pool index used for allocations that are not served by an event pool. */
+#define EVENT_POOL_NONE UINT8_MAX
+
+/** @brief Alignment of the blocks in an event pool. */
+#define EVENT_POOL_BLOCK_ALIGN 8
+
+/** @brief Header that the event allocator prepends to every event. Module queues hold pointers to
+ *	   events instead of copies, so an event must stay allocated until the Application Event
+ *	   Manager and every module that has enqueued it are done with it.
+ */
+union event_ref {
+	struct {
+		/** Number of references held to the event. */
+		atomic_t count;
+		/** Event pool that the event was allocated from, EVENT_POOL_NONE for the heap. */
+		uint8_t pool;
+	};
+	/** Keeps the alignment of the event that follows the header. */
+	uint64_t align;
+};
+
+/** @brief Number of bytes reserved in front of each event in a pool block for the header. */
+#define EVENT_POOL_BLOCK_HEADER_SIZE ROUND_UP(sizeof(union event_ref), EVENT_POOL_BLOCK_ALIGN)
+
+/** @brief Usage statistics of an event pool. */
+struct event_pool_stats {
+	/** Name of the event type that the pool is sized for. */
+	const char *name;
+	/** Size of each block in the pool, including the block header. */
+	size_t block_size;
+	/** Number of blocks in the pool. */
+	uint32_t block_count;
+	/** Number of blocks currently in use. */
+	uint32_t used;
+	/** Highest number of blocks in use at the same time since boot. */
+	uint32_t max_used;
+	/** Number of allocations that could not be served because the pool was exhausted. */
+	uint32_t alloc_failures;
+};
+
+/** @brief Allocate a block from the event pool that fits the requested size best.
+ *
+ *  Pools are selected by block size only, so an event can be allocated from a pool that was
+ *  sized for another event type of the same size.
+ *
+ *  @param[in] size Requested block size, including the block header.
+ *  @param[out] pool Index of the pool that the block was allocated from, or EVENT_POOL_NONE.
+ *
+ *  @return Pointer to the allocated block, or NULL if there is no pool for the requested size or
+ *	    all pools for that size are exhausted. In the latter case the allocation failure is
+ *	    recorded in the pool statistics.
+ */
+void *event_pool_alloc(size_t size, uint8_t *pool);
+
+/** @brief Return a block to the event pool it was allocated from.
+ *
+ *  @param[in] block Pointer to the block.
+ *  @param[in] pool Index of the pool, as returned by event_pool_alloc().
+ */
+void event_pool_free(void *block, uint8_t pool);
+
+/** @brief Get the number of event pools.
+ *
+ *  @return Number of event pools.
+ */
+size_t event_pool_count_get(void);
+
+/** @brief Get usage statistics of an event pool.
+ *
+ *  @param[in] index Index of the pool.
+ *  @param[out] stats Pointer to a structure that the statistics will be written to.
+ *
+ *  @retval 0 if successful.
+ *  @retval -ENOENT if there is no pool with the given index.
+ */
+int event_pool_stats_get(size_t index, struct event_pool_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _EVENT_POOL_H_ */
@@ -148,6 +148,14 @@ struct location_module_cloud_location {
 	bool wifi_access_points_valid;
 	/** Wi-Fi access points. */
 	struct location_module_wifi_access_points wifi_access_points;
+#endif
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+	/** The location was found in the cloud location cache and is not sent to cloud. The
+	 *  neighbor cell and Wi-Fi access point information is not valid.
+	 */
+	bool cached;
+	/** Cached location. Only latitude, longitude and accuracy are valid. */
+	struct location_module_pvt location;
 #endif
 	/** Uptime when the event was sent. */
 	int64_t timestamp;
@@ -63,6 +63,21 @@ enum modem_module_event_type {
 	 */
 	MODEM_EVT_LTE_EDRX_UPDATE,
 
+	/** The RRC connection has been released and the modem is in RRC idle mode.
+	 *  The event has associated payload of type @ref modem_module_rrc in
+	 *  the `data.rrc` member.
+	 */
+	MODEM_EVT_LTE_RRC_IDLE,
+
+	/** An RRC connection has been established with the network. */
+	MODEM_EVT_LTE_RRC_CONNECTED,
+
+	/** The RSRP of the serving cell has changed by at least
+	 *  CONFIG_MODEM_RSRP_UPDATE_DELTA_DB since the last update.
+	 *  The event has associated payload of type int16_t in the `data.rsrp` member.
+	 */
+	MODEM_EVT_LTE_RSRP_UPDATE,
+
 	/** Static modem data has been sampled and is ready.
 	 *  The event has associated payload of type @ref modem_module_static_modem_data in
 	 *  the `data.modem_static` member.
@@ -148,6 +163,16 @@ struct modem_module_edrx {
 	float ptw;
 };
 
+/** @brief RRC connection information. */
+struct modem_module_rrc {
+	/** Time spent in RRC connected mode [ms]. */
+	uint32_t connected_time_ms;
+	/** Estimated RRC connected time saved by requesting an early release [ms]. */
+	uint32_t saved_time_ms;
+	/** True if an early release was requested during the connection. */
+	bool release_requested;
+};
+
 struct modem_module_static_modem_data {
 	int64_t timestamp;
 	char iccid[23];
@@ -181,6 +206,11 @@ struct modem_module_event {
 		struct modem_module_cell cell;
 		struct modem_module_psm psm;
 		struct modem_module_edrx edrx;
+		struct modem_module_rrc rrc;
+		/* RSRP of the serving cell, converted to dBm if
+		 * CONFIG_MODEM_DYNAMIC_DATA_CONVERT_RSRP_TO_DBM is enabled.
+		 */
+		int16_t rsrp;
 		/* Module ID, used when acknowledging shutdown requests. */
 		uint32_t id;
 		int err;
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "location_cache.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(location_cache, CONFIG_LOCATION_MODULE_LOG_LEVEL);
+
+#define TTL_MS ((int64_t)CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE_TTL_SEC * MSEC_PER_SEC)
+
+struct cache_entry {
+	struct location_cache_key key;
+	struct location_cache_position position;
+	/* RSRP of the serving cell when the location was resolved. */
+	int16_t rsrp;
+	/* Uptime when the location was resolved [ms]. */
+	int64_t resolved;
+	/* Sequence number of the latest use, 0 if the entry is not in use. */
+	uint32_t used;
+};
+
+static struct cache_entry entries[CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE_SIZE];
+
+/* Sequence number of the latest use of any entry. */
+static uint32_t use_count;
+
+static struct location_cache_stats stats;
+
+static bool ap_in_key(const struct location_cache_key *key, const uint8_t *mac)
+{
+	for (size_t i = 0; i < key->ap_count; i++) {
+		if (memcmp(key->ap_mac[i], mac, LOCATION_CACHE_MAC_LEN) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* The access points are compared as a set, as the order of access points with similar RSSI
+ * varies between scans.
+ */
+static bool key_equal(const struct location_cache_key *a, const struct location_cache_key *b)
+{
+	if ((a->mcc != b->mcc) || (a->mnc != b->mnc) || (a->tac != b->tac) ||
+	    (a->cell_id != b->cell_id) || (a->ap_count != b->ap_count)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < a->ap_count; i++) {
+		if (!ap_in_key(b, a->ap_mac[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static struct cache_entry *entry_find(const struct location_cache_key *key)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (entries[i].used && key_equal(&entries[i].key, key)) {
+			return &entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Get an unused entry, or the least recently used entry if all are in use. */
+static struct cache_entry *entry_lru_get(void)
+{
+	struct cache_entry *lru = &entries[0];
+
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (entries[i].used == 0) {
+			return &entries[i];
+		}
+
+		if (entries[i].used < lru->used) {
+			lru = &entries[i];
+		}
+	}
+
+	return lru;
+}
+
+void location_cache_key_init(struct location_cache_key *key, const struct lte_lc_cell *cell)
+{
+	memset(key, 0, sizeof(*key));
+
+	key->mcc = cell->mcc;
+	key->mnc = cell->mnc;
+	key->tac = cell->tac;
+	key->cell_id = cell->id;
+}
+
+void location_cache_key_ap_add(struct location_cache_key *key, const uint8_t *mac, int8_t rssi)
+{
+	size_t pos = key->ap_count;
+
+	if (LOCATION_CACHE_AP_COUNT == 0) {
+		return;
+	}
+
+	/* Keep the access points sorted by RSSI, strongest first. */
+	while ((pos > 0) && (key->ap_rssi[pos - 1] < rssi)) {
+		pos--;
+	}
+
+	if (pos >= LOCATION_CACHE_AP_COUNT) {
+		return;
+	}
+
+	if (key->ap_count < LOCATION_CACHE_AP_COUNT) {
+		key->ap_count++;
+	}
+
+	for (size_t i = key->ap_count - 1; i > pos; i--) {
+		memcpy(key->ap_mac[i], key->ap_mac[i - 1], LOCATION_CACHE_MAC_LEN);
+		key->ap_rssi[i] = key->ap_rssi[i - 1];
+	}
+
+	memcpy(key->ap_mac[pos], mac, LOCATION_CACHE_MAC_LEN);
+	key->ap_rssi[pos] = rssi;
+}
+
+bool location_cache_key_valid(const struct location_cache_key *key)
+{
+	return key->cell_id != LTE_LC_CELL_EUTRAN_ID_INVALID;
+}
+
+int location_cache_lookup(const struct location_cache_key *key, int16_t rsrp, int64_t now,
+			  struct location_cache_position *position)
+{
+	struct cache_entry *entry = entry_find(key);
+
+	if (entry && ((now - entry->resolved) >= TTL_MS)) {
+		LOG_DBG("Cached location of cell %u has expired", key->cell_id);
+		entry->used = 0;
+		entry = NULL;
+	}
+
+	if (entry == NULL) {
+		stats.misses++;
+		return -ENOENT;
+	}
+
+	/* A large change in RSRP indicates that the device may have moved within the cell. */
+	if (abs(rsrp - entry->rsrp) > CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE_RSRP_DELTA_MAX) {
+		LOG_DBG("RSRP changed from %d to %d, cached location not used", entry->rsrp, rsrp);
+		stats.rejected++;
+		return -ERANGE;
+	}
+
+	entry->used = ++use_count;
+	*position = entry->position;
+
+	stats.hits++;
+
+	LOG_DBG("Location found in cache, %u hits, %u misses, %u rejected", stats.hits,
+		stats.misses, stats.rejected);
+
+	return 0;
+}
+
+void location_cache_add(const struct location_cache_key *key, int16_t rsrp, int64_t now,
+			const struct location_cache_position *position)
+{
+	struct cache_entry *entry = entry_find(key);
+
+	if (entry == NULL) {
+		entry = entry_lru_get();
+		entry->key = *key;
+	}
+
+	entry->position = *position;
+	entry->rsrp = rsrp;
+	entry->resolved = now;
+	entry->used = ++use_count;
+
+	LOG_DBG("Location of cell %u cached", key->cell_id);
+}
+
+void location_cache_stats_get(struct location_cache_stats *out)
+{
+	*out = stats;
+}
+
+void location_cache_clear(void)
+{
+	memset(entries, 0, sizeof(entries));
+}
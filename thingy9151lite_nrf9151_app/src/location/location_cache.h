@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LOCATION_CACHE_H__
+#define LOCATION_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/sys/util.h>
+#include <modem/lte_lc.h>
+
+/**@file
+ *
+ * @defgroup location_cache Cloud location cache
+ * @brief    Least recently used cache of locations resolved by cloud.
+ *
+ * @details Locations resolved by cloud from neighbor cell measurements and Wi-Fi access points
+ *	    are cached, keyed by the serving cell and, optionally, the strongest access points.
+ *	    A cached location is used until it expires, as long as the RSRP of the serving cell
+ *	    is close to the RSRP when the location was resolved.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE_WIFI_AP_COUNT)
+#define LOCATION_CACHE_AP_COUNT CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE_WIFI_AP_COUNT
+#else
+#define LOCATION_CACHE_AP_COUNT 0
+#endif
+
+/** Length of an access point MAC address. */
+#define LOCATION_CACHE_MAC_LEN 6
+
+/** @brief Cache key. */
+struct location_cache_key {
+	/** Mobile country code of the serving cell. */
+	int mcc;
+	/** Mobile network code of the serving cell. */
+	int mnc;
+	/** Tracking area code of the serving cell. */
+	uint32_t tac;
+	/** E-UTRAN cell ID of the serving cell. */
+	uint32_t cell_id;
+	/** Number of access points in the key. */
+	uint8_t ap_count;
+	/** MAC addresses of the strongest access points, strongest first. */
+	uint8_t ap_mac[MAX(LOCATION_CACHE_AP_COUNT, 1)][LOCATION_CACHE_MAC_LEN];
+	/** RSSI of the access points [dBm]. */
+	int8_t ap_rssi[MAX(LOCATION_CACHE_AP_COUNT, 1)];
+};
+
+/** @brief Cached location. */
+struct location_cache_position {
+	/** Latitude in degrees. */
+	double latitude;
+	/** Longitude in degrees. */
+	double longitude;
+	/** Accuracy (2D 1-sigma) in meters. */
+	float accuracy;
+};
+
+/** @brief Cache statistics, counted since boot. */
+struct location_cache_stats {
+	/** Lookups answered from the cache. */
+	uint32_t hits;
+	/** Lookups for which no valid location was cached. */
+	uint32_t misses;
+	/** Lookups that found a location that was rejected because the RSRP had changed. */
+	uint32_t rejected;
+};
+
+/**
+ * @brief Initialize a cache key with the serving cell.
+ *
+ * @param[out] key Cache key.
+ * @param[in] cell Serving cell.
+ */
+void location_cache_key_init(struct location_cache_key *key, const struct lte_lc_cell *cell);
+
+/**
+ * @brief Add an access point to a cache key.
+ *
+ * @note Only the strongest access points are kept in the key.
+ *
+ * @param[in,out] key Cache key.
+ * @param[in] mac MAC address of the access point.
+ * @param[in] rssi RSSI of the access point [dBm].
+ */
+void location_cache_key_ap_add(struct location_cache_key *key, const uint8_t *mac, int8_t rssi);
+
+/**
+ * @brief Check whether a cache key identifies a serving cell.
+ *
+ * @param[in] key Cache key.
+ *
+ * @return True if the key can be used with the cache.
+ */
+bool location_cache_key_valid(const struct location_cache_key *key);
+
+/**
+ * @brief Look up a location in the cache.
+ *
+ * @param[in] key Cache key.
+ * @param[in] rsrp Current RSRP of the serving cell, as reported by the modem.
+ * @param[in] now Current uptime [ms].
+ * @param[out] position Cached location.
+ *
+ * @retval 0 if a location was found.
+ * @retval -ENOENT if no valid location is cached for the key.
+ * @retval -ERANGE if the RSRP has changed too much since the location was resolved.
+ */
+int location_cache_lookup(const struct location_cache_key *key, int16_t rsrp, int64_t now,
+			  struct location_cache_position *position);
+
+/**
+ * @brief Add a location resolved by cloud to the cache.
+ *
+ * @note Replaces the location cached for the same key, or the least recently used location
+ *	 if the cache is full.
+ *
+ * @param[in] key Cache key.
+ * @param[in] rsrp RSRP of the serving cell when the measurements were taken.
+ * @param[in] now Current uptime [ms].
+ * @param[in] position Resolved location.
+ */
+void location_cache_add(const struct location_cache_key *key, int16_t rsrp, int64_t now,
+			const struct location_cache_position *position);
+
+/**
+ * @brief Get the cache statistics.
+ *
+ * @param[out] stats Cache statistics.
+ */
+void location_cache_stats_get(struct location_cache_stats *stats);
+
+/** @brief Remove all locations from the cache. */
+void location_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* LOCATION_CACHE_H__ */
@@ -18,6 +18,7 @@
 #include <caf/events/module_state_event.h>
 
 #include "modules_common.h"
+#include "event_trace/event_trace.h"
 #include "events/app_module_event.h"
 #include "events/cloud_module_event.h"
 #include "events/data_module_event.h"
@@ -35,9 +36,9 @@
 
 LOG_MODULE_REGISTER(MODULE, CONFIG_APPLICATION_MODULE_LOG_LEVEL);
 
-/* Message structure. Events from other modules are converted to messages
- * in the Application Event Manager handler, and then queued up in the message queue
- * for processing in the main thread.
+/* Message structure. Events from other modules are queued up by reference in the
+ * Application Event Manager handler, and then processed in the main thread. A dequeued
+ * message points to the event itself, the union only provides a typed view of it.
  */
 struct app_msg_data {
 	union {
@@ -93,13 +94,12 @@ static void data_sample_timer_handler(struct k_timer *timer);
 
 /* Application module message queue. */
 #define APP_QUEUE_ENTRY_COUNT		10
-#define APP_QUEUE_BYTE_ALIGNMENT	4
+#define APP_QUEUE_TELEMETRY_ENTRY_COUNT	5
 
 /* Data fetching timeouts */
 #define DATA_FETCH_TIMEOUT_DEFAULT 2
 
-K_MSGQ_DEFINE(msgq_app, sizeof(struct app_msg_data), APP_QUEUE_ENTRY_COUNT,
-	      APP_QUEUE_BYTE_ALIGNMENT);
+MODULE_QUEUE_DEFINE(msgq_app, APP_QUEUE_ENTRY_COUNT, APP_QUEUE_TELEMETRY_ENTRY_COUNT);
 
 /* Data sample timer used in active mode. */
 K_TIMER_DEFINE(data_sample_timer, data_sample_timer_handler, NULL);
@@ -162,6 +162,7 @@ static void state_set(enum state_type new_state)
 		state2str(new_state));
 
 	state = new_state;
+	event_trace_state(EVENT_TRACE_STATE, self.name, new_state);
 }
 
 static void sub_state_set(enum sub_state_type new_state)
@@ -176,6 +177,7 @@ static void sub_state_set(enum sub_state_type new_state)
 		sub_state2str(new_state));
 
 	sub_state = new_state;
+	event_trace_state(EVENT_TRACE_SUB_STATE, self.name, new_state);
 }
 
 #if defined(CONFIG_NRF_MODEM_LIB)
@@ -237,58 +239,15 @@ static void modem_init(void)
  */
 static bool app_event_handler(const struct app_event_header *aeh)
 {
-	struct app_msg_data msg = {0};
-	bool enqueue_msg = false;
-
-	if (is_cloud_module_event(aeh)) {
-		struct cloud_module_event *evt = cast_cloud_module_event(aeh);
-
-		msg.module.cloud = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_app_module_event(aeh)) {
-		struct app_module_event *evt = cast_app_module_event(aeh);
-
-		msg.module.app = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_data_module_event(aeh)) {
-		struct data_module_event *evt = cast_data_module_event(aeh);
-
-		msg.module.data = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_sensor_module_event(aeh)) {
-		struct sensor_module_event *evt = cast_sensor_module_event(aeh);
-
-		msg.module.sensor = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_util_module_event(aeh)) {
-		struct util_module_event *evt = cast_util_module_event(aeh);
-
-		msg.module.util = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_modem_module_event(aeh)) {
-		struct modem_module_event *evt = cast_modem_module_event(aeh);
-
-		msg.module.modem = *evt;
-		enqueue_msg = true;
-	}
+	bool enqueue_msg = is_cloud_module_event(aeh) ||
+			   is_app_module_event(aeh) ||
+			   is_data_module_event(aeh) ||
+			   is_sensor_module_event(aeh) ||
+			   is_util_module_event(aeh) ||
+			   is_modem_module_event(aeh);
 
 	if (enqueue_msg) {
-		int err = module_enqueue_msg(&self, &msg);
-
-		if (err) {
-			LOG_ERR("Message could not be enqueued");
-			SEND_ERROR(app, APP_EVT_ERROR, err);
-		}
+		module_enqueue_msg(&self, aeh);
 	}
 
 	return false;
@@ -530,7 +489,7 @@ static void on_all_events(struct app_msg_data *msg)
 int main(void)
 {
 	int err;
-	struct app_msg_data msg = { 0 };
+	struct app_msg_data *msg;
 
 	LOG_INF("Start thingy9151lite_nrf9151_app v%d.%d-%d-%s on %s",
 		CONFIG_VERSION_MAJOR,
@@ -597,22 +556,22 @@ int main(void)
 
 		switch (state) {
 		case STATE_INIT:
-			on_state_init(&msg);
+			on_state_init(msg);
 			break;
 		case STATE_RUNNING:
 			switch (sub_state) {
 			case SUB_STATE_ACTIVE_MODE:
-				on_sub_state_active(&msg);
+				on_sub_state_active(msg);
 				break;
 			case SUB_STATE_PASSIVE_MODE:
-				on_sub_state_passive(&msg);
+				on_sub_state_passive(msg);
 				break;
 			default:
 				LOG_ERR("Unknown sub state");
 				break;
 			}
 
-			on_state_running(&msg);
+			on_state_running(msg);
 			break;
 		case STATE_SHUTDOWN:
 			/* The shutdown state has no transition. */
@@ -622,7 +581,8 @@ int main(void)
 			break;
 		}
 
-		on_all_events(&msg);
+		on_all_events(msg);
+		module_msg_release(&self, msg);
 	}
 	return 0;
 }
@@ -22,10 +22,24 @@
 
 #include "cloud_wrapper.h"
 #include "cloud/cloud_codec/cloud_codec.h"
+#include "cloud/cloud_reconnect.h"
+
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+#include "cloud/cloud_send_scheduler.h"
+#endif
+
+#if defined(CONFIG_CLOUD_JOURNAL)
+#include "cloud/cloud_journal.h"
+#endif
+
+#if defined(CONFIG_CLOUD_AGNSS_CACHE)
+#include "cloud/agnss_cache.h"
+#endif
 
 #define MODULE cloud_module
 
 #include "modules_common.h"
+#include "event_trace/event_trace.h"
 #include "events/cloud_module_event.h"
 #include "events/app_module_event.h"
 #include "events/data_module_event.h"
@@ -37,16 +51,14 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_CLOUD_MODULE_LOG_LEVEL);
 
-BUILD_ASSERT(CONFIG_CLOUD_CONNECT_RETRIES < 14,
-	     "Cloud connect retries too large");
-
 BUILD_ASSERT(IS_ENABLED(CONFIG_NRF_CLOUD_MQTT) ||
 	     IS_ENABLED(CONFIG_AWS_IOT)	       ||
 	     IS_ENABLED(CONFIG_AZURE_IOT_HUB)  ||
 	     IS_ENABLED(CONFIG_LWM2M_INTEGRATION),
 	     "A cloud transport service must be enabled");
 
-#if defined(CONFIG_BOARD_QEMU_X86) || defined(CONFIG_BOARD_NATIVE_POSIX)
+#if defined(CONFIG_BOARD_QEMU_X86) || defined(CONFIG_BOARD_NATIVE_POSIX) || \
+	defined(CONFIG_BOARD_NATIVE_SIM)
 BUILD_ASSERT(IS_ENABLED(CONFIG_CLOUD_CLIENT_ID_USE_CUSTOM),
 	     "Passing IMEI as cloud client ID is not supported when building for PC builds. "
 	     "This is because IMEI is retrieved from the modem and not available when running "
@@ -81,21 +93,8 @@ static enum sub_state_type {
 
 static struct k_work_delayable connect_check_work;
 
-struct cloud_backoff_delay_lookup {
-	int delay;
-};
-
-/* Lookup table for backoff reconnection to cloud. Binary scaling. */
-static struct cloud_backoff_delay_lookup backoff_delay[] = {
-	{ 32 }, { 64 }, { 128 }, { 256 }, { 512 }, { 1024 },
-	{ 2048 }, { 4096 }, { 8192 }, { 16384 }, { 32768 },
-	{ 65536 }, { 131072 }, { 262144 }, { 524288 }, { 1048576 }
-};
-
-/* Variable that keeps track of how many times a reconnection to cloud
- * has been tried without success.
- */
-static int connect_retries;
+/* Set when the device has been connected to cloud since boot. */
+static bool cloud_connected_once;
 
 /* Local copy of the device configuration. */
 static struct cloud_data_cfg copy_cfg;
@@ -113,6 +112,71 @@ enum {
 	MEMFAULT,
 };
 
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+/* Send priority of each message type, lower values are sent first. Impacts and button presses
+ * are sent first, and Memfault data is sent last.
+ */
+static const uint8_t send_priority[] = {
+	[UI] = 0,
+	[CONFIG] = 1,
+	[CLOUD_LOCATION] = 1,
+	[AGNSS_REQUEST] = 1,
+	[PGPS_REQUEST] = 1,
+	[GENERIC] = 2,
+	[BATCH] = 3,
+	[MEMFAULT] = 4,
+};
+
+/* Radio connection release policy of a message type. */
+enum release_policy {
+	/* The radio connection can be released once the message has been sent, and acknowledged
+	 * if an acknowledgment is required.
+	 */
+	RELEASE_AFTER_SEND,
+	/* The cloud responds to the message. The radio connection is kept until the response has
+	 * been received, or until CONFIG_CLOUD_SEND_RESPONSE_TIMEOUT_SEC has passed.
+	 */
+	RELEASE_AFTER_RESPONSE,
+};
+
+static const uint8_t release_policy[] = {
+	[UI] = RELEASE_AFTER_SEND,
+	[CONFIG] = RELEASE_AFTER_SEND,
+	[CLOUD_LOCATION] = RELEASE_AFTER_RESPONSE,
+	[AGNSS_REQUEST] = RELEASE_AFTER_RESPONSE,
+	[PGPS_REQUEST] = RELEASE_AFTER_RESPONSE,
+	[GENERIC] = RELEASE_AFTER_SEND,
+	[BATCH] = RELEASE_AFTER_SEND,
+	[MEMFAULT] = RELEASE_AFTER_SEND,
+};
+
+/* QoS message ID of the last message of the latest send burst, 0 once it has been sent. */
+static atomic_t burst_last_id;
+
+/* Set when the last message of a send burst has been sent, until the burst is reported done. */
+static atomic_t burst_sent;
+
+/* Number of messages in the QoS library that are waiting for acknowledgment. */
+static atomic_t ack_outstanding;
+
+/* Bit mask of the message types that a response is expected for. */
+static atomic_t response_expected;
+
+static void response_timeout_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(response_timeout_work, response_timeout_work_fn);
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+
+#if defined(CONFIG_CLOUD_JOURNAL)
+BUILD_ASSERT((CLOUD_JOURNAL_MESSAGE_ID_BASE + CLOUD_JOURNAL_MESSAGE_ID_COUNT) <=
+	     QOS_MESSAGE_ID_BASE,
+	     "Journal message IDs overlap with QoS library message IDs");
+
+static void journal_drain_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(journal_drain_work, journal_drain_work_fn);
+#endif /* CONFIG_CLOUD_JOURNAL */
+
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
 /* Whether `agnss_request_buffer` has A-GNSS request buffered for sending when connection to
  * cloud has been re-established.
@@ -123,12 +187,22 @@ static bool agnss_request_buffered;
 static struct nrf_modem_gnss_agnss_data_frame agnss_request_buffer;
 #endif /* CONFIG_NRF_CLOUD_AGNSS */
 
+/* Acknowledgment IDs of messages in the QoS library. An entry is taken when its message is
+ * acknowledged or moved to the journal, and CLOUD_EVT_DATA_ACK is then sent with the ID.
+ * Accessed from the cloud module thread, the cloud integration and the send scheduler.
+ */
+static struct {
+	uint32_t qos_id;
+	uint32_t ack_id;
+} ack_ids[CONFIG_QOS_PENDING_MESSAGES_MAX];
+
+static struct k_spinlock ack_ids_lock;
+
 /* Cloud module message queue. */
-#define CLOUD_QUEUE_ENTRY_COUNT		20
-#define CLOUD_QUEUE_BYTE_ALIGNMENT	4
+#define CLOUD_QUEUE_ENTRY_COUNT		CONFIG_CLOUD_QUEUE_ENTRY_COUNT
+#define CLOUD_QUEUE_TELEMETRY_ENTRY_COUNT	CONFIG_CLOUD_QUEUE_TELEMETRY_ENTRY_COUNT
 
-K_MSGQ_DEFINE(msgq_cloud, sizeof(struct cloud_msg_data),
-	      CLOUD_QUEUE_ENTRY_COUNT, CLOUD_QUEUE_BYTE_ALIGNMENT);
+MODULE_QUEUE_DEFINE(msgq_cloud, CLOUD_QUEUE_ENTRY_COUNT, CLOUD_QUEUE_TELEMETRY_ENTRY_COUNT);
 
 static struct module_data self = {
 	.name = "cloud",
@@ -140,7 +214,13 @@ static struct module_data self = {
 static void connect_check_work_fn(struct k_work *work);
 static void send_config_received(void);
 static void add_qos_message(uint8_t *ptr, size_t len, uint8_t type,
-			    uint32_t flags, bool heap_allocated);
+			    uint32_t flags, bool heap_allocated, uint32_t ack_id);
+static void burst_message_sent(uint32_t id);
+static void burst_done_check(void);
+static void ack_received(void);
+static uint32_t ack_id_take(uint32_t qos_id);
+static void ack_send(uint32_t ack_id);
+static void response_received(uint8_t type);
 
 /* Convenience functions used in internal state handling. */
 static char *state2str(enum state_type state)
@@ -183,6 +263,7 @@ static void state_set(enum state_type new_state)
 		state2str(new_state));
 
 	state = new_state;
+	event_trace_state(EVENT_TRACE_STATE, self.name, new_state);
 }
 
 static void sub_state_set(enum sub_state_type new_state)
@@ -197,6 +278,7 @@ static void sub_state_set(enum sub_state_type new_state)
 		sub_state2str(new_state));
 
 	sub_state = new_state;
+	event_trace_state(EVENT_TRACE_SUB_STATE, self.name, new_state);
 }
 
 #if defined(CONFIG_NRF_CLOUD_AGNSS) && !defined(CONFIG_NRF_CLOUD_MQTT)
@@ -280,7 +362,8 @@ static int agnss_request_encode(struct nrf_modem_gnss_agnss_data_frame *incoming
 				output.len,
 				AGNSS_REQUEST,
 				QOS_FLAG_RELIABILITY_ACK_REQUIRED,
-				true);
+				true,
+				0);
 		break;
 	case -ENOTSUP:
 		LOG_ERR("Encoding of A-GNSS requests are not supported by the configured codec");
@@ -330,7 +413,8 @@ static int pgps_request_encode(struct gps_pgps_request *incoming_request)
 				output.len,
 				PGPS_REQUEST,
 				QOS_FLAG_RELIABILITY_ACK_REQUIRED,
-				true);
+				true,
+				0);
 		break;
 	case -ENOTSUP:
 		LOG_DBG("P-GPS request encoding is not supported, error: %d", err);
@@ -350,75 +434,31 @@ static int pgps_request_encode(struct gps_pgps_request *incoming_request)
 /* Handlers */
 static bool app_event_handler(const struct app_event_header *aeh)
 {
-	struct cloud_msg_data msg = {0};
-	bool enqueue_msg = false, consume = false;
-
-	if (is_app_module_event(aeh)) {
-		struct app_module_event *evt = cast_app_module_event(aeh);
-
-		msg.module.app = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_data_module_event(aeh)) {
-		struct data_module_event *evt = cast_data_module_event(aeh);
-
-		msg.module.data = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_modem_module_event(aeh)) {
-		struct modem_module_event *evt = cast_modem_module_event(aeh);
-
-		msg.module.modem = *evt;
-		enqueue_msg = true;
-	}
+	bool enqueue_msg = is_app_module_event(aeh) ||
+			   is_data_module_event(aeh) ||
+			   is_modem_module_event(aeh) ||
+			   is_cloud_module_event(aeh) ||
+			   is_util_module_event(aeh) ||
+			   is_location_module_event(aeh) ||
+			   is_debug_module_event(aeh);
+	bool consume = false;
 
 	if (is_cloud_module_event(aeh)) {
 		struct cloud_module_event *evt = cast_cloud_module_event(aeh);
 
-		msg.module.cloud = *evt;
-		enqueue_msg = true;
-
 		/* If the event is intended to only be used by the cloud module,
 		 * the event is consumed after it has been added to the internal message queue.
 		 * This is to prevent other modules that subscribe to cloud module events from
 		 * processing redundant events. Cloud module events are subscribed to first using
 		 * the APP_EVENT_SUBSCRIBE_FIRST macro.
 		 */
-		if (msg.module.cloud.type == CLOUD_EVT_DATA_SEND_QOS) {
+		if (evt->type == CLOUD_EVT_DATA_SEND_QOS) {
 			consume = true;
 		}
 	}
 
-	if (is_util_module_event(aeh)) {
-		struct util_module_event *evt = cast_util_module_event(aeh);
-
-		msg.module.util = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_location_module_event(aeh)) {
-		struct location_module_event *evt = cast_location_module_event(aeh);
-
-		msg.module.location = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_debug_module_event(aeh)) {
-		struct debug_module_event *evt = cast_debug_module_event(aeh);
-
-		msg.module.debug = *evt;
-		enqueue_msg = true;
-	}
-
 	if (enqueue_msg) {
-		int err = module_enqueue_msg(&self, &msg);
-
-		if (err) {
-			LOG_ERR("Message could not be enqueued");
-			SEND_ERROR(cloud, CLOUD_EVT_ERROR, err);
-		}
+		module_enqueue_msg(&self, aeh);
 	}
 
 	return consume;
@@ -449,6 +489,46 @@ static void config_data_handle(uint8_t *buf, const size_t len)
 	}
 }
 
+#if defined(CONFIG_CLOUD_AGNSS_CACHE)
+/**
+ * @brief Injects the requested A-GNSS data that is found in the A-GNSS cache.
+ *
+ * @param[in,out] request A-GNSS data request. The data found in the cache is removed from the
+ *			  request.
+ *
+ * @return True if all requested data was found in the cache.
+ */
+static bool agnss_cache_serve(struct nrf_modem_gnss_agnss_data_frame *request)
+{
+	int err;
+	uint8_t *buf;
+	size_t len;
+	struct nrf_modem_gnss_agnss_data_frame original = *request;
+
+	err = agnss_cache_lookup(request, &buf, &len);
+	if (err) {
+		LOG_WRN("agnss_cache_lookup, error: %d", err);
+		return false;
+	}
+
+	if (buf == NULL) {
+		return false;
+	}
+
+	err = location_agnss_data_process(buf, len);
+	k_free(buf);
+
+	if (err) {
+		/* Request all data from cloud instead. */
+		LOG_WRN("Failed to process cached A-GNSS data, error: %d", err);
+		*request = original;
+		return false;
+	}
+
+	return agnss_cache_request_empty(request);
+}
+#endif /* CONFIG_CLOUD_AGNSS_CACHE */
+
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
 /**
  * @brief Requests A-GNSS data upon receiving a request from the location module.
@@ -476,6 +556,13 @@ static void agnss_request_handle(struct nrf_modem_gnss_agnss_data_frame *incomin
 		}
 	}
 #else /* !CONFIG_NRF_CLOUD_MQTT */
+#if defined(CONFIG_CLOUD_AGNSS_CACHE)
+	if (agnss_cache_serve(incoming_request)) {
+		LOG_DBG("A-GNSS request answered from cache");
+		return;
+	}
+#endif /* CONFIG_CLOUD_AGNSS_CACHE */
+
 	/* If the nRF Cloud MQTT transport is not enabled, encode the A-GNSS request and send it
 	 * to the cloud.
 	 */
@@ -520,6 +607,14 @@ static void pgps_request_handle(struct gps_pgps_request *incoming_request)
 
 static void agnss_data_handle(const uint8_t *buf, const size_t len)
 {
+#if defined(CONFIG_CLOUD_AGNSS_CACHE)
+	int err = agnss_cache_store(buf, len);
+
+	if (err < 0) {
+		LOG_DBG("A-GNSS data not cached, error: %d", err);
+	}
+#endif /* CONFIG_CLOUD_AGNSS_CACHE */
+
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
 	(void)location_agnss_data_process(buf, len);
 #endif
@@ -582,8 +677,21 @@ static void cloud_wrap_event_handler(const struct cloud_wrap_event *const evt)
 		break;
 	}
 	case CLOUD_WRAP_EVT_CONNECTED: {
+		struct cloud_module_event *cloud_module_event = new_cloud_module_event();
+
 		LOG_DBG("CLOUD_WRAP_EVT_CONNECTED");
-		SEND_EVENT(cloud, CLOUD_EVT_CONNECTED);
+
+		__ASSERT(cloud_module_event, "Not enough heap left to allocate event");
+
+		cloud_module_event->type = CLOUD_EVT_CONNECTED;
+		cloud_reconnect_connected(&cloud_module_event->data.connection);
+
+		APP_EVENT_SUBMIT(cloud_module_event);
+		break;
+	}
+	case CLOUD_WRAP_EVT_CONNECT_ERROR: {
+		LOG_DBG("CLOUD_WRAP_EVT_CONNECT_ERROR: %d", evt->err);
+		cloud_reconnect_error(evt->err);
 		break;
 	}
 	case CLOUD_WRAP_EVT_DISCONNECTED: {
@@ -594,18 +702,22 @@ static void cloud_wrap_event_handler(const struct cloud_wrap_event *const evt)
 	case CLOUD_WRAP_EVT_DATA_RECEIVED:
 		LOG_DBG("CLOUD_WRAP_EVT_DATA_RECEIVED");
 		config_data_handle(evt->data.buf, evt->data.len);
+		response_received(CONFIG);
 		break;
 	case CLOUD_WRAP_EVT_PGPS_DATA_RECEIVED:
 		LOG_DBG("CLOUD_WRAP_EVT_PGPS_DATA_RECEIVED");
 		pgps_data_handle(evt->data.buf, evt->data.len);
+		response_received(PGPS_REQUEST);
 		break;
 	case CLOUD_WRAP_EVT_AGNSS_DATA_RECEIVED:
 		LOG_DBG("CLOUD_WRAP_EVT_AGNSS_DATA_RECEIVED");
 		agnss_data_handle(evt->data.buf, evt->data.len);
+		response_received(AGNSS_REQUEST);
 		break;
 	case CLOUD_WRAP_EVT_CLOUD_LOCATION_RESULT_RECEIVED:
 		LOG_DBG("CLOUD_WRAP_EVT_CLOUD_LOCATION_RESULT_RECEIVED");
 		cloud_location_data_handle(evt->data.buf, evt->data.len);
+		response_received(CLOUD_LOCATION);
 		break;
 	case CLOUD_WRAP_EVT_USER_ASSOCIATION_REQUEST: {
 		LOG_DBG("CLOUD_WRAP_EVT_USER_ASSOCIATION_REQUEST");
@@ -615,7 +727,7 @@ static void cloud_wrap_event_handler(const struct cloud_wrap_event *const evt)
 		 * until this happens.
 		 */
 		k_work_cancel_delayable(&connect_check_work);
-		connect_retries = 0;
+		cloud_reconnect_abort();
 
 		SEND_EVENT(cloud, CLOUD_EVT_USER_ASSOCIATION_REQUEST);
 		break;
@@ -669,6 +781,24 @@ static void cloud_wrap_event_handler(const struct cloud_wrap_event *const evt)
 	case CLOUD_WRAP_EVT_DATA_ACK: {
 		LOG_DBG("CLOUD_WRAP_EVT_DATA_ACK: %d", evt->message_id);
 
+#if defined(CONFIG_CLOUD_JOURNAL)
+		if (cloud_journal_id_check(evt->message_id)) {
+			int err = cloud_journal_ack(evt->message_id);
+
+			if (err == -ENOENT) {
+				LOG_DBG("Message Acknowledgment not in flight from journal, ID: %d",
+					evt->message_id);
+			} else if (err) {
+				LOG_ERR("cloud_journal_ack, error: %d", err);
+			}
+
+			burst_done_check();
+			break;
+		}
+#endif /* CONFIG_CLOUD_JOURNAL */
+
+		/* Removal drops the acknowledgment ID of the message, take it first. */
+		uint32_t ack_id = ack_id_take(evt->message_id);
 		int err = qos_message_remove(evt->message_id);
 
 		if (err == -ENODATA) {
@@ -677,8 +807,12 @@ static void cloud_wrap_event_handler(const struct cloud_wrap_event *const evt)
 		} else if (err) {
 			LOG_ERR("qos_message_remove, error: %d", err);
 			SEND_ERROR(cloud, CLOUD_EVT_ERROR, err);
+		} else {
+			ack_received();
+			ack_send(ack_id);
 		}
 
+		burst_message_sent(evt->message_id);
 		break;
 	}
 	case CLOUD_WRAP_EVT_PING_ACK: {
@@ -688,6 +822,8 @@ static void cloud_wrap_event_handler(const struct cloud_wrap_event *const evt)
 		 * established RCC connection and we can try to send all available messages.
 		 */
 		qos_message_notify_all();
+
+		cloud_reconnect_ping_ack();
 		break;
 	}
 	case CLOUD_WRAP_EVT_ERROR: {
@@ -717,11 +853,11 @@ static void send_config_received(void)
 static void connect_cloud(void)
 {
 	int err;
-	int backoff_sec = backoff_delay[connect_retries].delay;
+	uint32_t backoff_sec;
 
 	LOG_DBG("Connecting to cloud");
 
-	if (connect_retries > CONFIG_CLOUD_CONNECT_RETRIES) {
+	if (cloud_reconnect_retries_get() > CONFIG_CLOUD_CONNECT_RETRIES) {
 		LOG_WRN("Too many failed cloud connection attempts");
 		SEND_ERROR(cloud, CLOUD_EVT_ERROR, -ENETUNREACH);
 		return;
@@ -731,36 +867,223 @@ static void connect_cloud(void)
 	 * the socket is polled on in the internal cloud thread or the
 	 * cloud backend is the wrong state. We cannot treat this as an error as
 	 * it is rather common that cloud_connect can be called under these
-	 * conditions.
+	 * conditions. Errors that identify why the attempt failed are recorded by the
+	 * reconnect scheduler.
 	 */
+	backoff_sec = cloud_reconnect_attempt(k_uptime_get());
+
 	err = cloud_wrap_connect();
 	if (err) {
 		LOG_DBG("cloud_connect failed, error: %d", err);
+		cloud_reconnect_error(err);
 	}
 
-	connect_retries++;
-
 	LOG_DBG("Cloud connection establishment in progress");
-	LOG_DBG("New connection attempt in %d seconds if not successful",
+	LOG_DBG("New connection attempt in %u seconds if not successful",
 		backoff_sec);
 
 	/* Start timer to check connection status after backoff */
 	k_work_reschedule(&connect_check_work, K_SECONDS(backoff_sec));
 }
 
+#if defined(CONFIG_CLOUD_JOURNAL)
+/* Store a message that could not be sent in the journal. */
+static int journal_message_store(const struct qos_data *message)
+{
+	int err = cloud_journal_append(message->type, message->flags,
+				       (const char *)message->data.buf, message->data.len);
+
+	if (err) {
+		LOG_ERR("Message could not be stored in journal, error: %d", err);
+		return err;
+	}
+
+	LOG_DBG("Message stored in journal, ID: %d", message->id);
+	return 0;
+}
+
+/* Handle a message that is due to be sent while the device is not connected to cloud.
+ * Messages sent from the journal are still stored in it, and are sent again after
+ * reconnection. Other messages are moved from the QoS library to the journal.
+ */
+static void journal_message_defer(const struct qos_data *message)
+{
+	int err;
+	uint32_t ack_id;
+
+	if (cloud_journal_id_check(message->id)) {
+		k_free(message->data.buf);
+		return;
+	}
+
+	/* The message is kept in flash by the journal, the sender does not need to keep it. */
+	ack_id = ack_id_take(message->id);
+
+	if (journal_message_store(message) == 0) {
+		ack_send(ack_id);
+	}
+
+	/* Removal frees the message buffer. */
+	err = qos_message_remove(message->id);
+	if (err && (err != -ENODATA)) {
+		LOG_ERR("qos_message_remove, error: %d", err);
+	} else if (!err && qos_message_has_flag(message, QOS_FLAG_RELIABILITY_ACK_REQUIRED)) {
+		ack_received();
+	}
+}
+
+/* Send the next message in the journal. Runs every drain interval while connected to cloud,
+ * until the journal has been drained.
+ */
+static void journal_drain_work_fn(struct k_work *work)
+{
+	int err;
+	struct cloud_journal_entry entry;
+
+	if ((state != STATE_LTE_CONNECTED) || (sub_state != SUB_STATE_CLOUD_CONNECTED)) {
+		return;
+	}
+
+	err = cloud_journal_next(&entry);
+	if (err == -ENODATA) {
+		LOG_DBG("Journal drained");
+		burst_done_check();
+		return;
+	} else if ((err == -EBUSY) || (err == -ENOMEM)) {
+		/* Waiting for acknowledgments or heap, try again later. */
+	} else if (err) {
+		LOG_ERR("cloud_journal_next, error: %d", err);
+		return;
+	} else {
+		struct cloud_module_event *cloud_module_event = new_cloud_module_event();
+
+		__ASSERT(cloud_module_event, "Not enough heap left to allocate event");
+
+		cloud_module_event->type = CLOUD_EVT_DATA_SEND_QOS;
+		cloud_module_event->data.message = (struct qos_data) {
+			.heap_allocated = true,
+			.data.buf = (uint8_t *)entry.buf,
+			.data.len = entry.len,
+			.id = entry.id,
+			.type = entry.type,
+			.flags = entry.flags
+		};
+
+		APP_EVENT_SUBMIT(cloud_module_event);
+	}
+
+	k_work_reschedule(&journal_drain_work, K_MSEC(CONFIG_CLOUD_JOURNAL_DRAIN_INTERVAL_MS));
+}
+
+/* Called when the connection to cloud has been lost. Messages pending in the QoS library are
+ * notified so that they are moved to the journal.
+ */
+static void journal_disconnected(void)
+{
+	k_work_cancel_delayable(&journal_drain_work);
+	cloud_journal_rewind();
+	qos_message_notify_all();
+}
+#endif /* CONFIG_CLOUD_JOURNAL */
+
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+/* A send burst that is in progress when the connection to cloud is lost is not reported done.
+ * Messages that are still waiting for acknowledgment stay outstanding.
+ */
+static void burst_reset(void)
+{
+	atomic_clear(&burst_last_id);
+	atomic_clear(&burst_sent);
+	atomic_clear(&response_expected);
+	(void)k_work_cancel_delayable(&response_timeout_work);
+}
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+
 static void disconnect_cloud(void)
 {
 	cloud_wrap_disconnect();
 
-	connect_retries = 0;
+	cloud_reconnect_abort();
 	qos_timer_reset();
 
 	k_work_cancel_delayable(&connect_check_work);
+
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	burst_reset();
+#endif
+
+#if defined(CONFIG_CLOUD_JOURNAL)
+	journal_disconnected();
+#endif
 }
 
-/* Convenience function used to add messages to the QoS library. */
-static void add_qos_message(uint8_t *ptr, size_t len, uint8_t type,
-			    uint32_t flags, bool heap_allocated)
+/* Remember the acknowledgment ID of a message that is added to the QoS library. */
+static void ack_id_add(uint32_t qos_id, uint32_t ack_id)
+{
+	k_spinlock_key_t key;
+
+	if (ack_id == 0) {
+		return;
+	}
+
+	key = k_spin_lock(&ack_ids_lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(ack_ids); i++) {
+		if (ack_ids[i].ack_id == 0) {
+			ack_ids[i].qos_id = qos_id;
+			ack_ids[i].ack_id = ack_id;
+			k_spin_unlock(&ack_ids_lock, key);
+			return;
+		}
+	}
+
+	k_spin_unlock(&ack_ids_lock, key);
+
+	/* The sender sends the data again if it is not acknowledged. */
+	LOG_WRN("No room for acknowledgment ID %d", ack_id);
+}
+
+/* Remove and return the acknowledgment ID of a QoS message, 0 if it has none. */
+static uint32_t ack_id_take(uint32_t qos_id)
+{
+	uint32_t ack_id = 0;
+	k_spinlock_key_t key = k_spin_lock(&ack_ids_lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(ack_ids); i++) {
+		if ((ack_ids[i].ack_id != 0) && (ack_ids[i].qos_id == qos_id)) {
+			ack_id = ack_ids[i].ack_id;
+			ack_ids[i].ack_id = 0;
+			break;
+		}
+	}
+
+	k_spin_unlock(&ack_ids_lock, key);
+
+	return ack_id;
+}
+
+/* Notify the sender of a message that it has been acknowledged. */
+static void ack_send(uint32_t ack_id)
+{
+	struct cloud_module_event *cloud_module_event;
+
+	if (ack_id == 0) {
+		return;
+	}
+
+	cloud_module_event = new_cloud_module_event();
+
+	__ASSERT(cloud_module_event, "Not enough heap left to allocate event");
+
+	cloud_module_event->type = CLOUD_EVT_DATA_ACK;
+	cloud_module_event->data.ack.id = ack_id;
+
+	APP_EVENT_SUBMIT(cloud_module_event);
+}
+
+/* Add a message to the QoS library. Returns the ID of the message, or a negative error code. */
+static int qos_message_submit(uint8_t *ptr, size_t len, uint8_t type,
+			      uint32_t flags, bool heap_allocated, uint32_t ack_id)
 {
 	int err;
 	struct qos_data message = {
@@ -772,13 +1095,180 @@ static void add_qos_message(uint8_t *ptr, size_t len, uint8_t type,
 		.flags = flags
 	};
 
+	/* Added before the message, which can be sent and acknowledged as soon as it has been
+	 * added.
+	 */
+	ack_id_add(message.id, ack_id);
+
 	err = qos_message_add(&message);
+	if (err) {
+		(void)ack_id_take(message.id);
+	}
+
 	if (err == -ENOMEM) {
 		LOG_WRN("Cannot add message, internal pending list is full");
+
+#if defined(CONFIG_CLOUD_JOURNAL)
+		if (journal_message_store(&message) == 0) {
+			ack_send(ack_id);
+		}
+
+		if (heap_allocated) {
+			k_free(ptr);
+		}
+
+		(void)k_work_schedule(&journal_drain_work, K_NO_WAIT);
+#endif /* CONFIG_CLOUD_JOURNAL */
+		return err;
 	} else if (err) {
 		LOG_ERR("qos_message_add, error: %d", err);
 		SEND_ERROR(cloud, CLOUD_EVT_ERROR, err);
+		return err;
+	}
+
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	if (qos_message_has_flag(&message, QOS_FLAG_RELIABILITY_ACK_REQUIRED)) {
+		atomic_inc(&ack_outstanding);
+	}
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+
+	return message.id;
+}
+
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+/* Called by the send scheduler when the coalescing window of a burst has expired. */
+static void scheduler_send(const struct cloud_send_scheduler_msg *msg, bool last)
+{
+	int id = qos_message_submit((uint8_t *)msg->buf, msg->len, msg->type, msg->flags,
+				    msg->heap_allocated, msg->ack_id);
+
+	if (last && (id > 0)) {
+		atomic_set(&burst_last_id, id);
+	}
+}
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+
+/* Notify the other modules that the latest send burst is done, if its last message has been
+ * sent, no acknowledgments are outstanding and no responses are expected from cloud.
+ */
+static void burst_done_check(void)
+{
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	if (!atomic_get(&burst_sent) ||
+	    (atomic_get(&ack_outstanding) > 0) ||
+	    (atomic_get(&response_expected) != 0)) {
+		return;
+	}
+
+#if defined(CONFIG_CLOUD_JOURNAL)
+	if (cloud_journal_pending_count() > 0) {
+		return;
+	}
+#endif /* CONFIG_CLOUD_JOURNAL */
+
+	if (atomic_cas(&burst_sent, true, false)) {
+		LOG_DBG("Send burst done");
+		SEND_EVENT(cloud, CLOUD_EVT_DATA_SEND_DONE);
+	}
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+}
+
+/* Called when a message has been sent, and acknowledged if an acknowledgment was required. */
+static void burst_message_sent(uint32_t id)
+{
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	if (atomic_cas(&burst_last_id, id, 0)) {
+		LOG_DBG("Last message of send burst sent");
+		atomic_set(&burst_sent, true);
+		burst_done_check();
+	}
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+}
+
+/* Called when a message that required acknowledgment has been removed from the QoS library. */
+static void ack_received(void)
+{
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	if (atomic_dec(&ack_outstanding) <= 0) {
+		/* Messages added before the counter was reset. */
+		atomic_inc(&ack_outstanding);
+	}
+
+	burst_done_check();
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+}
+
+/* Keep the radio connection until a response to a message of the given type is received. */
+static void response_expect(uint8_t type)
+{
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	/* Not all cloud services return the resolved location to the device. */
+	if ((type == CLOUD_LOCATION) && !cloud_wrap_cloud_location_response_wait()) {
+		return;
+	}
+
+	atomic_or(&response_expected, BIT(type));
+	k_work_reschedule(&response_timeout_work,
+			  K_SECONDS(CONFIG_CLOUD_SEND_RESPONSE_TIMEOUT_SEC));
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+}
+
+/* Called when a message has been sent. Applies the release policy of the message type. */
+static void release_policy_apply(uint8_t type)
+{
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	if ((type < ARRAY_SIZE(release_policy)) &&
+	    (release_policy[type] == RELEASE_AFTER_RESPONSE)) {
+		response_expect(type);
+	}
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+}
+
+static void response_received(uint8_t type)
+{
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	if (atomic_and(&response_expected, ~BIT(type)) & BIT(type)) {
+		burst_done_check();
+	}
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+}
+
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+static void response_timeout_work_fn(struct k_work *work)
+{
+	if (atomic_clear(&response_expected)) {
+		LOG_DBG("Response from cloud not received");
+		burst_done_check();
+	}
+}
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+
+/* Convenience function used to add messages to the QoS library, through the send scheduler if
+ * it is enabled.
+ */
+static void add_qos_message(uint8_t *ptr, size_t len, uint8_t type,
+			    uint32_t flags, bool heap_allocated, uint32_t ack_id)
+{
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	int err;
+	struct cloud_send_scheduler_msg message = {
+		.buf = (char *)ptr,
+		.len = len,
+		.type = type,
+		.priority = send_priority[type],
+		.flags = flags,
+		.heap_allocated = heap_allocated,
+		.ack_id = ack_id
+	};
+
+	err = cloud_send_scheduler_add(&message);
+	if (err) {
+		LOG_ERR("cloud_send_scheduler_add, error: %d", err);
+		SEND_ERROR(cloud, CLOUD_EVT_ERROR, err);
 	}
+#else
+	(void)qos_message_submit(ptr, len, type, flags, heap_allocated, ack_id);
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
 }
 
 static void qos_event_handler(const struct qos_evt *evt)
@@ -812,6 +1302,9 @@ static void qos_event_handler(const struct qos_evt *evt)
 	case QOS_EVT_MESSAGE_REMOVED_FROM_LIST:
 		LOG_DBG("QOS_EVT_MESSAGE_REMOVED_FROM_LIST");
 
+		/* The message was not acknowledged, the sender keeps its data. */
+		(void)ack_id_take(evt->message.id);
+
 		if (evt->message.heap_allocated) {
 			LOG_DBG("Freeing pointer: %p", (void *)evt->message.data.buf);
 			k_free(evt->message.data.buf);
@@ -823,6 +1316,38 @@ static void qos_event_handler(const struct qos_evt *evt)
 	}
 }
 
+/* Reconnect after a random delay, so that devices that see the same change in network
+ * conditions do not reconnect at the same time.
+ */
+static void connect_jittered(void)
+{
+	uint32_t jitter_ms = cloud_reconnect_jitter_get();
+
+	LOG_DBG("New connection attempt in %u ms", jitter_ms);
+
+	k_work_reschedule(&connect_check_work, K_MSEC(jitter_ms));
+}
+
+#if defined(CONFIG_CLOUD_KEEP_CONNECTION)
+/* The connection is only kept if a keepalive ping is sent every CONFIG_MQTT_KEEPALIVE seconds,
+ * which wakes the modem from PSM. The keepalive is a build time option of the cloud client
+ * libraries, so it is checked against the periodic TAU granted by the network instead of being
+ * derived from it.
+ */
+static void keepalive_check(const struct modem_module_psm *psm)
+{
+	if (psm->tau <= 0) {
+		/* PSM is not enabled. */
+		return;
+	}
+
+	if (CONFIG_MQTT_KEEPALIVE < psm->tau) {
+		LOG_WRN("Keepalive pings every %d s wake the modem between TAUs every %d s",
+			CONFIG_MQTT_KEEPALIVE, psm->tau);
+	}
+}
+#endif /* CONFIG_CLOUD_KEEP_CONNECTION */
+
 /* If this work is executed, it means that the connection attempt was not
  * successful before the backoff timer expired. A timeout message is then
  * added to the message queue to signal the timeout.
@@ -855,6 +1380,30 @@ static int setup(void)
 		return err;
 	}
 
+#if defined(CONFIG_CLOUD_JOURNAL)
+	err = cloud_journal_init();
+	if (err) {
+		LOG_ERR("cloud_journal_init, error: %d", err);
+		return err;
+	}
+#endif /* CONFIG_CLOUD_JOURNAL */
+
+#if defined(CONFIG_CLOUD_AGNSS_CACHE)
+	err = agnss_cache_init();
+	if (err) {
+		/* Not critical, A-GNSS data is requested from cloud instead. */
+		LOG_ERR("agnss_cache_init, error: %d", err);
+	}
+#endif /* CONFIG_CLOUD_AGNSS_CACHE */
+
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+	err = cloud_send_scheduler_init(scheduler_send);
+	if (err) {
+		LOG_ERR("cloud_send_scheduler_init, error: %d", err);
+		return err;
+	}
+#endif /* CONFIG_CLOUD_SEND_SCHEDULER */
+
 #if (defined(CONFIG_MCUBOOT_IMG_MANAGER) && !defined(CONFIG_LWM2M_CARRIER))
 	/* After a successful initializaton, tell the bootloader that the
 	 * current image is confirmed to be working.
@@ -902,6 +1451,15 @@ static void on_state_lte_connected(struct cloud_msg_data *msg)
 	if (IS_EVENT(msg, modem, MODEM_EVT_CARRIER_FOTA_STOPPED)) {
 		connect_cloud();
 	}
+
+	/* Improved radio conditions reset the reconnection backoff. */
+	if ((IS_EVENT(msg, modem, MODEM_EVT_LTE_RRC_CONNECTED)) ||
+	    (IS_EVENT(msg, modem, MODEM_EVT_LTE_CELL_UPDATE))) {
+		if ((sub_state == SUB_STATE_CLOUD_DISCONNECTED) &&
+		    cloud_reconnect_trigger(k_uptime_get())) {
+			connect_jittered();
+		}
+	}
 }
 
 /* Message handler for STATE_LTE_DISCONNECTED. */
@@ -911,8 +1469,15 @@ static void on_state_lte_disconnected(struct cloud_msg_data *msg)
 	    (IS_EVENT(msg, debug, DEBUG_EVT_EMULATOR_NETWORK_CONNECTED))) {
 		state_set(STATE_LTE_CONNECTED);
 
-		/* LTE is now connected, cloud connection can be attempted */
-		connect_cloud();
+		/* LTE is now connected, cloud connection can be attempted. If the device has
+		 * been connected before, the LTE connection was lost, possibly together with
+		 * all other devices in the cell. Spread out the reconnection attempts.
+		 */
+		if (cloud_connected_once) {
+			connect_jittered();
+		} else {
+			connect_cloud();
+		}
 	}
 
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
@@ -923,6 +1488,13 @@ static void on_state_lte_disconnected(struct cloud_msg_data *msg)
 		return;
 	}
 #endif
+
+#if defined(CONFIG_CLOUD_JOURNAL)
+	if (IS_EVENT(msg, cloud, CLOUD_EVT_DATA_SEND_QOS)) {
+		journal_message_defer(&msg->module.cloud.data.message);
+		return;
+	}
+#endif
 }
 
 /* Message handler for SUB_STATE_CLOUD_CONNECTED. */
@@ -937,6 +1509,14 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 
 		/* Reset QoS timer. Will be restarted upon a successful call to qos_message_add() */
 		qos_timer_reset();
+
+#if defined(CONFIG_CLOUD_SEND_SCHEDULER)
+		burst_reset();
+#endif
+
+#if defined(CONFIG_CLOUD_JOURNAL)
+		journal_disconnected();
+#endif
 		return;
 	}
 
@@ -951,6 +1531,9 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 			LOG_ERR("cloud_wrap_state_get, err: %d", err);
 		} else {
 			LOG_DBG("Device configuration requested");
+
+			/* The radio connection is kept until the configuration is received. */
+			response_expect(CONFIG);
 		}
 	}
 
@@ -959,7 +1542,8 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 				msg->module.debug.data.memfault.len,
 				MEMFAULT,
 				QOS_FLAG_RELIABILITY_ACK_REQUIRED,
-				true);
+				true,
+				0);
 	}
 
 	if (IS_EVENT(msg, data, DATA_EVT_DATA_SEND)) {
@@ -983,16 +1567,25 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 						   paths);
 			if (err) {
 				LOG_ERR("cloud_wrap_data_send, err: %d", err);
+			} else {
+				ack_send(msg->module.data.data.buffer.ack_id);
 			}
 
 			return;
 		}
 
+		/* Data messages that report modem data to the device shadow carry an
+		 * acknowledgment ID. They are sent with acknowledgment, so that the reported
+		 * values are only left out of later messages once cloud has received them.
+		 */
 		add_qos_message(msg->module.data.data.buffer.buf,
 				msg->module.data.data.buffer.len,
 				GENERIC,
-				QOS_FLAG_RELIABILITY_ACK_DISABLED,
-				true);
+				msg->module.data.data.buffer.ack_id ?
+					QOS_FLAG_RELIABILITY_ACK_REQUIRED :
+					QOS_FLAG_RELIABILITY_ACK_DISABLED,
+				true,
+				msg->module.data.data.buffer.ack_id);
 	}
 
 	if (IS_EVENT(msg, data, DATA_EVT_CONFIG_SEND)) {
@@ -1000,15 +1593,47 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 				msg->module.data.data.buffer.len,
 				CONFIG,
 				QOS_FLAG_RELIABILITY_ACK_REQUIRED,
-				true);
+				true,
+				0);
 	}
 
 	if (IS_EVENT(msg, data, DATA_EVT_DATA_SEND_BATCH)) {
+
+		if (IS_ENABLED(CONFIG_LWM2M_INTEGRATION)) {
+
+			struct lwm2m_obj_path paths[CONFIG_CLOUD_CODEC_LWM2M_PATH_LIST_ENTRIES_MAX];
+
+			__ASSERT(ARRAY_SIZE(paths) ==
+				 ARRAY_SIZE(msg->module.data.data.buffer.paths),
+				 "Path object list not the same size");
+
+			for (int i = 0; i < ARRAY_SIZE(paths); i++) {
+				paths[i] = msg->module.data.data.buffer.paths[i];
+			}
+
+			err = cloud_wrap_batch_send(NULL,
+						    msg->module.data.data.buffer.valid_object_paths,
+						    true,
+						    0,
+						    paths);
+			if (err) {
+				LOG_ERR("cloud_wrap_batch_send, err: %d", err);
+			} else {
+				/* The LwM2M integration does not report acknowledgments, the
+				 * data is considered delivered once it has been sent.
+				 */
+				ack_send(msg->module.data.data.buffer.ack_id);
+			}
+
+			return;
+		}
+
 		add_qos_message(msg->module.data.data.buffer.buf,
 				msg->module.data.data.buffer.len,
 				BATCH,
 				QOS_FLAG_RELIABILITY_ACK_REQUIRED,
-				true);
+				true,
+				msg->module.data.data.buffer.ack_id);
 	}
 
 	if ((IS_EVENT(msg, data, DATA_EVT_UI_DATA_SEND)) ||
@@ -1042,7 +1667,8 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 				msg->module.data.data.buffer.len,
 				UI,
 				QOS_FLAG_RELIABILITY_ACK_REQUIRED,
-				true);
+				true,
+				0);
 	}
 
 	if (IS_EVENT(msg, data, DATA_EVT_CLOUD_LOCATION_DATA_SEND)) {
@@ -1060,7 +1686,8 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 				msg->module.data.data.buffer.len,
 				CLOUD_LOCATION,
 				QOS_FLAG_RELIABILITY_ACK_REQUIRED,
-				true);
+				true,
+				0);
 
 		/* Check if the configured cloud service will return the resolved location back
 		 * to the device. If it does not, indicate that location result is unknown.
@@ -1102,7 +1729,8 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 			err = cloud_wrap_batch_send(message->buf,
 						    message->len,
 						    ack,
-						    msg->module.cloud.data.message.id);
+						    msg->module.cloud.data.message.id,
+						    NULL);
 			if (err) {
 				LOG_WRN("cloud_wrap_batch_send, err: %d", err);
 			}
@@ -1166,6 +1794,30 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 			LOG_ERR("Unknown data type");
 			break;
 		}
+
+		if (!err) {
+			release_policy_apply(msg->module.cloud.data.message.type);
+		}
+
+		/* Messages that require acknowledgment are done when the acknowledgment is
+		 * received.
+		 */
+		if (!err && !ack) {
+			burst_message_sent(msg->module.cloud.data.message.id);
+		}
+
+#if defined(CONFIG_CLOUD_JOURNAL)
+		/* Messages sent from the journal are not kept in the QoS library, their buffers
+		 * are freed once they have been sent.
+		 */
+		if (cloud_journal_id_check(msg->module.cloud.data.message.id)) {
+			if (!err && !ack) {
+				(void)cloud_journal_ack(msg->module.cloud.data.message.id);
+			}
+
+			k_free(message->buf);
+		}
+#endif /* CONFIG_CLOUD_JOURNAL */
 	}
 
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
@@ -1189,9 +1841,12 @@ static void on_sub_state_cloud_disconnected(struct cloud_msg_data *msg)
 	if (IS_EVENT(msg, cloud, CLOUD_EVT_CONNECTED)) {
 		sub_state_set(SUB_STATE_CLOUD_CONNECTED);
 
-		connect_retries = 0;
+		cloud_connected_once = true;
 		k_work_cancel_delayable(&connect_check_work);
 
+		LOG_DBG("Connected after %u attempts",
+			msg->module.cloud.data.connection.attempts);
+
 #if defined(CONFIG_NRF_CLOUD_AGNSS)
 		if (agnss_request_buffered) {
 			LOG_DBG("Handle buffered A-GNSS request");
@@ -1199,6 +1854,13 @@ static void on_sub_state_cloud_disconnected(struct cloud_msg_data *msg)
 			agnss_request_buffered = false;
 		}
 #endif
+
+#if defined(CONFIG_CLOUD_JOURNAL)
+		if (cloud_journal_pending_count() > 0) {
+			LOG_DBG("Draining %d messages from journal", cloud_journal_pending_count());
+			k_work_reschedule(&journal_drain_work, K_NO_WAIT);
+		}
+#endif
 	}
 
 	if (IS_EVENT(msg, cloud, CLOUD_EVT_CONNECTION_TIMEOUT)) {
@@ -1216,9 +1878,24 @@ static void on_sub_state_cloud_disconnected(struct cloud_msg_data *msg)
 				msg->module.data.data.buffer.len,
 				CONFIG,
 				QOS_FLAG_RELIABILITY_ACK_REQUIRED,
-				true);
+				true,
+				0);
 	}
 
+#if defined(CONFIG_CLOUD_JOURNAL)
+	/* Messages that are due to be sent while disconnected are deferred to the journal,
+	 * except for the device configuration acknowledgment that nRF Cloud accepts before the
+	 * connection is fully established.
+	 */
+	if (IS_EVENT(msg, cloud, CLOUD_EVT_DATA_SEND_QOS) &&
+	    !(IS_ENABLED(CONFIG_NRF_CLOUD_MQTT) &&
+	      (msg->module.cloud.data.message.type == CONFIG) &&
+	      !cloud_journal_id_check(msg->module.cloud.data.message.id))) {
+		journal_message_defer(&msg->module.cloud.data.message);
+		return;
+	}
+#endif /* CONFIG_CLOUD_JOURNAL */
+
 	if (IS_EVENT(msg, cloud, CLOUD_EVT_DATA_SEND_QOS) &&
 	    IS_ENABLED(CONFIG_NRF_CLOUD_MQTT)) {
 		bool ack = qos_message_has_flag(&msg->module.cloud.data.message,
@@ -1265,6 +1942,22 @@ static void on_all_states(struct cloud_msg_data *msg)
 		state_set(STATE_SHUTDOWN);
 	}
 
+	if (IS_EVENT(msg, modem, MODEM_EVT_LTE_RSRP_UPDATE)) {
+		bool reset = cloud_reconnect_rsrp_update(msg->module.modem.data.rsrp,
+							 k_uptime_get());
+
+		if (reset && (state == STATE_LTE_CONNECTED) &&
+		    (sub_state == SUB_STATE_CLOUD_DISCONNECTED)) {
+			connect_jittered();
+		}
+	}
+
+#if defined(CONFIG_CLOUD_KEEP_CONNECTION)
+	if (IS_EVENT(msg, modem, MODEM_EVT_LTE_PSM_UPDATE)) {
+		keepalive_check(&msg->module.modem.data.psm);
+	}
+#endif
+
 	if (is_data_module_event(&msg->module.data.header)) {
 		switch (msg->module.data.type) {
 		case DATA_EVT_CONFIG_INIT:
@@ -1281,7 +1974,7 @@ static void on_all_states(struct cloud_msg_data *msg)
 static void module_thread_fn(void)
 {
 	int err;
-	struct cloud_msg_data msg = { 0 };
+	struct cloud_msg_data *msg;
 
 	self.thread_id = k_current_get();
 
@@ -1301,25 +1994,25 @@ static void module_thread_fn(void)
 
 		switch (state) {
 		case STATE_LTE_INIT:
-			on_state_init(&msg);
+			on_state_init(msg);
 			break;
 		case STATE_LTE_CONNECTED:
 			switch (sub_state) {
 			case SUB_STATE_CLOUD_CONNECTED:
-				on_sub_state_cloud_connected(&msg);
+				on_sub_state_cloud_connected(msg);
 				break;
 			case SUB_STATE_CLOUD_DISCONNECTED:
-				on_sub_state_cloud_disconnected(&msg);
+				on_sub_state_cloud_disconnected(msg);
 				break;
 			default:
 				LOG_ERR("Unknown sub state");
 				break;
 			}
 
-			on_state_lte_connected(&msg);
+			on_state_lte_connected(msg);
 			break;
 		case STATE_LTE_DISCONNECTED:
-			on_state_lte_disconnected(&msg);
+			on_state_lte_disconnected(msg);
 			break;
 		case STATE_SHUTDOWN:
 			/* The shutdown state has no transition. */
@@ -1329,7 +2022,8 @@ static void module_thread_fn(void)
 			break;
 		}
 
-		on_all_states(&msg);
+		on_all_states(msg);
+		module_msg_release(&self, msg);
 	}
 }
 
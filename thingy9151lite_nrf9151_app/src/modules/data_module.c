@@ -10,13 +10,21 @@
 #include <date_time.h>
 #if defined(CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY)
 #include <modem/lte_lc.h>
+#include "send_policy/send_policy.h"
 #endif
 
 #include "cloud/cloud_codec/cloud_codec.h"
+#include "cloud/cloud_codec/cloud_codec_storage.h"
+#include "cloud/cloud_codec/cloud_codec_shadow.h"
+#include "cloud/cloud_codec/cloud_codec_compress.h"
+#if defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+#include "cloud/cloud_codec/cloud_codec_gnss_track.h"
+#endif
 
 #define MODULE data_module
 
 #include "modules_common.h"
+#include "event_trace/event_trace.h"
 #include "events/app_module_event.h"
 #include "events/cloud_module_event.h"
 #include "events/data_module_event.h"
@@ -56,12 +64,38 @@ static enum state_type {
  * Upon a LTE connection loss the device will keep sampling/storing data in
  * the buffers, and empty the buffers in batches upon a reconnect.
  */
-static struct cloud_data_gnss gnss_buf[CONFIG_DATA_GNSS_BUFFER_COUNT];
-static struct cloud_data_sensors sensors_buf[CONFIG_DATA_SENSOR_BUFFER_COUNT];
-static struct cloud_data_ui ui_buf[CONFIG_DATA_UI_BUFFER_COUNT];
-static struct cloud_data_impact impact_buf[CONFIG_DATA_IMPACT_BUFFER_COUNT];
-static struct cloud_data_battery bat_buf[CONFIG_DATA_BATTERY_BUFFER_COUNT];
-static struct cloud_data_modem_dynamic modem_dyn_buf[CONFIG_DATA_MODEM_DYNAMIC_BUFFER_COUNT];
+#if !defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+static struct cloud_data_gnss gnss_items[CONFIG_DATA_GNSS_BUFFER_COUNT];
+#endif
+static struct cloud_data_sensors sensors_items[CONFIG_DATA_SENSOR_BUFFER_COUNT];
+static struct cloud_data_ui ui_items[CONFIG_DATA_UI_BUFFER_COUNT];
+static struct cloud_data_impact impact_items[CONFIG_DATA_IMPACT_BUFFER_COUNT];
+static struct cloud_data_battery bat_items[CONFIG_DATA_BATTERY_BUFFER_COUNT];
+static struct cloud_data_modem_dynamic modem_dyn_items[CONFIG_DATA_MODEM_DYNAMIC_BUFFER_COUNT];
+
+#if !defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+static struct cloud_data_gnss_ringbuffer gnss_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(gnss_items);
+#endif
+static struct cloud_data_sensors_ringbuffer sensors_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(sensors_items);
+static struct cloud_data_ui_ringbuffer ui_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(ui_items);
+static struct cloud_data_impact_ringbuffer impact_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(impact_items);
+static struct cloud_data_battery_ringbuffer bat_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(bat_items);
+static struct cloud_data_modem_dynamic_ringbuffer modem_dyn_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(modem_dyn_items);
+
+#if defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+/* Compressed GNSS track. GNSS data is buffered here instead of in a ringbuffer, and decoded
+ * when batch data is encoded.
+ */
+static struct cloud_codec_gnss_track_block gnss_track_blocks[CONFIG_DATA_GNSS_TRACK_BLOCK_COUNT];
+static struct cloud_codec_gnss_track gnss_track =
+	CLOUD_CODEC_GNSS_TRACK_INITIALIZER(gnss_track_blocks);
+#endif
 static struct cloud_data_cloud_location cloud_location;
 
 /* Static modem data does not change between firmware versions and does not
@@ -73,13 +107,29 @@ static struct cloud_data_modem_static modem_stat;
  */
 #define MODEM_STATIC_ARRAY_SIZE 1
 
-/* Head of ringbuffers. */
-static int head_gnss_buf;
-static int head_sensor_buf;
-static int head_modem_dyn_buf;
-static int head_ui_buf;
-static int head_impact_buf;
-static int head_bat_buf;
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+/* Set if the persistent sample store is available. All data added to the ringbuffers is then
+ * also stored in flash, and batch messages are encoded from the store.
+ */
+static bool sample_storage_ready;
+#endif
+
+/* Append a sample that has been added to a ringbuffer to the persistent sample store. */
+static void sample_store(enum cloud_codec_storage_type type, const void *data)
+{
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+	int err;
+
+	if (!sample_storage_ready) {
+		return;
+	}
+
+	err = cloud_codec_storage_append(type, data);
+	if (err) {
+		LOG_WRN("cloud_codec_storage_append, error: %d", err);
+	}
+#endif
+}
 
 static K_SEM_DEFINE(config_load_sem, 0, 1);
 
@@ -95,7 +145,8 @@ static struct cloud_data_cfg current_cfg = {
 	.accelerometer_inactivity_timeout	= CONFIG_DATA_ACCELEROMETER_INACT_TIMEOUT_SECONDS,
 	.no_data.gnss		 = !IS_ENABLED(CONFIG_DATA_SAMPLE_GNSS_DEFAULT),
 	.no_data.neighbor_cell	 = !IS_ENABLED(CONFIG_DATA_SAMPLE_NEIGHBOR_CELLS_DEFAULT),
-	.no_data.wifi		 = !IS_ENABLED(CONFIG_DATA_SAMPLE_WIFI_DEFAULT)
+	.no_data.wifi		 = !IS_ENABLED(CONFIG_DATA_SAMPLE_WIFI_DEFAULT),
+	.send_policy		 = CONFIG_DATA_SEND_POLICY_DEFAULT
 };
 
 static struct k_work_delayable data_send_work;
@@ -125,12 +176,36 @@ enum coneval_supported_data_type {
 	COUNT,
 };
 
+#if defined(CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY)
+/* Send policy parameters, indexed by coneval_supported_data_type. Cloud location data carries
+ * neighbor cell measurements.
+ */
+static const struct send_policy_type_cfg send_policy_types[COUNT] = {
+	[GENERIC] = {
+		.energy_min = CONFIG_DATA_GENERIC_UPDATES_ENERGY_MIN,
+		.percentile = CONFIG_DATA_GENERIC_UPDATES_SEND_PERCENTILE,
+		.defer_max = CONFIG_DATA_SEND_ATTEMPTS_COUNT_MAX,
+	},
+	[BATCH] = {
+		.energy_min = CONFIG_DATA_BATCH_UPDATES_ENERGY_MIN,
+		.percentile = CONFIG_DATA_BATCH_UPDATES_SEND_PERCENTILE,
+		.defer_max = CONFIG_DATA_SEND_ATTEMPTS_COUNT_MAX,
+	},
+	[CLOUD_LOCATION] = {
+		.energy_min = CONFIG_DATA_NEIGHBOR_CELL_UPDATES_ENERGY_MIN,
+		.percentile = CONFIG_DATA_NEIGHBOR_CELL_UPDATES_SEND_PERCENTILE,
+		.defer_max = CONFIG_DATA_SEND_ATTEMPTS_COUNT_MAX,
+	},
+};
+
+static struct send_policy send_policy;
+#endif /* CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY */
+
 /* Data module message queue. */
-#define DATA_QUEUE_ENTRY_COUNT		10
-#define DATA_QUEUE_BYTE_ALIGNMENT	4
+#define DATA_QUEUE_ENTRY_COUNT		CONFIG_DATA_QUEUE_ENTRY_COUNT
+#define DATA_QUEUE_TELEMETRY_ENTRY_COUNT	CONFIG_DATA_QUEUE_TELEMETRY_ENTRY_COUNT
 
-K_MSGQ_DEFINE(msgq_data, sizeof(struct data_msg_data),
-	      DATA_QUEUE_ENTRY_COUNT, DATA_QUEUE_BYTE_ALIGNMENT);
+MODULE_QUEUE_DEFINE(msgq_data, DATA_QUEUE_ENTRY_COUNT, DATA_QUEUE_TELEMETRY_ENTRY_COUNT);
 
 static struct module_data self = {
 	.name = "data",
@@ -140,6 +215,17 @@ static struct module_data self = {
 
 /* Forward declarations */
 static void data_send_work_fn(struct k_work *work);
+/* Apply a new send policy mode. Returns false if the mode is not supported. */
+static bool send_policy_set(int mode)
+{
+#if defined(CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY)
+	return send_policy_mode_set(&send_policy, mode) == 0;
+#else
+	/* The send policy is not applied, the mode is only stored. */
+	return mode >= 0;
+#endif /* CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY */
+}
+
 static int config_settings_handler(const char *key, size_t len,
 				   settings_read_cb read_cb, void *cb_arg);
 static void new_config_handle(struct cloud_data_cfg *new_config);
@@ -175,177 +261,40 @@ static void state_set(enum state_type new_state)
 		state2str(new_state));
 
 	state = new_state;
+	event_trace_state(EVENT_TRACE_STATE, self.name, new_state);
 }
 
 /* Handlers */
 static bool app_event_handler(const struct app_event_header *aeh)
 {
-	struct data_msg_data msg = {0};
-	bool enqueue_msg = false;
-
-	if (is_modem_module_event(aeh)) {
-		struct modem_module_event *event = cast_modem_module_event(aeh);
-
-		msg.module.modem = *event;
-		enqueue_msg = true;
-	}
-
-	if (is_cloud_module_event(aeh)) {
-		struct cloud_module_event *event = cast_cloud_module_event(aeh);
-
-		msg.module.cloud = *event;
-		enqueue_msg = true;
-	}
-
-	if (is_location_module_event(aeh)) {
-		struct location_module_event *event = cast_location_module_event(aeh);
-
-		msg.module.location = *event;
-		enqueue_msg = true;
-	}
-
-	if (is_sensor_module_event(aeh)) {
-		struct sensor_module_event *event =
-				cast_sensor_module_event(aeh);
-
-		msg.module.sensor = *event;
-		enqueue_msg = true;
-	}
-
-	if (is_ui_module_event(aeh)) {
-		struct ui_module_event *event = cast_ui_module_event(aeh);
-
-		msg.module.ui = *event;
-		enqueue_msg = true;
-	}
-
-	if (is_app_module_event(aeh)) {
-		struct app_module_event *event = cast_app_module_event(aeh);
-
-		msg.module.app = *event;
-		enqueue_msg = true;
-	}
-
-	if (is_data_module_event(aeh)) {
-		struct data_module_event *event = cast_data_module_event(aeh);
-
-		msg.module.data = *event;
-		enqueue_msg = true;
-	}
-
-	if (is_util_module_event(aeh)) {
-		struct util_module_event *event = cast_util_module_event(aeh);
-
-		msg.module.util = *event;
-		enqueue_msg = true;
-	}
+	bool enqueue_msg = is_modem_module_event(aeh) ||
+			   is_cloud_module_event(aeh) ||
+			   is_location_module_event(aeh) ||
+			   is_sensor_module_event(aeh) ||
+			   is_ui_module_event(aeh) ||
+			   is_app_module_event(aeh) ||
+			   is_data_module_event(aeh) ||
+			   is_util_module_event(aeh);
 
 	if (enqueue_msg) {
-		int err = module_enqueue_msg(&self, &msg);
-
-		if (err) {
-			LOG_ERR("Message could not be enqueued");
-			SEND_ERROR(data, DATA_EVT_ERROR, err);
-		}
+		module_enqueue_msg(&self, aeh);
 	}
 
 	return false;
 }
 
-static bool grant_send(enum coneval_supported_data_type type,
-		       struct lte_lc_conn_eval_params *coneval,
-		       bool override)
+static bool grant_send(enum coneval_supported_data_type type, bool override)
 {
 #if defined(CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY)
-	/* List used to keep track of how many times a data type has been denied a send.
-	 * Indexed by coneval_supported_data_type.
-	 */
-	static uint8_t send_denied_count[COUNT];
-
 	if (override) {
 		/* The override flag is set, grant send. */
 		return true;
 	}
 
-	if (send_denied_count[type] >= CONFIG_DATA_SEND_ATTEMPTS_COUNT_MAX) {
-		/* Grant send if a message has been attempted too many times. */
-		LOG_WRN("Too many attempts, granting send");
-		goto grant;
-	}
-
-	LOG_DBG("Current LTE energy estimate: %d", coneval->energy_estimate);
-
-	switch (type) {
-	case GENERIC:
-		if (IS_ENABLED(CONFIG_DATA_GENERIC_UPDATES_ENERGY_THRESHOLD_EXCESSIVE) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_GENERIC_UPDATES_ENERGY_THRESHOLD_INCREASED) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_INCREASED) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_GENERIC_UPDATES_ENERGY_THRESHOLD_NORMAL) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_NORMAL) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_GENERIC_UPDATES_ENERGY_THRESHOLD_REDUCED) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_REDUCED) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_GENERIC_UPDATES_ENERGY_THRESHOLD_EFFICIENT) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_EFFICIENT) {
-			goto grant;
-		}
-		break;
-	case NEIGHBOR_CELLS:
-		if (IS_ENABLED(CONFIG_DATA_NEIGHBOR_CELL_UPDATES_ENERGY_THRESHOLD_EXCESSIVE) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_NEIGHBOR_CELL_UPDATES_ENERGY_THRESHOLD_INCREASED)
-			   && coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_INCREASED) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_NEIGHBOR_CELL_UPDATES_ENERGY_THRESHOLD_NORMAL) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_NORMAL) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_NEIGHBOR_CELL_UPDATES_ENERGY_THRESHOLD_REDUCED) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_REDUCED) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_NEIGHBOR_CELL_UPDATES_ENERGY_THRESHOLD_EFFICIENT)
-			   && coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_EFFICIENT) {
-			goto grant;
-		}
-		break;
-	case BATCH:
-		if (IS_ENABLED(CONFIG_DATA_BATCH_UPDATES_ENERGY_THRESHOLD_EXCESSIVE) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_BATCH_UPDATES_ENERGY_THRESHOLD_INCREASED) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_INCREASED) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_BATCH_UPDATES_ENERGY_THRESHOLD_NORMAL) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_NORMAL) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_BATCH_UPDATES_ENERGY_THRESHOLD_REDUCED) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_REDUCED) {
-			goto grant;
-		} else if (IS_ENABLED(CONFIG_DATA_BATCH_UPDATES_ENERGY_THRESHOLD_EFFICIENT) &&
-		    coneval->energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_EFFICIENT) {
-			goto grant;
-		}
-		break;
-	default:
-		LOG_WRN("Invalid/unsupported data type: %d", type);
-		return false;
-	}
-
-	LOG_DBG("Send NOT granted, type: %d, energy estimate: %d, attempt: %d", type,
-		coneval->energy_estimate, send_denied_count[type]);
-	send_denied_count[type]++;
-	return false;
-
-grant:
-	LOG_DBG("Send granted, type: %d, energy estimate: %d, attempt: %d",
-		type, coneval->energy_estimate, send_denied_count[type]);
-	send_denied_count[type] = 0;
-#endif /* CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY */
+	return send_policy_grant(&send_policy, type);
+#else
 	return true;
+#endif /* CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY */
 }
 
 static int config_settings_handler(const char *key, size_t len,
@@ -439,12 +388,41 @@ static int setup(void)
 		LOG_DBG("Failed retrieveing the device configuration from flash in time");
 	}
 
+#if defined(CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY)
+	err = send_policy_init(&send_policy, current_cfg.send_policy, send_policy_types, COUNT);
+	if (err) {
+		LOG_WRN("Stored send policy not supported: %d, using default",
+			current_cfg.send_policy);
+
+		current_cfg.send_policy = CONFIG_DATA_SEND_POLICY_DEFAULT;
+
+		err = send_policy_init(&send_policy, current_cfg.send_policy, send_policy_types,
+				       COUNT);
+		if (err) {
+			LOG_ERR("send_policy_init, error: %d", err);
+			return err;
+		}
+	}
+#endif
+
 	err = cloud_codec_init(&current_cfg, cloud_codec_event_handler);
 	if (err) {
 		LOG_ERR("cloud_codec_init, error: %d", err);
 		return err;
 	}
 
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+	err = cloud_codec_storage_init();
+	if (err) {
+		/* Not critical, batch data is sent from the ringbuffers instead. */
+		LOG_ERR("cloud_codec_storage_init, error: %d", err);
+	} else {
+		sample_storage_ready = true;
+		LOG_DBG("%d unsent samples in persistent sample store",
+			cloud_codec_storage_pending_count());
+	}
+#endif
+
 	date_time_register_handler(date_time_event_handler);
 	return 0;
 }
@@ -485,6 +463,8 @@ static void config_print_all(void)
 	} else {
 		LOG_DBG("Requesting of Wi-Fi data is disabled");
 	}
+
+	LOG_DBG("Send policy: %d", current_cfg.send_policy);
 }
 
 static void config_distribute(enum data_module_event_type type)
@@ -500,7 +480,8 @@ static void config_distribute(enum data_module_event_type type)
 }
 
 static void data_send(enum data_module_event_type event,
-		      struct cloud_codec_data *data)
+		      struct cloud_codec_data *data,
+		      uint32_t ack_id)
 {
 	struct data_module_event *module_event = new_data_module_event();
 
@@ -521,12 +502,256 @@ static void data_send(enum data_module_event_type event,
 		module_event->data.buffer.len = data->len;
 	}
 
+	module_event->data.buffer.ack_id = ack_id;
+
 	APP_EVENT_SUBMIT(module_event);
 
 	/* Reset buffer */
 	memset(data, 0, sizeof(struct cloud_codec_data));
 }
 
+static void batch_send(struct cloud_codec_data *data, uint32_t ack_id)
+{
+	int err;
+
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_COMPRESS)) {
+		/* The batch message is sent uncompressed if compression fails. */
+		err = cloud_codec_compress(data);
+		if (err && (err != -EMSGSIZE)) {
+			LOG_WRN("cloud_codec_compress, error: %d", err);
+		}
+	}
+
+	data_send(DATA_EVT_DATA_SEND_BATCH, data, ack_id);
+}
+
+/* Returns the newest GNSS entry, from the compressed GNSS track if it is used. */
+static struct cloud_data_gnss *gnss_newest(void)
+{
+#if defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+	return cloud_codec_gnss_track_newest(&gnss_track);
+#else
+	return cloud_data_gnss_ringbuffer_newest(&gnss_buf);
+#endif
+}
+
+static bool buffers_empty(void)
+{
+#if defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+	bool gnss_empty = (cloud_codec_gnss_track_count(&gnss_track) == 0);
+#else
+	bool gnss_empty = (cloud_data_gnss_ringbuffer_count(&gnss_buf) == 0);
+#endif
+
+	return gnss_empty &&
+	       (cloud_data_sensors_ringbuffer_count(&sensors_buf) == 0) &&
+	       (cloud_data_ui_ringbuffer_count(&ui_buf) == 0) &&
+	       (cloud_data_impact_ringbuffer_count(&impact_buf) == 0) &&
+	       (cloud_data_battery_ringbuffer_count(&bat_buf) == 0) &&
+	       (cloud_data_modem_dynamic_ringbuffer_count(&modem_dyn_buf) == 0);
+}
+
+/* Release the GNSS entries that have been encoded, oldest first. */
+static void gnss_commit_dequeued(const struct cloud_data_gnss *gnss, size_t count)
+{
+#if defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+	size_t dequeued = 0;
+
+	/* The entries are decoded copies, the codec has only cleared their queued flags. */
+	while ((dequeued < count) && !gnss[dequeued].queued) {
+		dequeued++;
+	}
+
+	cloud_codec_gnss_track_release(&gnss_track, dequeued);
+#else
+	ARG_UNUSED(gnss);
+
+	cloud_data_gnss_ringbuffer_commit_dequeued(&gnss_buf, count);
+#endif
+}
+
+/* Batch-encode the live entries of each ringbuffer, oldest first. The codec may encode fewer
+ * entries to bound the message size. Encoded entries are released from the ringbuffers.
+ */
+static int batch_encode(struct cloud_codec_data *codec)
+{
+	int err;
+	struct cloud_data_gnss *gnss;
+	struct cloud_data_sensors *sensors;
+	struct cloud_data_ui *ui;
+	struct cloud_data_impact *impact;
+	struct cloud_data_battery *bat;
+	struct cloud_data_modem_dynamic *modem_dyn;
+	size_t gnss_count;
+	size_t sensors_count = cloud_data_sensors_ringbuffer_peek(&sensors_buf, SIZE_MAX,
+								  &sensors);
+	size_t ui_count = cloud_data_ui_ringbuffer_peek(&ui_buf, SIZE_MAX, &ui);
+	size_t impact_count = cloud_data_impact_ringbuffer_peek(&impact_buf, SIZE_MAX, &impact);
+	size_t bat_count = cloud_data_battery_ringbuffer_peek(&bat_buf, SIZE_MAX, &bat);
+	size_t modem_dyn_count = cloud_data_modem_dynamic_ringbuffer_peek(&modem_dyn_buf,
+									  SIZE_MAX, &modem_dyn);
+
+#if defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+	/* Fixes are decoded from the compressed GNSS track into a buffer that is only allocated
+	 * while the message is encoded.
+	 */
+	gnss = k_malloc(CONFIG_DATA_GNSS_BUFFER_COUNT * sizeof(struct cloud_data_gnss));
+	if (gnss == NULL) {
+		return -ENOMEM;
+	}
+
+	gnss_count = cloud_codec_gnss_track_peek(&gnss_track, gnss, CONFIG_DATA_GNSS_BUFFER_COUNT);
+#else
+	gnss_count = cloud_data_gnss_ringbuffer_peek(&gnss_buf, SIZE_MAX, &gnss);
+#endif
+
+	err = cloud_codec_encode_batch_data(codec,
+					    gnss,
+					    sensors,
+					    &modem_stat,
+					    modem_dyn,
+					    ui,
+					    impact,
+					    bat,
+					    gnss_count,
+					    sensors_count,
+					    MODEM_STATIC_ARRAY_SIZE,
+					    modem_dyn_count,
+					    ui_count,
+					    impact_count,
+					    bat_count);
+	if ((err == 0) || (err == -ENODATA)) {
+		/* Entries that were not queued have already been sent outside of a batch. Entries
+		 * that did not fit in the message are still queued and are encoded in the next one.
+		 */
+		gnss_commit_dequeued(gnss, gnss_count);
+		cloud_data_sensors_ringbuffer_commit_dequeued(&sensors_buf, sensors_count);
+		cloud_data_ui_ringbuffer_commit_dequeued(&ui_buf, ui_count);
+		cloud_data_impact_ringbuffer_commit_dequeued(&impact_buf, impact_count);
+		cloud_data_battery_ringbuffer_commit_dequeued(&bat_buf, bat_count);
+		cloud_data_modem_dynamic_ringbuffer_commit_dequeued(&modem_dyn_buf,
+								    modem_dyn_count);
+	}
+
+#if defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+	k_free(gnss);
+#endif
+
+	return err;
+}
+
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+/* Returns a bitmask of the sample types where the newest ringbuffer entry is queued. */
+static uint32_t heads_queued_get(void)
+{
+	uint32_t queued = 0;
+
+	queued |= gnss_newest()->queued ? BIT(CLOUD_CODEC_STORAGE_GNSS) : 0;
+	queued |= cloud_data_sensors_ringbuffer_newest(&sensors_buf)->queued ?
+		  BIT(CLOUD_CODEC_STORAGE_SENSOR) : 0;
+	queued |= cloud_data_ui_ringbuffer_newest(&ui_buf)->queued ?
+		  BIT(CLOUD_CODEC_STORAGE_UI) : 0;
+	queued |= cloud_data_impact_ringbuffer_newest(&impact_buf)->queued ?
+		  BIT(CLOUD_CODEC_STORAGE_IMPACT) : 0;
+	queued |= cloud_data_battery_ringbuffer_newest(&bat_buf)->queued ?
+		  BIT(CLOUD_CODEC_STORAGE_BATTERY) : 0;
+	queued |= cloud_data_modem_dynamic_ringbuffer_newest(&modem_dyn_buf)->queued ?
+		  BIT(CLOUD_CODEC_STORAGE_MODEM_DYNAMIC) : 0;
+
+	return queued;
+}
+
+/* Newest entries that have been encoded outside of a batch message are also in the persistent
+ * sample store. Mark them as sent so that they are not included in a batch message later.
+ */
+static void heads_mark_sent(uint32_t queued_before)
+{
+	uint32_t sent;
+
+	if (!sample_storage_ready) {
+		return;
+	}
+
+	sent = queued_before & ~heads_queued_get();
+
+	for (int i = 0; i < CLOUD_CODEC_STORAGE_TYPE_COUNT; i++) {
+		if (sent & BIT(i)) {
+			cloud_codec_storage_mark_sent(i);
+		}
+	}
+}
+
+/* Encode batch messages from the persistent sample store, oldest samples first. The ringbuffers
+ * are used as page buffers. They are cleared afterwards, everything in them is also in the store.
+ */
+static void data_encode_stored_batch(void)
+{
+	int err;
+	struct cloud_codec_data codec = { 0 };
+	struct cloud_codec_storage_page page = {
+		.gnss_buf = &gnss_buf,
+		.sensor_buf = &sensors_buf,
+		.ui_buf = &ui_buf,
+		.impact_buf = &impact_buf,
+		.bat_buf = &bat_buf,
+		.modem_dyn_buf = &modem_dyn_buf,
+	};
+
+	for (int i = 0; i < CONFIG_CLOUD_CODEC_STORAGE_PAGES_MAX; i++) {
+		uint32_t page_id;
+		uint32_t messages = 0;
+
+		err = cloud_codec_storage_page_out(&page, &page_id);
+		if (err == -ENODATA) {
+			LOG_DBG("No batch data to encode, persistent sample store is empty");
+			break;
+		} else if (err == -EBUSY) {
+			LOG_DBG("Waiting for stored batch data to be acknowledged");
+			break;
+		} else if (err < 0) {
+			LOG_ERR("cloud_codec_storage_page_out, error: %d", err);
+			SEND_ERROR(data, DATA_EVT_ERROR, err);
+			break;
+		}
+
+		/* A page that does not fit in one batch message is sent in several. The samples are
+		 * removed from the store when cloud has acknowledged all of them.
+		 */
+		do {
+			err = batch_encode(&codec);
+			if (err == 0) {
+				LOG_DBG("Stored batch data encoded successfully");
+				batch_send(&codec, page_id);
+				messages++;
+			}
+		} while ((err == 0) && !buffers_empty());
+
+		if ((err != 0) && (err != -ENODATA)) {
+			/* Samples are kept in the store and retried on the next update. Messages
+			 * that were already sent are acknowledged to a page that no longer exists.
+			 */
+			LOG_ERR("Error batch-enconding stored data: %d", err);
+			SEND_ERROR(data, DATA_EVT_ERROR, err);
+			cloud_codec_storage_page_abort(page_id);
+			break;
+		}
+
+		err = cloud_codec_storage_page_sent(page_id, messages);
+		if (err) {
+			LOG_ERR("cloud_codec_storage_page_sent, error: %d", err);
+			break;
+		}
+	}
+
+	cloud_data_gnss_ringbuffer_reset(&gnss_buf);
+	cloud_data_sensors_ringbuffer_reset(&sensors_buf);
+	cloud_data_ui_ringbuffer_reset(&ui_buf);
+	cloud_data_impact_ringbuffer_reset(&impact_buf);
+	cloud_data_battery_ringbuffer_reset(&bat_buf);
+	cloud_data_modem_dynamic_ringbuffer_reset(&modem_dyn_buf);
+}
+#endif /* CONFIG_CLOUD_CODEC_STORAGE */
+
 /* This function allocates buffer on the heap, which needs to be freed after use. */
 static void data_encode(void)
 {
@@ -564,15 +789,21 @@ static void data_encode(void)
 		 * grant encoding and sending of data.
 		 */
 		override = true;
+	} else {
+		err = send_policy_conn_eval_add(&send_policy, &coneval);
+		if (err) {
+			LOG_WRN("Connection evaluation not used, error: %d", err);
+			override = true;
+		}
 	}
 #endif
 
-	if (grant_send(CLOUD_LOCATION, &coneval, override)) {
+	if (grant_send(CLOUD_LOCATION, override)) {
 		err = cloud_codec_encode_cloud_location(&codec, &cloud_location);
 		switch (err) {
 		case 0:
 			LOG_DBG("Cloud location data encoded successfully");
-			data_send(DATA_EVT_CLOUD_LOCATION_DATA_SEND, &codec);
+			data_send(DATA_EVT_CLOUD_LOCATION_DATA_SEND, &codec, 0);
 			break;
 		case -ENOTSUP:
 			/* Cloud location data encoding not supported */
@@ -587,19 +818,32 @@ static void data_encode(void)
 		}
 	}
 
-	if (grant_send(GENERIC, &coneval, override)) {
+	if (grant_send(GENERIC, override)) {
+		uint32_t shadow_id;
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+		uint32_t queued_before = heads_queued_get();
+#endif
+
 		err = cloud_codec_encode_data(&codec,
-					      &gnss_buf[head_gnss_buf],
-					      &sensors_buf[head_sensor_buf],
-					      &modem_stat,
-					      &modem_dyn_buf[head_modem_dyn_buf],
-					      &ui_buf[head_ui_buf],
-					      &impact_buf[head_impact_buf],
-					      &bat_buf[head_bat_buf]);
+				gnss_newest(),
+				cloud_data_sensors_ringbuffer_newest(&sensors_buf),
+				&modem_stat,
+				cloud_data_modem_dynamic_ringbuffer_newest(&modem_dyn_buf),
+				cloud_data_ui_ringbuffer_newest(&ui_buf),
+				cloud_data_impact_ringbuffer_newest(&impact_buf),
+				cloud_data_battery_ringbuffer_newest(&bat_buf));
+
+		/* The modem data is marked as reported when cloud acknowledges the message. */
+		shadow_id = cloud_codec_shadow_update_done(err == 0);
+
 		switch (err) {
 		case 0:
 			LOG_DBG("Data encoded successfully");
-			data_send(DATA_EVT_DATA_SEND, &codec);
+			data_send(DATA_EVT_DATA_SEND, &codec,
+				  shadow_id ? (shadow_id | DATA_ACK_ID_SHADOW) : 0);
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+			heads_mark_sent(queued_before);
+#endif
 			break;
 		case -ENODATA:
 			/* This error might occur when data has not been obtained prior
@@ -617,38 +861,41 @@ static void data_encode(void)
 		}
 	}
 
-	if (grant_send(BATCH, &coneval, override)) {
-		err = cloud_codec_encode_batch_data(&codec,
-						    gnss_buf,
-						    sensors_buf,
-						    &modem_stat,
-						    modem_dyn_buf,
-						    ui_buf,
-						    impact_buf,
-						    bat_buf,
-						    ARRAY_SIZE(gnss_buf),
-						    ARRAY_SIZE(sensors_buf),
-						    MODEM_STATIC_ARRAY_SIZE,
-						    ARRAY_SIZE(modem_dyn_buf),
-						    ARRAY_SIZE(ui_buf),
-						    ARRAY_SIZE(impact_buf),
-						    ARRAY_SIZE(bat_buf));
-		switch (err) {
-		case 0:
-			LOG_DBG("Batch data encoded successfully");
-			data_send(DATA_EVT_DATA_SEND_BATCH, &codec);
-			break;
-		case -ENODATA:
-			LOG_DBG("No batch data to encode, ringbuffers are empty");
-			break;
-		case -ENOTSUP:
-			LOG_DBG("Encoding of batch data not supported");
-			break;
-		default:
-			LOG_ERR("Error batch-enconding data: %d", err);
-			SEND_ERROR(data, DATA_EVT_ERROR, err);
+	if (grant_send(BATCH, override)) {
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+		if (sample_storage_ready) {
+			data_encode_stored_batch();
 			return;
 		}
+#endif
+
+		/* Entries that do not fit in the maximum message size, and GNSS fixes beyond
+		 * CONFIG_DATA_GNSS_BUFFER_COUNT with the compressed GNSS track, are sent in
+		 * additional batch messages.
+		 */
+		do {
+			err = batch_encode(&codec);
+			switch (err) {
+			case 0:
+				LOG_DBG("Batch data encoded successfully");
+				batch_send(&codec, 0);
+				break;
+			case -ENODATA:
+				LOG_DBG("No batch data to encode, ringbuffers are empty");
+				break;
+			case -ENOTSUP:
+				LOG_DBG("Encoding of batch data not supported");
+				return;
+			case -ENOBUFS:
+				/* The codec buffers batch data until it has been sent. */
+				LOG_DBG("Batch data buffers full, remaining data is sent later");
+				return;
+			default:
+				LOG_ERR("Error batch-enconding data: %d", err);
+				SEND_ERROR(data, DATA_EVT_ERROR, err);
+				return;
+			}
+		} while (!buffers_empty());
 	}
 }
 
@@ -672,7 +919,55 @@ static void config_send(void)
 		return;
 	}
 
-	data_send(DATA_EVT_CONFIG_SEND, &codec);
+	data_send(DATA_EVT_CONFIG_SEND, &codec, 0);
+}
+
+/* Handle the acknowledgment of a message sent with an acknowledgment ID. Shadow updates are
+ * marked as reported, stored samples are removed when all batch messages they were sent in
+ * have been acknowledged.
+ */
+static void data_ack_handle(uint32_t ack_id)
+{
+	int err;
+
+	if (ack_id & DATA_ACK_ID_SHADOW) {
+		err = cloud_codec_shadow_update_ack(ack_id & ~DATA_ACK_ID_SHADOW);
+		if (err) {
+			LOG_DBG("Acknowledged shadow update is no longer pending");
+		}
+
+		return;
+	}
+
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+	if (!sample_storage_ready) {
+		return;
+	}
+
+	err = cloud_codec_storage_ack(ack_id);
+	if (err == -ENOENT) {
+		LOG_DBG("Acknowledged page %d is no longer pending", ack_id);
+	} else if (err) {
+		LOG_ERR("cloud_codec_storage_ack, error: %d", err);
+	}
+#endif /* CONFIG_CLOUD_CODEC_STORAGE */
+}
+
+/* Report all modem data fields to the device shadow in the next data message. Static modem data
+ * is only sampled once, it is therefore queued again, timestamped with the current uptime.
+ */
+static void shadow_refresh(void)
+{
+	if (!IS_ENABLED(CONFIG_CLOUD_CODEC_SHADOW_DELTA)) {
+		return;
+	}
+
+	cloud_codec_shadow_refresh();
+
+	if (strlen(modem_stat.imei) > 0) {
+		modem_stat.ts = k_uptime_get();
+		modem_stat.queued = true;
+	}
 }
 
 static void data_ui_send(void)
@@ -688,7 +983,11 @@ static void data_ui_send(void)
 		return;
 	}
 
-	err = cloud_codec_encode_ui_data(&codec, &ui_buf[head_ui_buf]);
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+	uint32_t queued_before = heads_queued_get();
+#endif
+
+	err = cloud_codec_encode_ui_data(&codec, cloud_data_ui_ringbuffer_newest(&ui_buf));
 	if (err == -ENODATA) {
 		LOG_DBG("No new UI data to encode, error: %d", err);
 		return;
@@ -701,7 +1000,10 @@ static void data_ui_send(void)
 		return;
 	}
 
-	data_send(DATA_EVT_UI_DATA_SEND, &codec);
+	data_send(DATA_EVT_UI_DATA_SEND, &codec, 0);
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+	heads_mark_sent(queued_before);
+#endif
 }
 
 static void data_impact_send(void)
@@ -713,7 +1015,12 @@ static void data_impact_send(void)
 		return;
 	}
 
-	err = cloud_codec_encode_impact_data(&codec, &impact_buf[head_impact_buf]);
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+	uint32_t queued_before = heads_queued_get();
+#endif
+
+	err = cloud_codec_encode_impact_data(&codec,
+					     cloud_data_impact_ringbuffer_newest(&impact_buf));
 	if (err == -ENODATA) {
 		LOG_DBG("No new impact data to encode, error: %d", err);
 		return;
@@ -726,7 +1033,10 @@ static void data_impact_send(void)
 		return;
 	}
 
-	data_send(DATA_EVT_IMPACT_DATA_SEND, &codec);
+	data_send(DATA_EVT_IMPACT_DATA_SEND, &codec, 0);
+#if defined(CONFIG_CLOUD_CODEC_STORAGE)
+	heads_mark_sent(queued_before);
+#endif
 }
 
 static void requested_data_clear(void)
@@ -914,6 +1224,18 @@ static void new_config_handle(struct cloud_data_cfg *new_config)
 		config_change = true;
 	}
 
+	if (current_cfg.send_policy != new_config->send_policy) {
+		if (send_policy_set(new_config->send_policy)) {
+			current_cfg.send_policy = new_config->send_policy;
+
+			LOG_DBG("New Send policy: %d", current_cfg.send_policy);
+
+			config_change = true;
+		} else {
+			LOG_WRN("New Send policy out of range: %d", new_config->send_policy);
+		}
+	}
+
 	/* If there has been a change in the currently applied device configuration we want to store
 	 * the configuration to flash and distribute it to other modules.
 	 */
@@ -947,6 +1269,8 @@ static void new_config_handle(struct cloud_data_cfg *new_config)
 static void on_cloud_state_disconnected(struct data_msg_data *msg)
 {
 	if (IS_EVENT(msg, cloud, CLOUD_EVT_CONNECTED)) {
+		/* The shadow may have been changed while the device was disconnected. */
+		shadow_refresh();
 		state_set(STATE_CLOUD_CONNECTED);
 		return;
 	}
@@ -986,6 +1310,7 @@ static void on_cloud_state_connected(struct data_msg_data *msg)
 	}
 
 	if (IS_EVENT(msg, cloud, CLOUD_EVT_CONFIG_EMPTY)) {
+		shadow_refresh();
 		config_send();
 		return;
 	}
@@ -1018,13 +1343,21 @@ static void on_all_states(struct data_msg_data *msg)
 			.no_data.neighbor_cell =
 				msg->module.cloud.data.config.no_data.neighbor_cell,
 			.no_data.wifi =
-				msg->module.cloud.data.config.no_data.wifi
+				msg->module.cloud.data.config.no_data.wifi,
+			.send_policy =
+				msg->module.cloud.data.config.send_policy
 		};
 
 		new_config_handle(&new);
 		return;
 	}
 
+	/* The data module is the only sender of messages with an acknowledgment ID. */
+	if (IS_EVENT(msg, cloud, CLOUD_EVT_DATA_ACK)) {
+		data_ack_handle(msg->module.cloud.data.ack.id);
+		return;
+	}
+
 	if (IS_EVENT(msg, app, APP_EVT_START)) {
 		config_print_all();
 		config_distribute(DATA_EVT_CONFIG_INIT);
@@ -1061,9 +1394,10 @@ static void on_all_states(struct data_msg_data *msg)
 			.queued = true
 		};
 
-		cloud_codec_populate_ui_buffer(ui_buf, &new_ui_data,
-					       &head_ui_buf,
-					       ARRAY_SIZE(ui_buf));
+		if (IS_ENABLED(CONFIG_DATA_UI_BUFFER_STORE)) {
+			cloud_data_ui_ringbuffer_put(&ui_buf, &new_ui_data);
+			sample_store(CLOUD_CODEC_STORAGE_UI, &new_ui_data);
+		}
 
 		SEND_EVENT(data, DATA_EVT_UI_DATA_READY);
 		return;
@@ -1131,11 +1465,10 @@ static void on_all_states(struct data_msg_data *msg)
 		strcpy(new_modem_data.apn, msg->module.modem.data.modem_dynamic.apn);
 		strcpy(new_modem_data.mccmnc, msg->module.modem.data.modem_dynamic.mccmnc);
 
-		cloud_codec_populate_modem_dynamic_buffer(
-						modem_dyn_buf,
-						&new_modem_data,
-						&head_modem_dyn_buf,
-						ARRAY_SIZE(modem_dyn_buf));
+		if (IS_ENABLED(CONFIG_DATA_DYNAMIC_MODEM_BUFFER_STORE)) {
+			cloud_data_modem_dynamic_ringbuffer_put(&modem_dyn_buf, &new_modem_data);
+			sample_store(CLOUD_CODEC_STORAGE_MODEM_DYNAMIC, &new_modem_data);
+		}
 
 		requested_data_status_set(APP_DATA_MODEM_DYNAMIC);
 	}
@@ -1144,6 +1477,14 @@ static void on_all_states(struct data_msg_data *msg)
 		requested_data_status_set(APP_DATA_BATTERY);
 	}
 
+#if defined(CONFIG_DATA_GRANT_SEND_ON_CONNECTION_QUALITY)
+	if (IS_EVENT(msg, modem, MODEM_EVT_LTE_RRC_IDLE)) {
+		/* Let the send policy learn how long the radio was on for the last send. */
+		send_policy_outcome_add(&send_policy,
+					msg->module.modem.data.rrc.connected_time_ms);
+	}
+#endif
+
 	if (IS_EVENT(msg, sensor, SENSOR_EVT_FUEL_GAUGE_READY)) {
 		struct cloud_data_battery new_battery_data = {
 			.bat = msg->module.sensor.data.bat.battery_level,
@@ -1151,9 +1492,10 @@ static void on_all_states(struct data_msg_data *msg)
 			.queued = true
 		};
 
-		cloud_codec_populate_bat_buffer(bat_buf, &new_battery_data,
-						&head_bat_buf,
-						ARRAY_SIZE(bat_buf));
+		if (IS_ENABLED(CONFIG_DATA_BATTERY_BUFFER_STORE)) {
+			cloud_data_battery_ringbuffer_put(&bat_buf, &new_battery_data);
+			sample_store(CLOUD_CODEC_STORAGE_BATTERY, &new_battery_data);
+		}
 
 		requested_data_status_set(APP_DATA_BATTERY);
 	}
@@ -1172,10 +1514,10 @@ static void on_all_states(struct data_msg_data *msg)
 			.queued = true
 		};
 
-		cloud_codec_populate_sensor_buffer(sensors_buf,
-						   &new_sensor_data,
-						   &head_sensor_buf,
-						   ARRAY_SIZE(sensors_buf));
+		if (IS_ENABLED(CONFIG_DATA_SENSOR_BUFFER_STORE)) {
+			cloud_data_sensors_ringbuffer_put(&sensors_buf, &new_sensor_data);
+			sample_store(CLOUD_CODEC_STORAGE_SENSOR, &new_sensor_data);
+		}
 
 		requested_data_status_set(APP_DATA_ENVIRONMENTAL);
 	}
@@ -1191,9 +1533,8 @@ static void on_all_states(struct data_msg_data *msg)
 			.queued = true
 		};
 
-		cloud_codec_populate_impact_buffer(impact_buf, &new_impact_data,
-						   &head_impact_buf,
-						   ARRAY_SIZE(impact_buf));
+		cloud_data_impact_ringbuffer_put(&impact_buf, &new_impact_data);
+		sample_store(CLOUD_CODEC_STORAGE_IMPACT, &new_impact_data);
 		SEND_EVENT(data, DATA_EVT_IMPACT_DATA_READY);
 		return;
 	}
@@ -1211,9 +1552,14 @@ static void on_all_states(struct data_msg_data *msg)
 		new_location_data.pvt.longi = msg->module.location.data.location.pvt.longitude;
 		new_location_data.pvt.spd = msg->module.location.data.location.pvt.speed;
 
-		cloud_codec_populate_gnss_buffer(gnss_buf, &new_location_data,
-						&head_gnss_buf,
-						ARRAY_SIZE(gnss_buf));
+		if (IS_ENABLED(CONFIG_DATA_GNSS_BUFFER_STORE)) {
+#if defined(CONFIG_CLOUD_CODEC_GNSS_TRACK)
+			cloud_codec_gnss_track_add(&gnss_track, &new_location_data);
+#else
+			cloud_data_gnss_ringbuffer_put(&gnss_buf, &new_location_data);
+#endif
+			sample_store(CLOUD_CODEC_STORAGE_GNSS, &new_location_data);
+		}
 
 		requested_data_status_set(APP_DATA_LOCATION);
 	}
@@ -1223,6 +1569,13 @@ static void on_all_states(struct data_msg_data *msg)
 	}
 
 	if (IS_EVENT(msg, location, LOCATION_MODULE_EVT_CLOUD_LOCATION_DATA_READY)) {
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+		if (msg->module.location.data.cloud_location.cached) {
+			/* Resolved from the cache in the location module, nothing to send. */
+			requested_data_status_set(APP_DATA_LOCATION);
+			return;
+		}
+#endif
 		cloud_location.neighbor_cells_valid = false;
 		cloud_location.neighbor_cells.queued = false;
 		if (msg->module.location.data.cloud_location.neighbor_cells_valid) {
@@ -1285,7 +1638,7 @@ static void on_all_states(struct data_msg_data *msg)
 static void module_thread_fn(void)
 {
 	int err;
-	struct data_msg_data msg = { 0 };
+	struct data_msg_data *msg;
 
 	self.thread_id = k_current_get();
 
@@ -1310,10 +1663,10 @@ static void module_thread_fn(void)
 
 		switch (state) {
 		case STATE_CLOUD_DISCONNECTED:
-			on_cloud_state_disconnected(&msg);
+			on_cloud_state_disconnected(msg);
 			break;
 		case STATE_CLOUD_CONNECTED:
-			on_cloud_state_connected(&msg);
+			on_cloud_state_connected(msg);
 			break;
 		case STATE_SHUTDOWN:
 			/* The shutdown state has no transition. */
@@ -1323,7 +1676,8 @@ static void module_thread_fn(void)
 			break;
 		}
 
-		on_all_states(&msg);
+		on_all_states(msg);
+		module_msg_release(&self, msg);
 	}
 }
 
@@ -20,6 +20,7 @@
 #include "watchdog_app.h"
 #endif /* CONFIG_WATCHDOG_APPLICATION */
 #include "modules_common.h"
+#include "events/event_pool.h"
 #include "events/app_module_event.h"
 #include "events/cloud_module_event.h"
 #include "events/data_module_event.h"
@@ -257,6 +258,30 @@ static void send_memfault_data(void)
 	}
 }
 
+static void add_rrc_metrics(const struct modem_module_rrc *rrc)
+{
+	int err;
+
+	err = MEMFAULT_METRIC_ADD(lte_rrc_connected_time_ms, rrc->connected_time_ms);
+	if (err) {
+		LOG_ERR("Failed updating lte_rrc_connected_time_ms metric, error: %d", err);
+	}
+
+	if (!rrc->release_requested) {
+		return;
+	}
+
+	err = MEMFAULT_METRIC_ADD(lte_rrc_release_count, 1);
+	if (err) {
+		LOG_ERR("Failed updating lte_rrc_release_count metric, error: %d", err);
+	}
+
+	err = MEMFAULT_METRIC_ADD(lte_rrc_release_saved_time_ms, rrc->saved_time_ms);
+	if (err) {
+		LOG_ERR("Failed updating lte_rrc_release_saved_time_ms metric, error: %d", err);
+	}
+}
+
 static void add_location_metrics(uint8_t satellites, uint32_t search_time,
 				 enum location_module_event_type event)
 {
@@ -289,6 +314,227 @@ static void add_location_metrics(uint8_t satellites, uint32_t search_time,
 	memfault_metrics_heartbeat_debug_trigger();
 }
 
+/* Number of connection attempts needed to connect to cloud, as a histogram, and the causes of
+ * the failed attempts.
+ */
+static void add_cloud_connect_metrics(const struct cloud_reconnect_summary *connection)
+{
+	int err;
+
+	if (connection->attempts == 0) {
+		return;
+	}
+
+	switch (cloud_reconnect_histogram_bucket(connection->attempts)) {
+	case 0:
+		err = MEMFAULT_METRIC_ADD(cloud_connect_attempts_1, 1);
+		break;
+	case 1:
+		err = MEMFAULT_METRIC_ADD(cloud_connect_attempts_2, 1);
+		break;
+	case 2:
+		err = MEMFAULT_METRIC_ADD(cloud_connect_attempts_3_to_4, 1);
+		break;
+	case 3:
+		err = MEMFAULT_METRIC_ADD(cloud_connect_attempts_5_to_8, 1);
+		break;
+	case 4:
+		err = MEMFAULT_METRIC_ADD(cloud_connect_attempts_9_to_16, 1);
+		break;
+	default:
+		err = MEMFAULT_METRIC_ADD(cloud_connect_attempts_over_16, 1);
+		break;
+	}
+
+	if (err) {
+		LOG_ERR("Failed updating cloud connection attempts metric, error: %d", err);
+	}
+
+	err = MEMFAULT_METRIC_ADD(cloud_connect_failure_timeout_count,
+				  connection->failures[CLOUD_RECONNECT_CAUSE_TIMEOUT]);
+	if (err) {
+		LOG_ERR("Failed updating cloud_connect_failure_timeout_count metric, error: %d",
+			err);
+	}
+
+	err = MEMFAULT_METRIC_ADD(cloud_connect_failure_network_count,
+				  connection->failures[CLOUD_RECONNECT_CAUSE_NETWORK]);
+	if (err) {
+		LOG_ERR("Failed updating cloud_connect_failure_network_count metric, error: %d",
+			err);
+	}
+
+	err = MEMFAULT_METRIC_ADD(cloud_connect_failure_dns_count,
+				  connection->failures[CLOUD_RECONNECT_CAUSE_DNS]);
+	if (err) {
+		LOG_ERR("Failed updating cloud_connect_failure_dns_count metric, error: %d", err);
+	}
+
+	err = MEMFAULT_METRIC_ADD(cloud_connect_failure_tls_count,
+				  connection->failures[CLOUD_RECONNECT_CAUSE_TLS]);
+	if (err) {
+		LOG_ERR("Failed updating cloud_connect_failure_tls_count metric, error: %d", err);
+	}
+
+	err = MEMFAULT_METRIC_ADD(cloud_connect_failure_rejected_count,
+				  connection->failures[CLOUD_RECONNECT_CAUSE_REJECTED]);
+	if (err) {
+		LOG_ERR("Failed updating cloud_connect_failure_rejected_count metric, error: %d",
+			err);
+	}
+}
+
+/* Count a connection handshake and its estimated size. The sum per day of
+ * cloud_connection_overhead_est_bytes is compared with and without CONFIG_CLOUD_KEEP_CONNECTION.
+ */
+static void add_cloud_handshake_metrics(void)
+{
+	int err;
+
+	err = MEMFAULT_METRIC_ADD(cloud_handshake_count, 1);
+	if (err) {
+		LOG_ERR("Failed updating cloud_handshake_count metric, error: %d", err);
+	}
+
+	err = MEMFAULT_METRIC_ADD(cloud_connection_overhead_est_bytes,
+				  CONFIG_DEBUG_MODULE_CLOUD_HANDSHAKE_BYTES);
+	if (err) {
+		LOG_ERR("Failed updating cloud overhead estimate metric, error: %d", err);
+	}
+}
+
+#if defined(CONFIG_CLOUD_MODULE)
+/* Report the keepalive pings acknowledged since the previous report and their estimated size.
+ * Pings are counted by the cloud module, which does not send an event for each ping.
+ */
+static void add_cloud_ping_metrics(void)
+{
+	static uint32_t reported_pings;
+	struct cloud_reconnect_stats stats;
+	uint32_t pings;
+	int err;
+
+	cloud_reconnect_stats_get(&stats);
+
+	pings = stats.pings - reported_pings;
+	if (pings == 0) {
+		return;
+	}
+
+	reported_pings = stats.pings;
+
+	err = MEMFAULT_METRIC_ADD(cloud_ping_count, pings);
+	if (err) {
+		LOG_ERR("Failed updating cloud_ping_count metric, error: %d", err);
+	}
+
+	err = MEMFAULT_METRIC_ADD(cloud_connection_overhead_est_bytes,
+				  pings * CONFIG_DEBUG_MODULE_CLOUD_PING_BYTES);
+	if (err) {
+		LOG_ERR("Failed updating cloud overhead estimate metric, error: %d", err);
+	}
+}
+#endif /* CONFIG_CLOUD_MODULE */
+
+#if defined(CONFIG_EVENT_POOL)
+/* Report the highest event pool utilization and the number of events that were allocated from
+ * the heap because their pool was exhausted, since the previous report.
+ */
+static void add_event_pool_metrics(void)
+{
+	static uint32_t reported_failures;
+	struct event_pool_stats stats;
+	uint32_t peak_pct = 0;
+	uint32_t failures = 0;
+	int err;
+
+	for (size_t i = 0; i < event_pool_count_get(); i++) {
+		(void)event_pool_stats_get(i, &stats);
+
+		peak_pct = MAX(peak_pct, (stats.max_used * 100) / stats.block_count);
+		failures += stats.alloc_failures;
+
+		if (stats.alloc_failures) {
+			LOG_WRN("Event pool \"%s\": %u of %u blocks used at peak, %u failures",
+				stats.name, stats.max_used, stats.block_count,
+				stats.alloc_failures);
+		}
+	}
+
+	err = MEMFAULT_METRIC_SET_UNSIGNED(event_pool_peak_usage_pct, peak_pct);
+	if (err) {
+		LOG_ERR("Failed updating event_pool_peak_usage_pct metric, error: %d", err);
+	}
+
+	err = MEMFAULT_METRIC_ADD(event_pool_alloc_failure_count, failures - reported_failures);
+	if (err) {
+		LOG_ERR("Failed updating event_pool_alloc_failure_count metric, error: %d", err);
+	}
+
+	reported_failures = failures;
+}
+#endif /* CONFIG_EVENT_POOL */
+
+#if defined(CONFIG_MODULES_COMMON_STATS)
+static void add_module_stats_metrics(const char *name, MemfaultMetricId latency_key,
+				     MemfaultMetricId depth_key, MemfaultMetricId handler_key)
+{
+	struct module_stats stats;
+	int err;
+
+	if (module_stats_get(name, &stats)) {
+		return;
+	}
+
+	err = memfault_metrics_heartbeat_set_unsigned(latency_key,
+						      stats.latency_max_us / USEC_PER_MSEC);
+	if (err) {
+		LOG_ERR("Failed updating %s queue latency metric, error: %d", name, err);
+	}
+
+	err = memfault_metrics_heartbeat_set_unsigned(depth_key, stats.depth_max);
+	if (err) {
+		LOG_ERR("Failed updating %s queue depth metric, error: %d", name, err);
+	}
+
+	err = memfault_metrics_heartbeat_set_unsigned(handler_key,
+						      stats.handler_time_max_us / USEC_PER_MSEC);
+	if (err) {
+		LOG_ERR("Failed updating %s handler time metric, error: %d", name, err);
+	}
+}
+
+#define ADD_MODULE_STATS_METRICS(_mod)							\
+	add_module_stats_metrics(STRINGIFY(_mod),					\
+				 MEMFAULT_METRICS_KEY(_mod##_queue_latency_max_ms),	\
+				 MEMFAULT_METRICS_KEY(_mod##_queue_depth_max),		\
+				 MEMFAULT_METRICS_KEY(_mod##_handler_time_max_ms))
+
+/* Report the since-boot maximum queue latency, queue depth and handler execution time of each
+ * module thread, and the number of messages lost because a queue was full since the previous
+ * report.
+ */
+static void add_modules_stats_metrics(void)
+{
+	static uint32_t reported_drops;
+	uint32_t drops = module_queue_drop_count_get();
+	int err;
+
+	ADD_MODULE_STATS_METRICS(app);
+	ADD_MODULE_STATS_METRICS(cloud);
+	ADD_MODULE_STATS_METRICS(data);
+	ADD_MODULE_STATS_METRICS(modem);
+	ADD_MODULE_STATS_METRICS(sensor);
+
+	err = MEMFAULT_METRIC_ADD(module_queue_overflow_count, drops - reported_drops);
+	if (err) {
+		LOG_ERR("Failed updating module_queue_overflow_count metric, error: %d", err);
+	}
+
+	reported_drops = drops;
+}
+#endif /* CONFIG_MODULES_COMMON_STATS */
+
 static void memfault_handle_event(struct debug_msg_data *msg)
 {
 	if (IS_EVENT(msg, app, APP_EVT_START)) {
@@ -308,6 +554,9 @@ static void memfault_handle_event(struct debug_msg_data *msg)
 	    (IS_EVENT(msg, data, DATA_EVT_DATA_SEND_BATCH)) ||
 	    (IS_EVENT(msg, data, DATA_EVT_CLOUD_LOCATION_DATA_SEND)) ||
 	    (IS_EVENT(msg, data, DATA_EVT_UI_DATA_SEND))) {
+#if defined(CONFIG_CLOUD_MODULE)
+		add_cloud_ping_metrics();
+#endif
 		/* Limit how often non-coredump memfault data (events and metrics) are sent
 		 * to memfault. Updates can never occur more often than the interval set by
 		 * CONFIG_DEBUG_MODULE_MEMFAULT_UPDATES_MIN_INTERVAL_SEC and the first update is
@@ -323,6 +572,12 @@ static void memfault_handle_event(struct debug_msg_data *msg)
 		}
 
 		last_update = k_uptime_get();
+#if defined(CONFIG_EVENT_POOL)
+		add_event_pool_metrics();
+#endif
+#if defined(CONFIG_MODULES_COMMON_STATS)
+		add_modules_stats_metrics();
+#endif
 		send_type = METRICS;
 		send_memfault_data();
 		return;
@@ -339,6 +594,11 @@ static void memfault_handle_event(struct debug_msg_data *msg)
 		return;
 	}
 
+	if (IS_EVENT(msg, cloud, CLOUD_EVT_CONNECTED)) {
+		add_cloud_connect_metrics(&msg->module.cloud.data.connection);
+		add_cloud_handshake_metrics();
+	}
+
 	/* If the module is configured to use an external cloud transport, coredumps are
 	 * sent on an established connection to the configured cloud service.
 	 */
@@ -357,6 +617,11 @@ static void memfault_handle_event(struct debug_msg_data *msg)
 				msg->module.location.type);
 		return;
 	}
+
+	if (IS_EVENT(msg, modem, MODEM_EVT_LTE_RRC_IDLE)) {
+		add_rrc_metrics(&msg->module.modem.data.rrc);
+		return;
+	}
 }
 #endif /* defined(CONFIG_MEMFAULT) */
 
@@ -373,7 +638,8 @@ static void message_handler(struct debug_msg_data *msg)
 		/* Notify the rest of the application that it is connected to network
 		 * when building for PC.
 		 */
-		if (IS_ENABLED(CONFIG_BOARD_QEMU_X86) || IS_ENABLED(CONFIG_BOARD_NATIVE_POSIX)) {
+		if (IS_ENABLED(CONFIG_BOARD_QEMU_X86) || IS_ENABLED(CONFIG_BOARD_NATIVE_POSIX) ||
+		    IS_ENABLED(CONFIG_BOARD_NATIVE_SIM)) {
 			{ SEND_EVENT(debug, DEBUG_EVT_EMULATOR_INITIALIZED); }
 			SEND_EVENT(debug, DEBUG_EVT_EMULATOR_NETWORK_CONNECTED);
 		}
@@ -16,6 +16,7 @@
 #define MODULE location_module
 
 #include "modules_common.h"
+#include "event_trace/event_trace.h"
 #include "events/app_module_event.h"
 #include "events/location_module_event.h"
 #include "events/data_module_event.h"
@@ -23,6 +24,10 @@
 #include "events/modem_module_event.h"
 #include "events/cloud_module_event.h"
 
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+#include "location/location_cache.h"
+#endif
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_LOCATION_MODULE_LOG_LEVEL);
 
@@ -75,6 +80,14 @@ static struct module_stats {
  */
 static bool cloud_location_request_pending;
 
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+/* Cache key and serving cell RSRP of the measurements in the pending cloud location request.
+ * The location resolved by cloud is cached with them.
+ */
+static struct location_cache_key pending_key;
+static int16_t pending_rsrp;
+#endif
+
 static struct module_data self = {
 	.name = "location",
 	.msg_q = NULL,
@@ -127,6 +140,7 @@ static void state_set(enum state_type new_state)
 		state2str(new_state));
 
 	state = new_state;
+	event_trace_state(EVENT_TRACE_STATE, self.name, new_state);
 }
 
 static void sub_state_set(enum sub_state_type new_state)
@@ -141,6 +155,7 @@ static void sub_state_set(enum sub_state_type new_state)
 		sub_state2str(new_state));
 
 	sub_state = new_state;
+	event_trace_state(EVENT_TRACE_SUB_STATE, self.name, new_state);
 }
 
 /* Handlers */
@@ -380,11 +395,104 @@ static void send_cloud_location_update(const struct location_data_cloud *cloud_l
 				evt->data.cloud_location.wifi_access_points.cnt);
 	}
 #endif
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+	evt->data.cloud_location.cached = false;
+#endif
+	evt->type = LOCATION_MODULE_EVT_CLOUD_LOCATION_DATA_READY;
+	evt->data.cloud_location.timestamp = k_uptime_get();
+
+	APP_EVENT_SUBMIT(evt);
+}
+
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+/**
+ * @brief Looks up the location of the measurements in a cloud location request in the cache.
+ *
+ * @param[in] cloud_location_info Cloud location request from the Location library.
+ *
+ * @return True if the location was found in the cache. A
+ *	   LOCATION_MODULE_EVT_CLOUD_LOCATION_DATA_READY event with the cached location has then
+ *	   been sent.
+ */
+static bool cloud_location_cache_lookup(const struct location_data_cloud *cloud_location_info)
+{
+	struct location_cache_position position;
+	struct location_module_event *evt;
+	int err;
+
+	if (cloud_location_info->cell_data == NULL) {
+		/* Measurements without a serving cell are not cached. */
+		pending_key.cell_id = LTE_LC_CELL_EUTRAN_ID_INVALID;
+		return false;
+	}
+
+	location_cache_key_init(&pending_key, &cloud_location_info->cell_data->current_cell);
+	pending_rsrp = cloud_location_info->cell_data->current_cell.rsrp;
+
+#if defined(CONFIG_LOCATION_METHOD_WIFI)
+	if (cloud_location_info->wifi_data != NULL) {
+		for (size_t i = 0; i < cloud_location_info->wifi_data->cnt; i++) {
+			location_cache_key_ap_add(&pending_key,
+						  cloud_location_info->wifi_data->ap_info[i].mac,
+						  cloud_location_info->wifi_data->ap_info[i].rssi);
+		}
+	}
+#endif
+
+	if (!location_cache_key_valid(&pending_key)) {
+		return false;
+	}
+
+	err = location_cache_lookup(&pending_key, pending_rsrp, k_uptime_get(), &position);
+	if (err) {
+		return false;
+	}
+
+	evt = new_location_module_event();
+
+	__ASSERT(evt, "Not enough heap left to allocate event");
+
+	evt->data.cloud_location.neighbor_cells_valid = false;
+#if defined(CONFIG_LOCATION_METHOD_WIFI)
+	evt->data.cloud_location.wifi_access_points_valid = false;
+#endif
+	evt->data.cloud_location.cached = true;
+	evt->data.cloud_location.location.latitude = position.latitude;
+	evt->data.cloud_location.location.longitude = position.longitude;
+	evt->data.cloud_location.location.accuracy = position.accuracy;
 	evt->type = LOCATION_MODULE_EVT_CLOUD_LOCATION_DATA_READY;
 	evt->data.cloud_location.timestamp = k_uptime_get();
 
 	APP_EVENT_SUBMIT(evt);
+
+	/* The measurements of this request are not sent to cloud and nothing is cached. */
+	pending_key.cell_id = LTE_LC_CELL_EUTRAN_ID_INVALID;
+
+	return true;
+}
+
+/**
+ * @brief Caches the location resolved by cloud for the pending cloud location request.
+ *
+ * @param[in] location Location resolved by cloud.
+ */
+static void cloud_location_cache_add(const struct location_data *location)
+{
+	struct location_cache_position position = {
+		.latitude = location->latitude,
+		.longitude = location->longitude,
+		.accuracy = location->accuracy,
+	};
+
+	if (!location_cache_key_valid(&pending_key)) {
+		return;
+	}
+
+	location_cache_add(&pending_key, pending_rsrp, k_uptime_get(), &position);
+
+	pending_key.cell_id = LTE_LC_CELL_EUTRAN_ID_INVALID;
 }
+#endif /* CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE */
 
 /* Non-static so that this can be used in tests to mock location library API. */
 void location_event_handler(const struct location_event_data *event_data)
@@ -496,8 +604,14 @@ void location_event_handler(const struct location_event_data *event_data)
 #if defined(CONFIG_LOCATION_METHOD_CELLULAR) || defined(CONFIG_LOCATION_METHOD_WIFI)
 	case LOCATION_EVT_CLOUD_LOCATION_EXT_REQUEST:
 		LOG_DBG("Getting cloud location request");
-		send_cloud_location_update(&event_data->cloud_location_request);
 		cloud_location_request_pending = true;
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+		if (cloud_location_cache_lookup(&event_data->cloud_location_request)) {
+			LOG_DBG("Cloud location found in cache");
+			break;
+		}
+#endif
+		send_cloud_location_update(&event_data->cloud_location_request);
 		break;
 #endif
 
@@ -539,6 +653,10 @@ static int setup(void)
 		return -1;
 	}
 
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+	pending_key.cell_id = LTE_LC_CELL_EUTRAN_ID_INVALID;
+#endif
+
 	return 0;
 }
 
@@ -566,12 +684,28 @@ static void on_state_running_location_search(struct location_msg_data *msg)
 	}
 
 	if (IS_EVENT(msg, cloud, CLOUD_EVT_CLOUD_LOCATION_RECEIVED)) {
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+		cloud_location_cache_add(&msg->module.cloud.data.cloud_location);
+#endif
 #if defined(CONFIG_LOCATION)
 		location_cloud_location_ext_result_set(
 			LOCATION_EXT_RESULT_SUCCESS,
 			&msg->module.cloud.data.cloud_location);
 #endif
 	}
+
+#if defined(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE)
+	if (IS_EVENT(msg, location, LOCATION_MODULE_EVT_CLOUD_LOCATION_DATA_READY) &&
+	    msg->module.location.data.cloud_location.cached) {
+		struct location_data location = {
+			.latitude = msg->module.location.data.cloud_location.location.latitude,
+			.longitude = msg->module.location.data.cloud_location.location.longitude,
+			.accuracy = msg->module.location.data.cloud_location.location.accuracy,
+		};
+
+		location_cloud_location_ext_result_set(LOCATION_EXT_RESULT_SUCCESS, &location);
+	}
+#endif
 	if (IS_EVENT(msg, cloud, CLOUD_EVT_CLOUD_LOCATION_ERROR)) {
 		location_cloud_location_ext_result_set(LOCATION_EXT_RESULT_ERROR, NULL);
 	}
@@ -7,6 +7,7 @@
 #include <zephyr/kernel.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <app_event_manager.h>
 #include <math.h>
@@ -16,6 +17,11 @@
 #include <modem/nrf_modem_lib.h>
 #include <modem/pdn.h>
 
+#if defined(CONFIG_MODEM_RELEASE_AFTER_SEND)
+#include <zephyr/net/socket.h>
+#include <zephyr/net/socket_ncs.h>
+#endif
+
 #if defined(CONFIG_MEMFAULT)
 #include <memfault/ports/zephyr/http.h>
 #endif
@@ -23,6 +29,7 @@
 #define MODULE modem_module
 
 #include "modules_common.h"
+#include "event_trace/event_trace.h"
 #include "events/app_module_event.h"
 #include "events/data_module_event.h"
 #include "events/modem_module_event.h"
@@ -67,17 +74,33 @@ static struct modem_param_info modem_param;
 /* Value that holds the latest RSRP value. */
 static int16_t rsrp_value_latest;
 
+/* RSRP value in the latest MODEM_EVT_LTE_RSRP_UPDATE event. */
+static int16_t rsrp_value_reported = INT16_MIN;
+
 /* Value that holds the latest LTE network mode. */
 static enum lte_lc_lte_mode nw_mode_latest;
 
+/* Uptime when the RRC connection was established, 0 when in RRC idle mode. */
+static uint32_t rrc_connected_time;
+
+#if defined(CONFIG_MODEM_RELEASE_AFTER_SEND)
+/* Uptime when an early release of the current RRC connection was requested, 0 if not requested.
+ * Set from the module thread and read from the LTE link controller event handler.
+ */
+static atomic_t release_time;
+
+/* Cumulative number of early releases and estimated RRC connected time saved by them. */
+static uint32_t release_count;
+static uint64_t release_saved_time_ms;
+#endif /* CONFIG_MODEM_RELEASE_AFTER_SEND */
+
 const k_tid_t module_thread;
 
 /* Modem module message queue. */
 #define MODEM_QUEUE_ENTRY_COUNT		10
-#define MODEM_QUEUE_BYTE_ALIGNMENT	4
+#define MODEM_QUEUE_TELEMETRY_ENTRY_COUNT	4
 
-K_MSGQ_DEFINE(msgq_modem, sizeof(struct modem_msg_data),
-	      MODEM_QUEUE_ENTRY_COUNT, MODEM_QUEUE_BYTE_ALIGNMENT);
+MODULE_QUEUE_DEFINE(msgq_modem, MODEM_QUEUE_ENTRY_COUNT, MODEM_QUEUE_TELEMETRY_ENTRY_COUNT);
 
 K_SEM_DEFINE(nrf_modem_initialized, 0, 1);
 NRF_MODEM_LIB_ON_INIT(asset_tracker_init_hook, on_modem_lib_init, NULL);
@@ -97,6 +120,7 @@ static struct module_data self = {
 static void send_cell_update(uint32_t cell_id, uint32_t tac);
 static void send_psm_update(int tau, int active_time);
 static void send_edrx_update(float edrx, float ptw);
+static void rrc_update(enum lte_lc_rrc_mode mode);
 static inline int adjust_rsrp(int input);
 
 /* Convenience functions used in internal state handling. */
@@ -128,49 +152,19 @@ static void state_set(enum state_type new_state)
 		state2str(new_state));
 
 	state = new_state;
+	event_trace_state(EVENT_TRACE_STATE, self.name, new_state);
 }
 
 /* Handlers */
 static bool app_event_handler(const struct app_event_header *aeh)
 {
-	struct modem_msg_data msg = {0};
-	bool enqueue_msg = false;
-
-	if (is_modem_module_event(aeh)) {
-		struct modem_module_event *evt = cast_modem_module_event(aeh);
-
-		msg.module.modem = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_app_module_event(aeh)) {
-		struct app_module_event *evt = cast_app_module_event(aeh);
-
-		msg.module.app = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_cloud_module_event(aeh)) {
-		struct cloud_module_event *evt = cast_cloud_module_event(aeh);
-
-		msg.module.cloud = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_util_module_event(aeh)) {
-		struct util_module_event *evt = cast_util_module_event(aeh);
-
-		msg.module.util = *evt;
-		enqueue_msg = true;
-	}
+	bool enqueue_msg = is_modem_module_event(aeh) ||
+			   is_app_module_event(aeh) ||
+			   is_cloud_module_event(aeh) ||
+			   is_util_module_event(aeh);
 
 	if (enqueue_msg) {
-		int err = module_enqueue_msg(&self, &msg);
-
-		if (err) {
-			LOG_ERR("Message could not be enqueued");
-			SEND_ERROR(modem, MODEM_EVT_ERROR, err);
-		}
+		module_enqueue_msg(&self, aeh);
 	}
 
 	return false;
@@ -224,6 +218,7 @@ static void lte_evt_handler(const struct lte_lc_evt *const evt)
 		LOG_DBG("RRC mode: %s",
 			evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ?
 			"Connected" : "Idle");
+		rrc_update(evt->rrc_mode);
 		break;
 	case LTE_LC_EVT_CELL_UPDATE:
 		LOG_DBG("LTE cell changed: Cell ID: %d, Tracking area: %d",
@@ -315,6 +310,19 @@ static void modem_rsrp_handler(char rsrp_value)
 
 	LOG_DBG("Incoming RSRP status message, RSRP value is %d",
 		rsrp_value_latest);
+
+	if (abs(rsrp_value_latest - rsrp_value_reported) >= CONFIG_MODEM_RSRP_UPDATE_DELTA_DB) {
+		struct modem_module_event *evt = new_modem_module_event();
+
+		__ASSERT(evt, "Not enough heap left to allocate event");
+
+		evt->type = MODEM_EVT_LTE_RSRP_UPDATE;
+		evt->data.rsrp = rsrp_value_latest;
+
+		rsrp_value_reported = rsrp_value_latest;
+
+		APP_EVENT_SUBMIT(evt);
+	}
 }
 
 #ifdef CONFIG_LWM2M_CARRIER
@@ -491,6 +499,67 @@ static void send_edrx_update(float edrx, float ptw)
 	APP_EVENT_SUBMIT(evt);
 }
 
+/* Track the time spent in RRC connected mode. If an early release was requested, the time saved
+ * is estimated as the part of the network inactivity timer that did not have to run out.
+ */
+static void rrc_update(enum lte_lc_rrc_mode mode)
+{
+	struct modem_module_event *evt;
+	uint32_t now = MAX(k_uptime_get_32(), 1);
+	uint32_t saved_time_ms = 0;
+	bool release_requested = false;
+
+	if (mode == LTE_LC_RRC_MODE_CONNECTED) {
+		rrc_connected_time = now;
+
+#if defined(CONFIG_MODEM_RELEASE_AFTER_SEND)
+		(void)atomic_clear(&release_time);
+#endif
+		SEND_EVENT(modem, MODEM_EVT_LTE_RRC_CONNECTED);
+		return;
+	}
+
+	if (rrc_connected_time == 0) {
+		/* Idle mode reported without a preceding connection. */
+		return;
+	}
+
+#if defined(CONFIG_MODEM_RELEASE_AFTER_SEND)
+	uint32_t release_requested_time = (uint32_t)atomic_clear(&release_time);
+
+	if (release_requested_time != 0) {
+		uint32_t inactivity_ms = CONFIG_MODEM_RELEASE_INACTIVITY_TIMER_SEC * MSEC_PER_SEC;
+		uint32_t release_delay_ms = now - release_requested_time;
+
+		release_requested = true;
+
+		if (release_delay_ms < inactivity_ms) {
+			saved_time_ms = inactivity_ms - release_delay_ms;
+		}
+
+		release_count++;
+		release_saved_time_ms += saved_time_ms;
+
+		LOG_INF("RRC released %u ms after request, saved: %u ms, total saved: %u ms "
+			"in %u releases", release_delay_ms, saved_time_ms,
+			(uint32_t)release_saved_time_ms, release_count);
+	}
+#endif /* CONFIG_MODEM_RELEASE_AFTER_SEND */
+
+	evt = new_modem_module_event();
+
+	__ASSERT(evt, "Not enough heap left to allocate event");
+
+	evt->type = MODEM_EVT_LTE_RRC_IDLE;
+	evt->data.rrc.connected_time_ms = now - rrc_connected_time;
+	evt->data.rrc.saved_time_ms = saved_time_ms;
+	evt->data.rrc.release_requested = release_requested;
+
+	rrc_connected_time = 0;
+
+	APP_EVENT_SUBMIT(evt);
+}
+
 static inline int adjust_rsrp(int input)
 {
 	if (IS_ENABLED(CONFIG_MODEM_DYNAMIC_DATA_CONVERT_RSRP_TO_DBM)) {
@@ -642,6 +711,32 @@ static int lte_connect(void)
 	return 0;
 }
 
+#if defined(CONFIG_MODEM_RELEASE_AFTER_SEND)
+/* Indicate to the network that no more data is expected, so that the RRC connection is released
+ * without waiting for the network inactivity timer to expire. The indication applies to the
+ * connection and is given through a socket that is only opened for this purpose.
+ */
+static int radio_release(void)
+{
+	int err;
+	int rai = RAI_NO_DATA;
+	int fd = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+	if (fd < 0) {
+		return -errno;
+	}
+
+	err = zsock_setsockopt(fd, SOL_SOCKET, SO_RAI, &rai, sizeof(rai));
+	if (err) {
+		err = -errno;
+	}
+
+	(void)zsock_close(fd);
+
+	return err;
+}
+#endif /* CONFIG_MODEM_RELEASE_AFTER_SEND */
+
 static int modem_data_init(void)
 {
 	int err;
@@ -769,6 +864,19 @@ static void on_state_connected(struct modem_msg_data *msg)
 		state_set(STATE_DISCONNECTED);
 	}
 
+#if defined(CONFIG_MODEM_RELEASE_AFTER_SEND)
+	if (IS_EVENT(msg, cloud, CLOUD_EVT_DATA_SEND_DONE)) {
+		int err = radio_release();
+
+		if (err) {
+			LOG_WRN("Radio release not indicated, error: %d", err);
+		} else {
+			LOG_DBG("Radio release indicated");
+			(void)atomic_set(&release_time, MAX(k_uptime_get_32(), 1));
+		}
+	}
+#endif /* CONFIG_MODEM_RELEASE_AFTER_SEND */
+
 	if (IS_EVENT(msg, modem, MODEM_EVT_CARRIER_EVENT_LTE_POWER_OFF_REQUEST)) {
 		int err;
 
@@ -857,7 +965,7 @@ static void on_all_states(struct modem_msg_data *msg)
 static void module_thread_fn(void)
 {
 	int err;
-	struct modem_msg_data msg = { 0 };
+	struct modem_msg_data *msg;
 
 	self.thread_id = k_current_get();
 
@@ -883,13 +991,13 @@ static void module_thread_fn(void)
 
 		switch (state) {
 		case STATE_DISCONNECTED:
-			on_state_disconnected(&msg);
+			on_state_disconnected(msg);
 			break;
 		case STATE_CONNECTING:
-			on_state_connecting(&msg);
+			on_state_connecting(msg);
 			break;
 		case STATE_CONNECTED:
-			on_state_connected(&msg);
+			on_state_connected(msg);
 			break;
 		case STATE_SHUTDOWN:
 			/* The shutdown state has no transition. */
@@ -899,7 +1007,8 @@ static void module_thread_fn(void)
 			break;
 		}
 
-		on_all_states(&msg);
+		on_all_states(msg);
+		module_msg_release(&self, msg);
 	}
 }
 
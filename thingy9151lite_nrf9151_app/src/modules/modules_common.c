@@ -6,18 +6,22 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/types.h>
+#include <string.h>
 #include <app_event_manager.h>
 #include "modules_common.h"
+#include "events/event_pool.h"
+#include "event_trace/event_trace.h"
+#include "events/modem_module_event.h"
+#include "events/sensor_module_event.h"
+
+#if defined(CONFIG_MODULES_COMMON_STATS_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
 
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_REGISTER(modules_common, CONFIG_MODULES_COMMON_LOG_LEVEL);
 
-struct event_prototype {
-	struct app_event_header header;
-	uint8_t event_id;
-};
-
 /* List containing metadata on active modules in the application. */
 static sys_slist_t module_list = SYS_SLIST_STATIC_INIT(&module_list);
 static K_MUTEX_DEFINE(module_list_lock);
@@ -28,81 +32,358 @@ static struct modules_info {
 	atomic_t shutdown_supported_count;
 	/* Number of active modules in the application. */
 	atomic_t active_modules_count;
+	/* Number of messages lost because a module message queue was full. */
+	atomic_t queue_drop_count;
 } modules_info;
 
+/* Get the header that the allocator prepends to every Application Event Manager allocation. */
+static inline union event_ref *event_ref_get(const void *event)
+{
+	return (union event_ref *)event - 1;
+}
+
+static void log_event(const struct module_data *module, const struct app_event_header *aeh)
+{
+	struct event_type *event = (struct event_type *)aeh->type_id;
+
+	if (event->log_event_func) {
+		event->log_event_func(aeh);
+	}
+#ifdef CONFIG_APP_EVENT_MANAGER_USE_DEPRECATED_LOG_FUN
+	else if (event->log_event_func_dep) {
+		char buf[50];
+
+		event->log_event_func_dep(aeh, buf, sizeof(buf));
+		LOG_DBG("%s module: Dequeued %s",
+			module->name,
+			buf);
+	}
+#endif
+}
+
+/* Overrides of the weak Application Event Manager allocator. The Application Event Manager holds
+ * the initial reference and drops it through app_event_manager_free() when all listeners have
+ * processed the event.
+ */
+void *app_event_manager_alloc(size_t size)
+{
+	union event_ref *ref = NULL;
+	uint8_t pool = EVENT_POOL_NONE;
+
+#if defined(CONFIG_EVENT_POOL)
+	ref = event_pool_alloc(sizeof(union event_ref) + size, &pool);
+#endif
+	if (!ref) {
+		ref = k_malloc(sizeof(union event_ref) + size);
+	}
+
+	if (unlikely(!ref)) {
+		LOG_ERR("Application Event Manager could not allocate memory");
+		k_panic();
+		return NULL;
+	}
+
+	atomic_set(&ref->count, 1);
+	ref->pool = pool;
+
+	return ref + 1;
+}
+
+void app_event_manager_free(void *addr)
+{
+	union event_ref *ref = event_ref_get(addr);
+
+	if (atomic_dec(&ref->count) != 1) {
+		return;
+	}
+
+#if defined(CONFIG_EVENT_POOL)
+	if (ref->pool != EVENT_POOL_NONE) {
+		event_pool_free(ref, ref->pool);
+		return;
+	}
+#endif
+	k_free(ref);
+}
+
+/* Classify an event as a control or telemetry message. Telemetry messages carry sampled data or
+ * state updates where a newer message supersedes an older one, so they can be dropped under
+ * load. Everything else, including all requests, lifecycle and error events, is control. Impact
+ * detections and button presses are one-off occurrences that are not repeated by a later
+ * message, so they are control as well.
+ */
+static enum module_msg_class msg_class_get(const struct app_event_header *aeh)
+{
+	if (is_sensor_module_event(aeh)) {
+		switch (cast_sensor_module_event(aeh)->type) {
+		case SENSOR_EVT_MOVEMENT_ACTIVITY_DETECTED:
+		case SENSOR_EVT_MOVEMENT_INACTIVITY_DETECTED:
+		case SENSOR_EVT_ENVIRONMENTAL_DATA_READY:
+		case SENSOR_EVT_FUEL_GAUGE_READY:
+			return MODULE_MSG_TELEMETRY;
+		default:
+			return MODULE_MSG_CONTROL;
+		}
+	}
+
+	if (is_modem_module_event(aeh)) {
+		switch (cast_modem_module_event(aeh)->type) {
+		case MODEM_EVT_LTE_RSRP_UPDATE:
+		case MODEM_EVT_MODEM_DYNAMIC_DATA_READY:
+			return MODULE_MSG_TELEMETRY;
+		default:
+			return MODULE_MSG_CONTROL;
+		}
+	}
+
+	return MODULE_MSG_CONTROL;
+}
+
+/* The queue functions are called with the queue lock held. */
+static const struct app_event_header *queue_pop(struct module_queue *queue)
+{
+	const struct app_event_header *aeh = queue->buf[queue->head];
+
+	queue->head = (queue->head + 1) % queue->size;
+	queue->used--;
+
+	if (msg_class_get(aeh) == MODULE_MSG_TELEMETRY) {
+		queue->telemetry_used--;
+	}
+
+	return aeh;
+}
+
+static void queue_push(struct module_queue *queue, const struct app_event_header *aeh,
+		       enum module_msg_class msg_class)
+{
+	queue->buf[(queue->head + queue->used) % queue->size] = aeh;
+	queue->used++;
+
+	if (msg_class == MODULE_MSG_TELEMETRY) {
+		queue->telemetry_used++;
+	}
+}
+
+/* Remove the oldest telemetry message from the queue. The messages in front of it are moved one
+ * entry towards the tail, so that the remaining messages keep their order.
+ */
+static const struct app_event_header *queue_telemetry_remove(struct module_queue *queue)
+{
+	uint16_t offset = 0;
+	size_t index = queue->head;
+	const struct app_event_header *aeh;
+
+	while (msg_class_get(queue->buf[index]) != MODULE_MSG_TELEMETRY) {
+		offset++;
+		index = (queue->head + offset) % queue->size;
+	}
+
+	aeh = queue->buf[index];
+
+	while (offset > 0) {
+		size_t prev = (queue->head + offset - 1) % queue->size;
+
+		queue->buf[index] = queue->buf[prev];
+#if defined(CONFIG_MODULES_COMMON_STATS)
+		queue->timestamp[index] = queue->timestamp[prev];
+#endif
+		index = prev;
+		offset--;
+	}
+
+	queue->head = (queue->head + 1) % queue->size;
+	queue->used--;
+	queue->telemetry_used--;
+
+	return aeh;
+}
+
+#if defined(CONFIG_MODULES_COMMON_STATS)
+/* Upper bounds of the dequeue latency histogram buckets, the last bucket is unbounded. */
+static const uint32_t latency_bucket_us[MODULE_STATS_LATENCY_BUCKETS - 1] = {
+	USEC_PER_MSEC, 10 * USEC_PER_MSEC, 100 * USEC_PER_MSEC, USEC_PER_SEC
+};
+
+/* The statistics functions are called with the queue lock held. */
+static void stats_enqueued(struct module_queue *queue)
+{
+	queue->timestamp[(queue->head + queue->used - 1) % queue->size] = k_cycle_get_32();
+	queue->stats.depth_max = MAX(queue->stats.depth_max, queue->used);
+}
+
+/* Called before the message at the head of the queue is popped. */
+static void stats_dequeued(struct module_queue *queue)
+{
+	uint32_t now = k_cycle_get_32();
+	uint32_t latency_us = k_cyc_to_us_floor32(now - queue->timestamp[queue->head]);
+	size_t bucket = 0;
+
+	while ((bucket < ARRAY_SIZE(latency_bucket_us)) &&
+	       (latency_us >= latency_bucket_us[bucket])) {
+		bucket++;
+	}
+
+	queue->stats.latency_hist[bucket]++;
+	queue->stats.latency_max_us = MAX(queue->stats.latency_max_us, latency_us);
+	queue->dequeue_timestamp = now;
+}
+
+static void stats_handled(struct module_queue *queue)
+{
+	uint32_t handler_time_us = k_cyc_to_us_floor32(k_cycle_get_32() -
+						       queue->dequeue_timestamp);
+
+	queue->stats.handled_count++;
+	queue->stats.handler_time_total_us += handler_time_us;
+	queue->stats.handler_time_max_us = MAX(queue->stats.handler_time_max_us,
+					       handler_time_us);
+}
+#else
+static inline void stats_enqueued(struct module_queue *queue) {}
+static inline void stats_dequeued(struct module_queue *queue) {}
+static inline void stats_handled(struct module_queue *queue) {}
+#endif /* CONFIG_MODULES_COMMON_STATS */
+
 /* Public interface */
 void module_purge_queue(struct module_data *module)
 {
-	k_msgq_purge(module->msg_q);
+	struct module_queue *queue = module->msg_q;
+	const struct app_event_header *aeh;
+
+	while (true) {
+		k_spinlock_key_t key = k_spin_lock(&queue->lock);
+
+		if (queue->used == 0) {
+			k_spin_unlock(&queue->lock, key);
+			break;
+		}
+
+		aeh = queue_pop(queue);
+		k_spin_unlock(&queue->lock, key);
+
+		event_trace_event(EVENT_TRACE_DROP, module->name, aeh);
+
+		/* Release the reference held by the purged message. */
+		(void)k_sem_take(queue->sem, K_NO_WAIT);
+		app_event_manager_free((void *)aeh);
+	}
 }
 
 int module_get_next_msg(struct module_data *module, void *msg)
 {
-	int err = k_msgq_get(module->msg_q, msg, K_FOREVER);
+	struct module_queue *queue = module->msg_q;
+	const struct app_event_header *aeh = NULL;
 
-	if (err == 0 && IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
-		struct event_prototype *evt_proto =
-			(struct event_prototype *)msg;
-		struct event_type *event =
-			(struct event_type *)evt_proto->header.type_id;
+	while (aeh == NULL) {
+		int err = k_sem_take(queue->sem, K_FOREVER);
 
-		if (event->log_event_func) {
-			event->log_event_func(&evt_proto->header);
+		if (err) {
+			return err;
 		}
-#ifdef CONFIG_APP_EVENT_MANAGER_USE_DEPRECATED_LOG_FUN
-		else if (event->log_event_func_dep) {
-			char buf[50];
 
-			event->log_event_func_dep(&evt_proto->header, buf, sizeof(buf));
-			LOG_DBG("%s module: Dequeued %s",
-				module->name,
-				buf);
+		k_spinlock_key_t key = k_spin_lock(&queue->lock);
+
+		/* Messages are dequeued in the order they were enqueued, independent of their
+		 * class. A request must not overtake a late response to the previous request,
+		 * which would otherwise be counted as the response to the new one. The queue can
+		 * be empty if it was purged after the semaphore was given, in that case wait for
+		 * the next message.
+		 */
+		if (queue->used) {
+			stats_dequeued(queue);
+			aeh = queue_pop(queue);
+			event_trace_event(EVENT_TRACE_DEQUEUE, module->name, aeh);
 		}
-#endif
+
+		k_spin_unlock(&queue->lock, key);
 	}
-	return err;
+
+	*(const struct app_event_header **)msg = aeh;
+
+	if (IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
+		log_event(module, aeh);
+	}
+	return 0;
 }
 
-int module_enqueue_msg(struct module_data *module, void *msg)
+void module_enqueue_msg(struct module_data *module, const struct app_event_header *aeh)
 {
-	int err;
+	struct module_queue *queue = module->msg_q;
+	enum module_msg_class msg_class = msg_class_get(aeh);
+	const struct app_event_header *dropped = NULL;
+	k_spinlock_key_t key;
+	bool full;
+
+	key = k_spin_lock(&queue->lock);
 
-	err = k_msgq_put(module->msg_q, msg, K_NO_WAIT);
-	if (err) {
-		LOG_WRN("%s: Message could not be enqueued, error code: %d",
-			module->name, err);
-			/* Purge message queue before reporting an error. This
-			 * makes sure that the calling module can
-			 * enqueue and process new events and is not being
-			 * blocked by a full message queue.
-			 *
-			 * This error is concidered irrecoverable and should be
-			 * rebooted on.
+	full = (queue->used == queue->size);
+
+	if (msg_class == MODULE_MSG_TELEMETRY) {
+		full = full || (queue->telemetry_used == queue->telemetry_size);
+	}
+
+	if (full) {
+		if (queue->telemetry_used == 0) {
+			k_spin_unlock(&queue->lock, key);
+
+			/* The queue is full of control messages. The message is lost, but the
+			 * module keeps running, messages already in the queue are kept.
 			 */
-			module_purge_queue(module);
-		return err;
+			LOG_ERR("%s: Message could not be enqueued, queue is full", module->name);
+
+			event_trace_event(EVENT_TRACE_DROP, module->name, aeh);
+			atomic_inc(&queue->overflow_count[msg_class]);
+			atomic_inc(&modules_info.queue_drop_count);
+			return;
+		}
+
+		/* Drop the oldest telemetry message to make room for the new one. */
+		dropped = queue_telemetry_remove(queue);
+	}
+
+	/* The reference is owned by the queue entry until module_msg_release() is called. */
+	atomic_inc(&event_ref_get(aeh)->count);
+	queue_push(queue, aeh, msg_class);
+	stats_enqueued(queue);
+
+	/* Trace under the queue lock, so that the records are in the same order as the queue
+	 * operations.
+	 */
+	if (dropped) {
+		event_trace_event(EVENT_TRACE_DROP, module->name, dropped);
+	}
+
+	event_trace_event(EVENT_TRACE_ENQUEUE, module->name, aeh);
+	k_spin_unlock(&queue->lock, key);
+
+	if (dropped) {
+		LOG_WRN("%s: Queue is full, oldest telemetry message dropped", module->name);
+
+		atomic_inc(&queue->overflow_count[MODULE_MSG_TELEMETRY]);
+		atomic_inc(&modules_info.queue_drop_count);
+		app_event_manager_free((void *)dropped);
+	} else {
+		k_sem_give(queue->sem);
 	}
 
 	if (IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
-		struct event_prototype *evt_proto = (struct event_prototype *)msg;
-		struct event_type *event = (struct event_type *)evt_proto->header.type_id;
+		log_event(module, aeh);
+	}
+}
 
-		if (event->log_event_func) {
-			event->log_event_func(&evt_proto->header);
-		}
-#ifdef CONFIG_APP_EVENT_MANAGER_USE_DEPRECATED_LOG_FUN
-		else if (event->log_event_func_dep) {
-			char buf[50];
+void module_msg_release(struct module_data *module, const void *msg)
+{
+	event_trace_event(EVENT_TRACE_RELEASE, module->name, msg);
 
-			event->log_event_func_dep(&evt_proto->header, buf, sizeof(buf));
-			LOG_DBG("%s module: Dequeued %s",
-				module->name,
-				buf);
-		}
-#endif
+	if (IS_ENABLED(CONFIG_MODULES_COMMON_STATS)) {
+		k_spinlock_key_t key = k_spin_lock(&module->msg_q->lock);
+
+		stats_handled(module->msg_q);
+		k_spin_unlock(&module->msg_q->lock, key);
 	}
 
-	return 0;
+	app_event_manager_free((void *)msg);
 }
 
 bool modules_shutdown_register(uint32_t id_reg)
@@ -182,3 +463,88 @@ uint32_t module_active_count_get(void)
 {
 	return atomic_get(&modules_info.active_modules_count);
 }
+
+uint32_t module_queue_overflow_count_get(const struct module_data *module,
+					 enum module_msg_class msg_class)
+{
+	if ((module->msg_q == NULL) || (msg_class >= MODULE_MSG_CLASS_COUNT)) {
+		return 0;
+	}
+
+	return atomic_get(&module->msg_q->overflow_count[msg_class]);
+}
+
+#if defined(CONFIG_MODULES_COMMON_STATS)
+int module_stats_get(const char *name, struct module_stats *stats)
+{
+	struct module_data *module;
+	int err = -ENOENT;
+
+	k_mutex_lock(&module_list_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&module_list, module, header) {
+		if ((module->msg_q == NULL) || (strcmp(module->name, name) != 0)) {
+			continue;
+		}
+
+		k_spinlock_key_t key = k_spin_lock(&module->msg_q->lock);
+
+		*stats = module->msg_q->stats;
+		k_spin_unlock(&module->msg_q->lock, key);
+
+		stats->depth_size = module->msg_q->size;
+
+		for (size_t i = 0; i < MODULE_MSG_CLASS_COUNT; i++) {
+			stats->overflow_count[i] = atomic_get(&module->msg_q->overflow_count[i]);
+		}
+
+		err = 0;
+		break;
+	}
+	k_mutex_unlock(&module_list_lock);
+
+	return err;
+}
+#endif /* CONFIG_MODULES_COMMON_STATS */
+
+uint32_t module_queue_drop_count_get(void)
+{
+	return atomic_get(&modules_info.queue_drop_count);
+}
+
+#if defined(CONFIG_MODULES_COMMON_STATS_SHELL)
+static int cmd_module_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	struct module_data *module;
+	struct module_stats stats;
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	k_mutex_lock(&module_list_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&module_list, module, header) {
+		if (module_stats_get(module->name, &stats)) {
+			continue;
+		}
+
+		shell_print(sh, "%s: depth max %u of %u, latency max %u us", module->name,
+			    stats.depth_max, stats.depth_size, stats.latency_max_us);
+		shell_print(sh, "  latency <1 ms %u, <10 ms %u, <100 ms %u, <1 s %u, >=1 s %u",
+			    stats.latency_hist[0], stats.latency_hist[1], stats.latency_hist[2],
+			    stats.latency_hist[3], stats.latency_hist[4]);
+		shell_print(sh, "  handled %u, handler avg %u us, max %u us",
+			    stats.handled_count,
+			    stats.handled_count ?
+				(uint32_t)(stats.handler_time_total_us / stats.handled_count) : 0,
+			    stats.handler_time_max_us);
+		shell_print(sh, "  lost control %u, telemetry %u",
+			    stats.overflow_count[MODULE_MSG_CONTROL],
+			    stats.overflow_count[MODULE_MSG_TELEMETRY]);
+	}
+	k_mutex_unlock(&module_list_lock);
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(module_stats, NULL, "Print module queue and handler statistics",
+		   cmd_module_stats);
+#endif /* CONFIG_MODULES_COMMON_STATS_SHELL */
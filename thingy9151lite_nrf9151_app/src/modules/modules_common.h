@@ -72,6 +72,108 @@ extern "C" {
 	event->data.id = _id;								\
 	APP_EVENT_SUBMIT(event)
 
+struct app_event_header;
+
+/** @brief Priority classes of messages in a module's queue. */
+enum module_msg_class {
+	/** Lifecycle, configuration, request and user input messages. Control messages can use
+	 *  every slot of the queue, and take the place of the oldest telemetry message if the queue
+	 *  is full. They are only dropped if the queue is full of control messages.
+	 */
+	MODULE_MSG_CONTROL,
+	/** Sampled data and unsolicited state updates. Telemetry messages can only use their share
+	 *  of the queue. If it is used up, the oldest telemetry message is dropped to make room for
+	 *  the new one.
+	 */
+	MODULE_MSG_TELEMETRY,
+	/** Number of message classes. */
+	MODULE_MSG_CLASS_COUNT
+};
+
+/** @brief Number of buckets in the dequeue latency histogram of a module. */
+#define MODULE_STATS_LATENCY_BUCKETS 5
+
+/** @brief Queue and handler statistics of a module. */
+struct module_stats {
+	/** Number of dequeued messages per time spent in the queue. The upper bounds of the
+	 *  buckets are 1 ms, 10 ms, 100 ms and 1 s. The last bucket counts the remaining messages.
+	 */
+	uint32_t latency_hist[MODULE_STATS_LATENCY_BUCKETS];
+	/** Longest time that a message has spent in the queue, in microseconds. */
+	uint32_t latency_max_us;
+	/** Highest number of messages in the queue at the same time. */
+	uint32_t depth_max;
+	/** Number of messages that fit in the queue. */
+	uint32_t depth_size;
+	/** Number of messages that have been handled by the module thread. */
+	uint32_t handled_count;
+	/** Longest handler execution time, in microseconds. */
+	uint32_t handler_time_max_us;
+	/** Total handler execution time, in microseconds. */
+	uint64_t handler_time_total_us;
+	/** Number of messages lost because the queue was full, per message class. */
+	uint32_t overflow_count[MODULE_MSG_CLASS_COUNT];
+};
+
+/** @brief Structure that contains a module's message queue. Use MODULE_QUEUE_DEFINE() to
+ *	   define it.
+ */
+struct module_queue {
+	/* Lock protecting the ring buffer. */
+	struct k_spinlock lock;
+	/* Semaphore counting the messages that are ready to be dequeued. */
+	struct k_sem *sem;
+	/* Ring buffer holding the enqueued messages of all classes, in the order they were
+	 * enqueued.
+	 */
+	const struct app_event_header **buf;
+#if defined(CONFIG_MODULES_COMMON_STATS)
+	/* Cycle count at which each message was enqueued. */
+	uint32_t *timestamp;
+#endif
+	/* Number of entries in the buffer. */
+	uint16_t size;
+	/* Maximum number of telemetry messages in the buffer. */
+	uint16_t telemetry_size;
+	/* Index of the oldest message. */
+	uint16_t head;
+	/* Number of messages in the buffer. */
+	uint16_t used;
+	/* Number of telemetry messages in the buffer. */
+	uint16_t telemetry_used;
+	/* Number of messages lost because the buffer was full, per message class. */
+	atomic_t overflow_count[MODULE_MSG_CLASS_COUNT];
+#if defined(CONFIG_MODULES_COMMON_STATS)
+	/* Statistics, protected by the lock. */
+	struct module_stats stats;
+	/* Cycle count at which the message that is being handled was dequeued. */
+	uint32_t dequeue_timestamp;
+#endif
+};
+
+/** @brief Macro used to define a module's message queue.
+ *
+ * The queue has room for @p _control_count + @p _telemetry_count messages. Telemetry messages
+ * can take at most @p _telemetry_count of them, so at least @p _control_count are always
+ * available to control messages.
+ *
+ * @param _name Name of the queue.
+ * @param _control_count Number of queue entries reserved for control messages.
+ * @param _telemetry_count Maximum number of queued telemetry messages.
+ */
+#define MODULE_QUEUE_DEFINE(_name, _control_count, _telemetry_count)				\
+	static const struct app_event_header *_name##_buf[(_control_count) + (_telemetry_count)]; \
+	IF_ENABLED(CONFIG_MODULES_COMMON_STATS,							\
+		   (static uint32_t _name##_ts[(_control_count) + (_telemetry_count)];))	\
+	static K_SEM_DEFINE(_name##_sem, 0, (_control_count) + (_telemetry_count));		\
+	static struct module_queue _name = {							\
+		.sem = &_name##_sem,								\
+		.buf = _name##_buf,								\
+		IF_ENABLED(CONFIG_MODULES_COMMON_STATS, (.timestamp = _name##_ts,))		\
+		.size = (_control_count) + (_telemetry_count),					\
+		.telemetry_size = _telemetry_count,						\
+	}
+
 /** @brief Structure that contains module metadata. */
 struct module_data {
 	/* Variable used to construct a linked list of module metadata. */
@@ -83,12 +185,12 @@ struct module_data {
 	/* Name of the module. */
 	char *name;
 	/* Pointer to the internal message queue in the module. */
-	struct k_msgq *msg_q;
+	struct module_queue *msg_q;
 	/* Flag signifying if the module supports shutdown. */
 	bool supports_shutdown;
 };
 
-/** @brief Purge a module's queue.
+/** @brief Purge a module's queue. The reference held by each purged message is released.
  *
  *  @param[in] module Pointer to a structure containing module metadata.
  *
@@ -97,22 +199,43 @@ struct module_data {
 void module_purge_queue(struct module_data *module);
 
 /** @brief Get the next message in a module's queue.
+ *
+ *  Messages are dequeued in the order in which they were enqueued, independent of their class.
+ *  Messages are passed by reference. The returned message points to the event that was
+ *  enqueued, is shared with other modules and must not be modified. The message must be released
+ *  using module_msg_release() when it has been processed.
  *
  *  @param[in] module Pointer to a structure containing module metadata.
- *  @param[out] msg Pointer to a message buffer that the output will be written to.
+ *  @param[out] msg Pointer to a message pointer that the output will be written to.
  *
  *  @return 0 if successful, otherwise a negative error code.
  */
 int module_get_next_msg(struct module_data *module, void *msg);
 
-/** @brief Enqueue message to a module's queue.
+/** @brief Enqueue an event to a module's queue.
+ *
+ *  The event is not copied. A reference to the event is taken, which keeps it allocated after
+ *  the Application Event Manager has finished processing it.
+ *
+ *  The event is classified as a control or telemetry message, see @ref module_msg_class.
+ *  If there is no room for the event, the oldest telemetry message is dropped. If the queue is
+ *  full of control messages, the event itself is dropped. A full queue is not reported to the
+ *  caller, messages that are lost are logged and counted, see module_queue_overflow_count_get().
  *
  *  @param[in] module Pointer to a structure containing module metadata.
- *  @param[in] msg Pointer to a message that will be enqueued.
+ *  @param[in] aeh Pointer to the header of the event that will be enqueued.
+ */
+void module_enqueue_msg(struct module_data *module, const struct app_event_header *aeh);
+
+/** @brief Release a message that has been dequeued using module_get_next_msg().
  *
- *  @return 0 if successful, otherwise a negative error code.
+ *  The time between dequeueing and releasing the message is recorded as the handler execution
+ *  time when CONFIG_MODULES_COMMON_STATS is enabled.
+ *
+ *  @param[in] module Pointer to a structure containing module metadata.
+ *  @param[in] msg Pointer to the message. The message must not be accessed after this call.
  */
-int module_enqueue_msg(struct module_data *module, void *msg);
+void module_msg_release(struct module_data *module, const void *msg);
 
 /** @brief Register that a module has performed a graceful shutdown.
  *
@@ -137,6 +260,36 @@ int module_start(struct module_data *module);
  */
 uint32_t module_active_count_get(void);
 
+/** @brief Get the number of messages of a class that have been lost because the message queue
+ *	   of a module was full.
+ *
+ *  @param[in] module Pointer to a structure containing module metadata.
+ *  @param[in] msg_class Message class.
+ *
+ *  @return Number of lost messages since boot.
+ */
+uint32_t module_queue_overflow_count_get(const struct module_data *module,
+					 enum module_msg_class msg_class);
+
+/** @brief Get the queue and handler statistics of a module.
+ *
+ *  Only available when CONFIG_MODULES_COMMON_STATS is enabled.
+ *
+ *  @param[in] name Name of the module.
+ *  @param[out] stats Pointer to a structure that the statistics will be written to.
+ *
+ *  @retval 0 if successful.
+ *  @retval -ENOENT if no started module with a message queue has the given name.
+ */
+int module_stats_get(const char *name, struct module_stats *stats);
+
+/** @brief Get the number of messages that have been lost because the message queue of a
+ *	   module was full.
+ *
+ *  @return Number of lost messages since boot, summed over all modules and message classes.
+ */
+uint32_t module_queue_drop_count_get(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,7 @@
 #define MODULE sensor_module
 
 #include "modules_common.h"
+#include "event_trace/event_trace.h"
 #include "events/app_module_event.h"
 #include "events/data_module_event.h"
 #include "events/sensor_module_event.h"
@@ -45,10 +46,9 @@ static enum state_type {
 
 /* Sensor module message queue. */
 #define SENSOR_QUEUE_ENTRY_COUNT	10
-#define SENSOR_QUEUE_BYTE_ALIGNMENT	4
+#define SENSOR_QUEUE_TELEMETRY_ENTRY_COUNT	1
 
-K_MSGQ_DEFINE(msgq_sensor, sizeof(struct sensor_msg_data),
-	      SENSOR_QUEUE_ENTRY_COUNT, SENSOR_QUEUE_BYTE_ALIGNMENT);
+MODULE_QUEUE_DEFINE(msgq_sensor, SENSOR_QUEUE_ENTRY_COUNT, SENSOR_QUEUE_TELEMETRY_ENTRY_COUNT);
 
 static struct module_data self = {
 	.name = "sensor",
@@ -83,42 +83,18 @@ static void state_set(enum state_type new_state)
 		state2str(new_state));
 
 	state = new_state;
+	event_trace_state(EVENT_TRACE_STATE, self.name, new_state);
 }
 
 /* Handlers */
 static bool app_event_handler(const struct app_event_header *aeh)
 {
-	struct sensor_msg_data msg = {0};
-	bool enqueue_msg = false;
-
-	if (is_app_module_event(aeh)) {
-		struct app_module_event *event = cast_app_module_event(aeh);
-
-		msg.module.app = *event;
-		enqueue_msg = true;
-	}
-
-	if (is_data_module_event(aeh)) {
-		struct data_module_event *event = cast_data_module_event(aeh);
-
-		msg.module.data = *event;
-		enqueue_msg = true;
-	}
-
-	if (is_util_module_event(aeh)) {
-		struct util_module_event *event = cast_util_module_event(aeh);
-
-		msg.module.util = *event;
-		enqueue_msg = true;
-	}
+	bool enqueue_msg = is_app_module_event(aeh) ||
+			   is_data_module_event(aeh) ||
+			   is_util_module_event(aeh);
 
 	if (enqueue_msg) {
-		int err = module_enqueue_msg(&self, &msg);
-
-		if (err) {
-			LOG_ERR("Message could not be enqueued");
-			SEND_ERROR(sensor, SENSOR_EVT_ERROR, err);
-		}
+		module_enqueue_msg(&self, aeh);
 	}
 
 	return false;
@@ -423,7 +399,7 @@ static void on_all_states(struct sensor_msg_data *msg)
 static void module_thread_fn(void)
 {
 	int err;
-	struct sensor_msg_data msg = { 0 };
+	struct sensor_msg_data *msg;
 
 	self.thread_id = k_current_get();
 
@@ -446,10 +422,10 @@ static void module_thread_fn(void)
 
 		switch (state) {
 		case STATE_INIT:
-			on_state_init(&msg);
+			on_state_init(msg);
 			break;
 		case STATE_RUNNING:
-			on_state_running(&msg);
+			on_state_running(msg);
 			break;
 		case STATE_SHUTDOWN:
 			/* The shutdown state has no transition. */
@@ -459,7 +435,8 @@ static void module_thread_fn(void)
 			break;
 		}
 
-		on_all_states(&msg);
+		on_all_states(msg);
+		module_msg_release(&self, msg);
 	}
 }
 
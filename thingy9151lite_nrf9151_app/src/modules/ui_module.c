@@ -13,6 +13,7 @@
 #define MODULE ui_module
 
 #include "modules_common.h"
+#include "event_trace/event_trace.h"
 #include "events/app_module_event.h"
 #include "events/data_module_event.h"
 #include "events/ui_module_event.h"
@@ -167,6 +168,7 @@ static void state_set(enum state_type new_state)
 		state2str(new_state));
 
 	state = new_state;
+	event_trace_state(EVENT_TRACE_STATE, self.name, new_state);
 }
 
 static void sub_state_set(enum sub_state_type new_state)
@@ -181,6 +183,7 @@ static void sub_state_set(enum sub_state_type new_state)
 		sub_state2str(new_state));
 
 	sub_state = new_state;
+	event_trace_state(EVENT_TRACE_SUB_STATE, self.name, new_state);
 }
 
 static void sub_sub_state_set(enum sub_sub_state_type new_state)
@@ -195,6 +198,7 @@ static void sub_sub_state_set(enum sub_sub_state_type new_state)
 		sub_sub_state2str(new_state));
 
 	sub_sub_state = new_state;
+	event_trace_state(EVENT_TRACE_SUB_SUB_STATE, self.name, new_state);
 }
 
 /* Handlers */
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include "send_policy.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(send_policy, CONFIG_DATA_MODULE_LOG_LEVEL);
+
+/* Number of connection evaluations needed before the adaptive policy is used. Until then the
+ * threshold policy is used.
+ */
+#define HISTORY_COUNT_MIN MIN(4, CONFIG_DATA_SEND_POLICY_HISTORY_SIZE)
+
+/* Weight of a new measurement in the learned radio-on time, as 1 / COST_WEIGHT. */
+#define COST_WEIGHT 4
+
+/* Radio-on time of a send before any has been measured, per energy estimate [ms]. Based on the
+ * repetitions and retries that the modem estimates for each energy estimate.
+ */
+static const uint32_t cost_initial_ms[SEND_POLICY_ENERGY_LEVEL_COUNT] = {
+	[LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 16000,
+	[LTE_LC_ENERGY_CONSUMPTION_INCREASED - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 8000,
+	[LTE_LC_ENERGY_CONSUMPTION_NORMAL - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 4000,
+	[LTE_LC_ENERGY_CONSUMPTION_REDUCED - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 3000,
+	[LTE_LC_ENERGY_CONSUMPTION_EFFICIENT - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 2000,
+};
+
+static bool energy_estimate_valid(int energy_estimate)
+{
+	return (energy_estimate >= LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE) &&
+	       (energy_estimate <= LTE_LC_ENERGY_CONSUMPTION_EFFICIENT);
+}
+
+static uint32_t cost(const struct send_policy *policy, int energy_estimate)
+{
+	return policy->cost_ms[energy_estimate - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE];
+}
+
+static const struct send_policy_sample *latest_sample(const struct send_policy *policy)
+{
+	size_t index = (policy->history_next + ARRAY_SIZE(policy->history) - 1) %
+		       ARRAY_SIZE(policy->history);
+
+	return &policy->history[index];
+}
+
+/* Get the radio-on time at the given percentile of the connection evaluations in the history. */
+static uint32_t cost_percentile(const struct send_policy *policy, uint8_t percentile)
+{
+	uint32_t costs[ARRAY_SIZE(policy->history)];
+	size_t count = policy->history_count;
+
+	/* Insertion sort, the history is small. */
+	for (size_t i = 0; i < count; i++) {
+		uint32_t value = cost(policy, policy->history[i].energy_estimate);
+		size_t j = i;
+
+		while ((j > 0) && (costs[j - 1] > value)) {
+			costs[j] = costs[j - 1];
+			j--;
+		}
+
+		costs[j] = value;
+	}
+
+	return costs[((count - 1) * MIN(percentile, 100)) / 100];
+}
+
+static bool threshold_grant(const struct send_policy_type_cfg *cfg,
+			    const struct send_policy_sample *sample)
+{
+	return sample->energy_estimate >= cfg->energy_min;
+}
+
+static bool adaptive_grant(const struct send_policy *policy,
+			   const struct send_policy_type_cfg *cfg,
+			   const struct send_policy_sample *sample)
+{
+	uint32_t limit;
+
+	if (policy->history_count < HISTORY_COUNT_MIN) {
+		return threshold_grant(cfg, sample);
+	}
+
+	limit = cost_percentile(policy, cfg->percentile);
+
+	LOG_DBG("Radio-on time: %u ms, limit: %u ms", cost(policy, sample->energy_estimate),
+		limit);
+
+	return cost(policy, sample->energy_estimate) <= limit;
+}
+
+int send_policy_init(struct send_policy *policy, enum send_policy_mode mode,
+		     const struct send_policy_type_cfg *types, size_t type_count)
+{
+	if (((unsigned int)mode >= SEND_POLICY_MODE_COUNT) ||
+	    (type_count > SEND_POLICY_TYPE_COUNT_MAX)) {
+		return -EINVAL;
+	}
+
+	memset(policy, 0, sizeof(*policy));
+
+	policy->mode = mode;
+	policy->types = types;
+	policy->type_count = type_count;
+
+	memcpy(policy->cost_ms, cost_initial_ms, sizeof(policy->cost_ms));
+
+	return 0;
+}
+
+int send_policy_mode_set(struct send_policy *policy, enum send_policy_mode mode)
+{
+	/* The mode comes from the device configuration, which can hold any integer. */
+	if ((unsigned int)mode >= SEND_POLICY_MODE_COUNT) {
+		return -EINVAL;
+	}
+
+	policy->mode = mode;
+	memset(policy->defer_count, 0, sizeof(policy->defer_count));
+
+	return 0;
+}
+
+int send_policy_conn_eval_add(struct send_policy *policy,
+			      const struct lte_lc_conn_eval_params *params)
+{
+	struct send_policy_sample *sample = &policy->history[policy->history_next];
+
+	if (!energy_estimate_valid(params->energy_estimate)) {
+		return -EINVAL;
+	}
+
+	sample->energy_estimate = params->energy_estimate;
+	sample->ce_level = params->ce_level;
+	sample->rsrp = params->rsrp;
+
+	policy->history_next = (policy->history_next + 1) % ARRAY_SIZE(policy->history);
+
+	if (policy->history_count < ARRAY_SIZE(policy->history)) {
+		policy->history_count++;
+	}
+
+	/* Logged in the format of the replay harness traces, so that traces can be recorded from
+	 * the log.
+	 */
+	LOG_DBG("Connection evaluation: %d,%d,%d", sample->energy_estimate, sample->rsrp,
+		sample->ce_level);
+
+	return 0;
+}
+
+bool send_policy_grant(struct send_policy *policy, uint8_t type)
+{
+	const struct send_policy_type_cfg *cfg;
+	const struct send_policy_sample *sample;
+	bool grant;
+
+	if (type >= policy->type_count) {
+		LOG_WRN("Unknown data type: %d, granting send", type);
+		return true;
+	}
+
+	if (policy->history_count == 0) {
+		return true;
+	}
+
+	cfg = &policy->types[type];
+	sample = latest_sample(policy);
+
+	if (policy->mode == SEND_POLICY_ALWAYS) {
+		/* Sends are still recorded, so that radio-on times are learned in all modes. */
+		grant = true;
+	} else if (policy->defer_count[type] >= cfg->defer_max) {
+		/* Grant send if a message has been deferred too many times. */
+		LOG_WRN("Too many attempts, granting send");
+		grant = true;
+	} else if (policy->mode == SEND_POLICY_ADAPTIVE) {
+		grant = adaptive_grant(policy, cfg, sample);
+	} else {
+		grant = threshold_grant(cfg, sample);
+	}
+
+	if (!grant) {
+		LOG_DBG("Send NOT granted, type: %d, energy estimate: %d, attempt: %d", type,
+			sample->energy_estimate, policy->defer_count[type]);
+		policy->defer_count[type]++;
+		return false;
+	}
+
+	LOG_DBG("Send granted, type: %d, energy estimate: %d, attempt: %d", type,
+		sample->energy_estimate, policy->defer_count[type]);
+
+	policy->defer_count[type] = 0;
+	policy->outcome_energy_estimate = sample->energy_estimate;
+
+	return true;
+}
+
+void send_policy_outcome_add(struct send_policy *policy, uint32_t connected_time_ms)
+{
+	int energy_estimate = policy->outcome_energy_estimate;
+	uint32_t *cost_ms;
+
+	if (!energy_estimate_valid(energy_estimate)) {
+		return;
+	}
+
+	cost_ms = &policy->cost_ms[energy_estimate - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE];
+
+	/* Moving average, weighted towards the latest measurements. */
+	*cost_ms = (uint32_t)(((uint64_t)*cost_ms * (COST_WEIGHT - 1) + connected_time_ms) /
+			      COST_WEIGHT);
+
+	LOG_DBG("Radio-on time at energy estimate %d: %u ms, learned: %u ms", energy_estimate,
+		connected_time_ms, *cost_ms);
+
+	policy->outcome_energy_estimate = 0;
+}
+
+uint32_t send_policy_cost_get(const struct send_policy *policy, int energy_estimate)
+{
+	if (!energy_estimate_valid(energy_estimate)) {
+		return 0;
+	}
+
+	return cost(policy, energy_estimate);
+}
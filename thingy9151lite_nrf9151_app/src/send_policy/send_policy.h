@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef SEND_POLICY_H__
+#define SEND_POLICY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <modem/lte_lc.h>
+
+/**@file
+ *
+ * @defgroup send_policy Send policy
+ * @brief    Decides whether data is sent now or deferred, based on LTE connection evaluation.
+ *
+ * @details The policy keeps a history of the latest connection evaluations and learns the
+ *	    radio-on time that sending costs at each energy estimate from the RRC connected
+ *	    time measured after each granted send. Each data type has its own parameters, and
+ *	    a data type is never deferred more than a set number of times in a row.
+ *
+ *	    The policy does not depend on the modem, connection evaluations and measured
+ *	    radio-on times are passed in by the caller. This allows recorded traces to be
+ *	    replayed against the policy.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Maximum number of data types handled by a send policy. */
+#define SEND_POLICY_TYPE_COUNT_MAX 4
+
+/** @brief Number of energy estimates reported by connection evaluation. */
+#define SEND_POLICY_ENERGY_LEVEL_COUNT \
+	(LTE_LC_ENERGY_CONSUMPTION_EFFICIENT - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE + 1)
+
+/** @brief Send policy modes. The values are used in the device configuration. */
+enum send_policy_mode {
+	/** Send when the energy estimate is at least the minimum set for the data type. */
+	SEND_POLICY_THRESHOLD = 0,
+	/** Send when the learned radio-on time at the current energy estimate is among the
+	 *  lowest seen in the history, as set by the percentile of the data type.
+	 */
+	SEND_POLICY_ADAPTIVE = 1,
+	/** Always send. */
+	SEND_POLICY_ALWAYS = 2,
+
+	SEND_POLICY_MODE_COUNT,
+};
+
+/** @brief Parameters of a data type. */
+struct send_policy_type_cfg {
+	/** Minimum energy estimate, of type enum lte_lc_energy_estimate. Used by the threshold
+	 *  policy, and by the adaptive policy until enough history has been collected.
+	 */
+	int energy_min;
+	/** Percentile of the radio-on times in the history that the radio-on time at the
+	 *  current energy estimate must be within for the adaptive policy to send. Lower values
+	 *  wait longer for better conditions.
+	 */
+	uint8_t percentile;
+	/** Maximum number of times in a row that sending can be deferred. */
+	uint8_t defer_max;
+};
+
+/** @brief Connection evaluation kept in the history. */
+struct send_policy_sample {
+	/** Energy estimate, of type enum lte_lc_energy_estimate. */
+	int8_t energy_estimate;
+	/** Coverage enhancement level, of type enum lte_lc_ce_level. */
+	uint8_t ce_level;
+	/** RSRP, as reported by connection evaluation. */
+	int16_t rsrp;
+};
+
+/** @brief Send policy state. Members are internal. */
+struct send_policy {
+	enum send_policy_mode mode;
+	const struct send_policy_type_cfg *types;
+	size_t type_count;
+	uint8_t defer_count[SEND_POLICY_TYPE_COUNT_MAX];
+	struct send_policy_sample history[CONFIG_DATA_SEND_POLICY_HISTORY_SIZE];
+	size_t history_count;
+	size_t history_next;
+	/* Learned radio-on time of a send, per energy estimate [ms]. */
+	uint32_t cost_ms[SEND_POLICY_ENERGY_LEVEL_COUNT];
+	/* Energy estimate when sending was last granted, 0 if no radio-on time is expected. */
+	int8_t outcome_energy_estimate;
+};
+
+/**
+ * @brief Initialize a send policy.
+ *
+ * @param[out] policy Send policy.
+ * @param[in] mode Send policy mode.
+ * @param[in] types Parameters of each data type, indexed by data type. Must stay valid as
+ *		    long as the policy is used.
+ * @param[in] type_count Number of data types.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the mode is unknown or there are too many data types.
+ */
+int send_policy_init(struct send_policy *policy, enum send_policy_mode mode,
+		     const struct send_policy_type_cfg *types, size_t type_count);
+
+/**
+ * @brief Change the mode of a send policy.
+ *
+ * @note The history and the learned radio-on times are kept.
+ *
+ * @param[in] policy Send policy.
+ * @param[in] mode Send policy mode.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the mode is unknown.
+ */
+int send_policy_mode_set(struct send_policy *policy, enum send_policy_mode mode);
+
+/**
+ * @brief Add a connection evaluation to the history.
+ *
+ * @note Decisions made with send_policy_grant() are based on the latest connection
+ *	 evaluation that has been added.
+ *
+ * @param[in] policy Send policy.
+ * @param[in] params Connection evaluation parameters.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the energy estimate is out of range.
+ */
+int send_policy_conn_eval_add(struct send_policy *policy,
+			      const struct lte_lc_conn_eval_params *params);
+
+/**
+ * @brief Decide whether data of a type is sent now or deferred.
+ *
+ * @note Data is always sent if no connection evaluation has been added, if the data type is
+ *	 unknown, or if sending has been deferred the maximum number of times in a row.
+ *
+ * @param[in] policy Send policy.
+ * @param[in] type Data type.
+ *
+ * @return True if the data is to be sent now.
+ */
+bool send_policy_grant(struct send_policy *policy, uint8_t type);
+
+/**
+ * @brief Report the radio-on time that followed a granted send.
+ *
+ * @note The time is attributed to the energy estimate at the last granted send. It is ignored
+ *	 if nothing has been granted since the last report.
+ *
+ * @param[in] policy Send policy.
+ * @param[in] connected_time_ms RRC connected time of the connection used to send [ms].
+ */
+void send_policy_outcome_add(struct send_policy *policy, uint32_t connected_time_ms);
+
+/**
+ * @brief Get the learned radio-on time of a send.
+ *
+ * @param[in] policy Send policy.
+ * @param[in] energy_estimate Energy estimate, of type enum lte_lc_energy_estimate.
+ *
+ * @return Radio-on time [ms], or 0 if the energy estimate is out of range.
+ */
+uint32_t send_policy_cost_get(const struct send_policy *policy, int energy_estimate);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* SEND_POLICY_H__ */
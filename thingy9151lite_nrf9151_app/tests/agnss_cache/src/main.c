@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include <nrf_cloud_agnss_schema_v1.h>
+
+#include "cmock_date_time.h"
+#include "agnss_cache.h"
+
+#define TIME_START	1700000000000LL
+#define MINUTE_MS	(60 * 1000LL)
+#define HOUR_MS		(60 * MINUTE_MS)
+
+/* GPS time [s] of a UNIX time [ms]. */
+#define GPS_TIME_S(_unix_ms)	(((_unix_ms) / 1000) - 315964800LL + 18)
+#define GPS_WEEK_S		604800LL
+
+/* UNIX time returned by the date_time mock, 0 if the date and time are not known. */
+static int64_t time_now;
+
+static uint8_t response[512];
+static size_t response_len;
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static int date_time_now_stub(int64_t *unix_time_ms, int cmock_num_calls)
+{
+	ARG_UNUSED(cmock_num_calls);
+
+	if (time_now == 0) {
+		return -ENODATA;
+	}
+
+	*unix_time_ms = time_now;
+	return 0;
+}
+
+static void response_start(void)
+{
+	response[0] = NRF_CLOUD_AGNSS_BIN_SCHEMA_VERSION;
+	response_len = 1;
+}
+
+static void response_add(uint8_t type, const void *elements, size_t size, uint16_t count)
+{
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(response), response_len + 3 + (count * size));
+
+	response[response_len] = type;
+	sys_put_le16(count, &response[response_len + 1]);
+	response_len += 3;
+
+	memcpy(&response[response_len], elements, count * size);
+	response_len += count * size;
+}
+
+/* Reference times of the elements, at the given UNIX time [ms]. */
+static uint16_t toe_get(int64_t unix_ms)
+{
+	return (GPS_TIME_S(unix_ms) % GPS_WEEK_S) / 16;
+}
+
+static uint8_t toa_get(int64_t unix_ms)
+{
+	return (GPS_TIME_S(unix_ms) % GPS_WEEK_S) / 4096;
+}
+
+static uint8_t wn_get(int64_t unix_ms)
+{
+	return (GPS_TIME_S(unix_ms) / GPS_WEEK_S) & 0xFF;
+}
+
+/* Response with UTC parameters, a Klobuchar correction and ephemerides and almanacs for
+ * satellites 1 and 5, with reference times at the start of the test.
+ */
+static void response_build(void)
+{
+	struct nrf_cloud_agnss_utc utc = {
+		.dn = 7, .tot = toa_get(TIME_START), .wn_t = wn_get(TIME_START) };
+	struct nrf_cloud_agnss_klobuchar klobuchar = { .alpha0 = 1 };
+	struct nrf_cloud_agnss_ephemeris ephemerides[] = {
+		{ .sv_id = 1, .toe = toe_get(TIME_START) },
+		{ .sv_id = 5, .toe = toe_get(TIME_START) },
+	};
+	struct nrf_cloud_agnss_almanac almanacs[] = {
+		{ .sv_id = 1, .toa = toa_get(TIME_START), .wn = wn_get(TIME_START) },
+		{ .sv_id = 5, .toa = toa_get(TIME_START), .wn = wn_get(TIME_START) },
+	};
+
+	response_start();
+	response_add(NRF_CLOUD_AGNSS_UTC_PARAMETERS, &utc, sizeof(utc), 1);
+	response_add(NRF_CLOUD_AGNSS_EPHEMERIDES, ephemerides, sizeof(ephemerides[0]),
+		     ARRAY_SIZE(ephemerides));
+	response_add(NRF_CLOUD_AGNSS_ALMANAC, almanacs, sizeof(almanacs[0]),
+		     ARRAY_SIZE(almanacs));
+	response_add(NRF_CLOUD_AGNSS_KLOBUCHAR_CORRECTION, &klobuchar, sizeof(klobuchar), 1);
+}
+
+static void request_init(struct nrf_modem_gnss_agnss_data_frame *request, uint32_t data_flags,
+			 uint64_t sv_mask_ephe, uint64_t sv_mask_alm)
+{
+	memset(request, 0, sizeof(*request));
+
+	request->data_flags = data_flags;
+	request->system_count = 1;
+	request->system[0].system_id = NRF_MODEM_GNSS_SYSTEM_GPS;
+	request->system[0].sv_mask_ephe = sv_mask_ephe;
+	request->system[0].sv_mask_alm = sv_mask_alm;
+}
+
+/* Count the elements of a type in an A-GNSS response. */
+static uint16_t element_count(const uint8_t *buf, size_t len, uint8_t type)
+{
+	static const struct {
+		uint8_t type;
+		size_t size;
+	} sizes[] = {
+		{ NRF_CLOUD_AGNSS_UTC_PARAMETERS, sizeof(struct nrf_cloud_agnss_utc) },
+		{ NRF_CLOUD_AGNSS_EPHEMERIDES, sizeof(struct nrf_cloud_agnss_ephemeris) },
+		{ NRF_CLOUD_AGNSS_ALMANAC, sizeof(struct nrf_cloud_agnss_almanac) },
+		{ NRF_CLOUD_AGNSS_KLOBUCHAR_CORRECTION, sizeof(struct nrf_cloud_agnss_klobuchar) },
+		{ NRF_CLOUD_AGNSS_NEQUICK_CORRECTION, sizeof(struct nrf_cloud_agnss_nequick) },
+	};
+	size_t pos = 1;
+
+	TEST_ASSERT_EQUAL(NRF_CLOUD_AGNSS_BIN_SCHEMA_VERSION, buf[0]);
+
+	while (pos < len) {
+		uint16_t count = sys_get_le16(&buf[pos + 1]);
+		size_t size = 0;
+
+		for (size_t i = 0; i < ARRAY_SIZE(sizes); i++) {
+			if (sizes[i].type == buf[pos]) {
+				size = sizes[i].size;
+			}
+		}
+
+		TEST_ASSERT_NOT_EQUAL(0, size);
+
+		if (buf[pos] == type) {
+			return count;
+		}
+
+		pos += 3 + (count * size);
+	}
+
+	TEST_ASSERT_EQUAL(len, pos);
+
+	return 0;
+}
+
+void setUp(void)
+{
+	time_now = TIME_START;
+	__cmock_date_time_now_Stub(date_time_now_stub);
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_init());
+	TEST_ASSERT_EQUAL(0, agnss_cache_clear());
+
+	response_build();
+}
+
+void tearDown(void)
+{
+}
+
+void test_agnss_cache_hit(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame request;
+	struct agnss_cache_stats before, after;
+	uint8_t *buf;
+	size_t len;
+
+	TEST_ASSERT_EQUAL(6, agnss_cache_store(response, response_len));
+
+	agnss_cache_stats_get(&before);
+
+	request_init(&request, NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST, BIT64(0) | BIT64(4),
+		     BIT64(0));
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NOT_NULL(buf);
+
+	TEST_ASSERT_EQUAL(1, element_count(buf, len, NRF_CLOUD_AGNSS_UTC_PARAMETERS));
+	TEST_ASSERT_EQUAL(2, element_count(buf, len, NRF_CLOUD_AGNSS_EPHEMERIDES));
+	TEST_ASSERT_EQUAL(1, element_count(buf, len, NRF_CLOUD_AGNSS_ALMANAC));
+	TEST_ASSERT_EQUAL(0, element_count(buf, len, NRF_CLOUD_AGNSS_KLOBUCHAR_CORRECTION));
+
+	k_free(buf);
+
+	/* Nothing is left to request from cloud. */
+	TEST_ASSERT_TRUE(agnss_cache_request_empty(&request));
+
+	agnss_cache_stats_get(&after);
+	TEST_ASSERT_EQUAL(before.hits + 1, after.hits);
+	TEST_ASSERT_EQUAL(before.elements_served + 4, after.elements_served);
+	TEST_ASSERT_EQUAL(before.bytes_served + len, after.bytes_served);
+}
+
+void test_agnss_cache_partial_hit(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame request;
+	struct agnss_cache_stats before, after;
+	uint8_t *buf;
+	size_t len;
+
+	TEST_ASSERT_EQUAL(6, agnss_cache_store(response, response_len));
+
+	agnss_cache_stats_get(&before);
+
+	request_init(&request, NRF_MODEM_GNSS_AGNSS_GPS_SYS_TIME_AND_SV_TOW_REQUEST |
+			       NRF_MODEM_GNSS_AGNSS_NEQUICK_REQUEST |
+			       NRF_MODEM_GNSS_AGNSS_KLOBUCHAR_REQUEST,
+		     BIT64(0) | BIT64(1), 0);
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NOT_NULL(buf);
+
+	TEST_ASSERT_EQUAL(1, element_count(buf, len, NRF_CLOUD_AGNSS_EPHEMERIDES));
+	TEST_ASSERT_EQUAL(1, element_count(buf, len, NRF_CLOUD_AGNSS_KLOBUCHAR_CORRECTION));
+
+	k_free(buf);
+
+	/* Only the data that was not found is left in the request. */
+	TEST_ASSERT_EQUAL(NRF_MODEM_GNSS_AGNSS_GPS_SYS_TIME_AND_SV_TOW_REQUEST |
+			  NRF_MODEM_GNSS_AGNSS_NEQUICK_REQUEST, request.data_flags);
+	TEST_ASSERT_EQUAL_UINT64(BIT64(1), request.system[0].sv_mask_ephe);
+	TEST_ASSERT_FALSE(agnss_cache_request_empty(&request));
+
+	agnss_cache_stats_get(&after);
+	TEST_ASSERT_EQUAL(before.partial_hits + 1, after.partial_hits);
+}
+
+void test_agnss_cache_miss(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame request;
+	struct agnss_cache_stats before, after;
+	uint8_t *buf;
+	size_t len;
+
+	agnss_cache_stats_get(&before);
+
+	request_init(&request, NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST, BIT64(0), 0);
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NULL(buf);
+	TEST_ASSERT_EQUAL(0, len);
+
+	/* The request is left as it was. */
+	TEST_ASSERT_EQUAL(NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST, request.data_flags);
+	TEST_ASSERT_EQUAL_UINT64(BIT64(0), request.system[0].sv_mask_ephe);
+
+	agnss_cache_stats_get(&after);
+	TEST_ASSERT_EQUAL(before.misses + 1, after.misses);
+}
+
+void test_agnss_cache_expiry(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame request;
+	uint8_t *buf;
+	size_t len;
+
+	TEST_ASSERT_EQUAL(6, agnss_cache_store(response, response_len));
+
+	/* Ephemerides have expired, almanacs have not. */
+	time_now += CONFIG_CLOUD_AGNSS_CACHE_EPHEMERIS_VALIDITY_MIN * MINUTE_MS;
+
+	request_init(&request, 0, BIT64(0), BIT64(0));
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NOT_NULL(buf);
+	TEST_ASSERT_EQUAL(0, element_count(buf, len, NRF_CLOUD_AGNSS_EPHEMERIDES));
+	TEST_ASSERT_EQUAL(1, element_count(buf, len, NRF_CLOUD_AGNSS_ALMANAC));
+	TEST_ASSERT_EQUAL_UINT64(BIT64(0), request.system[0].sv_mask_ephe);
+
+	k_free(buf);
+
+	time_now += CONFIG_CLOUD_AGNSS_CACHE_ALMANAC_VALIDITY_HOURS * HOUR_MS;
+
+	request_init(&request, 0, 0, BIT64(0));
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NULL(buf);
+}
+
+/* Ephemerides are valid for a set time after their reference time, not after they were
+ * received.
+ */
+void test_agnss_cache_reference_time(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame request;
+	struct nrf_cloud_agnss_ephemeris ephemeris = {
+		.sv_id = 1, .toe = toe_get(TIME_START - HOUR_MS) };
+	struct nrf_cloud_agnss_ephemeris expired = {
+		.sv_id = 2,
+		.toe = toe_get(TIME_START - (CONFIG_CLOUD_AGNSS_CACHE_EPHEMERIS_VALIDITY_MIN *
+					     MINUTE_MS) - MINUTE_MS) };
+	uint8_t *buf;
+	size_t len;
+
+	response_start();
+	response_add(NRF_CLOUD_AGNSS_EPHEMERIDES, &ephemeris, sizeof(ephemeris), 1);
+	response_add(NRF_CLOUD_AGNSS_EPHEMERIDES, &expired, sizeof(expired), 1);
+
+	/* An element that has already expired is not stored. */
+	TEST_ASSERT_EQUAL(1, agnss_cache_store(response, response_len));
+
+	time_now += (CONFIG_CLOUD_AGNSS_CACHE_EPHEMERIS_VALIDITY_MIN * MINUTE_MS) - HOUR_MS -
+		    MINUTE_MS;
+
+	request_init(&request, 0, BIT64(0) | BIT64(1), 0);
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NOT_NULL(buf);
+	TEST_ASSERT_EQUAL(1, element_count(buf, len, NRF_CLOUD_AGNSS_EPHEMERIDES));
+	TEST_ASSERT_EQUAL_UINT64(BIT64(1), request.system[0].sv_mask_ephe);
+
+	k_free(buf);
+
+	time_now += 2 * MINUTE_MS;
+
+	request_init(&request, 0, BIT64(0), 0);
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NULL(buf);
+}
+
+/* A cached element is only replaced by an element that is valid until later. */
+void test_agnss_cache_store_newer(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame request;
+	struct nrf_cloud_agnss_ephemeris ephemeris = {
+		.sv_id = 1, .toe = toe_get(TIME_START - HOUR_MS) };
+	uint8_t *buf;
+	size_t len;
+
+	TEST_ASSERT_EQUAL(6, agnss_cache_store(response, response_len));
+
+	/* The same data downloaded again is not stored again. */
+	TEST_ASSERT_EQUAL(0, agnss_cache_store(response, response_len));
+
+	/* An older ephemeris does not replace the cached one. */
+	response_start();
+	response_add(NRF_CLOUD_AGNSS_EPHEMERIDES, &ephemeris, sizeof(ephemeris), 1);
+	TEST_ASSERT_EQUAL(0, agnss_cache_store(response, response_len));
+
+	request_init(&request, 0, BIT64(0), 0);
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NOT_NULL(buf);
+	memcpy(&ephemeris, &buf[1 + 3], sizeof(ephemeris));
+	TEST_ASSERT_EQUAL(toe_get(TIME_START), ephemeris.toe);
+
+	k_free(buf);
+
+	/* A newer ephemeris does. */
+	time_now += HOUR_MS;
+	ephemeris.toe = toe_get(time_now);
+
+	response_start();
+	response_add(NRF_CLOUD_AGNSS_EPHEMERIDES, &ephemeris, sizeof(ephemeris), 1);
+	TEST_ASSERT_EQUAL(1, agnss_cache_store(response, response_len));
+}
+
+void test_agnss_cache_reboot(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame request;
+	uint8_t *buf;
+	size_t len;
+
+	TEST_ASSERT_EQUAL(6, agnss_cache_store(response, response_len));
+
+	/* The cache is loaded from flash after a reboot. */
+	TEST_ASSERT_EQUAL(0, agnss_cache_init());
+
+	request_init(&request, NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST, BIT64(4), 0);
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NOT_NULL(buf);
+	TEST_ASSERT_EQUAL(1, element_count(buf, len, NRF_CLOUD_AGNSS_UTC_PARAMETERS));
+	TEST_ASSERT_EQUAL(1, element_count(buf, len, NRF_CLOUD_AGNSS_EPHEMERIDES));
+	TEST_ASSERT_TRUE(agnss_cache_request_empty(&request));
+
+	k_free(buf);
+
+	/* Cleared elements are not loaded. */
+	TEST_ASSERT_EQUAL(0, agnss_cache_clear());
+	TEST_ASSERT_EQUAL(0, agnss_cache_init());
+
+	request_init(&request, NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST, BIT64(4), 0);
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NULL(buf);
+}
+
+void test_agnss_cache_no_time(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame request;
+	uint8_t *buf;
+	size_t len;
+
+	TEST_ASSERT_EQUAL(6, agnss_cache_store(response, response_len));
+
+	time_now = 0;
+
+	TEST_ASSERT_EQUAL(-ENODATA, agnss_cache_store(response, response_len));
+
+	request_init(&request, NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST, BIT64(0), 0);
+
+	TEST_ASSERT_EQUAL(0, agnss_cache_lookup(&request, &buf, &len));
+	TEST_ASSERT_NULL(buf);
+}
+
+void test_agnss_cache_store_invalid(void)
+{
+	struct nrf_cloud_agnss_ephemeris ephemeris = { .sv_id = 1 };
+	uint8_t location[] = { 0 };
+
+	TEST_ASSERT_EQUAL(-EINVAL, agnss_cache_store(NULL, 0));
+	TEST_ASSERT_EQUAL(-EINVAL, agnss_cache_store(response, 1));
+
+	response[0] = NRF_CLOUD_AGNSS_BIN_SCHEMA_VERSION + 1;
+	TEST_ASSERT_EQUAL(-EINVAL, agnss_cache_store(response, response_len));
+
+	/* Parsing stops at an element type that is not cached. */
+	response_start();
+	response_add(NRF_CLOUD_AGNSS_LOCATION, location, sizeof(location), 1);
+	response_add(NRF_CLOUD_AGNSS_EPHEMERIDES, &ephemeris, sizeof(ephemeris), 1);
+	TEST_ASSERT_EQUAL(0, agnss_cache_store(response, response_len));
+
+	/* Truncated elements are not stored. */
+	response_start();
+	response_add(NRF_CLOUD_AGNSS_EPHEMERIDES, &ephemeris, sizeof(ephemeris), 1);
+	TEST_ASSERT_EQUAL(0, agnss_cache_store(response, response_len - 1));
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
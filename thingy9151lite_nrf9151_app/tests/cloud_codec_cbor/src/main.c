@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <stdio.h>
+#include <string.h>
+#include <zcbor_encode.h>
+#include <zcbor_decode.h>
+
+#include "cloud_codec.h"
+#include "cbor/cbor_protocol_keys.h"
+#include "json_validate.h"
+
+/* Timestamp returned by the date_time mock. */
+#define TEST_TIMESTAMP 1563968747123
+
+/* The batch test entries do not fit in a single message of less than 1 kB. */
+#define BATCH_SPLIT ((CONFIG_CLOUD_CODEC_BATCH_SIZE_MAX > 0) && \
+		     (CONFIG_CLOUD_CODEC_BATCH_SIZE_MAX < 1024))
+
+static struct cloud_codec_data output;
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+void setUp(void)
+{
+	memset(&output, 0, sizeof(output));
+}
+
+void tearDown(void)
+{
+	k_free(output.buf);
+}
+
+/* Batch data. The entries are the same as in the batch test of the JSON common codec, so that
+ * the encoded sizes can be compared.
+ */
+
+static struct cloud_data_battery battery[2];
+static struct cloud_data_gnss gnss[2];
+static struct cloud_data_modem_dynamic modem_dynamic[2];
+static struct cloud_data_modem_static modem_static[2];
+static struct cloud_data_ui ui[2];
+static struct cloud_data_impact impact[2];
+static struct cloud_data_sensors environmental[2];
+
+static void batch_data_init(void)
+{
+	for (size_t i = 0; i < 2; i++) {
+		battery[i] = (struct cloud_data_battery){
+			.bat = 3600, .bat_ts = 1000, .queued = true };
+		gnss[i] = (struct cloud_data_gnss){
+			.pvt.longi = 10, .pvt.lat = 62, .pvt.acc = 24, .pvt.alt = 170,
+			.pvt.spd = 1, .pvt.hdg = 176, .gnss_ts = 1000, .queued = true };
+		modem_dynamic[i] = (struct cloud_data_modem_dynamic){
+			.area = 12, .mccmnc = "24202", .cell = 33703719, .ip = "10.81.183.99",
+			.ts = 1000, .queued = true };
+		modem_static[i] = (struct cloud_data_modem_static){
+			.imei = "352656106111232", .iccid = "89450421180216211234",
+			.fw = "mfw_nrf9160_1.2.3", .brdv = "nrf9160dk_nrf9160",
+			.appv = "v1.0.0-development", .ts = 1000, .queued = true };
+		ui[i] = (struct cloud_data_ui){ .btn = 1, .btn_ts = 1000, .queued = true };
+		impact[i] = (struct cloud_data_impact){
+			.magnitude = 300.0, .ts = 1000, .queued = true };
+		environmental[i] = (struct cloud_data_sensors){
+			.humidity = 50, .temperature = 23, .env_ts = 1000, .queued = true };
+	}
+
+	modem_dynamic[0].band = 3;
+	modem_dynamic[0].nw_mode = LTE_LC_LTE_MODE_NBIOT;
+	modem_dynamic[0].rsrp = -8;
+	modem_dynamic[1].band = 20;
+	modem_dynamic[1].nw_mode = LTE_LC_LTE_MODE_LTEM;
+	modem_dynamic[1].rsrp = -5;
+
+	environmental[0].pressure = 80;
+	environmental[0].bsec_air_quality = 50;
+	environmental[1].pressure = 101;
+	environmental[1].bsec_air_quality = 55;
+}
+
+static int batch_data_encode(void)
+{
+	return cloud_codec_encode_batch_data(&output,
+					     gnss,
+					     environmental,
+					     modem_static,
+					     modem_dynamic,
+					     ui,
+					     impact,
+					     battery,
+					     ARRAY_SIZE(gnss),
+					     ARRAY_SIZE(environmental),
+					     ARRAY_SIZE(modem_static),
+					     ARRAY_SIZE(modem_dynamic),
+					     ARRAY_SIZE(ui),
+					     ARRAY_SIZE(impact),
+					     ARRAY_SIZE(battery));
+}
+
+/* Decode a number that is encoded as either an integer or a floating point value. */
+static bool number_decode(zcbor_state_t *state, double *value)
+{
+	int32_t value_int;
+
+	if (zcbor_float_decode(state, value)) {
+		return true;
+	}
+
+	if (zcbor_int32_decode(state, &value_int)) {
+		*value = value_int;
+		return true;
+	}
+
+	return false;
+}
+
+/* Decode an entry map with a single unsigned value. */
+static void uint_entry_check(zcbor_state_t *state, uint32_t value)
+{
+	uint32_t key;
+	uint32_t decoded_value;
+	uint64_t ts;
+
+	TEST_ASSERT_TRUE(zcbor_map_start_decode(state));
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+	TEST_ASSERT_EQUAL(CBOR_DATA_VALUE, key);
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &decoded_value));
+	TEST_ASSERT_EQUAL(value, decoded_value);
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+	TEST_ASSERT_EQUAL(CBOR_DATA_TIMESTAMP, key);
+	TEST_ASSERT_TRUE(zcbor_uint64_decode(state, &ts));
+	TEST_ASSERT_TRUE(TEST_TIMESTAMP == ts);
+	TEST_ASSERT_TRUE(zcbor_map_end_decode(state));
+}
+
+void test_encode_batch_data(void)
+{
+	int ret;
+	uint32_t key;
+	double value;
+	size_t json_len = strlen(TEST_VALIDATE_BATCH_JSON_SCHEMA);
+
+	if (BATCH_SPLIT) {
+		TEST_IGNORE_MESSAGE("Batch is split over several messages");
+	}
+
+	batch_data_init();
+
+	ret = batch_data_encode();
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_NOT_NULL(output.buf);
+
+	printk("Batch size, JSON: %zu bytes, CBOR: %zu bytes\n", json_len, output.len);
+
+	/* The integer keys and binary numbers should at least halve the size of the message. */
+	TEST_ASSERT_LESS_OR_EQUAL(json_len / 2, output.len);
+
+	for (size_t i = 0; i < 2; i++) {
+		TEST_ASSERT_FALSE(battery[i].queued);
+		TEST_ASSERT_FALSE(gnss[i].queued);
+		TEST_ASSERT_FALSE(modem_dynamic[i].queued);
+		TEST_ASSERT_FALSE(modem_static[i].queued);
+		TEST_ASSERT_FALSE(ui[i].queued);
+		TEST_ASSERT_FALSE(impact[i].queued);
+		TEST_ASSERT_FALSE(environmental[i].queued);
+	}
+
+	ZCBOR_STATE_D(state, 4, output.buf, output.len, 1, 0);
+
+	TEST_ASSERT_TRUE(zcbor_map_start_decode(state));
+
+	/* Entries are encoded in a fixed order, check the GNSS entries and skip ahead to the last
+	 * three data types.
+	 */
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+	TEST_ASSERT_EQUAL(CBOR_DATA_MODEM_STATIC, key);
+	TEST_ASSERT_TRUE(zcbor_any_skip(state, NULL));
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+	TEST_ASSERT_EQUAL(CBOR_DATA_MODEM_DYNAMIC, key);
+	TEST_ASSERT_TRUE(zcbor_any_skip(state, NULL));
+
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+	TEST_ASSERT_EQUAL(CBOR_DATA_GNSS, key);
+	TEST_ASSERT_TRUE(zcbor_list_start_decode(state));
+
+	for (size_t i = 0; i < 2; i++) {
+		TEST_ASSERT_TRUE(zcbor_map_start_decode(state));
+		TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+		TEST_ASSERT_EQUAL(CBOR_DATA_VALUE, key);
+		TEST_ASSERT_TRUE(zcbor_map_start_decode(state));
+		TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+		TEST_ASSERT_EQUAL(CBOR_GNSS_LONGITUDE, key);
+		TEST_ASSERT_TRUE(number_decode(state, &value));
+		TEST_ASSERT_EQUAL_DOUBLE(10, value);
+		TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+		TEST_ASSERT_EQUAL(CBOR_GNSS_LATITUDE, key);
+		TEST_ASSERT_TRUE(number_decode(state, &value));
+		TEST_ASSERT_EQUAL_DOUBLE(62, value);
+
+		while (!zcbor_array_at_end(state)) {
+			TEST_ASSERT_TRUE(zcbor_any_skip(state, NULL));
+		}
+
+		TEST_ASSERT_TRUE(zcbor_map_end_decode(state));
+
+		while (!zcbor_array_at_end(state)) {
+			TEST_ASSERT_TRUE(zcbor_any_skip(state, NULL));
+		}
+
+		TEST_ASSERT_TRUE(zcbor_map_end_decode(state));
+	}
+
+	TEST_ASSERT_TRUE(zcbor_list_end_decode(state));
+
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+	TEST_ASSERT_EQUAL(CBOR_DATA_ENVIRONMENTALS, key);
+	TEST_ASSERT_TRUE(zcbor_any_skip(state, NULL));
+
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+	TEST_ASSERT_EQUAL(CBOR_DATA_BUTTON, key);
+	TEST_ASSERT_TRUE(zcbor_list_start_decode(state));
+	uint_entry_check(state, 1);
+	uint_entry_check(state, 1);
+	TEST_ASSERT_TRUE(zcbor_list_end_decode(state));
+
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+	TEST_ASSERT_EQUAL(CBOR_DATA_IMPACT, key);
+	TEST_ASSERT_TRUE(zcbor_any_skip(state, NULL));
+
+	TEST_ASSERT_TRUE(zcbor_uint32_decode(state, &key));
+	TEST_ASSERT_EQUAL(CBOR_DATA_BATTERY, key);
+	TEST_ASSERT_TRUE(zcbor_list_start_decode(state));
+	uint_entry_check(state, 3600);
+	uint_entry_check(state, 3600);
+	TEST_ASSERT_TRUE(zcbor_list_end_decode(state));
+
+	TEST_ASSERT_TRUE(zcbor_map_end_decode(state));
+	TEST_ASSERT_EQUAL_PTR((uint8_t *)output.buf + output.len, state->payload);
+}
+
+void test_encode_batch_data_empty(void)
+{
+	int ret;
+
+	if (BATCH_SPLIT) {
+		TEST_IGNORE_MESSAGE("Batch is split over several messages");
+	}
+
+	batch_data_init();
+
+	ret = batch_data_encode();
+	TEST_ASSERT_EQUAL(0, ret);
+	k_free(output.buf);
+	memset(&output, 0, sizeof(output));
+
+	/* All entries have been dequeued by the previous call. */
+	ret = batch_data_encode();
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+	TEST_ASSERT_NULL(output.buf);
+}
+
+/* Entries that do not fit in the maximum batch message size are encoded in the following
+ * messages. The size of an entry is bounded from the size of its structure.
+ */
+void test_encode_batch_data_size_max(void)
+{
+	int ret;
+	size_t count = 0;
+
+	batch_data_init();
+
+	while (true) {
+		ret = batch_data_encode();
+		if (ret != 0) {
+			break;
+		}
+
+		count++;
+
+		if (CONFIG_CLOUD_CODEC_BATCH_SIZE_MAX > 0) {
+			TEST_ASSERT_LESS_OR_EQUAL(CONFIG_CLOUD_CODEC_BATCH_SIZE_MAX, output.len);
+		}
+
+		k_free(output.buf);
+		memset(&output, 0, sizeof(output));
+	}
+
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+
+	if (BATCH_SPLIT) {
+		TEST_ASSERT_GREATER_THAN(1, count);
+	} else {
+		TEST_ASSERT_EQUAL(1, count);
+	}
+
+	/* All entries have been dequeued. */
+	for (size_t i = 0; i < 2; i++) {
+		TEST_ASSERT_FALSE(battery[i].queued);
+		TEST_ASSERT_FALSE(gnss[i].queued);
+		TEST_ASSERT_FALSE(modem_dynamic[i].queued);
+		TEST_ASSERT_FALSE(modem_static[i].queued);
+		TEST_ASSERT_FALSE(ui[i].queued);
+		TEST_ASSERT_FALSE(impact[i].queued);
+		TEST_ASSERT_FALSE(environmental[i].queued);
+	}
+}
+
+/* Button messages are sent to the messages topic and encoded in CBOR. Data messages update the
+ * device shadow and are encoded in JSON, see below.
+ */
+void test_encode_ui_data(void)
+{
+	int ret;
+	struct cloud_data_ui data = {
+		.btn = 1,
+		.btn_ts = 1000,
+		.queued = true
+	};
+	/* {6: {0: 1, 1: 1563968747123}} */
+	const uint8_t expected[] = {
+		0xA1, 0x06, 0xA2, 0x00, 0x01, 0x01,
+		0x1B, 0x00, 0x00, 0x01, 0x6C, 0x23, 0xCD, 0x36, 0x73
+	};
+
+	ret = cloud_codec_encode_ui_data(&output, &data);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_EQUAL(sizeof(expected), output.len);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, output.buf, sizeof(expected));
+	TEST_ASSERT_FALSE(data.queued);
+}
+
+/* Device shadow. The device shadow only accepts JSON, so the shadow messages are encoded and
+ * decoded by the AWS IoT codec when CBOR is enabled.
+ */
+
+static const struct cloud_data_cfg config = {
+	.active_mode = false,
+	.active_wait_timeout = 120,
+	.movement_resolution = 120,
+	.movement_timeout = 3600,
+	.location_timeout = 60,
+	.accelerometer_activity_threshold = 10.5,
+	.accelerometer_inactivity_threshold = 5,
+	.accelerometer_inactivity_timeout = 80,
+	.no_data.gnss = true,
+	.no_data.neighbor_cell = true,
+	.send_policy = 1
+};
+
+/* Delta document as published by AWS IoT to $aws/things/<thing name>/shadow/update/delta. */
+static const char shadow_delta[] =
+	"{\"version\":42,\"timestamp\":1700000000,"
+	"\"state\":{\"cfg\":{\"act\":false,\"actwt\":120,\"mvres\":120,\"mvt\":3600,"
+	"\"loct\":60,\"accath\":10.5,\"accith\":5,\"accito\":80,\"sndpol\":1,"
+	"\"nod\":[\"gnss\",\"ncell\"]}},"
+	"\"metadata\":{\"cfg\":{\"act\":{\"timestamp\":1700000000},"
+	"\"loct\":{\"timestamp\":1700000000}}}}";
+
+void test_decode_shadow_delta(void)
+{
+	int ret;
+	struct cloud_data_cfg decoded = {0};
+
+	ret = cloud_codec_decode_config(shadow_delta, strlen(shadow_delta), &decoded);
+	TEST_ASSERT_EQUAL(0, ret);
+
+	TEST_ASSERT_EQUAL(config.active_mode, decoded.active_mode);
+	TEST_ASSERT_EQUAL(config.active_wait_timeout, decoded.active_wait_timeout);
+	TEST_ASSERT_EQUAL(config.movement_resolution, decoded.movement_resolution);
+	TEST_ASSERT_EQUAL(config.movement_timeout, decoded.movement_timeout);
+	TEST_ASSERT_EQUAL(config.location_timeout, decoded.location_timeout);
+	TEST_ASSERT_EQUAL_DOUBLE(config.accelerometer_activity_threshold,
+				 decoded.accelerometer_activity_threshold);
+	TEST_ASSERT_EQUAL_DOUBLE(config.accelerometer_inactivity_threshold,
+				 decoded.accelerometer_inactivity_threshold);
+	TEST_ASSERT_EQUAL_DOUBLE(config.accelerometer_inactivity_timeout,
+				 decoded.accelerometer_inactivity_timeout);
+	TEST_ASSERT_EQUAL(config.no_data.gnss, decoded.no_data.gnss);
+	TEST_ASSERT_EQUAL(config.no_data.neighbor_cell, decoded.no_data.neighbor_cell);
+	TEST_ASSERT_EQUAL(config.no_data.wifi, decoded.no_data.wifi);
+	TEST_ASSERT_EQUAL(config.send_policy, decoded.send_policy);
+
+	/* A retransmitted delta with the same version must not be handled twice. */
+	ret = cloud_codec_decode_config(shadow_delta, strlen(shadow_delta), &decoded);
+	TEST_ASSERT_EQUAL(-ECANCELED, ret);
+}
+
+void test_encode_configuration_json(void)
+{
+	int ret;
+	struct cloud_data_cfg data = config;
+	const char prefix[] = "{\"state\":{\"reported\":{\"cfg\":{";
+
+	ret = cloud_codec_encode_config(&output, &data);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_EQUAL_MEMORY(prefix, output.buf, sizeof(prefix) - 1);
+}
+
+void test_encode_shadow_data_json(void)
+{
+	int ret;
+	struct cloud_data_gnss gnss_data = {0};
+	struct cloud_data_sensors sensor_data = {0};
+	struct cloud_data_modem_static modem_static_data = {0};
+	struct cloud_data_modem_dynamic modem_dynamic_data = {0};
+	struct cloud_data_ui ui_data = { .btn = 1, .btn_ts = 1000, .queued = true };
+	struct cloud_data_impact impact_data = {0};
+	struct cloud_data_battery battery_data = {0};
+	const char expected[] =
+		"{\"state\":{\"reported\":{\"btn\":{\"v\":1,\"ts\":1563968747123}}}}";
+
+	ret = cloud_codec_encode_data(&output, &gnss_data, &sensor_data, &modem_static_data,
+				      &modem_dynamic_data, &ui_data, &impact_data, &battery_data);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_EQUAL(strlen(expected), output.len);
+	TEST_ASSERT_EQUAL_MEMORY(expected, output.buf, output.len);
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
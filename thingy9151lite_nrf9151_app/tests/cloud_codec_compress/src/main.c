@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#include "cloud_codec.h"
+#include "cloud_codec_compress.h"
+
+/* Size of the LZ4 frame header written by the compressor. */
+#define FRAME_HEADER_SIZE 15
+
+/* Batch message in the format of the AWS IoT codec. */
+static const char batch[] =
+	"{\"bat\":[{\"v\":3600,\"ts\":1563968747123},{\"v\":3590,\"ts\":1563968807123},"
+	"{\"v\":3580,\"ts\":1563968867123}],"
+	"\"env\":[{\"v\":{\"temp\":23.5,\"hum\":50.1,\"pressure\":101.3},\"ts\":1563968747123},"
+	"{\"v\":{\"temp\":23.6,\"hum\":50.2,\"pressure\":101.3},\"ts\":1563968807123},"
+	"{\"v\":{\"temp\":23.7,\"hum\":50.2,\"pressure\":101.4},\"ts\":1563968867123},"
+	"{\"v\":{\"temp\":23.8,\"hum\":50.3,\"pressure\":101.4},\"ts\":1563968927123}],"
+	"\"gnss\":[{\"v\":{\"lng\":10.4351,\"lat\":63.4305,\"acc\":4.5,\"alt\":45.2,\"spd\":1.4,"
+	"\"hdg\":45.3},\"ts\":1563968747123},{\"v\":{\"lng\":10.4359,\"lat\":63.4310,\"acc\":4.1,"
+	"\"alt\":45.0,\"spd\":1.5,\"hdg\":44.9},\"ts\":1563968807123},{\"v\":{\"lng\":10.4367,"
+	"\"lat\":63.4315,\"acc\":3.9,\"alt\":44.8,\"spd\":1.4,\"hdg\":45.1},"
+	"\"ts\":1563968867123}]}";
+
+/* Decompressed message. */
+static uint8_t decompressed[sizeof(batch)];
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+/* Decode an LZ4 frame written by the compressor. Returns the decompressed length. */
+static size_t frame_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t size)
+{
+	size_t in = FRAME_HEADER_SIZE;
+	size_t out = 0;
+
+	TEST_ASSERT_GREATER_OR_EQUAL(FRAME_HEADER_SIZE, len);
+	TEST_ASSERT_EQUAL_HEX32(CLOUD_CODEC_COMPRESS_MAGIC, sys_get_le32(src));
+
+	while (true) {
+		uint32_t block_size = sys_get_le32(&src[in]);
+		size_t block_end;
+
+		in += sizeof(uint32_t);
+
+		if (block_size == 0) {
+			break;
+		}
+
+		if (block_size & BIT(31)) {
+			block_size &= ~BIT(31);
+			TEST_ASSERT_LESS_OR_EQUAL(size - out, block_size);
+			memcpy(&dst[out], &src[in], block_size);
+			in += block_size;
+			out += block_size;
+			continue;
+		}
+
+		block_end = in + block_size;
+
+		while (in < block_end) {
+			uint8_t token = src[in++];
+			size_t literal_len = token >> 4;
+			size_t match_len = token & 0x0F;
+			size_t offset;
+
+			if (literal_len == 15) {
+				do {
+					literal_len += src[in];
+				} while (src[in++] == UINT8_MAX);
+			}
+
+			TEST_ASSERT_LESS_OR_EQUAL(size - out, literal_len);
+			memcpy(&dst[out], &src[in], literal_len);
+			in += literal_len;
+			out += literal_len;
+
+			/* The last sequence of a block only has literals. */
+			if (in == block_end) {
+				break;
+			}
+
+			offset = src[in] | (src[in + 1] << 8);
+			in += 2;
+
+			if (match_len == 15) {
+				do {
+					match_len += src[in];
+				} while (src[in++] == UINT8_MAX);
+			}
+
+			match_len += 4;
+
+			TEST_ASSERT_TRUE(offset > 0 && offset <= out);
+			TEST_ASSERT_LESS_OR_EQUAL(size - out, match_len);
+
+			/* Matches may overlap the output, copy byte by byte. */
+			for (size_t i = 0; i < match_len; i++, out++) {
+				dst[out] = dst[out - offset];
+			}
+		}
+
+		TEST_ASSERT_EQUAL(block_end, in);
+	}
+
+	TEST_ASSERT_EQUAL(len, in);
+
+	return out;
+}
+
+static struct cloud_codec_data message_alloc(const void *data, size_t len)
+{
+	struct cloud_codec_data message = {
+		.buf = k_malloc(len),
+		.len = len,
+	};
+
+	TEST_ASSERT_NOT_NULL(message.buf);
+	memcpy(message.buf, data, len);
+
+	return message;
+}
+
+void setUp(void)
+{
+	cloud_codec_compress_stats_reset();
+	memset(decompressed, 0, sizeof(decompressed));
+}
+
+void test_compress_batch(void)
+{
+	struct cloud_codec_data message = message_alloc(batch, strlen(batch));
+	size_t len;
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_compress(&message));
+	TEST_ASSERT_TRUE(cloud_codec_compressed((const uint8_t *)message.buf, message.len));
+
+	/* Batch messages are repetitive, expect at least a third to be saved. */
+	TEST_ASSERT_LESS_THAN(strlen(batch) * 2 / 3, message.len);
+
+	len = frame_decode((const uint8_t *)message.buf, message.len, decompressed,
+			   sizeof(decompressed));
+	TEST_ASSERT_EQUAL(strlen(batch), len);
+	TEST_ASSERT_EQUAL_MEMORY(batch, decompressed, len);
+
+	k_free(message.buf);
+}
+
+void test_compress_repeated(void)
+{
+	/* Long literal and match lengths that do not fit in the token. */
+	static uint8_t repeated[sizeof(decompressed)];
+	struct cloud_codec_data message;
+	size_t len;
+
+	for (size_t i = 0; i < sizeof(repeated); i++) {
+		repeated[i] = (i < 300) ? (uint8_t)(i * 7) : 'a';
+	}
+
+	message = message_alloc(repeated, sizeof(repeated));
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_compress(&message));
+
+	len = frame_decode((const uint8_t *)message.buf, message.len, decompressed,
+			   sizeof(decompressed));
+	TEST_ASSERT_EQUAL(sizeof(repeated), len);
+	TEST_ASSERT_EQUAL_MEMORY(repeated, decompressed, len);
+
+	k_free(message.buf);
+}
+
+void test_compress_incompressible(void)
+{
+	uint8_t noise[256];
+	uint32_t state = 1;
+	struct cloud_codec_data message;
+	char *buf;
+
+	for (size_t i = 0; i < sizeof(noise); i++) {
+		state = state * 1103515245 + 12345;
+		noise[i] = state >> 16;
+	}
+
+	message = message_alloc(noise, sizeof(noise));
+	buf = message.buf;
+
+	/* The message is left unchanged. */
+	TEST_ASSERT_EQUAL(-EMSGSIZE, cloud_codec_compress(&message));
+	TEST_ASSERT_EQUAL_PTR(buf, message.buf);
+	TEST_ASSERT_EQUAL(sizeof(noise), message.len);
+	TEST_ASSERT_FALSE(cloud_codec_compressed((const uint8_t *)message.buf, message.len));
+
+	k_free(message.buf);
+}
+
+void test_compress_short(void)
+{
+	struct cloud_codec_data message = message_alloc("{}", 2);
+
+	TEST_ASSERT_EQUAL(-EMSGSIZE, cloud_codec_compress(&message));
+	TEST_ASSERT_EQUAL_MEMORY("{}", message.buf, 2);
+
+	k_free(message.buf);
+}
+
+void test_compress_invalid(void)
+{
+	struct cloud_codec_data message = { 0 };
+
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_codec_compress(NULL));
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_codec_compress(&message));
+}
+
+void test_compressed_json(void)
+{
+	TEST_ASSERT_FALSE(cloud_codec_compressed((const uint8_t *)batch, strlen(batch)));
+	TEST_ASSERT_FALSE(cloud_codec_compressed(NULL, 0));
+}
+
+void test_compress_stats(void)
+{
+	struct cloud_codec_compress_stats stats;
+	struct cloud_codec_data message = message_alloc(batch, strlen(batch));
+	struct cloud_codec_data uncompressed = message_alloc("{}", 2);
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_compress(&message));
+	TEST_ASSERT_EQUAL(-EMSGSIZE, cloud_codec_compress(&uncompressed));
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_compress_stats_get(&stats));
+	TEST_ASSERT_EQUAL(1, stats.count);
+	TEST_ASSERT_EQUAL(1, stats.skipped);
+	TEST_ASSERT_EQUAL(strlen(batch), stats.bytes_in);
+	TEST_ASSERT_EQUAL(message.len, stats.bytes_out);
+	TEST_ASSERT_EQUAL(stats.last_us, stats.max_us);
+	TEST_ASSERT_EQUAL(stats.last_us, stats.total_us);
+
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_codec_compress_stats_get(NULL));
+
+	cloud_codec_compress_stats_reset();
+	TEST_ASSERT_EQUAL(0, cloud_codec_compress_stats_get(&stats));
+	TEST_ASSERT_EQUAL(0, stats.count);
+	TEST_ASSERT_EQUAL(0, stats.skipped);
+
+	k_free(message.buf);
+	k_free(uncompressed.buf);
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
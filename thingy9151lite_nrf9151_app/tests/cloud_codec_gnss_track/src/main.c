@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include "cloud_codec.h"
+#include "cloud_codec_gnss_track.h"
+
+/* Default number of blocks in the data module, CONFIG_DATA_GNSS_TRACK_BLOCK_COUNT. */
+#define TEST_BLOCK_COUNT 4
+
+/* Number of fixes in the synthetic track. Enough to overflow the track. */
+#define TEST_FIX_COUNT 400
+
+/* Interval between fixes in the synthetic track. */
+#define TEST_FIX_INTERVAL_MS 60000
+
+static struct cloud_codec_gnss_track_block blocks[TEST_BLOCK_COUNT];
+static struct cloud_codec_gnss_track track = CLOUD_CODEC_GNSS_TRACK_INITIALIZER(blocks);
+
+/* Synthetic track. */
+static struct cloud_data_gnss fixes[TEST_FIX_COUNT];
+
+/* State of the pseudo random number generator used to add noise to the synthetic track. */
+static uint32_t prng_state = 1;
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static int32_t noise(int32_t amplitude)
+{
+	prng_state = prng_state * 1103515245 + 12345;
+
+	return (int32_t)((prng_state >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+/* Fix number n of an asset moving north-east at walking speed, sampled once a minute. */
+static struct cloud_data_gnss fix_generate(int n)
+{
+	struct cloud_data_gnss fix = {
+		.gnss_ts = 1000000 + (int64_t)n * TEST_FIX_INTERVAL_MS + noise(500),
+		.pvt = {
+			.lat = 63.4305 + n * 0.0005 + noise(20) * 1e-6,
+			.longi = 10.3951 + n * 0.0008 + noise(20) * 1e-6,
+			.alt = 45.0f + noise(30) / 10.0f,
+			.acc = 4.0f + noise(15) / 10.0f,
+			.spd = 1.4f + noise(3) / 10.0f,
+			.hdg = 45.0f + noise(50) / 10.0f,
+		},
+		.queued = true
+	};
+
+	return fix;
+}
+
+void setUp(void)
+{
+	cloud_codec_gnss_track_reset(&track);
+
+	for (int i = 0; i < ARRAY_SIZE(fixes); i++) {
+		fixes[i] = fix_generate(i);
+	}
+}
+
+static void fix_assert_equal(const struct cloud_data_gnss *expected,
+			     const struct cloud_data_gnss *actual)
+{
+	TEST_ASSERT_EQUAL_INT64(expected->gnss_ts, actual->gnss_ts);
+	TEST_ASSERT_DOUBLE_WITHIN(0.6e-6, expected->pvt.lat, actual->pvt.lat);
+	TEST_ASSERT_DOUBLE_WITHIN(0.6e-6, expected->pvt.longi, actual->pvt.longi);
+	TEST_ASSERT_FLOAT_WITHIN(0.06f, expected->pvt.alt, actual->pvt.alt);
+	TEST_ASSERT_FLOAT_WITHIN(0.06f, expected->pvt.acc, actual->pvt.acc);
+	TEST_ASSERT_FLOAT_WITHIN(0.06f, expected->pvt.spd, actual->pvt.spd);
+	TEST_ASSERT_FLOAT_WITHIN(0.06f, expected->pvt.hdg, actual->pvt.hdg);
+	TEST_ASSERT_TRUE(actual->queued);
+	TEST_ASSERT_FALSE(actual->ts_unix);
+}
+
+void test_empty_track(void)
+{
+	struct cloud_data_gnss fix;
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_count(&track));
+	TEST_ASSERT_EQUAL(-ENODATA, cloud_codec_gnss_track_get(&track, &fix));
+	TEST_ASSERT_FALSE(cloud_codec_gnss_track_newest(&track)->queued);
+}
+
+void test_fixes_are_returned_oldest_first(void)
+{
+	struct cloud_data_gnss fix;
+
+	for (int i = 0; i < 20; i++) {
+		cloud_codec_gnss_track_add(&track, &fixes[i]);
+	}
+
+	TEST_ASSERT_EQUAL(20, cloud_codec_gnss_track_count(&track));
+
+	for (int i = 0; i < 20; i++) {
+		TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_get(&track, &fix));
+		fix_assert_equal(&fixes[i], &fix);
+	}
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_count(&track));
+	TEST_ASSERT_EQUAL(-ENODATA, cloud_codec_gnss_track_get(&track, &fix));
+}
+
+void test_newest_fix_is_uncompressed(void)
+{
+	cloud_codec_gnss_track_add(&track, &fixes[0]);
+	cloud_codec_gnss_track_add(&track, &fixes[1]);
+
+	TEST_ASSERT_EQUAL_MEMORY(&fixes[1], cloud_codec_gnss_track_newest(&track),
+				 sizeof(struct cloud_data_gnss));
+}
+
+void test_sent_newest_fix_is_not_stored(void)
+{
+	struct cloud_data_gnss fix;
+
+	cloud_codec_gnss_track_add(&track, &fixes[0]);
+
+	/* Newest fix encoded outside of a batch message. */
+	cloud_codec_gnss_track_newest(&track)->queued = false;
+
+	cloud_codec_gnss_track_add(&track, &fixes[1]);
+
+	TEST_ASSERT_EQUAL(1, cloud_codec_gnss_track_count(&track));
+	TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_get(&track, &fix));
+	fix_assert_equal(&fixes[1], &fix);
+	TEST_ASSERT_FALSE(cloud_codec_gnss_track_newest(&track)->queued);
+}
+
+void test_oldest_block_is_dropped_when_full(void)
+{
+	struct cloud_data_gnss fix;
+	int added = 0;
+	size_t count;
+
+	/* Add fixes until the first block has been dropped. */
+	do {
+		TEST_ASSERT_TRUE(added < ARRAY_SIZE(fixes));
+		cloud_codec_gnss_track_add(&track, &fixes[added++]);
+		count = cloud_codec_gnss_track_count(&track);
+	} while (count == added);
+
+	/* Remaining fixes are the newest ones, in order. */
+	for (int i = added - count; i < added; i++) {
+		TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_get(&track, &fix));
+		fix_assert_equal(&fixes[i], &fix);
+	}
+
+	TEST_ASSERT_EQUAL(-ENODATA, cloud_codec_gnss_track_get(&track, &fix));
+}
+
+void test_add_after_partial_read(void)
+{
+	struct cloud_data_gnss fix;
+
+	for (int i = 0; i < 4; i++) {
+		cloud_codec_gnss_track_add(&track, &fixes[i]);
+	}
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_get(&track, &fix));
+	fix_assert_equal(&fixes[0], &fix);
+
+	for (int i = 4; i < 6; i++) {
+		cloud_codec_gnss_track_add(&track, &fixes[i]);
+	}
+
+	for (int i = 1; i < 6; i++) {
+		TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_get(&track, &fix));
+		fix_assert_equal(&fixes[i], &fix);
+	}
+}
+
+/* Test that fixes added after all fixes in a full block have been read are returned. */
+void test_add_after_full_read(void)
+{
+	struct cloud_data_gnss fix;
+	size_t block_fixes;
+	size_t tail;
+	int first;
+	int added = 0;
+
+	/* Find the number of fixes that fill the first block. */
+	do {
+		TEST_ASSERT_TRUE(added < ARRAY_SIZE(fixes));
+		cloud_codec_gnss_track_add(&track, &fixes[added++]);
+	} while (track.used < 2);
+
+	block_fixes = blocks[0].count;
+	cloud_codec_gnss_track_reset(&track);
+
+	/* Fill the first block. The last fix is kept uncompressed as the newest fix. */
+	for (added = 0; added <= block_fixes; added++) {
+		cloud_codec_gnss_track_add(&track, &fixes[added]);
+	}
+
+	TEST_ASSERT_EQUAL(1, track.used);
+
+	for (int i = 0; i < added; i++) {
+		TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_get(&track, &fix));
+		fix_assert_equal(&fixes[i], &fix);
+	}
+
+	TEST_ASSERT_EQUAL(-ENODATA, cloud_codec_gnss_track_get(&track, &fix));
+
+	/* Add fixes until a new block has been opened. */
+	tail = track.tail;
+	first = added;
+
+	do {
+		TEST_ASSERT_TRUE(added < ARRAY_SIZE(fixes));
+		cloud_codec_gnss_track_add(&track, &fixes[added++]);
+	} while ((track.tail == tail) && (track.used == 1));
+
+	TEST_ASSERT_EQUAL(added - first, cloud_codec_gnss_track_count(&track));
+
+	for (int i = first; i < added; i++) {
+		TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_get(&track, &fix));
+		fix_assert_equal(&fixes[i], &fix);
+	}
+
+	TEST_ASSERT_EQUAL(-ENODATA, cloud_codec_gnss_track_get(&track, &fix));
+}
+
+/* Test that peeked fixes stay queued until they are released, across blocks and including the
+ * newest fix.
+ */
+void test_peek_and_release(void)
+{
+	struct cloud_data_gnss peeked[8];
+	size_t count;
+	int added = 0;
+
+	/* Add fixes until the second block has been opened, and then a few more. */
+	do {
+		TEST_ASSERT_TRUE(added < ARRAY_SIZE(fixes));
+		cloud_codec_gnss_track_add(&track, &fixes[added++]);
+	} while (track.used < 2);
+
+	for (int i = 0; i < 5; i++) {
+		cloud_codec_gnss_track_add(&track, &fixes[added++]);
+	}
+
+	/* Release all but the last fixes of the first block. */
+	cloud_codec_gnss_track_release(&track, blocks[0].count - 3);
+	count = cloud_codec_gnss_track_count(&track);
+
+	TEST_ASSERT_EQUAL(ARRAY_SIZE(peeked), cloud_codec_gnss_track_peek(&track, peeked,
+									ARRAY_SIZE(peeked)));
+	TEST_ASSERT_EQUAL(count, cloud_codec_gnss_track_count(&track));
+
+	for (int i = 0; i < ARRAY_SIZE(peeked); i++) {
+		fix_assert_equal(&fixes[added - count + i], &peeked[i]);
+	}
+
+	cloud_codec_gnss_track_release(&track, 5);
+	TEST_ASSERT_EQUAL(count - 5, cloud_codec_gnss_track_count(&track));
+
+	/* The remaining fixes are the newest ones, and the last one is the uncompressed newest
+	 * fix.
+	 */
+	TEST_ASSERT_EQUAL(count - 5, cloud_codec_gnss_track_peek(&track, peeked,
+								 ARRAY_SIZE(peeked)));
+
+	for (int i = 0; i < count - 5; i++) {
+		fix_assert_equal(&fixes[added - count + 5 + i], &peeked[i]);
+	}
+
+	cloud_codec_gnss_track_release(&track, count - 5);
+	TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_count(&track));
+	TEST_ASSERT_EQUAL(0, cloud_codec_gnss_track_peek(&track, peeked, ARRAY_SIZE(peeked)));
+}
+
+void test_compression_ratio(void)
+{
+	/* Number of uncompressed fixes that fit in the same amount of RAM, including the state
+	 * of the track.
+	 */
+	size_t uncompressed = (sizeof(blocks) + sizeof(track)) / sizeof(struct cloud_data_gnss);
+	size_t stored = 0;
+	int added = 0;
+
+	/* Fill all blocks, until the first block is dropped. */
+	while (true) {
+		TEST_ASSERT_TRUE(added < ARRAY_SIZE(fixes));
+		cloud_codec_gnss_track_add(&track, &fixes[added++]);
+
+		if (cloud_codec_gnss_track_count(&track) < added) {
+			break;
+		}
+
+		stored = cloud_codec_gnss_track_count(&track);
+	}
+
+	/* At least five times as many fixes as an uncompressed ringbuffer of the same size. */
+	TEST_ASSERT_GREATER_OR_EQUAL(5 * uncompressed, stored);
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
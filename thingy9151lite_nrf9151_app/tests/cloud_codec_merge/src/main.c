@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include "cloud_codec.h"
+#include "cloud_codec_merge.h"
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static struct cloud_codec_data dst;
+static struct cloud_codec_data src;
+
+/* Populate a message with a heap allocated copy of a string, as the codecs output it. */
+static void message_set(struct cloud_codec_data *msg, const char *str)
+{
+	msg->len = strlen(str);
+	msg->buf = k_malloc(msg->len + 1);
+
+	TEST_ASSERT_NOT_NULL(msg->buf);
+	memcpy(msg->buf, str, msg->len + 1);
+}
+
+static void merge_expect(const char *a, const char *b, const char *merged)
+{
+	message_set(&dst, a);
+	message_set(&src, b);
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_merge(&dst, &src, 0));
+	TEST_ASSERT_EQUAL(strlen(merged), dst.len);
+	TEST_ASSERT_EQUAL_STRING(merged, dst.buf);
+
+	/* The second message is not changed. */
+	TEST_ASSERT_EQUAL_STRING(b, src.buf);
+}
+
+static void merge_fail_expect(const char *a, const char *b, int err)
+{
+	message_set(&dst, a);
+	message_set(&src, b);
+
+	TEST_ASSERT_EQUAL(err, cloud_codec_merge(&dst, &src, 0));
+
+	/* Both messages are left unchanged. */
+	TEST_ASSERT_EQUAL_STRING(a, dst.buf);
+	TEST_ASSERT_EQUAL(strlen(a), dst.len);
+	TEST_ASSERT_EQUAL_STRING(b, src.buf);
+}
+
+void setUp(void)
+{
+	memset(&dst, 0, sizeof(dst));
+	memset(&src, 0, sizeof(src));
+}
+
+void tearDown(void)
+{
+	k_free(dst.buf);
+	k_free(src.buf);
+}
+
+void test_merge_arrays(void)
+{
+	/* Batch messages in the format of the nRF Cloud codec. */
+	merge_expect("[{\"appId\":\"BUTTON\",\"data\":\"1\",\"ts\":1563968747123}]",
+		     "[{\"appId\":\"GNSS\",\"data\":{\"lat\":63.4305},\"ts\":1563968747124},"
+		     "{\"appId\":\"TEMP\",\"data\":\"23.5\",\"ts\":1563968747125}]",
+		     "[{\"appId\":\"BUTTON\",\"data\":\"1\",\"ts\":1563968747123},"
+		     "{\"appId\":\"GNSS\",\"data\":{\"lat\":63.4305},\"ts\":1563968747124},"
+		     "{\"appId\":\"TEMP\",\"data\":\"23.5\",\"ts\":1563968747125}]");
+}
+
+void test_merge_objects(void)
+{
+	/* Button press and impact messages in the format of the AWS IoT codec. */
+	merge_expect("{\"ui\":{\"v\":1,\"ts\":1563968747123}}",
+		     "{\"impact\":{\"v\":{\"magnitude\":300.5},\"ts\":1563968747124}}",
+		     "{\"ui\":{\"v\":1,\"ts\":1563968747123},"
+		     "\"impact\":{\"v\":{\"magnitude\":300.5},\"ts\":1563968747124}}");
+}
+
+void test_merge_empty(void)
+{
+	merge_expect("[]", "[1,2]", "[1,2]");
+	tearDown();
+	setUp();
+
+	merge_expect("{\"a\":1}", "{}", "{\"a\":1}");
+}
+
+void test_merge_whitespace(void)
+{
+	merge_expect(" [1, 2]\n", "\t[3] ", "[1, 2,3]");
+}
+
+void test_merge_common_member(void)
+{
+	/* Two button presses cannot be merged into one object. */
+	merge_fail_expect("{\"ui\":{\"v\":1,\"ts\":1563968747123}}",
+			  "{\"ui\":{\"v\":2,\"ts\":1563968747124}}",
+			  -ENOTSUP);
+}
+
+void test_merge_nested_member(void)
+{
+	/* Names of nested members, and string values, are not top-level member names. */
+	merge_expect("{\"bat\":[{\"v\":3600,\"ts\":1}],\"x\":\"gnss\"}",
+		     "{\"gnss\":{\"v\":{\"bat\":1},\"ts\":2}}",
+		     "{\"bat\":[{\"v\":3600,\"ts\":1}],\"x\":\"gnss\","
+		     "\"gnss\":{\"v\":{\"bat\":1},\"ts\":2}}");
+}
+
+void test_merge_escaped_name(void)
+{
+	merge_fail_expect("{\"a\\\"b\":{\"}\":1}}", "{\"a\\\"b\":2}", -ENOTSUP);
+	tearDown();
+	setUp();
+
+	merge_expect("{\"a\\\"b\":1}", "{\"a\\\"c\":2}", "{\"a\\\"b\":1,\"a\\\"c\":2}");
+}
+
+void test_merge_mixed(void)
+{
+	merge_fail_expect("[1]", "{\"a\":1}", -ENOTSUP);
+}
+
+void test_merge_not_json(void)
+{
+	/* Compressed messages start with the LZ4 frame magic number. */
+	merge_fail_expect("\x04\x22\x4d\x18", "[1]", -ENOTSUP);
+	tearDown();
+	setUp();
+
+	merge_fail_expect("[1", "[2]", -ENOTSUP);
+}
+
+void test_merge_size_max(void)
+{
+	message_set(&dst, "[1,2]");
+	message_set(&src, "[3,4]");
+
+	TEST_ASSERT_EQUAL(-EMSGSIZE, cloud_codec_merge(&dst, &src, strlen("[1,2,3,4]") - 1));
+	TEST_ASSERT_EQUAL_STRING("[1,2]", dst.buf);
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_merge(&dst, &src, strlen("[1,2,3,4]")));
+	TEST_ASSERT_EQUAL_STRING("[1,2,3,4]", dst.buf);
+}
+
+void test_merge_members_max(void)
+{
+	char obj[CLOUD_CODEC_MERGE_MEMBERS_MAX * 8 + 8] = "{";
+	size_t len = 1;
+
+	/* One member more than can be compared. */
+	for (int i = 0; i <= CLOUD_CODEC_MERGE_MEMBERS_MAX; i++) {
+		len += snprintk(&obj[len], sizeof(obj) - len, "%s\"m%d\":1", i ? "," : "", i);
+	}
+
+	obj[len++] = '}';
+	obj[len] = '\0';
+
+	merge_fail_expect(obj, "{\"n\":1}", -ENOTSUP);
+}
+
+void test_merge_invalid(void)
+{
+	message_set(&dst, "  ");
+	message_set(&src, "[1]");
+
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_codec_merge(&dst, &src, 0));
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_codec_merge(NULL, &src, 0));
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_codec_merge(&dst, NULL, 0));
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cloud_codec_ringbuffer.h"
+
+#define TEST_RINGBUFFER_SIZE 4
+
+struct test_entry {
+	int value;
+	bool queued;
+};
+
+CLOUD_CODEC_RINGBUFFER_DECLARE(test_ringbuffer, struct test_entry);
+
+static struct test_entry items[TEST_RINGBUFFER_SIZE];
+static struct test_ringbuffer rb = CLOUD_CODEC_RINGBUFFER_INITIALIZER(items);
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+void setUp(void)
+{
+	test_ringbuffer_reset(&rb);
+}
+
+static void put_values(int first, int count)
+{
+	for (int i = 0; i < count; i++) {
+		struct test_entry entry = { .value = first + i, .queued = true };
+
+		test_ringbuffer_put(&rb, &entry);
+	}
+}
+
+void test_empty_ringbuffer(void)
+{
+	struct test_entry *entries;
+
+	TEST_ASSERT_EQUAL(0, test_ringbuffer_count(&rb));
+	TEST_ASSERT_EQUAL(0, test_ringbuffer_peek(&rb, SIZE_MAX, &entries));
+
+	/* The newest slot of an empty ringbuffer holds no queued entry. */
+	TEST_ASSERT_FALSE(test_ringbuffer_newest(&rb)->queued);
+}
+
+void test_put_and_newest(void)
+{
+	put_values(1, 3);
+
+	TEST_ASSERT_EQUAL(3, test_ringbuffer_count(&rb));
+	TEST_ASSERT_EQUAL(3, test_ringbuffer_newest(&rb)->value);
+	TEST_ASSERT_TRUE(test_ringbuffer_newest(&rb)->queued);
+}
+
+void test_peek_returns_oldest_entries(void)
+{
+	struct test_entry *entries;
+
+	put_values(1, 3);
+
+	TEST_ASSERT_EQUAL(2, test_ringbuffer_peek(&rb, 2, &entries));
+	TEST_ASSERT_EQUAL(1, entries[0].value);
+	TEST_ASSERT_EQUAL(2, entries[1].value);
+
+	/* Peek does not consume entries. */
+	TEST_ASSERT_EQUAL(3, test_ringbuffer_count(&rb));
+}
+
+void test_commit_releases_entries(void)
+{
+	struct test_entry *entries;
+
+	put_values(1, 3);
+	test_ringbuffer_commit(&rb, 2);
+
+	TEST_ASSERT_EQUAL(1, test_ringbuffer_count(&rb));
+	TEST_ASSERT_EQUAL(1, test_ringbuffer_peek(&rb, SIZE_MAX, &entries));
+	TEST_ASSERT_EQUAL(3, entries[0].value);
+
+	/* Committing more entries than are live releases only the live entries. */
+	test_ringbuffer_commit(&rb, 10);
+	TEST_ASSERT_EQUAL(0, test_ringbuffer_count(&rb));
+}
+
+void test_commit_dequeued_stops_at_queued_entry(void)
+{
+	struct test_entry *entries;
+
+	put_values(1, 4);
+
+	/* The first two entries and the last entry have been encoded. */
+	TEST_ASSERT_EQUAL(4, test_ringbuffer_peek(&rb, SIZE_MAX, &entries));
+	entries[0].queued = false;
+	entries[1].queued = false;
+	entries[3].queued = false;
+
+	TEST_ASSERT_EQUAL(2, test_ringbuffer_commit_dequeued(&rb, 4));
+	TEST_ASSERT_EQUAL(2, test_ringbuffer_count(&rb));
+	TEST_ASSERT_EQUAL(1, test_ringbuffer_peek(&rb, 1, &entries));
+	TEST_ASSERT_EQUAL(3, entries[0].value);
+
+	/* Nothing is released while the oldest entry is queued. */
+	TEST_ASSERT_EQUAL(0, test_ringbuffer_commit_dequeued(&rb, 4));
+
+	/* No more than n entries are released. */
+	entries[0].queued = false;
+	TEST_ASSERT_EQUAL(1, test_ringbuffer_commit_dequeued(&rb, 1));
+	TEST_ASSERT_EQUAL(1, test_ringbuffer_count(&rb));
+	TEST_ASSERT_EQUAL(1, test_ringbuffer_commit_dequeued(&rb, 4));
+	TEST_ASSERT_EQUAL(0, test_ringbuffer_count(&rb));
+}
+
+void test_overwrite_oldest_when_full(void)
+{
+	struct test_entry *entries;
+
+	put_values(1, TEST_RINGBUFFER_SIZE + 2);
+
+	TEST_ASSERT_EQUAL(TEST_RINGBUFFER_SIZE, test_ringbuffer_count(&rb));
+	TEST_ASSERT_EQUAL(TEST_RINGBUFFER_SIZE + 2, test_ringbuffer_newest(&rb)->value);
+
+	/* Oldest live entry is 3, all live entries are returned in order. */
+	TEST_ASSERT_EQUAL(TEST_RINGBUFFER_SIZE, test_ringbuffer_peek(&rb, SIZE_MAX, &entries));
+
+	for (int i = 0; i < TEST_RINGBUFFER_SIZE; i++) {
+		TEST_ASSERT_EQUAL(3 + i, entries[i].value);
+	}
+}
+
+void test_peek_after_wraparound(void)
+{
+	struct test_entry *entries;
+
+	put_values(1, TEST_RINGBUFFER_SIZE + 2);
+	test_ringbuffer_commit(&rb, 2);
+
+	/* Entries 5 and 6 are at the start of the array, 7 and 8 are written after them. */
+	put_values(7, 2);
+	TEST_ASSERT_EQUAL(TEST_RINGBUFFER_SIZE, test_ringbuffer_peek(&rb, SIZE_MAX, &entries));
+	TEST_ASSERT_EQUAL_PTR(&items[0], entries);
+
+	for (int i = 0; i < TEST_RINGBUFFER_SIZE; i++) {
+		TEST_ASSERT_EQUAL(5 + i, entries[i].value);
+	}
+
+	test_ringbuffer_commit(&rb, TEST_RINGBUFFER_SIZE);
+	TEST_ASSERT_EQUAL(0, test_ringbuffer_count(&rb));
+}
+
+void test_peek_wrapped(void)
+{
+	struct test_entry *entries;
+
+	put_values(1, 3);
+	test_ringbuffer_commit(&rb, 2);
+	put_values(4, 2);
+
+	/* Live entries 3, 4 and 5 wrap around the end of the array. */
+	TEST_ASSERT_EQUAL(2, test_ringbuffer_peek(&rb, 2, &entries));
+	TEST_ASSERT_EQUAL(3, entries[0].value);
+	TEST_ASSERT_EQUAL(4, entries[1].value);
+
+	TEST_ASSERT_EQUAL(3, test_ringbuffer_peek(&rb, SIZE_MAX, &entries));
+	TEST_ASSERT_EQUAL(3, entries[0].value);
+	TEST_ASSERT_EQUAL(4, entries[1].value);
+	TEST_ASSERT_EQUAL(5, entries[2].value);
+
+	/* The ringbuffer keeps working after the array has been rotated. */
+	put_values(6, 2);
+	TEST_ASSERT_EQUAL(TEST_RINGBUFFER_SIZE, test_ringbuffer_count(&rb));
+	TEST_ASSERT_EQUAL(7, test_ringbuffer_newest(&rb)->value);
+	TEST_ASSERT_EQUAL(TEST_RINGBUFFER_SIZE, test_ringbuffer_peek(&rb, SIZE_MAX, &entries));
+
+	for (int i = 0; i < TEST_RINGBUFFER_SIZE; i++) {
+		TEST_ASSERT_EQUAL(4 + i, entries[i].value);
+	}
+}
+
+void test_reset(void)
+{
+	put_values(1, 3);
+	test_ringbuffer_reset(&rb);
+
+	TEST_ASSERT_EQUAL(0, test_ringbuffer_count(&rb));
+	TEST_ASSERT_FALSE(test_ringbuffer_newest(&rb)->queued);
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/fs/fcb.h>
+#include <date_time.h>
+#include <string.h>
+
+#include "cloud_codec.h"
+#include "cloud_codec_storage.h"
+
+#define PAGES_MAX	CONFIG_CLOUD_CODEC_STORAGE_PAGES_MAX
+#define SENT_MAX	CONFIG_CLOUD_CODEC_STORAGE_SENT_MAX
+
+/* Page buffers, small enough for a few samples to span several pages. */
+#define PAGE_SIZE	2
+
+static struct cloud_data_gnss gnss_items[PAGE_SIZE];
+static struct cloud_data_sensors sensors_items[PAGE_SIZE];
+static struct cloud_data_ui ui_items[PAGE_SIZE];
+static struct cloud_data_impact impact_items[PAGE_SIZE];
+static struct cloud_data_battery bat_items[PAGE_SIZE];
+static struct cloud_data_modem_dynamic modem_dyn_items[PAGE_SIZE];
+
+static struct cloud_data_gnss_ringbuffer gnss_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(gnss_items);
+static struct cloud_data_sensors_ringbuffer sensors_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(sensors_items);
+static struct cloud_data_ui_ringbuffer ui_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(ui_items);
+static struct cloud_data_impact_ringbuffer impact_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(impact_items);
+static struct cloud_data_battery_ringbuffer bat_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(bat_items);
+static struct cloud_data_modem_dynamic_ringbuffer modem_dyn_buf =
+	CLOUD_CODEC_RINGBUFFER_INITIALIZER(modem_dyn_items);
+
+static struct cloud_codec_storage_page page = {
+	.gnss_buf = &gnss_buf,
+	.sensor_buf = &sensors_buf,
+	.ui_buf = &ui_buf,
+	.impact_buf = &impact_buf,
+	.bat_buf = &bat_buf,
+	.modem_dyn_buf = &modem_dyn_buf,
+};
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+/* Timestamps are stored as they are, in UNIX time. */
+int date_time_uptime_to_unix_time_ms(int64_t *uptime)
+{
+	return 0;
+}
+
+static void storage_erase(void)
+{
+	const struct flash_area *fa;
+
+	TEST_ASSERT_EQUAL(0, flash_area_open(FIXED_PARTITION_ID(data_storage), &fa));
+	TEST_ASSERT_EQUAL(0, flash_area_erase(fa, 0, fa->fa_size));
+	flash_area_close(fa);
+}
+
+static void battery_append(uint16_t bat)
+{
+	struct cloud_data_battery sample = {
+		.bat = bat,
+		.bat_ts = 1563968747000 + bat,
+		.queued = true,
+	};
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_append(CLOUD_CODEC_STORAGE_BATTERY, &sample));
+}
+
+/* Page out the next samples, check that they are the expected battery samples and send the
+ * page in the given number of messages. Returns the page ID.
+ */
+static uint32_t page_send_expect(uint16_t first, size_t count, uint32_t messages)
+{
+	struct cloud_data_battery *bat;
+	uint32_t id;
+
+	TEST_ASSERT_EQUAL(count, cloud_codec_storage_page_out(&page, &id));
+	TEST_ASSERT_EQUAL(count, cloud_data_battery_ringbuffer_peek(&bat_buf, SIZE_MAX, &bat));
+
+	for (size_t i = 0; i < count; i++) {
+		TEST_ASSERT_EQUAL(first + i, bat[i].bat);
+		TEST_ASSERT_TRUE(bat[i].queued);
+	}
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_page_sent(id, messages));
+
+	return id;
+}
+
+static void no_page_expect(void)
+{
+	uint32_t id;
+
+	TEST_ASSERT_EQUAL(-ENODATA, cloud_codec_storage_page_out(&page, &id));
+}
+
+void setUp(void)
+{
+	storage_erase();
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_init());
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_pending_count());
+}
+
+void tearDown(void)
+{
+}
+
+void test_storage_ack(void)
+{
+	uint32_t id;
+
+	battery_append(1);
+	battery_append(2);
+
+	id = page_send_expect(1, 2, 1);
+
+	/* Samples are kept until the page has been acknowledged. */
+	TEST_ASSERT_EQUAL(2, cloud_codec_storage_pending_count());
+	no_page_expect();
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_ack(id));
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_pending_count());
+	TEST_ASSERT_EQUAL(-ENOENT, cloud_codec_storage_ack(id));
+
+	/* The read position is kept across reboots. */
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_init());
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_pending_count());
+	no_page_expect();
+}
+
+void test_storage_not_acked(void)
+{
+	battery_append(1);
+	battery_append(2);
+
+	(void)page_send_expect(1, 2, 1);
+
+	/* Samples that were sent and not acknowledged are sent again after a reboot. */
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_init());
+	TEST_ASSERT_EQUAL(2, cloud_codec_storage_pending_count());
+	(void)page_send_expect(1, 2, 1);
+}
+
+void test_storage_ack_messages(void)
+{
+	uint32_t id;
+
+	battery_append(1);
+
+	/* A page sent in several messages is acknowledged when all of them are. */
+	id = page_send_expect(1, 1, 2);
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_ack(id));
+	TEST_ASSERT_EQUAL(1, cloud_codec_storage_pending_count());
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_ack(id));
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_pending_count());
+}
+
+void test_storage_ack_in_order(void)
+{
+	uint32_t id[PAGES_MAX];
+	uint32_t busy_id;
+
+	for (int i = 1; i <= PAGE_SIZE * (PAGES_MAX + 1); i++) {
+		battery_append(i);
+	}
+
+	for (int i = 0; i < PAGES_MAX; i++) {
+		id[i] = page_send_expect(1 + i * PAGE_SIZE, PAGE_SIZE, 1);
+	}
+
+	TEST_ASSERT_EQUAL(-EBUSY, cloud_codec_storage_page_out(&page, &busy_id));
+
+	/* Samples are only removed once all older pages have been acknowledged. */
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_ack(id[PAGES_MAX - 1]));
+	TEST_ASSERT_EQUAL(PAGE_SIZE * (PAGES_MAX + 1), cloud_codec_storage_pending_count());
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_ack(id[0]));
+	TEST_ASSERT_EQUAL(PAGE_SIZE, cloud_codec_storage_pending_count());
+
+	(void)page_send_expect(1 + PAGES_MAX * PAGE_SIZE, PAGE_SIZE, 1);
+}
+
+void test_storage_cursor_batched(void)
+{
+	uint32_t id;
+
+	for (int i = 1; i <= PAGE_SIZE * 2; i++) {
+		battery_append(i);
+	}
+
+	id = page_send_expect(1, PAGE_SIZE, 1);
+	(void)page_send_expect(1 + PAGE_SIZE, PAGE_SIZE, 1);
+
+	/* The read position is not written to flash while a page is waiting for
+	 * acknowledgment, the acknowledged page is sent again after a reboot.
+	 */
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_ack(id));
+	TEST_ASSERT_EQUAL(PAGE_SIZE, cloud_codec_storage_pending_count());
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_init());
+	TEST_ASSERT_EQUAL(PAGE_SIZE * 2, cloud_codec_storage_pending_count());
+}
+
+void test_storage_abort(void)
+{
+	uint32_t id;
+
+	battery_append(1);
+
+	TEST_ASSERT_EQUAL(1, cloud_codec_storage_page_out(&page, &id));
+	cloud_codec_storage_page_abort(id);
+
+	/* An aborted page is paged out again. */
+	(void)page_send_expect(1, 1, 1);
+}
+
+void test_storage_ack_timeout(void)
+{
+	battery_append(1);
+
+	(void)page_send_expect(1, 1, 1);
+	no_page_expect();
+
+	/* Pages that are not acknowledged in time are sent again. */
+	k_sleep(K_MSEC(CONFIG_CLOUD_CODEC_STORAGE_ACK_TIMEOUT_SEC * MSEC_PER_SEC + 100));
+
+	(void)page_send_expect(1, 1, 1);
+}
+
+void test_storage_mark_sent(void)
+{
+	uint32_t id;
+
+	for (int i = 1; i <= SENT_MAX + 2; i++) {
+		battery_append(i);
+
+		/* Samples 2 and up are sent as they are sampled. */
+		if (i >= 2) {
+			cloud_codec_storage_mark_sent(CLOUD_CODEC_STORAGE_BATTERY);
+		}
+	}
+
+	/* The last SENT_MAX samples marked as sent are skipped, older ones are sent again. */
+	id = page_send_expect(1, 2, 1);
+	no_page_expect();
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_ack(id));
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_pending_count());
+}
+
+void test_storage_skipped_page(void)
+{
+	uint32_t id;
+
+	battery_append(1);
+	cloud_codec_storage_mark_sent(CLOUD_CODEC_STORAGE_BATTERY);
+
+	/* A page where all samples were skipped is not sent, it is acknowledged at once. */
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_page_out(&page, &id));
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_page_sent(id, 0));
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_pending_count());
+}
+
+/* Test that a store that was written with another record layout is erased. */
+void test_storage_other_layout(void)
+{
+	static struct flash_sector sectors[2];
+	/* FCB magic of the store before records had a layout version. */
+	struct fcb other = {
+		.f_magic = 0x61743273,
+		.f_sectors = sectors,
+		.f_sector_cnt = ARRAY_SIZE(sectors),
+	};
+	struct fcb_entry loc;
+	uint8_t record[16];
+
+	for (size_t i = 0; i < ARRAY_SIZE(sectors); i++) {
+		sectors[i].fs_off = i * CONFIG_CLOUD_CODEC_STORAGE_SECTOR_SIZE;
+		sectors[i].fs_size = CONFIG_CLOUD_CODEC_STORAGE_SECTOR_SIZE;
+	}
+
+	/* The sequence number in the header is nonzero, so the record would be pending if it
+	 * was read.
+	 */
+	memset(record, 0x01, sizeof(record));
+
+	storage_erase();
+
+	TEST_ASSERT_EQUAL(0, fcb_init(FIXED_PARTITION_ID(data_storage), &other));
+	TEST_ASSERT_EQUAL(0, fcb_append(&other, sizeof(record), &loc));
+	TEST_ASSERT_EQUAL(0, flash_area_write(other.fap, FCB_ENTRY_FA_DATA_OFF(loc), record,
+					      sizeof(record)));
+	TEST_ASSERT_EQUAL(0, fcb_append_finish(&other, &loc));
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_init());
+	TEST_ASSERT_EQUAL(0, cloud_codec_storage_pending_count());
+	no_page_expect();
+
+	/* The erased store is used as a new one. */
+	battery_append(1);
+	(void)page_send_expect(1, 1, 1);
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
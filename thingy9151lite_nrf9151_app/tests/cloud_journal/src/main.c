@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <string.h>
+
+#include "cloud_journal.h"
+
+#define INFLIGHT_MAX	CONFIG_CLOUD_JOURNAL_INFLIGHT_MAX
+#define SECTOR_SIZE	CONFIG_CLOUD_JOURNAL_SECTOR_SIZE
+
+/* Message types, as used by the cloud module. */
+enum {
+	GENERIC = 0,
+	BATCH,
+	UI,
+};
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static void journal_erase(void)
+{
+	const struct flash_area *fa;
+
+	TEST_ASSERT_EQUAL(0, flash_area_open(FIXED_PARTITION_ID(message_journal), &fa));
+	TEST_ASSERT_EQUAL(0, flash_area_erase(fa, 0, fa->fa_size));
+	flash_area_close(fa);
+}
+
+static void message_append(const char *str, uint8_t type, uint32_t flags)
+{
+	TEST_ASSERT_EQUAL(0, cloud_journal_append(type, flags, str, strlen(str)));
+}
+
+/* Read the next message out of the journal and check its contents. Returns the message ID. */
+static uint32_t message_next_expect(const char *str, uint8_t type, uint32_t flags)
+{
+	struct cloud_journal_entry entry;
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_next(&entry));
+	TEST_ASSERT_EQUAL(strlen(str), entry.len);
+	TEST_ASSERT_EQUAL_MEMORY(str, entry.buf, entry.len);
+	TEST_ASSERT_EQUAL(type, entry.type);
+	TEST_ASSERT_EQUAL(flags, entry.flags);
+	TEST_ASSERT_TRUE(cloud_journal_id_check(entry.id));
+
+	k_free(entry.buf);
+
+	return entry.id;
+}
+
+static void no_message_expect(void)
+{
+	struct cloud_journal_entry entry;
+
+	TEST_ASSERT_EQUAL(-ENODATA, cloud_journal_next(&entry));
+}
+
+void setUp(void)
+{
+	journal_erase();
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_init());
+	TEST_ASSERT_EQUAL(0, cloud_journal_pending_count());
+}
+
+void tearDown(void)
+{
+}
+
+void test_journal_order(void)
+{
+	message_append("{\"a\":1}", GENERIC, 0);
+	message_append("[1]", BATCH, 1);
+	TEST_ASSERT_EQUAL(2, cloud_journal_pending_count());
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(message_next_expect("{\"a\":1}", GENERIC, 0)));
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(message_next_expect("[1]", BATCH, 1)));
+
+	no_message_expect();
+	TEST_ASSERT_EQUAL(0, cloud_journal_pending_count());
+}
+
+void test_journal_inflight_max(void)
+{
+	struct cloud_journal_entry entry;
+	uint32_t id;
+
+	for (int i = 0; i <= INFLIGHT_MAX; i++) {
+		message_append("[1]", BATCH, 0);
+	}
+
+	id = message_next_expect("[1]", BATCH, 0);
+
+	for (int i = 1; i < INFLIGHT_MAX; i++) {
+		message_next_expect("[1]", BATCH, 0);
+	}
+
+	TEST_ASSERT_EQUAL(-EBUSY, cloud_journal_next(&entry));
+
+	/* An acknowledgment makes room for the next message. */
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(id));
+	message_next_expect("[1]", BATCH, 0);
+}
+
+void test_journal_ack_out_of_order(void)
+{
+	uint32_t first, second;
+
+	message_append("[1]", BATCH, 0);
+	message_append("[2]", BATCH, 0);
+
+	first = message_next_expect("[1]", BATCH, 0);
+	second = message_next_expect("[2]", BATCH, 0);
+
+	/* A message is not removed before all older messages have been acknowledged. */
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(second));
+	TEST_ASSERT_EQUAL(2, cloud_journal_pending_count());
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(first));
+	TEST_ASSERT_EQUAL(0, cloud_journal_pending_count());
+}
+
+void test_journal_rewind(void)
+{
+	message_append("[1]", BATCH, 0);
+	message_append("[2]", BATCH, 0);
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(message_next_expect("[1]", BATCH, 0)));
+	message_next_expect("[2]", BATCH, 0);
+
+	/* The connection was lost before the second message was acknowledged. */
+	cloud_journal_rewind();
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(message_next_expect("[2]", BATCH, 0)));
+	no_message_expect();
+}
+
+void test_journal_reboot(void)
+{
+	message_append("[1]", BATCH, 0);
+	message_append("{\"ui\":1}", UI, 1);
+	message_append("[3]", BATCH, 0);
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(message_next_expect("[1]", BATCH, 0)));
+	message_next_expect("{\"ui\":1}", UI, 1);
+
+	/* Unacknowledged messages are kept across reboots. */
+	TEST_ASSERT_EQUAL(0, cloud_journal_init());
+	TEST_ASSERT_EQUAL(2, cloud_journal_pending_count());
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(message_next_expect("{\"ui\":1}", UI, 1)));
+
+	/* New messages are appended after the recovered ones. */
+	message_append("[4]", BATCH, 0);
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(message_next_expect("[3]", BATCH, 0)));
+	TEST_ASSERT_EQUAL(0, cloud_journal_ack(message_next_expect("[4]", BATCH, 0)));
+	no_message_expect();
+
+	TEST_ASSERT_EQUAL(0, cloud_journal_init());
+	TEST_ASSERT_EQUAL(0, cloud_journal_pending_count());
+	no_message_expect();
+}
+
+void test_journal_full(void)
+{
+	static char buf[SECTOR_SIZE / 4];
+	struct cloud_journal_entry entry;
+	char last = 0;
+
+	memset(buf, 'x', sizeof(buf));
+
+	/* Fill more than the whole journal, the oldest messages are dropped. */
+	for (int i = 0; i < 16; i++) {
+		buf[0] = 'a' + i;
+		TEST_ASSERT_EQUAL(0, cloud_journal_append(BATCH, 0, buf, sizeof(buf)));
+	}
+
+	TEST_ASSERT_GREATER_THAN(0, cloud_journal_pending_count());
+	TEST_ASSERT_LESS_THAN(16, cloud_journal_pending_count());
+
+	while (cloud_journal_next(&entry) == 0) {
+		/* Messages that are kept are read out in order. */
+		TEST_ASSERT_GREATER_THAN(last, entry.buf[0]);
+		last = entry.buf[0];
+
+		TEST_ASSERT_EQUAL(0, cloud_journal_ack(entry.id));
+		k_free(entry.buf);
+	}
+
+	/* The newest message is kept. */
+	TEST_ASSERT_EQUAL('a' + 15, last);
+	TEST_ASSERT_EQUAL(0, cloud_journal_pending_count());
+}
+
+void test_journal_invalid(void)
+{
+	static char buf[SECTOR_SIZE];
+
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_journal_append(BATCH, 0, NULL, 1));
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_journal_append(BATCH, 0, "[1]", 0));
+	TEST_ASSERT_EQUAL(-EMSGSIZE, cloud_journal_append(BATCH, 0, buf, sizeof(buf)));
+
+	TEST_ASSERT_EQUAL(-ENOENT, cloud_journal_ack(CLOUD_JOURNAL_MESSAGE_ID_BASE));
+	TEST_ASSERT_FALSE(cloud_journal_id_check(CLOUD_JOURNAL_MESSAGE_ID_BASE - 1));
+	TEST_ASSERT_FALSE(cloud_journal_id_check(CLOUD_JOURNAL_MESSAGE_ID_BASE +
+						 CLOUD_JOURNAL_MESSAGE_ID_COUNT));
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+
+#include "cloud_reconnect.h"
+
+#define BASE_SEC	CONFIG_CLOUD_RECONNECT_BACKOFF_BASE_SEC
+#define MAX_SEC		CONFIG_CLOUD_RECONNECT_BACKOFF_MAX_SEC
+#define BASE_MS		(BASE_SEC * 1000LL)
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+void setUp(void)
+{
+	cloud_reconnect_abort();
+}
+
+void tearDown(void)
+{
+}
+
+void test_cloud_reconnect_delay(void)
+{
+	uint32_t previous = BASE_SEC;
+
+	for (int i = 0; i < 100; i++) {
+		uint32_t delay = cloud_reconnect_attempt(i * BASE_MS);
+
+		TEST_ASSERT_GREATER_OR_EQUAL(BASE_SEC, delay);
+		TEST_ASSERT_LESS_OR_EQUAL(MIN(previous * 3, MAX_SEC), delay);
+
+		previous = delay;
+	}
+
+	TEST_ASSERT_EQUAL(100, cloud_reconnect_retries_get());
+}
+
+void test_cloud_reconnect_trigger(void)
+{
+	struct cloud_reconnect_stats before, after;
+
+	cloud_reconnect_stats_get(&before);
+
+	(void)cloud_reconnect_attempt(0);
+	(void)cloud_reconnect_attempt(BASE_MS);
+	cloud_reconnect_error(-ENETUNREACH);
+
+	TEST_ASSERT_TRUE(cloud_reconnect_trigger(BASE_MS + 1000));
+	TEST_ASSERT_EQUAL(0, cloud_reconnect_retries_get());
+
+	/* The backoff is only reset once per failed attempt. */
+	TEST_ASSERT_FALSE(cloud_reconnect_trigger(BASE_MS + 2000));
+
+	cloud_reconnect_stats_get(&after);
+	TEST_ASSERT_EQUAL(before.resets + 1, after.resets);
+}
+
+void test_cloud_reconnect_trigger_not_connecting(void)
+{
+	TEST_ASSERT_FALSE(cloud_reconnect_trigger(0));
+}
+
+void test_cloud_reconnect_trigger_active_attempt(void)
+{
+	(void)cloud_reconnect_attempt(0);
+
+	/* Within the base delay, the RRC connection is most likely set up by the attempt. */
+	TEST_ASSERT_FALSE(cloud_reconnect_trigger(BASE_MS - 1));
+	TEST_ASSERT_TRUE(cloud_reconnect_trigger(BASE_MS));
+}
+
+void test_cloud_reconnect_trigger_tls(void)
+{
+	(void)cloud_reconnect_attempt(0);
+	cloud_reconnect_error(-EACCES);
+
+	TEST_ASSERT_FALSE(cloud_reconnect_trigger(1000));
+	TEST_ASSERT_EQUAL(1, cloud_reconnect_retries_get());
+}
+
+void test_cloud_reconnect_trigger_rejected(void)
+{
+	(void)cloud_reconnect_attempt(0);
+	cloud_reconnect_error(-ECONNREFUSED);
+
+	TEST_ASSERT_FALSE(cloud_reconnect_trigger(1000));
+}
+
+void test_cloud_reconnect_unknown_error(void)
+{
+	(void)cloud_reconnect_attempt(0);
+
+	/* Returned when the cloud library is busy, the attempt is still ongoing. */
+	cloud_reconnect_error(-EINPROGRESS);
+
+	TEST_ASSERT_FALSE(cloud_reconnect_trigger(1000));
+}
+
+void test_cloud_reconnect_rsrp(void)
+{
+	TEST_ASSERT_FALSE(cloud_reconnect_rsrp_update(-110, 0));
+
+	(void)cloud_reconnect_attempt(0);
+	cloud_reconnect_error(-EHOSTUNREACH);
+
+	TEST_ASSERT_FALSE(cloud_reconnect_rsrp_update(-105, 1000));
+	TEST_ASSERT_TRUE(cloud_reconnect_rsrp_update(-100, 2000));
+}
+
+void test_cloud_reconnect_connected(void)
+{
+	struct cloud_reconnect_summary summary;
+	struct cloud_reconnect_stats before, after;
+
+	cloud_reconnect_stats_get(&before);
+
+	(void)cloud_reconnect_attempt(0);
+	cloud_reconnect_error(-EHOSTUNREACH);
+	(void)cloud_reconnect_attempt(BASE_MS);
+	/* Times out. */
+	(void)cloud_reconnect_attempt(4 * BASE_MS);
+
+	cloud_reconnect_connected(&summary);
+
+	TEST_ASSERT_EQUAL(3, summary.attempts);
+	TEST_ASSERT_EQUAL(1, summary.failures[CLOUD_RECONNECT_CAUSE_DNS]);
+	TEST_ASSERT_EQUAL(1, summary.failures[CLOUD_RECONNECT_CAUSE_TIMEOUT]);
+	TEST_ASSERT_EQUAL(0, summary.failures[CLOUD_RECONNECT_CAUSE_TLS]);
+	TEST_ASSERT_EQUAL(0, cloud_reconnect_retries_get());
+
+	cloud_reconnect_stats_get(&after);
+	TEST_ASSERT_EQUAL(before.histogram[2] + 1, after.histogram[2]);
+	TEST_ASSERT_EQUAL(before.failures[CLOUD_RECONNECT_CAUSE_DNS] + 1,
+			  after.failures[CLOUD_RECONNECT_CAUSE_DNS]);
+
+	/* A new connection without attempts is not counted. */
+	cloud_reconnect_connected(&summary);
+	TEST_ASSERT_EQUAL(0, summary.attempts);
+}
+
+void test_cloud_reconnect_ping_ack(void)
+{
+	struct cloud_reconnect_stats before, after;
+
+	cloud_reconnect_stats_get(&before);
+	cloud_reconnect_ping_ack();
+	cloud_reconnect_ping_ack();
+	cloud_reconnect_stats_get(&after);
+
+	TEST_ASSERT_EQUAL(before.pings + 2, after.pings);
+}
+
+void test_cloud_reconnect_histogram_bucket(void)
+{
+	TEST_ASSERT_EQUAL(0, cloud_reconnect_histogram_bucket(1));
+	TEST_ASSERT_EQUAL(1, cloud_reconnect_histogram_bucket(2));
+	TEST_ASSERT_EQUAL(2, cloud_reconnect_histogram_bucket(3));
+	TEST_ASSERT_EQUAL(2, cloud_reconnect_histogram_bucket(4));
+	TEST_ASSERT_EQUAL(3, cloud_reconnect_histogram_bucket(5));
+	TEST_ASSERT_EQUAL(3, cloud_reconnect_histogram_bucket(8));
+	TEST_ASSERT_EQUAL(4, cloud_reconnect_histogram_bucket(16));
+	TEST_ASSERT_EQUAL(5, cloud_reconnect_histogram_bucket(17));
+	TEST_ASSERT_EQUAL(5, cloud_reconnect_histogram_bucket(UINT32_MAX));
+}
+
+void test_cloud_reconnect_cause(void)
+{
+	TEST_ASSERT_EQUAL(CLOUD_RECONNECT_CAUSE_DNS, cloud_reconnect_cause_get(-EHOSTUNREACH));
+	TEST_ASSERT_EQUAL(CLOUD_RECONNECT_CAUSE_TLS, cloud_reconnect_cause_get(-EACCES));
+	TEST_ASSERT_EQUAL(CLOUD_RECONNECT_CAUSE_REJECTED,
+			  cloud_reconnect_cause_get(-ECONNREFUSED));
+	TEST_ASSERT_EQUAL(CLOUD_RECONNECT_CAUSE_NETWORK, cloud_reconnect_cause_get(-ENETUNREACH));
+	TEST_ASSERT_EQUAL(CLOUD_RECONNECT_CAUSE_TIMEOUT, cloud_reconnect_cause_get(-ETIMEDOUT));
+	TEST_ASSERT_EQUAL(CLOUD_RECONNECT_CAUSE_TIMEOUT, cloud_reconnect_cause_get(-EIO));
+}
+
+void test_cloud_reconnect_jitter(void)
+{
+	for (int i = 0; i < 100; i++) {
+		TEST_ASSERT_LESS_OR_EQUAL(CONFIG_CLOUD_RECONNECT_RESET_JITTER_SEC * 1000,
+					  cloud_reconnect_jitter_get());
+	}
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include "cloud_send_scheduler.h"
+
+#define WINDOW_MS	CONFIG_CLOUD_SEND_SCHEDULER_WINDOW_MS
+#define PENDING_MAX	CONFIG_CLOUD_SEND_SCHEDULER_MSG_MAX
+#define SENT_MAX	(PENDING_MAX * 2)
+
+/* Message types, as used by the cloud module. */
+enum {
+	GENERIC = 0,
+	BATCH,
+	UI,
+	MEMFAULT = 7,
+};
+
+/* Messages handed on by the scheduler. */
+struct sent_msg {
+	char buf[64];
+	uint8_t type;
+	uint32_t flags;
+	uint32_t ack_id;
+	bool last;
+};
+
+static struct sent_msg sent[SENT_MAX];
+static size_t sent_count;
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static void send_handler(const struct cloud_send_scheduler_msg *msg, bool last)
+{
+	TEST_ASSERT_LESS_THAN(SENT_MAX, sent_count);
+	TEST_ASSERT_LESS_THAN(sizeof(sent[0].buf), msg->len);
+
+	memcpy(sent[sent_count].buf, msg->buf, msg->len);
+	sent[sent_count].buf[msg->len] = '\0';
+	sent[sent_count].type = msg->type;
+	sent[sent_count].flags = msg->flags;
+	sent[sent_count].ack_id = msg->ack_id;
+	sent[sent_count].last = last;
+	sent_count++;
+
+	if (msg->heap_allocated) {
+		k_free(msg->buf);
+	}
+}
+
+static void message_add(const char *str, uint8_t type, uint8_t priority, uint32_t flags,
+			bool heap_allocated)
+{
+	struct cloud_send_scheduler_msg msg = {
+		.buf = (char *)str,
+		.len = strlen(str),
+		.type = type,
+		.priority = priority,
+		.flags = flags,
+		.heap_allocated = heap_allocated,
+	};
+
+	if (heap_allocated) {
+		msg.buf = k_malloc(msg.len + 1);
+		TEST_ASSERT_NOT_NULL(msg.buf);
+		memcpy(msg.buf, str, msg.len + 1);
+	}
+
+	TEST_ASSERT_EQUAL(0, cloud_send_scheduler_add(&msg));
+}
+
+void setUp(void)
+{
+	memset(sent, 0, sizeof(sent));
+	sent_count = 0;
+
+	TEST_ASSERT_EQUAL(0, cloud_send_scheduler_init(send_handler));
+}
+
+void tearDown(void)
+{
+	cloud_send_scheduler_flush();
+}
+
+void test_send_scheduler_window(void)
+{
+	message_add("{\"a\":1}", GENERIC, 2, 0, false);
+
+	k_sleep(K_MSEC(WINDOW_MS / 2));
+	TEST_ASSERT_EQUAL(0, sent_count);
+
+	/* A later message does not extend the window. */
+	message_add("[1]", BATCH, 3, 0, false);
+
+	k_sleep(K_MSEC(WINDOW_MS / 2 + 10));
+	TEST_ASSERT_EQUAL(2, sent_count);
+	TEST_ASSERT_FALSE(sent[0].last);
+	TEST_ASSERT_TRUE(sent[1].last);
+}
+
+void test_send_scheduler_priority(void)
+{
+	message_add("{\"memfault\":1}", MEMFAULT, 4, 0, false);
+	message_add("[1]", BATCH, 3, 0, false);
+	message_add("{\"ui\":1}", UI, 0, 0, false);
+	message_add("[2]", BATCH, 3, 0, false);
+
+	cloud_send_scheduler_flush();
+
+	/* Messages with the same priority are sent in the order they were added. */
+	TEST_ASSERT_EQUAL(4, sent_count);
+	TEST_ASSERT_EQUAL_STRING("{\"ui\":1}", sent[0].buf);
+	TEST_ASSERT_EQUAL_STRING("[1]", sent[1].buf);
+	TEST_ASSERT_EQUAL_STRING("[2]", sent[2].buf);
+	TEST_ASSERT_EQUAL_STRING("{\"memfault\":1}", sent[3].buf);
+
+	TEST_ASSERT_FALSE(sent[0].last);
+	TEST_ASSERT_FALSE(sent[1].last);
+	TEST_ASSERT_FALSE(sent[2].last);
+	TEST_ASSERT_TRUE(sent[3].last);
+}
+
+void test_send_scheduler_merge(void)
+{
+	message_add("[1]", BATCH, 3, 0, true);
+	message_add("{\"ui\":1}", UI, 0, 0, true);
+	message_add("[2]", BATCH, 3, 0, true);
+	message_add("{\"impact\":1}", UI, 0, 0, true);
+
+	cloud_send_scheduler_flush();
+
+	TEST_ASSERT_EQUAL(2, sent_count);
+	TEST_ASSERT_EQUAL_STRING("{\"ui\":1,\"impact\":1}", sent[0].buf);
+	TEST_ASSERT_EQUAL(UI, sent[0].type);
+	TEST_ASSERT_EQUAL_STRING("[1,2]", sent[1].buf);
+	TEST_ASSERT_EQUAL(BATCH, sent[1].type);
+	TEST_ASSERT_TRUE(sent[1].last);
+}
+
+void test_send_scheduler_merge_incompatible(void)
+{
+	/* Different flags. */
+	message_add("[1]", BATCH, 3, 0, true);
+	message_add("[2]", BATCH, 3, 1, true);
+
+	/* Different types. */
+	message_add("{\"a\":1}", GENERIC, 2, 0, true);
+	message_add("{\"b\":1}", UI, 0, 0, true);
+
+	cloud_send_scheduler_flush();
+
+	TEST_ASSERT_EQUAL(4, sent_count);
+	TEST_ASSERT_EQUAL_STRING("{\"b\":1}", sent[0].buf);
+	TEST_ASSERT_EQUAL_STRING("{\"a\":1}", sent[1].buf);
+	TEST_ASSERT_EQUAL_STRING("[1]", sent[2].buf);
+	TEST_ASSERT_EQUAL_STRING("[2]", sent[3].buf);
+	TEST_ASSERT_EQUAL(1, sent[3].flags);
+}
+
+void test_send_scheduler_merge_static(void)
+{
+	/* Messages that are not heap allocated are not merged. */
+	message_add("[1]", BATCH, 3, 0, false);
+	message_add("[2]", BATCH, 3, 0, true);
+
+	cloud_send_scheduler_flush();
+
+	TEST_ASSERT_EQUAL(2, sent_count);
+}
+
+void test_send_scheduler_merge_ack_id(void)
+{
+	struct cloud_send_scheduler_msg msg = {
+		.len = strlen("[2]"),
+		.type = BATCH,
+		.priority = 3,
+		.heap_allocated = true,
+		.ack_id = 7,
+	};
+
+	/* Messages that are acknowledged to the sender are not merged. */
+	message_add("[1]", BATCH, 3, 0, true);
+
+	msg.buf = k_malloc(msg.len + 1);
+	TEST_ASSERT_NOT_NULL(msg.buf);
+	memcpy(msg.buf, "[2]", msg.len + 1);
+	TEST_ASSERT_EQUAL(0, cloud_send_scheduler_add(&msg));
+
+	message_add("[3]", BATCH, 3, 0, true);
+
+	cloud_send_scheduler_flush();
+
+	TEST_ASSERT_EQUAL(2, sent_count);
+	TEST_ASSERT_EQUAL_STRING("[1,3]", sent[0].buf);
+	TEST_ASSERT_EQUAL(0, sent[0].ack_id);
+	TEST_ASSERT_EQUAL_STRING("[2]", sent[1].buf);
+	TEST_ASSERT_EQUAL(7, sent[1].ack_id);
+}
+
+void test_send_scheduler_full(void)
+{
+	for (int i = 0; i < PENDING_MAX; i++) {
+		message_add("{\"a\":1}", GENERIC, 2, 0, false);
+	}
+
+	TEST_ASSERT_EQUAL(0, sent_count);
+
+	/* The pending messages are sent before the window expires, they do not end the
+	 * burst.
+	 */
+	message_add("{\"ui\":1}", UI, 0, 0, false);
+
+	TEST_ASSERT_EQUAL(PENDING_MAX, sent_count);
+
+	for (int i = 0; i < PENDING_MAX; i++) {
+		TEST_ASSERT_FALSE(sent[i].last);
+	}
+
+	k_sleep(K_MSEC(WINDOW_MS + 10));
+
+	TEST_ASSERT_EQUAL(PENDING_MAX + 1, sent_count);
+	TEST_ASSERT_EQUAL_STRING("{\"ui\":1}", sent[PENDING_MAX].buf);
+	TEST_ASSERT_TRUE(sent[PENDING_MAX].last);
+}
+
+void test_send_scheduler_flush_empty(void)
+{
+	cloud_send_scheduler_flush();
+
+	TEST_ASSERT_EQUAL(0, sent_count);
+}
+
+void test_send_scheduler_invalid(void)
+{
+	struct cloud_send_scheduler_msg msg = {
+		.buf = "[1]",
+		.len = 0,
+	};
+
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_send_scheduler_init(NULL));
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_send_scheduler_add(NULL));
+	TEST_ASSERT_EQUAL(-EINVAL, cloud_send_scheduler_add(&msg));
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
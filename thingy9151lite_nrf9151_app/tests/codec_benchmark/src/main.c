@@ -0,0 +1,463 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Benchmark of the cloud codec backends.
+ *
+ * Every benchmarked operation is run CONFIG_CODEC_BENCHMARK_ITERATIONS times on fixtures that
+ * correspond to full data module ringbuffers with the default buffer counts. One line is
+ * printed per operation, prefixed with BENCHMARK_PREFIX, with the following comma separated
+ * columns:
+ *
+ *	backend, variant, operation, error code, iterations, cycles per operation,
+ *	peak heap usage in bytes, heap allocations per operation, output size in bytes.
+ *
+ * The encode_data_delta operation encodes a data message where only the RSRP has changed since
+ * the previous message, which shows the effect of CONFIG_CLOUD_CODEC_SHADOW_DELTA.
+ * For config decoding the output size is the size of the decoded input. Operations that the
+ * backend does not support are reported with error code -ENOTSUP (-134) and zero values.
+ *
+ * Code runs in zero simulated time on native_sim, cycle counts are therefore only meaningful
+ * on qemu_cortex_m3, which is run with instruction counting, and on hardware.
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/heap_listener.h>
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/sys/sys_heap.h>
+#include <string.h>
+
+#include "cloud_codec.h"
+#include "cloud_codec_shadow.h"
+
+#include "json_protocol_names.h"
+
+#define BENCHMARK_PREFIX "BENCHMARK:"
+
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+#define BENCHMARK_BACKEND "cbor"
+#elif defined(CONFIG_CLOUD_CODEC_AWS_IOT)
+#define BENCHMARK_BACKEND "aws_iot"
+#elif defined(CONFIG_CLOUD_CODEC_AZURE_IOT_HUB)
+#define BENCHMARK_BACKEND "azure_iot_hub"
+#else
+#define BENCHMARK_BACKEND "nrf_cloud"
+#endif
+
+/* Encoder options that change the cost of the JSON backends. */
+#if defined(CONFIG_CLOUD_CODEC_JSON_WRITER) && defined(CONFIG_CLOUD_CODEC_JSON_ARENA)
+#define BENCHMARK_VARIANT "writer+arena"
+#elif defined(CONFIG_CLOUD_CODEC_JSON_WRITER)
+#define BENCHMARK_VARIANT "writer"
+#elif defined(CONFIG_CLOUD_CODEC_JSON_ARENA)
+#define BENCHMARK_VARIANT "arena"
+#else
+#define BENCHMARK_VARIANT "default"
+#endif
+
+/* Ringbuffer sizes, the defaults of the data module. */
+#define GNSS_COUNT	    10
+#define SENSOR_COUNT	    10
+#define MODEM_DYNAMIC_COUNT 3
+#define UI_COUNT	    3
+#define IMPACT_COUNT	    1
+#define BATTERY_COUNT	    3
+#define MODEM_STATIC_COUNT  1
+
+#define NEIGHBOR_CELL_COUNT 10
+
+BUILD_ASSERT(NEIGHBOR_CELL_COUNT <= CONFIG_LTE_NEIGHBOR_CELLS_MAX);
+
+/* Uptime of the first sample, the date_time mock converts it to a constant UNIX time. */
+#define SAMPLE_TS	 1000
+#define SAMPLE_INTERVAL	 60000
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static struct cloud_data_gnss gnss[GNSS_COUNT];
+static struct cloud_data_sensors sensors[SENSOR_COUNT];
+static struct cloud_data_modem_dynamic modem_dynamic[MODEM_DYNAMIC_COUNT];
+static struct cloud_data_ui ui[UI_COUNT];
+static struct cloud_data_impact impact[IMPACT_COUNT];
+static struct cloud_data_battery battery[BATTERY_COUNT];
+static struct cloud_data_modem_static modem_static[MODEM_STATIC_COUNT];
+static struct cloud_data_cloud_location cloud_location;
+static struct cloud_data_cfg config;
+
+/* Configuration as it is received in a device shadow delta. */
+static const char config_input[] =
+	"{\"" OBJECT_CONFIG "\":{"
+	"\"" CONFIG_DEVICE_MODE "\":false,"
+	"\"" CONFIG_ACTIVE_TIMEOUT "\":120,"
+	"\"" CONFIG_MOVE_RES "\":120,"
+	"\"" CONFIG_MOVE_TIMEOUT "\":3600,"
+	"\"" CONFIG_LOCATION_TIMEOUT "\":300,"
+	"\"" CONFIG_ACC_ACT_THRESHOLD "\":4.5,"
+	"\"" CONFIG_ACC_INACT_THRESHOLD "\":2.5,"
+	"\"" CONFIG_ACC_INACT_TIMEOUT "\":80.5,"
+	"\"" CONFIG_NO_DATA_LIST "\":[\"" CONFIG_NO_DATA_LIST_GNSS "\"]}}";
+static const size_t config_input_len = sizeof(config_input) - 1;
+
+static const struct cloud_data_cfg config_fixture = {
+	.active_mode = false,
+	.active_wait_timeout = 120,
+	.movement_resolution = 120,
+	.movement_timeout = 3600,
+	.location_timeout = 300,
+	.accelerometer_activity_threshold = 4.5,
+	.accelerometer_inactivity_threshold = 2.5,
+	.accelerometer_inactivity_timeout = 80.5,
+	.no_data.gnss = true,
+};
+
+/* Number of allocations from the system heap, counted by the heap listener. */
+static uint32_t alloc_count;
+
+static void heap_alloc_cb(uintptr_t heap_id, void *mem, size_t bytes)
+{
+	ARG_UNUSED(heap_id);
+	ARG_UNUSED(mem);
+	ARG_UNUSED(bytes);
+
+	alloc_count++;
+}
+
+/* The heap ID is set when the system heap has been found. */
+HEAP_LISTENER_ALLOC_DEFINE(heap_alloc_listener, 0, heap_alloc_cb);
+
+/* The system heap that k_malloc() allocates from. */
+static struct k_heap *system_heap;
+
+/* The system heap is not exposed by the kernel. It is found as the heap that holds a block
+ * allocated with k_malloc().
+ */
+static struct k_heap *system_heap_find(void)
+{
+	struct k_heap *found = NULL;
+	uint8_t *mem = k_malloc(1);
+
+	if (mem == NULL) {
+		return NULL;
+	}
+
+	STRUCT_SECTION_FOREACH(k_heap, heap) {
+		uint8_t *start = heap->heap.init_mem;
+
+		if ((mem >= start) && (mem < (start + heap->heap.init_bytes))) {
+			found = heap;
+			break;
+		}
+	}
+
+	k_free(mem);
+
+	return found;
+}
+
+/* Fill the buffers with samples as the data module would after a full sampling period.
+ * Encoding clears the queued flags, so this is done before every iteration. All modem data
+ * fields are reported to the shadow.
+ */
+static void data_init(void)
+{
+	cloud_codec_shadow_refresh();
+
+	for (size_t i = 0; i < GNSS_COUNT; i++) {
+		gnss[i] = (struct cloud_data_gnss){
+			.pvt.longi = 10.417 + i * 0.00173,
+			.pvt.lat = 63.431 + i * 0.00091,
+			.pvt.acc = 4.8 + i * 0.3,
+			.pvt.alt = 45.2 + i * 0.7,
+			.pvt.spd = 12.56,
+			.pvt.hdg = 176.12,
+			.gnss_ts = SAMPLE_TS + i * SAMPLE_INTERVAL,
+			.queued = true
+		};
+	}
+
+	for (size_t i = 0; i < SENSOR_COUNT; i++) {
+		sensors[i] = (struct cloud_data_sensors){
+			.temperature = 21.46 + i * 0.12,
+			.humidity = 48.13 - i * 0.27,
+			.pressure = 100.12 + i * 0.01,
+			.bsec_air_quality = 50 + i,
+			.env_ts = SAMPLE_TS + i * SAMPLE_INTERVAL,
+			.queued = true
+		};
+	}
+
+	for (size_t i = 0; i < MODEM_DYNAMIC_COUNT; i++) {
+		modem_dynamic[i] = (struct cloud_data_modem_dynamic){
+			.band = 20,
+			.nw_mode = LTE_LC_LTE_MODE_LTEM,
+			.mcc = 242,
+			.mnc = 1,
+			.area = 2305,
+			.cell = 33703719 + i,
+			.rsrp = -97 - i,
+			.ip = "10.81.183.99",
+			.apn = "telenor.iot",
+			.mccmnc = "24201",
+			.ts = SAMPLE_TS + i * SAMPLE_INTERVAL,
+			.queued = true
+		};
+	}
+
+	for (size_t i = 0; i < UI_COUNT; i++) {
+		ui[i] = (struct cloud_data_ui){
+			.btn = 1 + (i % 2),
+			.btn_ts = SAMPLE_TS + i * SAMPLE_INTERVAL,
+			.queued = true
+		};
+	}
+
+	for (size_t i = 0; i < IMPACT_COUNT; i++) {
+		impact[i] = (struct cloud_data_impact){
+			.magnitude = 312.5,
+			.ts = SAMPLE_TS + i * SAMPLE_INTERVAL,
+			.queued = true
+		};
+	}
+
+	for (size_t i = 0; i < BATTERY_COUNT; i++) {
+		battery[i] = (struct cloud_data_battery){
+			.bat = 87 - i,
+			.bat_ts = SAMPLE_TS + i * SAMPLE_INTERVAL,
+			.queued = true
+		};
+	}
+
+	modem_static[0] = (struct cloud_data_modem_static){
+		.iccid = "89450421180216211234",
+		.appv = "v1.0.0-development",
+		.brdv = "thingy91_nrf9160",
+		.fw = "mfw_nrf9160_1.3.5",
+		.imei = "352656106111232",
+		.ts = SAMPLE_TS,
+		.queued = true
+	};
+
+	memset(&cloud_location, 0, sizeof(cloud_location));
+
+	cloud_location.neighbor_cells_valid = true;
+	cloud_location.neighbor_cells.cell_data.current_cell.mcc = 242;
+	cloud_location.neighbor_cells.cell_data.current_cell.mnc = 1;
+	cloud_location.neighbor_cells.cell_data.current_cell.id = 33703719;
+	cloud_location.neighbor_cells.cell_data.current_cell.tac = 2305;
+	cloud_location.neighbor_cells.cell_data.current_cell.earfcn = 6400;
+	cloud_location.neighbor_cells.cell_data.current_cell.timing_advance = 80;
+	cloud_location.neighbor_cells.cell_data.current_cell.rsrp = -97;
+	cloud_location.neighbor_cells.cell_data.current_cell.rsrq = -10;
+	cloud_location.neighbor_cells.cell_data.ncells_count = NEIGHBOR_CELL_COUNT;
+
+	for (size_t i = 0; i < NEIGHBOR_CELL_COUNT; i++) {
+		cloud_location.neighbor_cells.neighbor_cells[i] = (struct lte_lc_ncell){
+			.earfcn = 6400,
+			.time_diff = 24 * i,
+			.phys_cell_id = 100 + i,
+			.rsrp = -100 - i,
+			.rsrq = -11,
+		};
+	}
+
+	cloud_location.neighbor_cells.ts = SAMPLE_TS;
+	cloud_location.neighbor_cells.queued = true;
+	cloud_location.ts = SAMPLE_TS;
+	cloud_location.queued = true;
+}
+
+static int encode_data(struct cloud_codec_data *output)
+{
+	/* The latest entry of each buffer is sent in a data message. */
+	return cloud_codec_encode_data(output,
+				       &gnss[GNSS_COUNT - 1],
+				       &sensors[SENSOR_COUNT - 1],
+				       &modem_static[0],
+				       &modem_dynamic[MODEM_DYNAMIC_COUNT - 1],
+				       &ui[UI_COUNT - 1],
+				       &impact[IMPACT_COUNT - 1],
+				       &battery[BATTERY_COUNT - 1]);
+}
+
+/* Report the data once, and queue it again with a new RSRP value, as in a periodic update
+ * where only the signal strength has changed since the last update.
+ */
+static void data_delta_init(void)
+{
+	struct cloud_codec_data output = { 0 };
+
+	data_init();
+
+	if (encode_data(&output) == 0) {
+		k_free(output.buf);
+	}
+
+	for (size_t i = 0; i < MODEM_DYNAMIC_COUNT; i++) {
+		modem_dynamic[i].rsrp -= 3;
+		modem_dynamic[i].queued = true;
+	}
+
+	modem_static[0].queued = true;
+	gnss[GNSS_COUNT - 1].queued = true;
+	sensors[SENSOR_COUNT - 1].queued = true;
+	ui[UI_COUNT - 1].queued = true;
+	impact[IMPACT_COUNT - 1].queued = true;
+	battery[BATTERY_COUNT - 1].queued = true;
+}
+
+static int encode_batch_data(struct cloud_codec_data *output)
+{
+	return cloud_codec_encode_batch_data(output,
+					     gnss, sensors, modem_static, modem_dynamic, ui,
+					     impact, battery,
+					     GNSS_COUNT, SENSOR_COUNT, MODEM_STATIC_COUNT,
+					     MODEM_DYNAMIC_COUNT, UI_COUNT, IMPACT_COUNT,
+					     BATTERY_COUNT);
+}
+
+static int encode_cloud_location(struct cloud_codec_data *output)
+{
+	return cloud_codec_encode_cloud_location(output, &cloud_location);
+}
+
+static int decode_config(struct cloud_codec_data *output)
+{
+	int err = cloud_codec_decode_config(config_input, config_input_len, &config);
+
+	if (err == 0) {
+		output->len = config_input_len;
+	}
+
+	return err;
+}
+
+static void benchmark_run(const char *operation, void (*prepare_fn)(void),
+			  int (*operation_fn)(struct cloud_codec_data *))
+{
+	int err = 0;
+	uint64_t cycles = 0;
+	uint32_t allocs = 0;
+	size_t peak_heap = 0;
+	size_t output_len = 0;
+	uint32_t iterations;
+
+	for (iterations = 0; iterations < CONFIG_CODEC_BENCHMARK_ITERATIONS; iterations++) {
+		struct cloud_codec_data output = { 0 };
+		struct sys_memory_stats stats;
+		size_t allocated_before;
+		uint32_t start;
+
+		prepare_fn();
+
+		sys_heap_runtime_stats_reset_max(&system_heap->heap);
+		sys_heap_runtime_stats_get(&system_heap->heap, &stats);
+		allocated_before = stats.allocated_bytes;
+		alloc_count = 0;
+
+		start = k_cycle_get_32();
+		err = operation_fn(&output);
+		cycles += k_cycle_get_32() - start;
+
+		allocs += alloc_count;
+
+		sys_heap_runtime_stats_get(&system_heap->heap, &stats);
+		peak_heap = MAX(peak_heap, stats.max_allocated_bytes - allocated_before);
+
+		k_free(output.buf);
+
+		if (err) {
+			break;
+		}
+
+		output_len = output.len;
+	}
+
+	if (err) {
+		cycles = 0;
+		allocs = 0;
+		peak_heap = 0;
+		iterations = 0;
+	}
+
+	printk("%s%s,%s,%s,%d,%u,%u,%zu,%u,%zu\n", BENCHMARK_PREFIX, BENCHMARK_BACKEND,
+	       BENCHMARK_VARIANT, operation, err, iterations,
+	       iterations ? (uint32_t)(cycles / iterations) : 0, peak_heap,
+	       iterations ? (allocs / iterations) : 0, output_len);
+
+	/* Unsupported operations are reported, but do not fail the benchmark. */
+	if (err != -ENOTSUP) {
+		TEST_ASSERT_EQUAL(0, err);
+	}
+}
+
+void setUp(void)
+{
+	config = (struct cloud_data_cfg){ 0 };
+}
+
+void tearDown(void)
+{
+}
+
+void test_encode_data(void)
+{
+	benchmark_run("encode_data", data_init, encode_data);
+}
+
+void test_encode_data_delta(void)
+{
+	benchmark_run("encode_data_delta", data_delta_init, encode_data);
+}
+
+void test_encode_batch_data(void)
+{
+	benchmark_run("encode_batch_data", data_init, encode_batch_data);
+}
+
+void test_encode_cloud_location(void)
+{
+	benchmark_run("encode_cloud_location", data_init, encode_cloud_location);
+}
+
+void test_decode_config(void)
+{
+	benchmark_run("decode_config", data_init, decode_config);
+
+	TEST_ASSERT_EQUAL(config_fixture.active_mode, config.active_mode);
+	TEST_ASSERT_EQUAL(config_fixture.movement_timeout, config.movement_timeout);
+	TEST_ASSERT_EQUAL(config_fixture.no_data.gnss, config.no_data.gnss);
+}
+
+int main(void)
+{
+	int err;
+
+	err = cloud_codec_init(NULL, NULL);
+	if (err) {
+		printk("cloud_codec_init, error: %d\n", err);
+		return err;
+	}
+
+	system_heap = system_heap_find();
+	if (system_heap == NULL) {
+		printk("System heap not found\n");
+		return -ENOMEM;
+	}
+
+	heap_alloc_listener.heap_id = HEAP_ID_FROM_POINTER(&system_heap->heap);
+	heap_listener_register(&heap_alloc_listener);
+
+	printk("%sbackend,variant,operation,error,iterations,cycles,peak_heap,allocs,bytes\n",
+	       BENCHMARK_PREFIX);
+
+	(void)unity_main();
+
+	return 0;
+}
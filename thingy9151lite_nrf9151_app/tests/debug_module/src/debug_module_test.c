@@ -21,6 +21,8 @@
 #include "location_module_event.h"
 #include "debug_module_event.h"
 #include "data_module_event.h"
+#include "modem_module_event.h"
+#include "cloud_module_event.h"
 
 extern struct event_listener __event_listener_debug_module;
 
@@ -31,6 +33,8 @@ static struct app_module_event app_module_event_memory;
 static struct data_module_event data_module_event_memory;
 static struct location_module_event location_module_event_memory;
 static struct debug_module_event debug_module_event_memory;
+static struct modem_module_event modem_module_event_memory;
+static struct cloud_module_event cloud_module_event_memory;
 
 #define DEBUG_MODULE_EVT_HANDLER(aeh) __event_listener_debug_module.notification(aeh)
 
@@ -164,14 +168,99 @@ void test_memfault_trigger_metric_sampling_on_location_timeout(void)
 	app_event_manager_free(location_module_event);
 }
 
+/* Test whether the RRC metrics are updated when the RRC connection is released early. */
+void test_memfault_trigger_metric_sampling_on_rrc_idle(void)
+{
+	resetTest();
+	setup_debug_module_in_init_state();
+
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(lte_rrc_connected_time_ms), 2500, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(lte_rrc_release_count), 1, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(lte_rrc_release_saved_time_ms), 9000, 0);
+
+	__cmock_app_event_manager_alloc_ExpectAnyArgsAndReturn(&modem_module_event_memory);
+	__cmock_app_event_manager_free_ExpectAnyArgs();
+	struct modem_module_event *modem_module_event = new_modem_module_event();
+
+	modem_module_event->type = MODEM_EVT_LTE_RRC_IDLE;
+	modem_module_event->data.rrc.connected_time_ms = 2500;
+	modem_module_event->data.rrc.saved_time_ms = 9000;
+	modem_module_event->data.rrc.release_requested = true;
+
+	TEST_ASSERT_EQUAL(0, DEBUG_MODULE_EVT_HANDLER(
+		(struct app_event_header *)modem_module_event));
+	app_event_manager_free(modem_module_event);
+}
+
+/* Test whether the number of attempts needed to connect to cloud is added to the histogram
+ * metrics, and the causes of the failed attempts to the failure metrics.
+ */
+void test_memfault_trigger_metric_sampling_on_cloud_connected(void)
+{
+	resetTest();
+	setup_debug_module_in_init_state();
+
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_connect_attempts_3_to_4), 1, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_connect_failure_timeout_count), 1, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_connect_failure_network_count), 0, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_connect_failure_dns_count), 0, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_connect_failure_tls_count), 2, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_connect_failure_rejected_count), 0, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_handshake_count), 1, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_connection_overhead_est_bytes),
+		CONFIG_DEBUG_MODULE_CLOUD_HANDSHAKE_BYTES, 0);
+
+	/* Coredumps are sent on a cloud connection, there is none to send. */
+	__cmock_memfault_packetizer_data_available_ExpectAndReturn(0);
+
+	__cmock_app_event_manager_alloc_ExpectAnyArgsAndReturn(&cloud_module_event_memory);
+	__cmock_app_event_manager_free_ExpectAnyArgs();
+	struct cloud_module_event *cloud_module_event = new_cloud_module_event();
+
+	cloud_module_event->type = CLOUD_EVT_CONNECTED;
+	cloud_module_event->data.connection = (struct cloud_reconnect_summary){
+		.attempts = 4,
+		.failures = {
+			[CLOUD_RECONNECT_CAUSE_TIMEOUT] = 1,
+			[CLOUD_RECONNECT_CAUSE_TLS] = 2,
+		},
+	};
+
+	TEST_ASSERT_EQUAL(0, DEBUG_MODULE_EVT_HANDLER(
+		(struct app_event_header *)cloud_module_event));
+	app_event_manager_free(cloud_module_event);
+}
+
 /* Test that the debug module is able to submit Memfault data externally through events
- * of type DEBUG_EVT_MEMFAULT_DATA_READY carrying chunks of data.
+ * of type DEBUG_EVT_MEMFAULT_DATA_READY carrying chunks of data, and that the keepalive pings
+ * counted by the cloud module since the last report are added to the ping metrics.
  */
 void test_memfault_trigger_data_send(void)
 {
 	resetTest();
 	setup_debug_module_in_init_state();
 
+	cloud_reconnect_ping_ack();
+	cloud_reconnect_ping_ack();
+	cloud_reconnect_ping_ack();
+
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_ping_count), 3, 0);
+	__cmock_memfault_metrics_heartbeat_add_ExpectAndReturn(
+		MEMFAULT_METRICS_KEY(cloud_connection_overhead_est_bytes),
+		3 * CONFIG_DEBUG_MODULE_CLOUD_PING_BYTES, 0);
+
 	__cmock__event_submit_ExpectAnyArgs();
 
 	__cmock_memfault_packetizer_data_available_ExpectAndReturn(1);
@@ -0,0 +1,69 @@
+#
+# Copyright (c) 2024 Emcraft Systems
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Decode the event trace dump that the test firmware prints, using the host decoder."""
+
+import sys
+from pathlib import Path
+
+from twister_harness import DeviceAdapter
+
+sys.path.insert(0, str(Path(__file__).resolve().parents[3] / 'scripts'))
+
+import event_trace_decode as decode  # noqa: E402
+
+
+def test_event_trace_decode(dut: DeviceAdapter, tmp_path):
+    lines = dut.readlines_until(regex='PROJECT EXECUTION (SUCCESSFUL|FAILED)')
+    assert 'PROJECT EXECUTION SUCCESSFUL' in lines[-1]
+
+    log = tmp_path / 'console.log'
+    log.write_text('\n'.join(dut.readlines_until(regex='event_trace end')))
+
+    cycles_per_sec, names, records, overwritten = decode.parse_dump(decode.read_dump(log))
+
+    assert cycles_per_sec > 0
+    assert overwritten == 0
+    assert names == ['sensor_module_event', 'data', 'app']
+
+    # The sequence recorded by sequence_record() in src/main.c.
+    none = decode.NAME_NONE
+    assert [record[1:4] for record in records] == [
+        (decode.SUBMIT, none, 0),
+        (decode.ENQUEUE, 1, 0),
+        (decode.DEQUEUE, 1, 0),
+        (decode.RELEASE, 1, 0),
+        (decode.STATE, 1, none),
+        (decode.DROP, 2, 0),
+    ]
+
+    timestamps = [record[0] for record in records]
+    assert timestamps == sorted(timestamps)
+
+    event_type = records[0][4]
+    assert all(record[4] == event_type for record in records if record[3] == 0)
+    assert records[4][4] == 2
+
+    timeline = decode.Timeline(cycles_per_sec, names)
+    for record in records:
+        timeline.add(record)
+    timeline.close_all(timeline.last_us)
+
+    event = f'sensor_module_event:{event_type}'
+    data_tid = timeline.tids['data']
+    data_events = [e for e in timeline.events if e.get('tid') == data_tid and e['ph'] != 'M']
+
+    # The time in the queue, followed by the time in the handler.
+    assert [e['ph'] for e in data_events] == ['b', 'e', 'B', 'E']
+    assert data_events[0]['args']['event'] == event
+    assert data_events[0]['id'] == data_events[1]['id']
+    assert data_events[2]['name'] == event
+
+    state_events = [e for e in timeline.events if e.get('tid') == timeline.tids['data state']]
+    assert [e.get('name') for e in state_events if e['ph'] == 'B'] == ['state 2']
+
+    assert any(e['ph'] == 'i' and e.get('name') == f'drop {event}' and
+               e['tid'] == timeline.tids['app'] for e in timeline.events)
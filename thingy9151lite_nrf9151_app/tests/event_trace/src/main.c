@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2024 Emcraft Systems
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <app_event_manager.h>
+
+#include "event_trace.h"
+#include "sensor_module_event.h"
+
+#define HEADER_SIZE sizeof(struct event_trace_dump_header)
+#define RECORD_SIZE sizeof(struct event_trace_record)
+#define DUMP_SIZE_MAX (HEADER_SIZE + CONFIG_EVENT_TRACE_NAME_COUNT * EVENT_TRACE_NAME_LEN +	\
+		       CONFIG_EVENT_TRACE_RECORD_COUNT * RECORD_SIZE)
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static uint8_t dump[DUMP_SIZE_MAX] __aligned(4);
+static uint8_t dump_copy[DUMP_SIZE_MAX];
+static size_t dump_copy_len;
+static struct sensor_module_event *event;
+
+/* Record the life of an event in a module queue, a state transition and a dropped event. The same
+ * sequence is decoded by the host test in pytest/.
+ */
+static void sequence_record(void)
+{
+	event_trace_event(EVENT_TRACE_SUBMIT, NULL, &event->header);
+	event_trace_event(EVENT_TRACE_ENQUEUE, "data", &event->header);
+	event_trace_event(EVENT_TRACE_DEQUEUE, "data", &event->header);
+	event_trace_event(EVENT_TRACE_RELEASE, "data", &event->header);
+	event_trace_state(EVENT_TRACE_STATE, "data", 2);
+	event_trace_event(EVENT_TRACE_DROP, "app", &event->header);
+}
+
+/* Read the complete dump in one part and return its header. */
+static size_t dump_get(struct event_trace_dump_header *header)
+{
+	size_t len = event_trace_dump_read(0, dump, sizeof(dump));
+
+	TEST_ASSERT_EQUAL(event_trace_dump_size_get(), len);
+	TEST_ASSERT_GREATER_OR_EQUAL(HEADER_SIZE, len);
+	memcpy(header, dump, sizeof(*header));
+
+	return len;
+}
+
+static const char *dump_name_get(size_t index)
+{
+	return (const char *)&dump[HEADER_SIZE + index * EVENT_TRACE_NAME_LEN];
+}
+
+static const struct event_trace_record *dump_record_get(
+	const struct event_trace_dump_header *header, size_t index)
+{
+	return (const struct event_trace_record *)&dump[HEADER_SIZE +
+							header->name_count * EVENT_TRACE_NAME_LEN +
+							index * RECORD_SIZE];
+}
+
+static int dump_copy_write(const uint8_t *buf, size_t len, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(dump_copy), dump_copy_len + len);
+	memcpy(&dump_copy[dump_copy_len], buf, len);
+	dump_copy_len += len;
+
+	return 0;
+}
+
+static int dump_error_write(const uint8_t *buf, size_t len, void *user_data)
+{
+	int *calls = user_data;
+
+	ARG_UNUSED(buf);
+	ARG_UNUSED(len);
+
+	(*calls)++;
+
+	return -EIO;
+}
+
+void setUp(void)
+{
+	event_trace_clear();
+	dump_copy_len = 0;
+}
+
+void tearDown(void)
+{
+}
+
+void test_event_trace_dump_format(void)
+{
+	struct event_trace_dump_header header;
+	const struct event_trace_record *rec;
+	size_t len;
+
+	sequence_record();
+	len = dump_get(&header);
+
+	TEST_ASSERT_EQUAL_HEX32(EVENT_TRACE_MAGIC, header.magic);
+	TEST_ASSERT_EQUAL(EVENT_TRACE_VERSION, header.version);
+	TEST_ASSERT_EQUAL(RECORD_SIZE, header.record_size);
+	TEST_ASSERT_EQUAL(sys_clock_hw_cycles_per_sec(), header.cycles_per_sec);
+	TEST_ASSERT_EQUAL(3, header.name_count);
+	TEST_ASSERT_EQUAL(6, header.record_count);
+	TEST_ASSERT_EQUAL(0, header.overwritten_count);
+	TEST_ASSERT_EQUAL(HEADER_SIZE + 3 * EVENT_TRACE_NAME_LEN + 6 * RECORD_SIZE, len);
+
+	/* Names are added in the order they are first recorded. */
+	TEST_ASSERT_EQUAL_STRING("sensor_module_event", dump_name_get(0));
+	TEST_ASSERT_EQUAL_STRING("data", dump_name_get(1));
+	TEST_ASSERT_EQUAL_STRING("app", dump_name_get(2));
+
+	rec = dump_record_get(&header, 0);
+	TEST_ASSERT_EQUAL(EVENT_TRACE_SUBMIT, rec->type);
+	TEST_ASSERT_EQUAL(EVENT_TRACE_NAME_NONE, rec->module);
+	TEST_ASSERT_EQUAL(0, rec->event);
+	TEST_ASSERT_EQUAL(SENSOR_EVT_ENVIRONMENTAL_DATA_READY, rec->arg);
+
+	rec = dump_record_get(&header, 1);
+	TEST_ASSERT_EQUAL(EVENT_TRACE_ENQUEUE, rec->type);
+	TEST_ASSERT_EQUAL(1, rec->module);
+	TEST_ASSERT_EQUAL(0, rec->event);
+
+	rec = dump_record_get(&header, 4);
+	TEST_ASSERT_EQUAL(EVENT_TRACE_STATE, rec->type);
+	TEST_ASSERT_EQUAL(1, rec->module);
+	TEST_ASSERT_EQUAL(EVENT_TRACE_NAME_NONE, rec->event);
+	TEST_ASSERT_EQUAL(2, rec->arg);
+
+	rec = dump_record_get(&header, 5);
+	TEST_ASSERT_EQUAL(EVENT_TRACE_DROP, rec->type);
+	TEST_ASSERT_EQUAL(2, rec->module);
+
+	for (size_t i = 1; i < header.record_count; i++) {
+		TEST_ASSERT_GREATER_OR_EQUAL(dump_record_get(&header, i - 1)->timestamp,
+					     dump_record_get(&header, i)->timestamp);
+	}
+}
+
+/* Test that the oldest records are overwritten and counted when the ring buffer is full, and
+ * that the dump starts with the oldest remaining record.
+ */
+void test_event_trace_overwrite(void)
+{
+	struct event_trace_dump_header header;
+
+	for (uint32_t i = 0; i < CONFIG_EVENT_TRACE_RECORD_COUNT + 3; i++) {
+		event_trace_state(EVENT_TRACE_SUB_STATE, "data", i);
+	}
+
+	(void)dump_get(&header);
+
+	TEST_ASSERT_EQUAL(CONFIG_EVENT_TRACE_RECORD_COUNT, header.record_count);
+	TEST_ASSERT_EQUAL(3, header.overwritten_count);
+
+	for (size_t i = 0; i < header.record_count; i++) {
+		TEST_ASSERT_EQUAL(i + 3, dump_record_get(&header, i)->arg);
+	}
+}
+
+/* Test that names that do not fit in the name table are recorded without a name, and that long
+ * names are truncated.
+ */
+void test_event_trace_name_table_full(void)
+{
+	static const char *const modules[] = {
+		"first", "second", "third", "a module name that does not fit", "fifth"
+	};
+	struct event_trace_dump_header header;
+
+	TEST_ASSERT_EQUAL(CONFIG_EVENT_TRACE_NAME_COUNT + 1, ARRAY_SIZE(modules));
+
+	for (size_t i = 0; i < ARRAY_SIZE(modules); i++) {
+		event_trace_state(EVENT_TRACE_STATE, modules[i], i);
+	}
+
+	(void)dump_get(&header);
+
+	TEST_ASSERT_EQUAL(CONFIG_EVENT_TRACE_NAME_COUNT, header.name_count);
+	TEST_ASSERT_EQUAL(ARRAY_SIZE(modules), header.record_count);
+	TEST_ASSERT_EQUAL_STRING_LEN(modules[3], dump_name_get(3), EVENT_TRACE_NAME_LEN - 1);
+	TEST_ASSERT_EQUAL('\0', dump_name_get(3)[EVENT_TRACE_NAME_LEN - 1]);
+	TEST_ASSERT_EQUAL(3, dump_record_get(&header, 3)->module);
+	TEST_ASSERT_EQUAL(EVENT_TRACE_NAME_NONE, dump_record_get(&header, 4)->module);
+}
+
+/* Test that a dump read in parts that do not line up with the header, names and records is the
+ * same as a dump read at once.
+ */
+void test_event_trace_dump_read_parts(void)
+{
+	struct event_trace_dump_header header;
+	size_t len, read;
+
+	sequence_record();
+	len = dump_get(&header);
+
+	while ((read = event_trace_dump_read(dump_copy_len, &dump_copy[dump_copy_len], 7)) > 0) {
+		dump_copy_len += read;
+	}
+
+	TEST_ASSERT_EQUAL(len, dump_copy_len);
+	TEST_ASSERT_EQUAL_MEMORY(dump, dump_copy, len);
+}
+
+/* Test the dump callback, and that recording is resumed after the dump. */
+void test_event_trace_dump(void)
+{
+	struct event_trace_dump_header header;
+	int calls = 0;
+	size_t len;
+
+	sequence_record();
+	len = dump_get(&header);
+
+	TEST_ASSERT_EQUAL(0, event_trace_dump(dump_copy_write, NULL));
+	TEST_ASSERT_EQUAL(len, dump_copy_len);
+	TEST_ASSERT_EQUAL_MEMORY(dump, dump_copy, len);
+
+	/* An error from the callback stops the dump. */
+	TEST_ASSERT_EQUAL(-EIO, event_trace_dump(dump_error_write, &calls));
+	TEST_ASSERT_EQUAL(1, calls);
+
+	event_trace_state(EVENT_TRACE_STATE, "data", 0);
+	(void)dump_get(&header);
+	TEST_ASSERT_EQUAL(7, header.record_count);
+}
+
+void test_event_trace_pause(void)
+{
+	struct event_trace_dump_header header;
+
+	event_trace_pause(true);
+	event_trace_state(EVENT_TRACE_STATE, "data", 0);
+	event_trace_pause(false);
+
+	(void)dump_get(&header);
+	TEST_ASSERT_EQUAL(0, header.record_count);
+	TEST_ASSERT_EQUAL(0, header.name_count);
+
+	event_trace_state(EVENT_TRACE_STATE, "data", 0);
+
+	(void)dump_get(&header);
+	TEST_ASSERT_EQUAL(1, header.record_count);
+}
+
+static int dump_hex_print(const uint8_t *buf, size_t len, void *user_data)
+{
+	char hex[64 + 1];
+
+	ARG_UNUSED(user_data);
+
+	for (size_t i = 0; i < len; i += 32) {
+		bin2hex(&buf[i], MIN(len - i, 32), hex, sizeof(hex));
+		printk("%s\n", hex);
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	event = new_sensor_module_event();
+	event->type = SENSOR_EVT_ENVIRONMENTAL_DATA_READY;
+
+	(void)unity_main();
+
+	/* Print the dump in the format of the event_trace dump shell command, for the host test
+	 * in pytest/.
+	 */
+	event_trace_clear();
+	sequence_record();
+
+	printk("event_trace begin\n");
+	(void)event_trace_dump(dump_hex_print, NULL);
+	printk("event_trace end\n");
+
+	app_event_manager_free(event);
+
+	return 0;
+}
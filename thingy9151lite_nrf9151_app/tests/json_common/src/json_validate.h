@@ -82,6 +82,17 @@
 					"}"							\
 				"}"
 
+#define TEST_VALIDATE_MODEM_DYNAMIC_DELTA_JSON_SCHEMA						\
+				"{"								\
+					"\"roam\":{"						\
+						"\"v\":{"					\
+							"\"rsrp\":-10,"			\
+							"\"cell\":33703720"			\
+						"},"						\
+						"\"ts\":1563968747123"				\
+					"}"							\
+				"}"
+
 #define TEST_VALIDATE_UI_JSON_SCHEMA								\
 				"{"								\
 					"\"btn\":{"						\
@@ -13,6 +13,8 @@
 
 #include "json_helpers.h"
 #include "json_common.h"
+#include "json_arena.h"
+#include "cloud_codec_shadow.h"
 #include "cloud_codec.h"
 #include "json_protocol_names.h"
 #include "json_validate.h"
@@ -149,6 +151,32 @@ void test_encode_battery_data_array(void)
 	TEST_ASSERT_EQUAL(0, ret);
 }
 
+void test_encode_battery_data_unix_timestamp(void)
+{
+	int ret;
+	struct cloud_data_battery data = {
+		.bat = 3600,
+		.bat_ts = 1563968700000,
+		.queued = true,
+		.ts_unix = true
+	};
+
+	ret = json_common_battery_data_add(dummy.root_obj,
+					   &data,
+					   JSON_COMMON_ADD_DATA_TO_OBJECT,
+					   DATA_BATTERY,
+					   NULL);
+	TEST_ASSERT_EQUAL(0, ret);
+
+	/* Timestamps already in UNIX time are encoded as is. */
+	cJSON *battery_obj = cJSON_GetObjectItem(dummy.root_obj, DATA_BATTERY);
+	cJSON *ts_obj = cJSON_GetObjectItem(battery_obj, DATA_TIMESTAMP);
+
+	TEST_ASSERT_NOT_NULL(ts_obj);
+	TEST_ASSERT_EQUAL_DOUBLE(1563968700000, ts_obj->valuedouble);
+	TEST_ASSERT_FALSE(data.queued);
+}
+
 /* GNSS */
 
 void test_encode_gnss_data_object(void)
@@ -507,6 +535,201 @@ void test_encode_modem_static_data_array(void)
 	TEST_ASSERT_EQUAL(0, ret);
 }
 
+#if defined(CONFIG_CLOUD_CODEC_SHADOW_DELTA)
+/* Modem data shadow delta */
+
+/* Finish the staged shadow update and acknowledge it, as cloud does when it has received the
+ * message.
+ */
+static void shadow_update_acked(void)
+{
+	uint32_t id = cloud_codec_shadow_update_done(true);
+
+	TEST_ASSERT_NOT_EQUAL(0, id);
+	TEST_ASSERT_EQUAL(0, cloud_codec_shadow_update_ack(id));
+}
+
+void test_encode_modem_dynamic_data_delta(void)
+{
+	int ret;
+	uint32_t fields;
+	struct cloud_data_modem_dynamic data = {
+		.band = 3,
+		.nw_mode = LTE_LC_LTE_MODE_NBIOT,
+		.rsrp = -8,
+		.area = 12,
+		.mccmnc = "24202",
+		.cell = 33703719,
+		.ip = "10.81.183.99",
+		.ts = 1000,
+		.queued = true,
+	};
+
+	cloud_codec_shadow_refresh();
+
+	/* All fields are reported in the first update. */
+	fields = cloud_codec_shadow_modem_dynamic_stage(&data);
+	TEST_ASSERT_EQUAL(CLOUD_CODEC_SHADOW_MODEM_DYNAMIC_ALL, fields);
+
+	shadow_update_acked();
+
+	/* Only the fields that have changed are reported afterwards. */
+	data.rsrp = -10;
+	data.cell = 33703720;
+	data.ts = 1000;
+
+	fields = cloud_codec_shadow_modem_dynamic_stage(&data);
+	TEST_ASSERT_EQUAL(CLOUD_CODEC_SHADOW_MODEM_RSRP | CLOUD_CODEC_SHADOW_MODEM_CELL, fields);
+
+	ret = json_common_modem_dynamic_fields_add(dummy.root_obj,
+						   &data,
+						   fields,
+						   JSON_COMMON_ADD_DATA_TO_OBJECT,
+						   DATA_MODEM_DYNAMIC,
+						   NULL);
+	TEST_ASSERT_EQUAL(0, ret);
+
+	ret = encoded_output_check(dummy.root_obj, TEST_VALIDATE_MODEM_DYNAMIC_DELTA_JSON_SCHEMA,
+				   data.queued);
+	TEST_ASSERT_EQUAL(0, ret);
+
+	shadow_update_acked();
+}
+
+void test_encode_modem_static_data_delta_unchanged(void)
+{
+	int ret;
+	uint32_t fields;
+	struct cloud_data_modem_static data = {
+		.imei = "352656106111232",
+		.iccid = "89450421180216211234",
+		.fw = "mfw_nrf9160_1.2.3",
+		.brdv = "nrf9160dk_nrf9160",
+		.appv = "v1.0.0-development",
+		.ts = 1000,
+		.queued = true
+	};
+
+	cloud_codec_shadow_refresh();
+
+	fields = cloud_codec_shadow_modem_static_stage(&data);
+	TEST_ASSERT_EQUAL(CLOUD_CODEC_SHADOW_MODEM_STATIC_ALL, fields);
+
+	shadow_update_acked();
+
+	/* Unchanged data is dequeued without being encoded. */
+	fields = cloud_codec_shadow_modem_static_stage(&data);
+	TEST_ASSERT_EQUAL(0, fields);
+
+	ret = json_common_modem_static_fields_add(dummy.root_obj,
+						  &data,
+						  fields,
+						  JSON_COMMON_ADD_DATA_TO_OBJECT,
+						  DATA_MODEM_STATIC,
+						  NULL);
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+	TEST_ASSERT_FALSE(data.queued);
+	TEST_ASSERT_NULL(cJSON_GetObjectItem(dummy.root_obj, DATA_MODEM_STATIC));
+
+	shadow_update_acked();
+
+	/* Data that is not queued is not staged. */
+	TEST_ASSERT_EQUAL(0, cloud_codec_shadow_modem_static_stage(&data));
+
+	/* All fields are reported again after a refresh. */
+	cloud_codec_shadow_refresh();
+
+	data.queued = true;
+
+	fields = cloud_codec_shadow_modem_static_stage(&data);
+	TEST_ASSERT_EQUAL(CLOUD_CODEC_SHADOW_MODEM_STATIC_ALL, fields);
+
+	shadow_update_acked();
+}
+
+void test_encode_modem_data_delta_discarded(void)
+{
+	uint32_t fields;
+	struct cloud_data_modem_dynamic data = {
+		.band = 3,
+		.nw_mode = LTE_LC_LTE_MODE_NBIOT,
+		.rsrp = -8,
+		.mccmnc = "24202",
+		.queued = true,
+	};
+
+	cloud_codec_shadow_refresh();
+
+	(void)cloud_codec_shadow_modem_dynamic_stage(&data);
+	shadow_update_acked();
+
+	/* Values staged for an update that failed to encode are not stored as reported. */
+	data.band = 20;
+
+	fields = cloud_codec_shadow_modem_dynamic_stage(&data);
+	TEST_ASSERT_EQUAL(CLOUD_CODEC_SHADOW_MODEM_BAND, fields);
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_shadow_update_done(false));
+
+	fields = cloud_codec_shadow_modem_dynamic_stage(&data);
+	TEST_ASSERT_EQUAL(CLOUD_CODEC_SHADOW_MODEM_BAND, fields);
+
+	shadow_update_acked();
+}
+
+void test_encode_modem_data_delta_not_acked(void)
+{
+	uint32_t fields;
+	uint32_t id_old;
+	uint32_t id;
+	struct cloud_data_modem_dynamic data = {
+		.band = 3,
+		.nw_mode = LTE_LC_LTE_MODE_NBIOT,
+		.rsrp = -8,
+		.mccmnc = "24202",
+		.queued = true,
+	};
+
+	cloud_codec_shadow_refresh();
+
+	(void)cloud_codec_shadow_modem_dynamic_stage(&data);
+	shadow_update_acked();
+
+	/* Values of an update that has not been acknowledged are reported again. */
+	data.band = 20;
+
+	fields = cloud_codec_shadow_modem_dynamic_stage(&data);
+	TEST_ASSERT_EQUAL(CLOUD_CODEC_SHADOW_MODEM_BAND, fields);
+	id_old = cloud_codec_shadow_update_done(true);
+	TEST_ASSERT_NOT_EQUAL(0, id_old);
+
+	fields = cloud_codec_shadow_modem_dynamic_stage(&data);
+	TEST_ASSERT_EQUAL(CLOUD_CODEC_SHADOW_MODEM_BAND, fields);
+	id = cloud_codec_shadow_update_done(true);
+	TEST_ASSERT_NOT_EQUAL(id_old, id);
+
+	/* Only the most recent update is pending. */
+	TEST_ASSERT_EQUAL(-ENOENT, cloud_codec_shadow_update_ack(id_old));
+	TEST_ASSERT_EQUAL(0, cloud_codec_shadow_update_ack(id));
+	TEST_ASSERT_EQUAL(-ENOENT, cloud_codec_shadow_update_ack(id));
+
+	TEST_ASSERT_EQUAL(0, cloud_codec_shadow_modem_dynamic_stage(&data));
+	TEST_ASSERT_NOT_EQUAL(0, cloud_codec_shadow_update_done(true));
+
+	/* A pending update is dropped on refresh. */
+	data.band = 3;
+
+	(void)cloud_codec_shadow_modem_dynamic_stage(&data);
+	id = cloud_codec_shadow_update_done(true);
+	cloud_codec_shadow_refresh();
+	TEST_ASSERT_EQUAL(-ENOENT, cloud_codec_shadow_update_ack(id));
+
+	fields = cloud_codec_shadow_modem_dynamic_stage(&data);
+	TEST_ASSERT_EQUAL(CLOUD_CODEC_SHADOW_MODEM_DYNAMIC_ALL, fields);
+	TEST_ASSERT_EQUAL(0, cloud_codec_shadow_update_done(false));
+}
+#endif /* CONFIG_CLOUD_CODEC_SHADOW_DELTA */
+
 /* UI */
 
 void test_encode_ui_data_object(void)
@@ -1025,6 +1248,453 @@ void test_encode_batch_data_object(void)
 	TEST_ASSERT_EQUAL(-EINVAL, ret);
 }
 
+/* Batch messages */
+
+struct batch_fixture {
+	struct cloud_data_battery battery[3];
+	struct cloud_data_gnss gnss[2];
+	struct cloud_data_modem_dynamic modem_dynamic[2];
+	struct cloud_data_modem_static modem_static[1];
+	struct cloud_data_ui ui[2];
+	struct cloud_data_impact impact[2];
+	struct cloud_data_sensors environmental[2];
+};
+
+/* Values are chosen to cover integer, fractional and negative numbers, as well as strings
+ * that need to be escaped.
+ */
+static void batch_fixture_init(struct batch_fixture *fixture)
+{
+	memset(fixture, 0, sizeof(*fixture));
+
+	fixture->battery[0] = (struct cloud_data_battery){ .bat = 3600, .bat_ts = 1000,
+							   .queued = true };
+	/* Not queued, must not be encoded. */
+	fixture->battery[1] = (struct cloud_data_battery){ .bat = 3500, .bat_ts = 2000 };
+	fixture->battery[2] = (struct cloud_data_battery){ .bat = 3400, .bat_ts = 1563968747999,
+							   .ts_unix = true, .queued = true };
+
+	fixture->gnss[0] = (struct cloud_data_gnss){
+		.pvt.longi = 10.417716, .pvt.lat = 63.431007, .pvt.acc = 12.5, .pvt.alt = 170.2,
+		.pvt.spd = 0.1, .pvt.hdg = 176.12, .gnss_ts = 1000, .queued = true };
+	fixture->gnss[1] = (struct cloud_data_gnss){
+		.pvt.longi = -0.000001, .pvt.lat = -33.8688, .pvt.acc = 24, .pvt.alt = -2,
+		.pvt.spd = 1, .pvt.hdg = 0, .gnss_ts = 1000, .queued = true };
+
+	fixture->modem_dynamic[0] = (struct cloud_data_modem_dynamic){
+		.band = 3, .nw_mode = LTE_LC_LTE_MODE_NBIOT, .rsrp = -8, .area = 12,
+		.mccmnc = "24202", .cell = 33703719, .ip = "10.81.183.99", .ts = 1000,
+		.queued = true };
+	fixture->modem_dynamic[1] = (struct cloud_data_modem_dynamic){
+		.band = 20, .nw_mode = LTE_LC_LTE_MODE_NONE, .rsrp = -5, .area = 12,
+		.mccmnc = "24202", .cell = 33703719, .ip = "10.81.183.99", .ts = 1000,
+		.queued = true };
+
+	fixture->modem_static[0] = (struct cloud_data_modem_static){
+		.imei = "352656106111232", .iccid = "89450421180216211234",
+		.fw = "mfw_nrf9160_1.2.3", .brdv = "nrf9160dk_nrf9160",
+		.appv = "v1.0.0-\"dev\"\t\\\x01", .ts = 1000, .queued = true };
+
+	fixture->ui[0] = (struct cloud_data_ui){ .btn = 1, .btn_ts = 1000, .queued = true };
+	fixture->ui[1] = (struct cloud_data_ui){ .btn = 2, .btn_ts = 1001, .queued = true };
+
+	fixture->impact[0] = (struct cloud_data_impact){ .magnitude = 300.0, .ts = 1000,
+							 .queued = true };
+	fixture->impact[1] = (struct cloud_data_impact){ .magnitude = 12.3456789, .ts = 1000,
+							 .queued = true };
+
+	fixture->environmental[0] = (struct cloud_data_sensors){
+		.humidity = 50.5, .temperature = 23.1, .pressure = 80, .bsec_air_quality = 50,
+		.env_ts = 1000, .queued = true };
+	/* Air quality not provided. */
+	fixture->environmental[1] = (struct cloud_data_sensors){
+		.humidity = 49, .temperature = -4.25, .pressure = 101.325, .bsec_air_quality = -1,
+		.env_ts = 1000, .queued = true };
+}
+
+static void batch_fixture_buffers_get(struct batch_fixture *fixture,
+				      struct json_common_batch_buffer *buffers)
+{
+	buffers[0] = (struct json_common_batch_buffer){
+		JSON_COMMON_MODEM_STATIC, fixture->modem_static,
+		ARRAY_SIZE(fixture->modem_static), DATA_MODEM_STATIC };
+	buffers[1] = (struct json_common_batch_buffer){
+		JSON_COMMON_MODEM_DYNAMIC, fixture->modem_dynamic,
+		ARRAY_SIZE(fixture->modem_dynamic), DATA_MODEM_DYNAMIC };
+	buffers[2] = (struct json_common_batch_buffer){
+		JSON_COMMON_GNSS, fixture->gnss, ARRAY_SIZE(fixture->gnss), DATA_GNSS };
+	buffers[3] = (struct json_common_batch_buffer){
+		JSON_COMMON_SENSOR, fixture->environmental,
+		ARRAY_SIZE(fixture->environmental), DATA_ENVIRONMENTALS };
+	buffers[4] = (struct json_common_batch_buffer){
+		JSON_COMMON_UI, fixture->ui, ARRAY_SIZE(fixture->ui), DATA_BUTTON };
+	buffers[5] = (struct json_common_batch_buffer){
+		JSON_COMMON_IMPACT, fixture->impact, ARRAY_SIZE(fixture->impact), DATA_IMPACT };
+	buffers[6] = (struct json_common_batch_buffer){
+		JSON_COMMON_BATTERY, fixture->battery, ARRAY_SIZE(fixture->battery),
+		DATA_BATTERY };
+}
+
+#define QUEUED_CHECK(_expected, _actual, _member)						\
+	for (size_t i = 0; i < ARRAY_SIZE((_expected)->_member); i++) {			\
+		TEST_ASSERT_EQUAL((_expected)->_member[i].queued, (_actual)->_member[i].queued);	\
+	}
+
+static void batch_fixture_queued_check(struct batch_fixture *expected,
+				       struct batch_fixture *actual)
+{
+	QUEUED_CHECK(expected, actual, battery);
+	QUEUED_CHECK(expected, actual, gnss);
+	QUEUED_CHECK(expected, actual, modem_dynamic);
+	QUEUED_CHECK(expected, actual, modem_static);
+	QUEUED_CHECK(expected, actual, ui);
+	QUEUED_CHECK(expected, actual, impact);
+	QUEUED_CHECK(expected, actual, environmental);
+}
+
+/* Number of queued entries in the batch fixture. */
+#define BATCH_FIXTURE_QUEUED_COUNT 13
+
+/* Build a batch message as a cJSON tree and return the length of the printed message. */
+static int batch_cjson_encode(struct json_common_batch_buffer *buffers, size_t count,
+			      size_t size_max, size_t *len)
+{
+	int ret;
+	char *buffer;
+	cJSON *root_obj = cJSON_CreateObject();
+
+	TEST_ASSERT_NOT_NULL(root_obj);
+
+	ret = json_common_batch_add(root_obj, buffers, count, size_max);
+	if (ret == 0) {
+		buffer = cJSON_PrintUnformatted(root_obj);
+		TEST_ASSERT_NOT_NULL(buffer);
+		*len = strlen(buffer);
+		cJSON_FreeString(buffer);
+	}
+
+	cJSON_Delete(root_obj);
+
+	return ret;
+}
+
+/* Batch messages built as a cJSON tree are split at the maximum message size, in buffer
+ * order.
+ */
+void test_encode_batch_data_cjson_chunked(void)
+{
+	int ret;
+	static struct batch_fixture reference_fixture;
+	static struct batch_fixture fixture;
+	struct json_common_batch_buffer buffers[7];
+	const size_t size_max = 256;
+	size_t count = 1;
+	size_t len;
+
+	batch_fixture_init(&reference_fixture);
+	batch_fixture_init(&fixture);
+
+	batch_fixture_buffers_get(&reference_fixture, buffers);
+
+	ret = batch_cjson_encode(buffers, ARRAY_SIZE(buffers), 0, &len);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_GREATER_THAN(size_max, len);
+
+	batch_fixture_buffers_get(&fixture, buffers);
+
+	ret = batch_cjson_encode(buffers, ARRAY_SIZE(buffers), size_max, &len);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_LESS_OR_EQUAL(size_max, len);
+
+	/* Only the entries in the first message are dequeued, starting with the first buffer. */
+	TEST_ASSERT_FALSE(fixture.modem_static[0].queued);
+	TEST_ASSERT_TRUE(fixture.battery[0].queued);
+	TEST_ASSERT_TRUE(fixture.battery[2].queued);
+
+	while (true) {
+		ret = batch_cjson_encode(buffers, ARRAY_SIZE(buffers), size_max, &len);
+		if (ret != 0) {
+			break;
+		}
+
+		count++;
+		TEST_ASSERT_LESS_OR_EQUAL(size_max, len);
+	}
+
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+	TEST_ASSERT_GREATER_THAN(1, count);
+
+	/* All entries have been dequeued, the same way as by an unbounded message. */
+	batch_fixture_queued_check(&reference_fixture, &fixture);
+}
+
+/* An entry that does not fit in the maximum message size is sent on its own. */
+void test_encode_batch_data_cjson_chunked_entry_too_large(void)
+{
+	int ret;
+	static struct batch_fixture fixture;
+	struct json_common_batch_buffer buffers[7];
+	size_t count = 0;
+	size_t len;
+
+	batch_fixture_init(&fixture);
+	batch_fixture_buffers_get(&fixture, buffers);
+
+	while (true) {
+		ret = batch_cjson_encode(buffers, ARRAY_SIZE(buffers), 1, &len);
+		if (ret != 0) {
+			break;
+		}
+
+		count++;
+	}
+
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+	TEST_ASSERT_EQUAL(BATCH_FIXTURE_QUEUED_COUNT, count);
+}
+
+#if defined(CONFIG_CLOUD_CODEC_JSON_WRITER)
+/* Streaming batch encoder */
+
+/* The streaming encoder must produce exactly the same output as the cJSON based encoder. */
+void test_encode_batch_data_writer_equal_to_cjson(void)
+{
+	int ret;
+	static struct batch_fixture cjson_fixture;
+	static struct batch_fixture writer_fixture;
+	struct json_common_batch_buffer buffers[7];
+	struct cloud_codec_data output = { 0 };
+
+	batch_fixture_init(&cjson_fixture);
+	batch_fixture_init(&writer_fixture);
+
+	batch_fixture_buffers_get(&cjson_fixture, buffers);
+
+	for (size_t i = 0; i < ARRAY_SIZE(buffers); i++) {
+		ret = json_common_batch_data_add(dummy.root_obj, buffers[i].type, buffers[i].buf,
+						 buffers[i].buf_count, buffers[i].object_label);
+		TEST_ASSERT_EQUAL(0, ret);
+	}
+
+	dummy.buffer = cJSON_PrintUnformatted(dummy.root_obj);
+	TEST_ASSERT_NOT_NULL(dummy.buffer);
+
+	batch_fixture_buffers_get(&writer_fixture, buffers);
+
+	ret = json_common_batch_encode(&output, buffers, ARRAY_SIZE(buffers), 0);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_NOT_NULL(output.buf);
+	TEST_ASSERT_EQUAL(strlen(dummy.buffer), output.len);
+	TEST_ASSERT_EQUAL_STRING(dummy.buffer, output.buf);
+
+	/* Entries must be dequeued the same way as by the cJSON based encoder. */
+	batch_fixture_queued_check(&cjson_fixture, &writer_fixture);
+
+	k_free(output.buf);
+
+	/* All entries have been dequeued, nothing is left to encode. */
+	ret = json_common_batch_encode(&output, buffers, ARRAY_SIZE(buffers), 0);
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+}
+
+/* Batch messages are split at the maximum message size, oldest entries first. */
+void test_encode_batch_data_writer_chunked(void)
+{
+	int ret;
+	static struct batch_fixture reference_fixture;
+	static struct batch_fixture fixture;
+	struct json_common_batch_buffer buffers[7];
+	struct cloud_codec_data output = { 0 };
+	const size_t size_max = 256;
+	size_t count = 1;
+
+	batch_fixture_init(&reference_fixture);
+	batch_fixture_init(&fixture);
+
+	batch_fixture_buffers_get(&reference_fixture, buffers);
+
+	ret = json_common_batch_encode(&output, buffers, ARRAY_SIZE(buffers), 0);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_GREATER_THAN(size_max, output.len);
+	k_free(output.buf);
+
+	batch_fixture_buffers_get(&fixture, buffers);
+
+	ret = json_common_batch_encode(&output, buffers, ARRAY_SIZE(buffers), size_max);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_LESS_OR_EQUAL(size_max, output.len);
+	TEST_ASSERT_EQUAL(strlen(output.buf), output.len);
+	k_free(output.buf);
+
+	/* Only the entries in the first message are dequeued, starting with the first buffer. */
+	TEST_ASSERT_FALSE(fixture.modem_static[0].queued);
+	TEST_ASSERT_TRUE(fixture.battery[0].queued);
+	TEST_ASSERT_TRUE(fixture.battery[2].queued);
+
+	while (true) {
+		ret = json_common_batch_encode(&output, buffers, ARRAY_SIZE(buffers), size_max);
+		if (ret != 0) {
+			break;
+		}
+
+		count++;
+		TEST_ASSERT_LESS_OR_EQUAL(size_max, output.len);
+		k_free(output.buf);
+	}
+
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+	TEST_ASSERT_GREATER_THAN(1, count);
+
+	/* All entries have been dequeued, the same way as by an unbounded message. */
+	batch_fixture_queued_check(&reference_fixture, &fixture);
+}
+
+/* An entry that does not fit in the maximum message size is sent on its own. */
+void test_encode_batch_data_writer_chunked_entry_too_large(void)
+{
+	int ret;
+	static struct batch_fixture fixture;
+	struct json_common_batch_buffer buffers[7];
+	struct cloud_codec_data output = { 0 };
+	size_t count = 0;
+
+	batch_fixture_init(&fixture);
+	batch_fixture_buffers_get(&fixture, buffers);
+
+	while (true) {
+		ret = json_common_batch_encode(&output, buffers, ARRAY_SIZE(buffers), 1);
+		if (ret != 0) {
+			break;
+		}
+
+		count++;
+		k_free(output.buf);
+	}
+
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+	TEST_ASSERT_EQUAL(BATCH_FIXTURE_QUEUED_COUNT, count);
+}
+
+void test_encode_batch_data_writer_measure(void)
+{
+	int ret;
+	static struct batch_fixture fixture;
+	struct json_writer writer;
+	char buf[32];
+
+	batch_fixture_init(&fixture);
+
+	/* A writer without a buffer only computes the length. Entries are not dequeued. */
+	json_writer_init(&writer, NULL, 0);
+
+	ret = json_common_batch_data_write(&writer, JSON_COMMON_UI, fixture.ui,
+					   ARRAY_SIZE(fixture.ui), DATA_BUTTON);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_EQUAL(0, json_writer_finish(&writer));
+	TEST_ASSERT_EQUAL(strlen("\"btn\":[{\"v\":1,\"ts\":1563968747123},"
+				 "{\"v\":2,\"ts\":1563968747123}]"),
+			  json_writer_len(&writer));
+	TEST_ASSERT_TRUE(fixture.ui[0].queued);
+	TEST_ASSERT_TRUE(fixture.ui[1].queued);
+
+	/* Output that does not fit in the buffer is reported. */
+	json_writer_init(&writer, buf, sizeof(buf));
+
+	ret = json_common_batch_data_write(&writer, JSON_COMMON_UI, fixture.ui,
+					   ARRAY_SIZE(fixture.ui), DATA_BUTTON);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_EQUAL(-ENOMEM, json_writer_finish(&writer));
+
+	/* Check for invalid inputs. */
+	json_writer_init(&writer, NULL, 0);
+
+	ret = json_common_batch_data_write(&writer, JSON_COMMON_UI, NULL, 0, DATA_BUTTON);
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+
+	ret = json_common_batch_data_write(&writer, -1, fixture.ui, ARRAY_SIZE(fixture.ui),
+					   DATA_BUTTON);
+	TEST_ASSERT_EQUAL(-ENODATA, ret);
+}
+#endif /* CONFIG_CLOUD_CODEC_JSON_WRITER */
+
+#if defined(CONFIG_CLOUD_CODEC_JSON_ARENA)
+/* JSON arena allocator */
+
+void test_json_arena_encode(void)
+{
+	int ret;
+	char *buffer;
+	cJSON *root_obj;
+	struct json_arena_stats stats;
+	struct cloud_data_battery data = {
+		.bat = 3600,
+		.bat_ts = 1000,
+		.queued = true
+	};
+
+	json_arena_begin(JSON_ARENA_ENCODE_DATA);
+
+	root_obj = cJSON_CreateObject();
+	TEST_ASSERT_NOT_NULL(root_obj);
+
+	ret = json_common_battery_data_add(root_obj,
+					   &data,
+					   JSON_COMMON_ADD_DATA_TO_OBJECT,
+					   DATA_BATTERY,
+					   NULL);
+	TEST_ASSERT_EQUAL(0, ret);
+
+	buffer = json_arena_print(root_obj);
+
+	cJSON_Delete(root_obj);
+	json_arena_end();
+
+	/* The output is moved to the heap and outlives the arena. */
+	TEST_ASSERT_NOT_NULL(buffer);
+	TEST_ASSERT_EQUAL_STRING(TEST_VALIDATE_BATTERY_JSON_SCHEMA, buffer);
+	k_free(buffer);
+
+	ret = json_arena_stats_get(JSON_ARENA_ENCODE_DATA, &stats);
+	TEST_ASSERT_EQUAL(0, ret);
+	TEST_ASSERT_EQUAL(1, stats.encode_count);
+	TEST_ASSERT_EQUAL(0, stats.fallback_count);
+
+	/* At least the root object and the printed output have been accounted for. */
+	TEST_ASSERT_GREATER_OR_EQUAL(sizeof(cJSON) + sizeof(TEST_VALIDATE_BATTERY_JSON_SCHEMA),
+				     stats.high_water);
+	TEST_ASSERT_LESS_OR_EQUAL(CONFIG_CLOUD_CODEC_JSON_ARENA_SIZE, stats.high_water);
+
+	/* Check for invalid inputs. */
+
+	ret = json_arena_stats_get(JSON_ARENA_ENCODE_COUNT, &stats);
+	TEST_ASSERT_EQUAL(-EINVAL, ret);
+}
+
+void test_json_arena_fallback(void)
+{
+	cJSON *item;
+	struct json_arena_stats stats;
+	static char string[CONFIG_CLOUD_CODEC_JSON_ARENA_SIZE + 1];
+
+	memset(string, 'a', sizeof(string) - 1);
+
+	json_arena_begin(JSON_ARENA_ENCODE_UI);
+
+	/* The string does not fit in the arena and is allocated from the heap. */
+	item = cJSON_CreateString(string);
+	TEST_ASSERT_NOT_NULL(item);
+	TEST_ASSERT_EQUAL_STRING(string, item->valuestring);
+
+	cJSON_Delete(item);
+	json_arena_end();
+
+	TEST_ASSERT_EQUAL(0, json_arena_stats_get(JSON_ARENA_ENCODE_UI, &stats));
+	TEST_ASSERT_EQUAL(1, stats.encode_count);
+	TEST_ASSERT_EQUAL(1, stats.fallback_count);
+	TEST_ASSERT_GREATER_THAN(CONFIG_CLOUD_CODEC_JSON_ARENA_SIZE, stats.high_water);
+}
+#endif /* CONFIG_CLOUD_CODEC_JSON_ARENA */
+
 /* Test used to verify encoding and decoding of data structures that contain floating point
  * values. Floating point values cannot be exactly represented in binary so they cannot be compared
  * with a predefined JSON string schema.
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+
+#include "location_cache.h"
+
+#define TTL_MS		(CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE_TTL_SEC * 1000LL)
+#define RSRP		50
+
+static const uint8_t mac_a[LOCATION_CACHE_MAC_LEN] = { 0x02, 0, 0, 0, 0, 0x0a };
+static const uint8_t mac_b[LOCATION_CACHE_MAC_LEN] = { 0x02, 0, 0, 0, 0, 0x0b };
+static const uint8_t mac_c[LOCATION_CACHE_MAC_LEN] = { 0x02, 0, 0, 0, 0, 0x0c };
+
+static const struct location_cache_position position = {
+	.latitude = 63.4305,
+	.longitude = 10.3951,
+	.accuracy = 800.0f,
+};
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static void key_init(struct location_cache_key *key, uint32_t cell_id)
+{
+	struct lte_lc_cell cell = {
+		.mcc = 242,
+		.mnc = 1,
+		.tac = 0x00b7,
+		.id = cell_id,
+		.rsrp = RSRP,
+	};
+
+	location_cache_key_init(key, &cell);
+}
+
+void setUp(void)
+{
+	location_cache_clear();
+}
+
+void tearDown(void)
+{
+}
+
+void test_location_cache_hit(void)
+{
+	struct location_cache_key key;
+	struct location_cache_position found;
+
+	key_init(&key, 1);
+	TEST_ASSERT_TRUE(location_cache_key_valid(&key));
+
+	TEST_ASSERT_EQUAL(-ENOENT, location_cache_lookup(&key, RSRP, 0, &found));
+
+	location_cache_add(&key, RSRP, 0, &position);
+
+	TEST_ASSERT_EQUAL(0, location_cache_lookup(&key, RSRP + 5, 1000, &found));
+	TEST_ASSERT_TRUE(found.latitude == position.latitude);
+	TEST_ASSERT_TRUE(found.longitude == position.longitude);
+	TEST_ASSERT_TRUE(found.accuracy == position.accuracy);
+
+	/* Another cell in the same tracking area. */
+	key_init(&key, 2);
+	TEST_ASSERT_EQUAL(-ENOENT, location_cache_lookup(&key, RSRP, 1000, &found));
+}
+
+void test_location_cache_rsrp(void)
+{
+	struct location_cache_key key;
+	struct location_cache_position found;
+	struct location_cache_stats before, after;
+
+	key_init(&key, 1);
+	location_cache_add(&key, RSRP, 0, &position);
+
+	location_cache_stats_get(&before);
+
+	TEST_ASSERT_EQUAL(-ERANGE, location_cache_lookup(&key, RSRP - 11, 0, &found));
+	TEST_ASSERT_EQUAL(0, location_cache_lookup(&key, RSRP - 10, 0, &found));
+
+	location_cache_stats_get(&after);
+	TEST_ASSERT_EQUAL(before.rejected + 1, after.rejected);
+	TEST_ASSERT_EQUAL(before.hits + 1, after.hits);
+}
+
+void test_location_cache_ttl(void)
+{
+	struct location_cache_key key;
+	struct location_cache_position found;
+
+	key_init(&key, 1);
+	location_cache_add(&key, RSRP, 0, &position);
+
+	TEST_ASSERT_EQUAL(0, location_cache_lookup(&key, RSRP, TTL_MS - 1, &found));
+	TEST_ASSERT_EQUAL(-ENOENT, location_cache_lookup(&key, RSRP, TTL_MS, &found));
+
+	/* A new resolution restarts the time to live. */
+	location_cache_add(&key, RSRP, TTL_MS, &position);
+	TEST_ASSERT_EQUAL(0, location_cache_lookup(&key, RSRP, TTL_MS + 1, &found));
+}
+
+void test_location_cache_lru(void)
+{
+	struct location_cache_key key;
+	struct location_cache_position found;
+
+	for (uint32_t cell_id = 1; cell_id <= CONFIG_LOCATION_MODULE_CLOUD_LOCATION_CACHE_SIZE;
+	     cell_id++) {
+		key_init(&key, cell_id);
+		location_cache_add(&key, RSRP, 0, &position);
+	}
+
+	/* Cell 1 is used, which leaves cell 2 as the least recently used. */
+	key_init(&key, 1);
+	TEST_ASSERT_EQUAL(0, location_cache_lookup(&key, RSRP, 0, &found));
+
+	key_init(&key, 100);
+	location_cache_add(&key, RSRP, 0, &position);
+
+	key_init(&key, 2);
+	TEST_ASSERT_EQUAL(-ENOENT, location_cache_lookup(&key, RSRP, 0, &found));
+
+	key_init(&key, 1);
+	TEST_ASSERT_EQUAL(0, location_cache_lookup(&key, RSRP, 0, &found));
+
+	key_init(&key, 100);
+	TEST_ASSERT_EQUAL(0, location_cache_lookup(&key, RSRP, 0, &found));
+}
+
+void test_location_cache_wifi(void)
+{
+	struct location_cache_key key, other;
+	struct location_cache_position found;
+
+	/* Only the two strongest access points are in the key. */
+	key_init(&key, 1);
+	location_cache_key_ap_add(&key, mac_c, -80);
+	location_cache_key_ap_add(&key, mac_a, -50);
+	location_cache_key_ap_add(&key, mac_b, -60);
+
+	TEST_ASSERT_EQUAL(2, key.ap_count);
+	TEST_ASSERT_EQUAL_MEMORY(mac_a, key.ap_mac[0], LOCATION_CACHE_MAC_LEN);
+	TEST_ASSERT_EQUAL_MEMORY(mac_b, key.ap_mac[1], LOCATION_CACHE_MAC_LEN);
+
+	location_cache_add(&key, RSRP, 0, &position);
+
+	/* The order of the strongest access points does not matter. */
+	key_init(&other, 1);
+	location_cache_key_ap_add(&other, mac_b, -55);
+	location_cache_key_ap_add(&other, mac_a, -58);
+	TEST_ASSERT_EQUAL(0, location_cache_lookup(&other, RSRP, 0, &found));
+
+	/* A different set of access points is a different location. */
+	key_init(&other, 1);
+	location_cache_key_ap_add(&other, mac_a, -50);
+	location_cache_key_ap_add(&other, mac_c, -60);
+	TEST_ASSERT_EQUAL(-ENOENT, location_cache_lookup(&other, RSRP, 0, &found));
+
+	/* The serving cell alone is a different key. */
+	key_init(&other, 1);
+	TEST_ASSERT_EQUAL(-ENOENT, location_cache_lookup(&other, RSRP, 0, &found));
+}
+
+void test_location_cache_key_invalid(void)
+{
+	struct location_cache_key key;
+
+	key_init(&key, LTE_LC_CELL_EUTRAN_ID_INVALID);
+	TEST_ASSERT_FALSE(location_cache_key_valid(&key));
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
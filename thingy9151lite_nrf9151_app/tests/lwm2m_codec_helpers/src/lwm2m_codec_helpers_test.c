@@ -11,6 +11,7 @@
 #include "lwm2m_client_utils/cmock_lwm2m_client_utils.h"
 #include "lwm2m_client_utils/cmock_lwm2m_client_utils_location.h"
 #include "lwm2m/cmock_lwm2m.h"
+#include "lwm2m/cmock_lwm2m_registry.h"
 #include "lwm2m_resource_ids.h"
 #include "lte_lc/cmock_lte_lc.h"
 #include "date_time/cmock_date_time.h"
@@ -33,6 +34,9 @@
 /* Mon Dec 05 2022 09:38:04 */
 #define UNIX_TIMESTAMP_DUMMY 1670233084418
 
+/* Number of values in each time-series cache. */
+#define BATCH_CACHE_ENTRIES CONFIG_CLOUD_CODEC_LWM2M_BATCH_CACHE_ENTRIES
+
 /* It is required to be added to each test. That is because unity's
  * main may return nonzero, while zephyr's main currently must
  * return 0 in all cases (other values are reserved).
@@ -67,6 +71,45 @@ static int callback(uint16_t obj_inst_id, uint16_t res_id, uint16_t res_inst_id,
 	return 0;
 }
 
+/* Time-series cache entry returned for all cached resources. */
+static struct lwm2m_time_series_resource cache_entry;
+
+/* Values written to the time-series caches. */
+static struct lwm2m_time_series_elem cached[BATCH_ENTRY_PATHS_MAX];
+static int cached_count;
+
+static bool cache_write_stub(struct lwm2m_time_series_resource *entry,
+			     struct lwm2m_time_series_elem *buf, int no_of_calls)
+{
+	TEST_ASSERT_EQUAL_PTR(&cache_entry, entry);
+	TEST_ASSERT_LESS_THAN(ARRAY_SIZE(cached), cached_count);
+
+	cached[cached_count++] = *buf;
+	return true;
+}
+
+/* Expect that one value is cached for each of the given resources, with caches of the given
+ * size.
+ */
+static void batch_cache_expect(const struct lwm2m_obj_path paths[], size_t count, size_t size)
+{
+	__cmock_lwm2m_registry_lock_Ignore();
+	__cmock_lwm2m_registry_unlock_Ignore();
+
+	for (size_t i = 0; i < count; i++) {
+		__cmock_lwm2m_cache_entry_get_by_object_ExpectAndReturn(&paths[i], &cache_entry);
+		__cmock_lwm2m_cache_size_ExpectAndReturn(&cache_entry, size);
+
+		if (size >= BATCH_CACHE_ENTRIES) {
+			/* The first full cache stops the write. */
+			break;
+		}
+	}
+
+	cached_count = 0;
+	__cmock_lwm2m_cache_write_Stub(cache_write_stub);
+}
+
 void test_create_objects_and_resources(void)
 {
 	/* Create object instances. */
@@ -745,6 +788,172 @@ void test_codec_helpers_set_neighbor_cell_data(void)
 	TEST_ASSERT_EQUAL(0, lwm2m_codec_helpers_set_neighbor_cell_data(&ncell));
 }
 
+void test_codec_helpers_setup_batch_cache(void)
+{
+	static const struct lwm2m_obj_path paths[] = {
+		BATCH_GNSS_PATHS,
+		BATCH_SENSOR_PATHS,
+		BATCH_BATTERY_PATHS,
+		BATCH_UI_PATHS,
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(paths); i++) {
+		__cmock_lwm2m_enable_cache_ExpectAndReturn(&paths[i], NULL, BATCH_CACHE_ENTRIES, 0);
+		__cmock_lwm2m_enable_cache_IgnoreArg_data_cache();
+	}
+
+	TEST_ASSERT_EQUAL(0, lwm2m_codec_helpers_setup_batch_cache());
+}
+
+void test_codec_helpers_batch_gnss_add(void)
+{
+	static const struct lwm2m_obj_path paths[] = { BATCH_GNSS_PATHS };
+	struct cloud_data_gnss gnss = {
+		.pvt.lat = 63.4305,
+		.pvt.longi = 10.3951,
+		.pvt.alt = 45.2,
+		.pvt.acc = 4.5,
+		.pvt.spd = 1.5,
+		.gnss_ts = UNIX_TIMESTAMP_DUMMY,
+		.ts_unix = true,
+		.queued = true,
+	};
+
+	batch_cache_expect(paths, ARRAY_SIZE(paths), 0);
+
+	TEST_ASSERT_EQUAL(0, lwm2m_codec_helpers_batch_gnss_add(&gnss));
+	TEST_ASSERT_EQUAL(ARRAY_SIZE(paths), cached_count);
+
+	/* All values have the timestamp of the fix. */
+	for (int i = 0; i < cached_count; i++) {
+		TEST_ASSERT_EQUAL(UNIX_TIMESTAMP_DUMMY / MSEC_PER_SEC, cached[i].t);
+	}
+
+	TEST_ASSERT_EQUAL_DOUBLE(gnss.pvt.lat, cached[0].f);
+	TEST_ASSERT_EQUAL_DOUBLE(gnss.pvt.longi, cached[1].f);
+	TEST_ASSERT_EQUAL_DOUBLE((double)gnss.pvt.alt, cached[2].f);
+	TEST_ASSERT_EQUAL_DOUBLE((double)gnss.pvt.acc, cached[3].f);
+	TEST_ASSERT_EQUAL_DOUBLE((double)gnss.pvt.spd, cached[4].f);
+	TEST_ASSERT_EQUAL(UNIX_TIMESTAMP_DUMMY / MSEC_PER_SEC, cached[5].time);
+}
+
+void test_codec_helpers_batch_gnss_add_uptime(void)
+{
+	static const struct lwm2m_obj_path paths[] = { BATCH_GNSS_PATHS };
+	struct cloud_data_gnss gnss = {
+		.gnss_ts = 1000,
+		.queued = true,
+	};
+
+	__cmock_date_time_uptime_to_unix_time_ms_ExpectAndReturn(&gnss.gnss_ts, 0);
+	batch_cache_expect(paths, ARRAY_SIZE(paths), 0);
+
+	TEST_ASSERT_EQUAL(0, lwm2m_codec_helpers_batch_gnss_add(&gnss));
+
+	/* The timestamp is only converted once, also if the entry is cached again. */
+	TEST_ASSERT_TRUE(gnss.ts_unix);
+}
+
+void test_codec_helpers_batch_gnss_add_cache_full(void)
+{
+	static const struct lwm2m_obj_path paths[] = { BATCH_GNSS_PATHS };
+	struct cloud_data_gnss gnss = {
+		.gnss_ts = UNIX_TIMESTAMP_DUMMY,
+		.ts_unix = true,
+		.queued = true,
+	};
+
+	batch_cache_expect(paths, ARRAY_SIZE(paths), BATCH_CACHE_ENTRIES);
+
+	TEST_ASSERT_EQUAL(-ENOBUFS, lwm2m_codec_helpers_batch_gnss_add(&gnss));
+	TEST_ASSERT_EQUAL(0, cached_count);
+}
+
+void test_codec_helpers_batch_gnss_add_not_queued(void)
+{
+	struct cloud_data_gnss gnss = { 0 };
+
+	TEST_ASSERT_EQUAL(-ENODATA, lwm2m_codec_helpers_batch_gnss_add(&gnss));
+}
+
+void test_codec_helpers_batch_sensor_add(void)
+{
+	static const struct lwm2m_obj_path paths[] = { BATCH_SENSOR_PATHS };
+	struct cloud_data_sensors sensor = {
+		.temperature = 23.5,
+		.humidity = 50.1,
+		.pressure = 101.3,
+		.env_ts = UNIX_TIMESTAMP_DUMMY,
+		.ts_unix = true,
+		.queued = true,
+	};
+
+	batch_cache_expect(paths, ARRAY_SIZE(paths), BATCH_CACHE_ENTRIES - 1);
+
+	TEST_ASSERT_EQUAL(0, lwm2m_codec_helpers_batch_sensor_add(&sensor));
+	TEST_ASSERT_EQUAL(ARRAY_SIZE(paths), cached_count);
+
+	for (int i = 0; i < 3; i++) {
+		TEST_ASSERT_EQUAL(UNIX_TIMESTAMP_DUMMY / MSEC_PER_SEC, cached[i].time);
+	}
+
+	TEST_ASSERT_EQUAL_DOUBLE(sensor.temperature, cached[3].f);
+	TEST_ASSERT_EQUAL_DOUBLE(sensor.humidity, cached[4].f);
+	TEST_ASSERT_EQUAL_DOUBLE(sensor.pressure, cached[5].f);
+}
+
+void test_codec_helpers_batch_battery_add(void)
+{
+	static const struct lwm2m_obj_path paths[] = { BATCH_BATTERY_PATHS };
+	struct cloud_data_battery battery = {
+		.bat = 3600,
+		.bat_ts = UNIX_TIMESTAMP_DUMMY,
+		.ts_unix = true,
+		.queued = true,
+	};
+
+	batch_cache_expect(paths, ARRAY_SIZE(paths), 0);
+
+	TEST_ASSERT_EQUAL(0, lwm2m_codec_helpers_batch_battery_add(&battery));
+	TEST_ASSERT_EQUAL(1, cached_count);
+	TEST_ASSERT_EQUAL(battery.bat, cached[0].i32);
+	TEST_ASSERT_EQUAL(UNIX_TIMESTAMP_DUMMY / MSEC_PER_SEC, cached[0].t);
+}
+
+void test_codec_helpers_batch_ui_add_button_2(void)
+{
+	static const struct lwm2m_obj_path paths[] = { BATCH_UI_PATHS };
+	struct cloud_data_ui user_interface = {
+		.btn = 2,
+		.btn_ts = UNIX_TIMESTAMP_DUMMY,
+		.ts_unix = true,
+		.queued = true,
+	};
+
+	batch_cache_expect(&paths[1], 1, 0);
+
+	__cmock_lwm2m_set_bool_ExpectAndReturn(
+		&LWM2M_OBJ(IPSO_OBJECT_PUSH_BUTTON_ID, 1, DIGITAL_INPUT_STATE_RID), true, 0);
+
+	__cmock_lwm2m_set_bool_ExpectAndReturn(
+		&LWM2M_OBJ(IPSO_OBJECT_PUSH_BUTTON_ID, 1, DIGITAL_INPUT_STATE_RID), false, 0);
+
+	TEST_ASSERT_EQUAL(0, lwm2m_codec_helpers_batch_ui_add(&user_interface));
+	TEST_ASSERT_EQUAL(1, cached_count);
+	TEST_ASSERT_EQUAL(UNIX_TIMESTAMP_DUMMY / MSEC_PER_SEC, cached[0].time);
+}
+
+void test_codec_helpers_batch_ui_add_invalid_button(void)
+{
+	struct cloud_data_ui user_interface = {
+		.btn = 3,
+		.ts_unix = true,
+		.queued = true,
+	};
+
+	TEST_ASSERT_EQUAL(-EINVAL, lwm2m_codec_helpers_batch_ui_add(&user_interface));
+}
+
 void test_codec_helpers_object_path_list_generate(void)
 {
 	struct cloud_codec_data output = { 0 };
@@ -218,6 +218,22 @@ void test_lwm2m_integration_ui_send(void)
 	TEST_ASSERT_EQUAL(0, cloud_wrap_ui_send(NULL, PATH_LEN, true, 0, paths));
 }
 
+void test_lwm2m_integration_batch_send(void)
+{
+	/* Populate path with random resource path references. */
+	struct lwm2m_obj_path paths[] = {
+		LWM2M_OBJ(6, 0, 0),
+		LWM2M_OBJ(6, 0, 1),
+		LWM2M_OBJ(6, 0, 2),
+		LWM2M_OBJ(6, 0, 3),
+		LWM2M_OBJ(6, 0, 5),
+	};
+
+	__cmock_lwm2m_send_cb_ExpectAndReturn(&client, paths, PATH_LEN, NULL, 0);
+
+	TEST_ASSERT_EQUAL(0, cloud_wrap_batch_send(NULL, PATH_LEN, true, 0, paths));
+}
+
 void test_lwm2m_integration_neighbor_cells_send(void)
 {
 	__cmock_location_assistance_ground_fix_request_send_ExpectAndReturn(&client, 0);
@@ -246,11 +262,6 @@ void test_lwm2m_integration_state_send(void)
 	TEST_ASSERT_EQUAL(-ENOTSUP, cloud_wrap_state_send(NULL, 0, true, 0));
 }
 
-void test_lwm2m_integration_batch_send(void)
-{
-	TEST_ASSERT_EQUAL(-ENOTSUP, cloud_wrap_batch_send(NULL, 0, true, 0));
-}
-
 void test_lwm2m_integration_pgps_request_send(void)
 {
 	__cmock_location_assistance_pgps_request_send_ExpectAndReturn(&client, 0);
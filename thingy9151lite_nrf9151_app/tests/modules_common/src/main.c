@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <app_event_manager.h>
+
+#include "modules_common.h"
+#include "event_pool.h"
+#include "sensor_module_event.h"
+#include "ui_module_event.h"
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+MODULE_QUEUE_DEFINE(first_queue, 4, 2);
+MODULE_QUEUE_DEFINE(second_queue, 4, 2);
+MODULE_QUEUE_DEFINE(stats_queue, 4, 2);
+
+static struct module_data first = {
+	.name = "first",
+	.msg_q = &first_queue,
+};
+
+static struct module_data second = {
+	.name = "second",
+	.msg_q = &second_queue,
+};
+
+/* Only used by the statistics tests, so that the high-water marks are not raised by other tests. */
+static struct module_data stats_module = {
+	.name = "stats",
+	.msg_q = &stats_queue,
+};
+
+/* Number of events that are currently allocated. All events in the tests fit in the event pools,
+ * so this is the number of events that have not been freed yet.
+ */
+static uint32_t events_allocated(void)
+{
+	struct event_pool_stats stats;
+	uint32_t used = 0;
+
+	for (size_t i = 0; i < event_pool_count_get(); i++) {
+		TEST_ASSERT_EQUAL(0, event_pool_stats_get(i, &stats));
+		used += stats.used;
+	}
+
+	return used;
+}
+
+/* Allocate an event the same way as the events that are submitted. The reference that the
+ * Application Event Manager holds is dropped by calling app_event_manager_free(), which the
+ * Application Event Manager does when all listeners have processed the event.
+ */
+static struct sensor_module_event *sensor_event_new(enum sensor_module_event_type type)
+{
+	struct sensor_module_event *event = new_sensor_module_event();
+
+	TEST_ASSERT_NOT_NULL(event);
+	event->type = type;
+
+	return event;
+}
+
+/* Enqueue an event to the first module and drop the reference of the Application Event Manager,
+ * so that the event is only kept by the queue.
+ */
+static void enqueue(struct app_event_header *aeh)
+{
+	module_enqueue_msg(&first, aeh);
+	app_event_manager_free(aeh);
+}
+
+/* Check that the next message in the queue of the first module is the given event. */
+static void dequeue_expect(const void *event)
+{
+	const struct app_event_header *msg;
+
+	TEST_ASSERT_EQUAL(0, module_get_next_msg(&first, &msg));
+	TEST_ASSERT_EQUAL_PTR(event, msg);
+	module_msg_release(&first, msg);
+}
+
+void setUp(void)
+{
+	TEST_ASSERT_EQUAL(0, events_allocated());
+}
+
+void tearDown(void)
+{
+	module_purge_queue(&first);
+	module_purge_queue(&second);
+	module_purge_queue(&stats_module);
+}
+
+/* Test that an event that is enqueued to several modules is passed to each of them by reference,
+ * and is freed when the last module has released it.
+ */
+void test_event_shared_by_queues(void)
+{
+	struct sensor_module_event *event = sensor_event_new(SENSOR_EVT_FUEL_GAUGE_READY);
+	const struct app_event_header *msg;
+
+	module_enqueue_msg(&first, &event->header);
+	module_enqueue_msg(&second, &event->header);
+
+	app_event_manager_free(event);
+	TEST_ASSERT_EQUAL(1, events_allocated());
+
+	TEST_ASSERT_EQUAL(0, module_get_next_msg(&first, &msg));
+	TEST_ASSERT_EQUAL_PTR(&event->header, msg);
+	module_msg_release(&first, msg);
+	TEST_ASSERT_EQUAL(1, events_allocated());
+
+	TEST_ASSERT_EQUAL(0, module_get_next_msg(&second, &msg));
+	TEST_ASSERT_EQUAL_PTR(&event->header, msg);
+	TEST_ASSERT_EQUAL(SENSOR_EVT_FUEL_GAUGE_READY,
+			  ((const struct sensor_module_event *)msg)->type);
+	module_msg_release(&second, msg);
+	TEST_ASSERT_EQUAL(0, events_allocated());
+}
+
+/* Test that an event that a module has already released is kept until the Application Event
+ * Manager has finished processing it.
+ */
+void test_event_released_before_event_manager(void)
+{
+	struct sensor_module_event *event = sensor_event_new(SENSOR_EVT_FUEL_GAUGE_READY);
+	const struct app_event_header *msg;
+
+	module_enqueue_msg(&first, &event->header);
+	TEST_ASSERT_EQUAL(0, module_get_next_msg(&first, &msg));
+	module_msg_release(&first, msg);
+	TEST_ASSERT_EQUAL(1, events_allocated());
+
+	app_event_manager_free(event);
+	TEST_ASSERT_EQUAL(0, events_allocated());
+}
+
+/* Test that purging a queue releases the reference held by each purged message. */
+void test_event_released_on_purge(void)
+{
+	struct sensor_module_event *event[] = {
+		sensor_event_new(SENSOR_EVT_FUEL_GAUGE_READY),
+		sensor_event_new(SENSOR_EVT_ERROR),
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(event); i++) {
+		module_enqueue_msg(&first, &event[i]->header);
+		module_enqueue_msg(&second, &event[i]->header);
+		app_event_manager_free(event[i]);
+	}
+
+	TEST_ASSERT_EQUAL(2, events_allocated());
+
+	module_purge_queue(&first);
+	TEST_ASSERT_EQUAL(2, events_allocated());
+
+	module_purge_queue(&second);
+	TEST_ASSERT_EQUAL(0, events_allocated());
+}
+
+/* Test that a telemetry message that is dropped from a full queue releases its reference. */
+void test_event_released_on_telemetry_drop(void)
+{
+	struct sensor_module_event *event[] = {
+		sensor_event_new(SENSOR_EVT_ENVIRONMENTAL_DATA_READY),
+		sensor_event_new(SENSOR_EVT_ENVIRONMENTAL_DATA_READY),
+		sensor_event_new(SENSOR_EVT_ENVIRONMENTAL_DATA_READY),
+	};
+	const struct app_event_header *msg;
+
+	for (size_t i = 0; i < ARRAY_SIZE(event); i++) {
+		module_enqueue_msg(&first, &event[i]->header);
+		app_event_manager_free(event[i]);
+	}
+
+	/* The queue holds two telemetry messages, the oldest one has been dropped. */
+	TEST_ASSERT_EQUAL(2, events_allocated());
+
+	for (size_t i = 1; i < ARRAY_SIZE(event); i++) {
+		TEST_ASSERT_EQUAL(0, module_get_next_msg(&first, &msg));
+		TEST_ASSERT_EQUAL_PTR(&event[i]->header, msg);
+		module_msg_release(&first, msg);
+	}
+
+	TEST_ASSERT_EQUAL(0, events_allocated());
+}
+
+/* Test that control and telemetry messages are dequeued in the order they were enqueued. */
+void test_queue_order_preserved(void)
+{
+	struct sensor_module_event *event[] = {
+		sensor_event_new(SENSOR_EVT_ENVIRONMENTAL_DATA_READY),
+		sensor_event_new(SENSOR_EVT_ERROR),
+		sensor_event_new(SENSOR_EVT_FUEL_GAUGE_READY),
+		sensor_event_new(SENSOR_EVT_ERROR),
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(event); i++) {
+		enqueue(&event[i]->header);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(event); i++) {
+		dequeue_expect(event[i]);
+	}
+
+	TEST_ASSERT_EQUAL(0, events_allocated());
+}
+
+/* Test that impact detections and button presses are control messages, which do not take the
+ * place of queued telemetry messages.
+ */
+void test_queue_impact_and_button_are_control(void)
+{
+	uint32_t overflow = module_queue_overflow_count_get(&first, MODULE_MSG_TELEMETRY);
+	struct sensor_module_event *telemetry[] = {
+		sensor_event_new(SENSOR_EVT_ENVIRONMENTAL_DATA_READY),
+		sensor_event_new(SENSOR_EVT_FUEL_GAUGE_READY),
+	};
+	struct sensor_module_event *impact = sensor_event_new(SENSOR_EVT_MOVEMENT_IMPACT_DETECTED);
+	struct ui_module_event *button = new_ui_module_event();
+
+	TEST_ASSERT_NOT_NULL(button);
+	button->type = UI_EVT_BUTTON_DATA_READY;
+
+	enqueue(&telemetry[0]->header);
+	enqueue(&telemetry[1]->header);
+	enqueue(&impact->header);
+	enqueue(&button->header);
+
+	TEST_ASSERT_EQUAL(overflow, module_queue_overflow_count_get(&first, MODULE_MSG_TELEMETRY));
+	TEST_ASSERT_EQUAL(4, events_allocated());
+
+	dequeue_expect(telemetry[0]);
+	dequeue_expect(telemetry[1]);
+	dequeue_expect(impact);
+	dequeue_expect(button);
+}
+
+/* Test that a control message that arrives at a full queue takes the place of the oldest
+ * telemetry message, and that the remaining messages keep their order.
+ */
+void test_queue_control_replaces_telemetry(void)
+{
+	uint32_t overflow = module_queue_overflow_count_get(&first, MODULE_MSG_TELEMETRY);
+	uint32_t drops = module_queue_drop_count_get();
+	struct sensor_module_event *event[] = {
+		sensor_event_new(SENSOR_EVT_ERROR),
+		sensor_event_new(SENSOR_EVT_ENVIRONMENTAL_DATA_READY),
+		sensor_event_new(SENSOR_EVT_ERROR),
+		sensor_event_new(SENSOR_EVT_FUEL_GAUGE_READY),
+		sensor_event_new(SENSOR_EVT_ERROR),
+		sensor_event_new(SENSOR_EVT_ERROR),
+	};
+	struct sensor_module_event *control = sensor_event_new(SENSOR_EVT_ERROR);
+
+	for (size_t i = 0; i < ARRAY_SIZE(event); i++) {
+		enqueue(&event[i]->header);
+	}
+
+	enqueue(&control->header);
+
+	TEST_ASSERT_EQUAL(overflow + 1,
+			  module_queue_overflow_count_get(&first, MODULE_MSG_TELEMETRY));
+	TEST_ASSERT_EQUAL(drops + 1, module_queue_drop_count_get());
+	TEST_ASSERT_EQUAL(ARRAY_SIZE(event), events_allocated());
+
+	dequeue_expect(event[0]);
+
+	for (size_t i = 2; i < ARRAY_SIZE(event); i++) {
+		dequeue_expect(event[i]);
+	}
+
+	dequeue_expect(control);
+	TEST_ASSERT_EQUAL(0, events_allocated());
+}
+
+/* Test that a message that arrives at a queue full of control messages is dropped and counted,
+ * and that the queued messages are kept.
+ */
+void test_queue_full_of_control(void)
+{
+	uint32_t control_overflow = module_queue_overflow_count_get(&first, MODULE_MSG_CONTROL);
+	uint32_t telemetry_overflow = module_queue_overflow_count_get(&first,
+								      MODULE_MSG_TELEMETRY);
+	uint32_t drops = module_queue_drop_count_get();
+	struct sensor_module_event *event[6];
+
+	for (size_t i = 0; i < ARRAY_SIZE(event); i++) {
+		event[i] = sensor_event_new(SENSOR_EVT_ERROR);
+		enqueue(&event[i]->header);
+	}
+
+	enqueue(&sensor_event_new(SENSOR_EVT_ERROR)->header);
+	enqueue(&sensor_event_new(SENSOR_EVT_FUEL_GAUGE_READY)->header);
+
+	TEST_ASSERT_EQUAL(control_overflow + 1,
+			  module_queue_overflow_count_get(&first, MODULE_MSG_CONTROL));
+	TEST_ASSERT_EQUAL(telemetry_overflow + 1,
+			  module_queue_overflow_count_get(&first, MODULE_MSG_TELEMETRY));
+	TEST_ASSERT_EQUAL(drops + 2, module_queue_drop_count_get());
+	TEST_ASSERT_EQUAL(ARRAY_SIZE(event), events_allocated());
+
+	for (size_t i = 0; i < ARRAY_SIZE(event); i++) {
+		dequeue_expect(event[i]);
+	}
+
+	TEST_ASSERT_EQUAL(0, events_allocated());
+}
+
+static void stats_get(struct module_stats *stats)
+{
+	TEST_ASSERT_EQUAL(0, module_stats_get(stats_module.name, stats));
+}
+
+/* Pass a message through the queue of the statistics module, with the given time spent in the
+ * queue and in the handler.
+ */
+static void stats_msg_handle(uint32_t latency_us, uint32_t handler_time_us)
+{
+	struct sensor_module_event *event = sensor_event_new(SENSOR_EVT_ERROR);
+	const struct app_event_header *msg;
+
+	module_enqueue_msg(&stats_module, &event->header);
+	app_event_manager_free(event);
+
+	k_busy_wait(latency_us);
+	TEST_ASSERT_EQUAL(0, module_get_next_msg(&stats_module, &msg));
+	k_busy_wait(handler_time_us);
+	module_msg_release(&stats_module, msg);
+}
+
+/* Test that each dequeued message is counted in the latency bucket of its time in the queue. */
+void test_stats_latency_histogram(void)
+{
+	const uint32_t latency_us[MODULE_STATS_LATENCY_BUCKETS] = {
+		0, 2 * USEC_PER_MSEC, 20 * USEC_PER_MSEC, 200 * USEC_PER_MSEC,
+		USEC_PER_SEC + 100 * USEC_PER_MSEC
+	};
+	struct module_stats before, after;
+
+	stats_get(&before);
+
+	for (size_t i = 0; i < ARRAY_SIZE(latency_us); i++) {
+		stats_msg_handle(latency_us[i], 0);
+	}
+
+	stats_get(&after);
+
+	for (size_t i = 0; i < MODULE_STATS_LATENCY_BUCKETS; i++) {
+		TEST_ASSERT_EQUAL(before.latency_hist[i] + 1, after.latency_hist[i]);
+	}
+
+	TEST_ASSERT_GREATER_OR_EQUAL(latency_us[MODULE_STATS_LATENCY_BUCKETS - 1],
+				     after.latency_max_us);
+}
+
+/* Test that the handler execution time is measured from dequeue to release. */
+void test_stats_handler_time(void)
+{
+	struct module_stats before, after;
+
+	stats_get(&before);
+
+	stats_msg_handle(0, 3 * USEC_PER_MSEC);
+	stats_msg_handle(0, USEC_PER_MSEC);
+
+	stats_get(&after);
+
+	TEST_ASSERT_EQUAL(before.handled_count + 2, after.handled_count);
+	TEST_ASSERT_GREATER_OR_EQUAL(4 * USEC_PER_MSEC,
+				     (uint32_t)(after.handler_time_total_us -
+						before.handler_time_total_us));
+	TEST_ASSERT_GREATER_OR_EQUAL(3 * USEC_PER_MSEC, after.handler_time_max_us);
+}
+
+/* Test the queue depth high-water mark, the queue size and the lost message counters. */
+void test_stats_queue_depth(void)
+{
+	struct module_stats before, after;
+	struct sensor_module_event *event;
+
+	stats_get(&before);
+	TEST_ASSERT_EQUAL(6, before.depth_size);
+
+	for (size_t i = 0; i < 3; i++) {
+		event = sensor_event_new(SENSOR_EVT_ERROR);
+		module_enqueue_msg(&stats_module, &event->header);
+		app_event_manager_free(event);
+	}
+
+	stats_get(&after);
+	TEST_ASSERT_EQUAL(MAX(before.depth_max, 3), after.depth_max);
+
+	/* Fill the queue, the last telemetry message finds no room. */
+	for (size_t i = 0; i < 3; i++) {
+		event = sensor_event_new(SENSOR_EVT_ERROR);
+		module_enqueue_msg(&stats_module, &event->header);
+		app_event_manager_free(event);
+	}
+
+	event = sensor_event_new(SENSOR_EVT_FUEL_GAUGE_READY);
+	module_enqueue_msg(&stats_module, &event->header);
+	app_event_manager_free(event);
+
+	stats_get(&after);
+	TEST_ASSERT_EQUAL(after.depth_size, after.depth_max);
+	TEST_ASSERT_EQUAL(before.overflow_count[MODULE_MSG_CONTROL],
+			  after.overflow_count[MODULE_MSG_CONTROL]);
+	TEST_ASSERT_EQUAL(before.overflow_count[MODULE_MSG_TELEMETRY] + 1,
+			  after.overflow_count[MODULE_MSG_TELEMETRY]);
+	TEST_ASSERT_EQUAL(module_queue_overflow_count_get(&stats_module, MODULE_MSG_TELEMETRY),
+			  after.overflow_count[MODULE_MSG_TELEMETRY]);
+}
+
+/* Test that statistics are only available for started modules. */
+void test_stats_unknown_module(void)
+{
+	struct module_stats stats;
+
+	TEST_ASSERT_EQUAL(-ENOENT, module_stats_get(first.name, &stats));
+	TEST_ASSERT_EQUAL(-ENOENT, module_stats_get("unknown", &stats));
+}
+
+/* Get the total number of blocks and allocation failures of the pools with the given block size.
+ * Event types of the same size share their pools.
+ */
+static void pool_usage_get(size_t block_size, uint32_t *block_count, uint32_t *alloc_failures)
+{
+	struct event_pool_stats stats;
+
+	*block_count = 0;
+	*alloc_failures = 0;
+
+	for (size_t i = 0; i < event_pool_count_get(); i++) {
+		TEST_ASSERT_EQUAL(0, event_pool_stats_get(i, &stats));
+
+		if (stats.block_size == block_size) {
+			*block_count += stats.block_count;
+			*alloc_failures += stats.alloc_failures;
+		}
+	}
+}
+
+/* Test that the pool blocks only reserve the size of the event allocator header in front of the
+ * event, and that an event is allocated from the heap when all blocks of its size are in use.
+ */
+void test_event_pool_exhausted(void)
+{
+	const size_t block_size = ROUND_UP(EVENT_POOL_BLOCK_HEADER_SIZE +
+					   sizeof(struct ui_module_event),
+					   EVENT_POOL_BLOCK_ALIGN);
+	struct ui_module_event *event[32];
+	uint32_t block_count, failures_before, failures_after;
+
+	TEST_ASSERT_EQUAL(sizeof(union event_ref), EVENT_POOL_BLOCK_HEADER_SIZE);
+
+	pool_usage_get(block_size, &block_count, &failures_before);
+	TEST_ASSERT_GREATER_OR_EQUAL(CONFIG_EVENT_POOL_UI_COUNT, block_count);
+	TEST_ASSERT_LESS_THAN(ARRAY_SIZE(event), block_count);
+
+	for (size_t i = 0; i <= block_count; i++) {
+		event[i] = new_ui_module_event();
+		TEST_ASSERT_NOT_NULL(event[i]);
+	}
+
+	/* The last event does not fit in the pools. */
+	TEST_ASSERT_EQUAL(block_count, events_allocated());
+
+	pool_usage_get(block_size, &block_count, &failures_after);
+	TEST_ASSERT_EQUAL(failures_before + 1, failures_after);
+
+	for (size_t i = 0; i <= block_count; i++) {
+		app_event_manager_free(event[i]);
+	}
+
+	TEST_ASSERT_EQUAL(0, events_allocated());
+}
+
+int main(void)
+{
+	/* Statistics are looked up by the name of a started module. */
+	(void)module_start(&stats_module);
+
+	(void)unity_main();
+	return 0;
+}
@@ -38,6 +38,7 @@ void tearDown(void)
 		"\"accThreshAct\":10,"\
 		"\"accThreshInact\":5,"\
 		"\"accTimeoutInact\":1,"\
+		"\"sendPolicy\":1,"\
 		"\"nod\":["\
 			"\"gnss\","\
 			"\"ncell\""\
@@ -60,6 +61,7 @@ const static struct cloud_data_cfg config_struct_example = {
 		.gnss = true,
 		.neighbor_cell = true,
 	},
+	.send_policy = 1,
 };
 
 #define UI_EXAMPLE \
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+
+#include "send_policy.h"
+
+/* Data types, as indexed by the data module. */
+enum {
+	GENERIC = 0,
+	BATCH,
+	TYPE_COUNT,
+};
+
+#define DEFER_MAX 3
+
+static const struct send_policy_type_cfg types[TYPE_COUNT] = {
+	[GENERIC] = {
+		.energy_min = LTE_LC_ENERGY_CONSUMPTION_NORMAL,
+		.percentile = 25,
+		.defer_max = DEFER_MAX,
+	},
+	[BATCH] = {
+		.energy_min = LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE,
+		.percentile = 100,
+		.defer_max = DEFER_MAX,
+	},
+};
+
+static struct send_policy policy;
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static void conn_eval_add(int energy_estimate)
+{
+	struct lte_lc_conn_eval_params params = {
+		.energy_estimate = energy_estimate,
+		.rsrp = -100,
+		.ce_level = LTE_LC_CE_LEVEL_0,
+	};
+
+	TEST_ASSERT_EQUAL(0, send_policy_conn_eval_add(&policy, &params));
+}
+
+static void policy_init(enum send_policy_mode mode)
+{
+	TEST_ASSERT_EQUAL(0, send_policy_init(&policy, mode, types, TYPE_COUNT));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_send_policy_no_history(void)
+{
+	policy_init(SEND_POLICY_THRESHOLD);
+
+	/* Nothing is known about the connection, data is sent. */
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+}
+
+void test_send_policy_threshold(void)
+{
+	policy_init(SEND_POLICY_THRESHOLD);
+
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_INCREASED);
+	TEST_ASSERT_FALSE(send_policy_grant(&policy, GENERIC));
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, BATCH));
+
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_NORMAL);
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+}
+
+void test_send_policy_defer_max(void)
+{
+	policy_init(SEND_POLICY_THRESHOLD);
+
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE);
+
+	for (int i = 0; i < DEFER_MAX; i++) {
+		TEST_ASSERT_FALSE(send_policy_grant(&policy, GENERIC));
+	}
+
+	/* Deferred the maximum number of times, data is sent regardless. */
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+
+	/* The count starts over after a send. */
+	TEST_ASSERT_FALSE(send_policy_grant(&policy, GENERIC));
+}
+
+void test_send_policy_always(void)
+{
+	policy_init(SEND_POLICY_ALWAYS);
+
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE);
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+
+	/* Changing the mode takes effect on the next decision. */
+	TEST_ASSERT_EQUAL(0, send_policy_mode_set(&policy, SEND_POLICY_THRESHOLD));
+	TEST_ASSERT_FALSE(send_policy_grant(&policy, GENERIC));
+}
+
+void test_send_policy_adaptive_short_history(void)
+{
+	policy_init(SEND_POLICY_ADAPTIVE);
+
+	/* The energy thresholds are used until enough history has been collected. */
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_INCREASED);
+	TEST_ASSERT_FALSE(send_policy_grant(&policy, GENERIC));
+
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_NORMAL);
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+}
+
+void test_send_policy_adaptive_constant(void)
+{
+	policy_init(SEND_POLICY_ADAPTIVE);
+
+	/* A device that never sees better conditions does not wait for them. */
+	for (int i = 0; i < CONFIG_DATA_SEND_POLICY_HISTORY_SIZE; i++) {
+		conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_INCREASED);
+	}
+
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+}
+
+void test_send_policy_adaptive_varying(void)
+{
+	policy_init(SEND_POLICY_ADAPTIVE);
+
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_EFFICIENT);
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_EFFICIENT);
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_INCREASED);
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_INCREASED);
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_NORMAL);
+
+	/* Better conditions have been seen recently, generic data waits for them while batch
+	 * data, which accepts any conditions in the history, is sent.
+	 */
+	TEST_ASSERT_FALSE(send_policy_grant(&policy, GENERIC));
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, BATCH));
+
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_EFFICIENT);
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+}
+
+void test_send_policy_outcome(void)
+{
+	uint32_t initial, reduced;
+
+	policy_init(SEND_POLICY_THRESHOLD);
+
+	initial = send_policy_cost_get(&policy, LTE_LC_ENERGY_CONSUMPTION_NORMAL);
+	reduced = send_policy_cost_get(&policy, LTE_LC_ENERGY_CONSUMPTION_REDUCED);
+
+	/* Radio-on time is only learned after a granted send. */
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_NORMAL);
+	send_policy_outcome_add(&policy, 3 * initial);
+	TEST_ASSERT_EQUAL(initial, send_policy_cost_get(&policy, LTE_LC_ENERGY_CONSUMPTION_NORMAL));
+
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+	send_policy_outcome_add(&policy, 3 * initial);
+	TEST_ASSERT_GREATER_THAN(initial,
+				 send_policy_cost_get(&policy, LTE_LC_ENERGY_CONSUMPTION_NORMAL));
+
+	/* Other energy estimates are not affected. */
+	TEST_ASSERT_EQUAL(reduced,
+			  send_policy_cost_get(&policy, LTE_LC_ENERGY_CONSUMPTION_REDUCED));
+}
+
+void test_send_policy_adaptive_learned(void)
+{
+	policy_init(SEND_POLICY_ADAPTIVE);
+
+	for (int i = 0; i < CONFIG_DATA_SEND_POLICY_HISTORY_SIZE; i++) {
+		conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_NORMAL);
+	}
+
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_REDUCED);
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+
+	/* Sending at the reduced energy estimate turns out to keep the radio on for long. The
+	 * radio-on time is learned in all modes.
+	 */
+	TEST_ASSERT_EQUAL(0, send_policy_mode_set(&policy, SEND_POLICY_ALWAYS));
+
+	for (int i = 0; i < 8; i++) {
+		TEST_ASSERT_TRUE(send_policy_grant(&policy, GENERIC));
+		send_policy_outcome_add(&policy, 20000);
+	}
+
+	TEST_ASSERT_EQUAL(0, send_policy_mode_set(&policy, SEND_POLICY_ADAPTIVE));
+
+	TEST_ASSERT_GREATER_THAN(send_policy_cost_get(&policy, LTE_LC_ENERGY_CONSUMPTION_NORMAL),
+				 send_policy_cost_get(&policy, LTE_LC_ENERGY_CONSUMPTION_REDUCED));
+	TEST_ASSERT_FALSE(send_policy_grant(&policy, GENERIC));
+}
+
+void test_send_policy_invalid(void)
+{
+	struct lte_lc_conn_eval_params params = { 0 };
+
+	TEST_ASSERT_EQUAL(-EINVAL, send_policy_init(&policy, SEND_POLICY_MODE_COUNT, types,
+						    TYPE_COUNT));
+	TEST_ASSERT_EQUAL(-EINVAL, send_policy_init(&policy, SEND_POLICY_THRESHOLD, types,
+						    SEND_POLICY_TYPE_COUNT_MAX + 1));
+
+	policy_init(SEND_POLICY_THRESHOLD);
+
+	TEST_ASSERT_EQUAL(-EINVAL, send_policy_mode_set(&policy, SEND_POLICY_MODE_COUNT));
+	TEST_ASSERT_EQUAL(-EINVAL, send_policy_mode_set(&policy, (enum send_policy_mode)-1));
+	TEST_ASSERT_EQUAL(-EINVAL, send_policy_conn_eval_add(&policy, &params));
+	TEST_ASSERT_EQUAL(0, send_policy_cost_get(&policy, 0));
+
+	/* Unknown data types are never deferred. */
+	conn_eval_add(LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE);
+	TEST_ASSERT_TRUE(send_policy_grant(&policy, TYPE_COUNT));
+}
+
+int main(void)
+{
+	(void)unity_main();
+	return 0;
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Replay of connection evaluation traces against the send policies.
+ *
+ * Each trace is a list of connection evaluations, one per data update, in the format that the
+ * send policy logs them at debug level: energy estimate, RSRP and CE level. Traces recorded
+ * from the log of a device can be added next to the synthetic traces below.
+ *
+ * At each step of a trace, new generic, batch and cloud location data is produced and the
+ * policy decides which data is sent. All data that is granted is sent in one connection, and
+ * the radio-on time of the connection is taken from a fixed model of the true radio-on time
+ * at each energy estimate. The radio-on time is reported back to the policy, as the modem
+ * module does with MODEM_EVT_LTE_RRC_IDLE.
+ *
+ * One line is printed per policy and trace, prefixed with REPLAY_PREFIX, with the following
+ * comma separated columns:
+ *
+ *	policy, trace, evaluations, connections, radio-on time in ms,
+ *	mean latency in evaluations (x100), maximum latency in evaluations.
+ *
+ * Latency is the number of evaluations from data is produced until it is sent.
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include "send_policy.h"
+
+#define REPLAY_PREFIX "REPLAY:"
+
+/* Data types, as indexed by the data module. */
+enum {
+	GENERIC = 0,
+	BATCH,
+	CLOUD_LOCATION,
+	TYPE_COUNT,
+};
+
+#define DEFER_MAX 3
+
+/* Default parameters of the data module. */
+static const struct send_policy_type_cfg types[TYPE_COUNT] = {
+	[GENERIC] = {
+		.energy_min = LTE_LC_ENERGY_CONSUMPTION_NORMAL,
+		.percentile = 50,
+		.defer_max = DEFER_MAX,
+	},
+	[BATCH] = {
+		.energy_min = LTE_LC_ENERGY_CONSUMPTION_REDUCED,
+		.percentile = 25,
+		.defer_max = DEFER_MAX,
+	},
+	[CLOUD_LOCATION] = {
+		.energy_min = LTE_LC_ENERGY_CONSUMPTION_NORMAL,
+		.percentile = 75,
+		.defer_max = DEFER_MAX,
+	},
+};
+
+/* Radio-on time of a connection at each energy estimate [ms]. Deliberately different from the
+ * initial values of the policy, so that learning is exercised.
+ */
+static const uint32_t radio_on_ms[] = {
+	[LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 20000,
+	[LTE_LC_ENERGY_CONSUMPTION_INCREASED - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 9000,
+	[LTE_LC_ENERGY_CONSUMPTION_NORMAL - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 5000,
+	[LTE_LC_ENERGY_CONSUMPTION_REDUCED - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 3000,
+	[LTE_LC_ENERGY_CONSUMPTION_EFFICIENT - LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE] = 1500,
+};
+
+struct trace_entry {
+	int8_t energy_estimate;
+	int16_t rsrp;
+	uint8_t ce_level;
+};
+
+struct trace {
+	const char *name;
+	const struct trace_entry *entries;
+	size_t count;
+};
+
+/* Device that stays in poor coverage. Waiting for better conditions only adds latency. */
+static const struct trace_entry basement[] = {
+	{6, -118, 1}, {6, -117, 1}, {6, -119, 1}, {5, -124, 2}, {6, -118, 1}, {6, -116, 1},
+	{6, -118, 1}, {6, -117, 1}, {5, -123, 2}, {6, -118, 1}, {6, -119, 1}, {6, -117, 1},
+	{6, -118, 1}, {5, -125, 2}, {6, -118, 1}, {6, -117, 1}, {6, -116, 1}, {6, -118, 1},
+	{6, -119, 1}, {6, -118, 1}, {5, -124, 2}, {6, -117, 1}, {6, -118, 1}, {6, -118, 1},
+};
+
+/* Device on a vehicle, passing through cells with varying coverage. */
+static const struct trace_entry truck[] = {
+	{9, -82, 0},  {8, -92, 0},  {7, -101, 0}, {6, -112, 1}, {5, -121, 2}, {6, -114, 1},
+	{7, -103, 0}, {8, -94, 0},  {9, -85, 0},  {9, -80, 0},  {8, -90, 0},  {6, -110, 1},
+	{5, -122, 2}, {5, -125, 2}, {6, -115, 1}, {7, -104, 0}, {9, -84, 0},  {8, -93, 0},
+	{7, -100, 0}, {6, -111, 1}, {7, -102, 0}, {9, -83, 0},  {8, -91, 0},  {6, -113, 1},
+	{5, -123, 2}, {6, -116, 1}, {8, -95, 0},  {9, -81, 0},  {7, -99, 0},  {6, -109, 1},
+};
+
+/* Stationary device with good coverage. */
+static const struct trace_entry office[] = {
+	{9, -79, 0}, {9, -80, 0}, {8, -88, 0}, {9, -81, 0}, {9, -79, 0}, {9, -78, 0},
+	{8, -89, 0}, {9, -80, 0}, {9, -82, 0}, {7, -97, 0}, {9, -80, 0}, {9, -79, 0},
+	{9, -81, 0}, {8, -87, 0}, {9, -80, 0}, {9, -79, 0}, {9, -78, 0}, {9, -80, 0},
+};
+
+#define TRACE(_name) { .name = #_name, .entries = _name, .count = ARRAY_SIZE(_name) }
+
+struct replay_result {
+	uint32_t connections;
+	uint32_t radio_on_ms;
+	uint32_t latency_sum;
+	uint32_t latency_max;
+	uint32_t sent;
+};
+
+static const char * const policy_names[] = {
+	[SEND_POLICY_THRESHOLD] = "threshold",
+	[SEND_POLICY_ADAPTIVE] = "adaptive",
+	[SEND_POLICY_ALWAYS] = "always",
+};
+
+static struct send_policy policy;
+
+/* The unity_main is not declared in any header file. It is only defined in the generated test
+ * runner because of ncs' unity configuration. It is therefore declared here to avoid a compiler
+ * warning.
+ */
+extern int unity_main(void);
+
+static void replay(const struct trace *trace, enum send_policy_mode mode,
+		   struct replay_result *result)
+{
+	/* Step at which the oldest unsent data of each type was produced, -1 if none. */
+	int produced[TYPE_COUNT];
+
+	memset(result, 0, sizeof(*result));
+
+	for (size_t i = 0; i < ARRAY_SIZE(produced); i++) {
+		produced[i] = -1;
+	}
+
+	TEST_ASSERT_EQUAL(0, send_policy_init(&policy, mode, types, TYPE_COUNT));
+
+	for (int step = 0; (size_t)step < trace->count; step++) {
+		const struct trace_entry *entry = &trace->entries[step];
+		struct lte_lc_conn_eval_params params = {
+			.energy_estimate = entry->energy_estimate,
+			.rsrp = entry->rsrp,
+			.ce_level = entry->ce_level,
+		};
+		bool connect = false;
+
+		TEST_ASSERT_EQUAL(0, send_policy_conn_eval_add(&policy, &params));
+
+		for (uint8_t type = 0; type < TYPE_COUNT; type++) {
+			uint32_t latency;
+
+			if (produced[type] < 0) {
+				produced[type] = step;
+			}
+
+			if (!send_policy_grant(&policy, type)) {
+				continue;
+			}
+
+			latency = step - produced[type];
+
+			result->latency_sum += latency;
+			result->latency_max = MAX(result->latency_max, latency);
+			result->sent++;
+
+			produced[type] = -1;
+			connect = true;
+		}
+
+		if (connect) {
+			uint32_t time_ms = radio_on_ms[entry->energy_estimate -
+						       LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE];
+
+			result->connections++;
+			result->radio_on_ms += time_ms;
+
+			send_policy_outcome_add(&policy, time_ms);
+		}
+	}
+
+	printk("%s%s,%s,%u,%u,%u,%u,%u\n", REPLAY_PREFIX, policy_names[mode], trace->name,
+	       (uint32_t)trace->count, result->connections, result->radio_on_ms,
+	       result->sent ? (result->latency_sum * 100) / result->sent : 0,
+	       result->latency_max);
+}
+
+static void replay_all(const struct trace *trace, struct replay_result *results)
+{
+	for (int mode = 0; mode < SEND_POLICY_MODE_COUNT; mode++) {
+		replay(trace, mode, &results[mode]);
+
+		/* No data waits longer than the maximum number of deferrals. */
+		TEST_ASSERT_LESS_OR_EQUAL(DEFER_MAX, results[mode].latency_max);
+	}
+
+	/* Sending at every evaluation has the lowest possible latency. */
+	TEST_ASSERT_EQUAL(0, results[SEND_POLICY_ALWAYS].latency_sum);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_replay_basement(void)
+{
+	const struct trace trace = TRACE(basement);
+	struct replay_result results[SEND_POLICY_MODE_COUNT];
+
+	replay_all(&trace, results);
+
+	/* The adaptive policy learns that waiting does not help and does not defer data as
+	 * often as the fixed threshold policy does.
+	 */
+	TEST_ASSERT_LESS_THAN(results[SEND_POLICY_THRESHOLD].latency_sum,
+			      results[SEND_POLICY_ADAPTIVE].latency_sum);
+}
+
+void test_replay_truck(void)
+{
+	const struct trace trace = TRACE(truck);
+	struct replay_result results[SEND_POLICY_MODE_COUNT];
+
+	replay_all(&trace, results);
+
+	/* Deferring data to good coverage saves radio-on time. */
+	TEST_ASSERT_LESS_THAN(results[SEND_POLICY_ALWAYS].radio_on_ms,
+			      results[SEND_POLICY_ADAPTIVE].radio_on_ms);
+}
+
+void test_replay_office(void)
+{
+	const struct trace trace = TRACE(office);
+	struct replay_result results[SEND_POLICY_MODE_COUNT];
+
+	replay_all(&trace, results);
+
+	TEST_ASSERT_LESS_OR_EQUAL(results[SEND_POLICY_ALWAYS].radio_on_ms,
+				  results[SEND_POLICY_ADAPTIVE].radio_on_ms);
+}
+
+int main(void)
+{
+	printk("%spolicy,trace,evaluations,connections,radio_on_ms,latency_mean_x100,"
+	       "latency_max\n", REPLAY_PREFIX);
+
+	(void)unity_main();
+	return 0;
+}